@@ -36,6 +36,46 @@
 #include "fastarchive.h"
 #include <string.h>
 #include <time.h>
+#include <thread>
+
+// Magic number at the end of version 2 archives
+const unsigned char FOOTER_MAGIC[4]={'F','A','v','2'};
+
+void packrecords(const unsigned long* values,const std::vector<int>& bits,int nbyte,int nbit,
+	long nrecord,unsigned char* pdata) {
+
+	// Packs the values of nrecord records into consecutive data records of nbyte bytes.
+	// Gives the same bit sequence as ItemList::bitmap(): the values of a record one
+	// after the other, highest order bit first, right aligned in the record
+
+	long nvalue=bits.size();
+	long r,i,bit;
+	int b;
+
+	memset(pdata,0,nbyte*nrecord);
+
+	for (r=0;r<nrecord;r++) {
+		bit=nbyte*8-nbit;
+		for (i=0;i<nvalue;i++) {
+			unsigned long val=*values++;
+			for (b=bits[i]-1;b>=0;b--,bit++)
+				if ((val>>b)&1) pdata[bit>>3]|=0x80>>(bit&7);
+		}
+		pdata+=nbyte;
+	}
+}
+
+void writeword(FILE* pfile,unsigned long val) {
+
+	// Writes a 4 byte value to file, high order first
+
+	unsigned char buf[4];
+	buf[0]=(unsigned char)(val>>24);
+	buf[1]=(unsigned char)(val>>16);
+	buf[2]=(unsigned char)(val>>8);
+	buf[3]=(unsigned char)val;
+	fwrite(buf,4,1,pfile);
+}
 
 void fail_fastarchive() {
 
@@ -124,6 +164,10 @@ void CFastArchive::newarchive(const char* name) {
 	strcat(filename,filebase);
 	strcat(filename,".bin");
 	nrecord=0;
+	version=VERSION_KEY;
+	valuebits.clear();
+	pending.clear();
+	npending=0;
 	pfile=fopen(filename,"wb");
 	if (!pfile) {
 		printf("CFastArchive::newarchive: could not open %s for output\n",(char*)filename);
@@ -277,7 +321,31 @@ void CFastArchive::storerecord() {
 	}
 
 	indexlist.bitmap();
-	itemlist.bitmap();
+
+	// Keep the values of the data items until there are enough records to
+	// compress a block on each thread (see flushrecords)
+
+	if (valuebits.empty()) {
+		itemlist.firstobj();
+		while (itemlist.isobj) {
+			Element& e=itemlist.getobj();
+			valuebits.insert(valuebits.end(),e.nval,e.nbit);
+			itemlist.nextobj();
+		}
+	}
+
+	itemlist.firstobj();
+	while (itemlist.isobj) {
+		Element& e=itemlist.getobj();
+		for (int i=0;i<e.nval;i++) {
+			unsigned char* buf=e.pbuf[i].buf;
+			unsigned long val=((unsigned long)buf[0]<<24)|((unsigned long)buf[1]<<16)|
+				((unsigned long)buf[2]<<8)|buf[3];
+			if (e.nbit<32) val&=(1UL<<e.nbit)-1;
+			pending.push_back(val);
+		}
+		itemlist.nextobj();
+	}
 
 	long nrecord = static_cast<long>(datalist.nobj);
 	long begin = 0;
@@ -305,7 +373,62 @@ void CFastArchive::storerecord() {
 	DataIndex& ind=datalist.insertobj(begin);
 	ind.initialise(indexlist.nbyte,indexlist.pdata,nrecord);
 
-	fwrite(itemlist.pdata,itemlist.nbyte,1,pfile);
+	if (++npending>=(long)BLOCKSIZE_FASTARCHIVE*nthread) flushrecords();
+}
+
+void CFastArchive::flushrecords() {
+
+	// Compresses the records kept by storerecord, one range of whole blocks on each
+	// thread, and writes them to file in the order they were stored
+
+	if (!npending) return;
+
+	int nbyte=itemlist.nbyte;
+	long nblock=(npending+BLOCKSIZE_FASTARCHIVE-1)/BLOCKSIZE_FASTARCHIVE;
+	long nworker=nthread<nblock ? nthread : nblock;
+	long nvalue=valuebits.size();
+
+	std::vector<unsigned char> packed((size_t)nbyte*npending);
+
+	if (nworker<=1) {
+		packrecords(&pending.front(),valuebits,nbyte,itemlist.nbit,npending,&packed.front());
+	}
+	else {
+		std::vector<std::thread> workers;
+		long first=0;
+		for (long i=0;i<nworker;i++) {
+			long last=(nblock*(i+1)/nworker)*BLOCKSIZE_FASTARCHIVE;
+			if (last>npending) last=npending;
+			workers.push_back(std::thread(packrecords,&pending[first*nvalue],std::cref(valuebits),
+				nbyte,itemlist.nbit,last-first,&packed[first*nbyte]));
+			first=last;
+		}
+		for (size_t i=0;i<workers.size();i++)
+			workers[i].join();
+	}
+
+	fwrite(&packed.front(),packed.size(),1,pfile);
+
+	pending.clear();
+	npending=0;
+}
+
+void CFastArchive::setversion(int v) {
+
+	if (v!=VERSION_KEY && v!=VERSION_KEY_BLOCKINDEX) {
+		printf("CFastArchive::setversion: unknown archive version %d\n",v);
+		exit(99);
+	}
+	if (writing) {
+		printf("CFastArchive::setversion: illegal call after writing commenced\n");
+		exit(99);
+	}
+	version=v;
+}
+
+void CFastArchive::setthreads(int n) {
+
+	nthread=n>1 ? n : 1;
 }
 
 void CFastArchive::closearchive() {
@@ -319,6 +442,8 @@ void CFastArchive::closearchive() {
 		writeheader();
 	}
 
+	flushrecords();
+
 	datalist.firstobj();
 	while (datalist.isobj) {
 		DataIndex& ind=datalist.getobj();
@@ -326,9 +451,15 @@ void CFastArchive::closearchive() {
 		fwrite(ind.pindex,ind.nbyte,1,pfile);
 		datalist.nextobj();
 	}
-	fclose(pfile);
 
-	makesource();
+	if (version==VERSION_KEY_BLOCKINDEX) {
+		writefooter();
+		makesource_blockindex();
+	}
+	else
+		makesource();
+
+	fclose(pfile);
 
 	pfile=NULL;
 	writing=false;
@@ -359,7 +490,7 @@ void CFastArchive::writenumstr(double dval) {
 
 	// Writes value to file as a string
 
-	char numstr[NUMSTRING];
+	char numstr[NUMSTRING]={0}; // zero padded, so the header is the same for the same archive
 	int i;
 
 	if (!pfile) return;
@@ -433,7 +564,7 @@ void CFastArchive::writeheader() {
 	}
 	hptr=pheader;
 
-	writebin(VERSION_KEY,1);
+	writebin(version,1);
 	writebin(hsize,2);
 	writebin(indexlist.nbyte+4,4);
 	writebin(indexlist.nobj,2);
@@ -473,6 +604,28 @@ void CFastArchive::writeheader() {
 	writebin(datalist.nobj,4);
 }
 
+void CFastArchive::writefooter() {
+
+	// Writes the footer of a version 2 archive, after the sorted index:
+	// <bytes>    block index: the key (index record without record number) of the
+	//            first record in each block of BLOCKSIZE_FASTARCHIVE index records
+	// <4 bytes>  number of records in a block
+	// <4 bytes>  number of blocks
+	// <4 bytes>  number of records in archive
+	// <4 bytes>  FOOTER_MAGIC
+
+	long nblock=(datalist.nobj+BLOCKSIZE_FASTARCHIVE-1)/BLOCKSIZE_FASTARCHIVE;
+	long i;
+
+	for (i=0;i<nblock;i++)
+		fwrite(datalist[i*BLOCKSIZE_FASTARCHIVE].pindex,indexlist.nbyte,1,pfile);
+
+	writeword(pfile,BLOCKSIZE_FASTARCHIVE);
+	writeword(pfile,nblock);
+	writeword(pfile,datalist.nobj);
+	fwrite(FOOTER_MAGIC,4,1,pfile);
+}
+
 void CFastArchive::makesource() {
 
 	char filename[MAXFILE];
@@ -945,3 +1098,398 @@ void CFastArchive::makesource() {
 }
 
 
+
+void CFastArchive::makesource_blockindex() {
+
+	// Writes the reader for a version 2 archive, which memory maps the archive file
+	// and finds records through the block index in the footer (see writefooter)
+
+	char filename[MAXFILE];
+	char classname[MAXNAME+1];
+	char allcaps[MAXNAME+1];
+	int i;
+
+	strcpy(filename,dir);
+	strcat(filename,filebase);
+	strcat(filename,".h");
+
+	FILE* out=fopen(filename,"wt");
+	if (!out) {
+		printf("CFastArchive::makesource_blockindex: could not open %s for output\n",(char*)filename);
+		exit(99);
+	}
+
+	strcpy(classname,filebase);
+	if (classname[0]>='a' && classname[0]<='z') classname[0]-='a'-'A';
+	strcpy(allcaps,filebase);
+	for (i=0;i<strlen(allcaps);i++)
+		if (allcaps[i]>='a' && allcaps[i]<='z') allcaps[i]-='a'-'A';
+
+	int nkey=indexlist.nbyte;
+	long nblock=(datalist.nobj+BLOCKSIZE_FASTARCHIVE-1)/BLOCKSIZE_FASTARCHIVE;
+
+	time_t t;
+	time(&t);
+
+	fprintf(out,"//////////////////////////////////////////////////////////////////////////////////////\n");
+	fprintf(out,"// %s.H\n",allcaps);
+	fprintf(out,"// Header file for input from a fast data archive (version 2, with block index)\n");
+	fprintf(out,"// Created automatically by FastArchive on %s//\n",ctime(&t));
+	fprintf(out,"// The following #includes should appear in your source code file:\n//\n");
+	fprintf(out,"//   #include <stdio.h>\n");
+	fprintf(out,"//   #include <stdlib.h>\n");
+	fprintf(out,"//   #include <string.h>\n");
+	fprintf(out,"//   #include \"%s\"\n",filename);
+	fprintf(out,"//\n");
+	fprintf(out,"// Functionality to retrieve data from the archive is provided by class %sArchive.\n",classname);
+	fprintf(out,"// The archive file is memory mapped, and records are found with a binary search on\n");
+	fprintf(out,"// the block index at the end of the file followed by a binary search within the\n");
+	fprintf(out,"// block. The following public functions are provided:\n");
+	fprintf(out,"//\n");
+	fprintf(out,"// bool open(const char* filename)\n");
+	fprintf(out,"//   Attempts to open the specified file as a fast data archive. The format must be\n");
+	fprintf(out,"//   exactly compatible with this version of %s.h (normally the archive and\n",filebase);
+	fprintf(out,"//   header file should have been produced together by the same program using class\n");
+	fprintf(out,"//   CFastArchive). Returns false if the file could not be opened or had format\n");
+	fprintf(out,"//   errors. open() with no argument is equivalent to open(\"%s.bin\").\n",filebase);
+	fprintf(out,"//\n");
+	fprintf(out,"// void close()\n");
+	fprintf(out,"//   Closes the archive (if open).\n");
+	fprintf(out,"//\n");
+	fprintf(out,"// bool rewind()\n");
+	fprintf(out,"//   Sets the file pointer to the first record in the archive file. Returns false if\n");
+	fprintf(out,"//   no archive file is currently open.\n");
+	fprintf(out,"//\n");
+	fprintf(out,"// bool getnext(%s& obj)\n",classname);
+	fprintf(out,"//   Retrieves the next record in the archive file and advances the file pointer to\n");
+	fprintf(out,"//   the next record. Data are written to the member variables of obj. Returns false if\n");
+	fprintf(out,"//   no archive file is currently open or if the file pointer is beyond the last\n");
+	fprintf(out,"//   record. Use rewind() and getnext() to retrieve data sequentially from the archive.\n");
+	fprintf(out,"//\n");
+	fprintf(out,"// bool getindex(%s& obj) const\n",classname);
+	fprintf(out,"//   Searches the archive for a record matching the values specified for the index\n");
+	fprintf(out,"//   item");
+	if (indexlist.nobj>1) fprintf(out, "s");
+	fprintf(out," (");
+
+	for (i=0;i<indexlist.nobj;i++) {
+		Element& e=indexlist[i];
+		fprintf(out,"%s",e.name);
+		if (i==indexlist.nobj-2) fprintf(out," and ");
+		else if (i<indexlist.nobj-2) fprintf(out,", ");
+	}
+
+	fprintf(out,") in obj. If a matching record is found, the data are\n");
+	fprintf(out,"//   written to the member variables of obj. Returns true if the archive was open and\n");
+	fprintf(out,"//   a matching record was found, otherwise false. May be called from several threads\n");
+	fprintf(out,"//   at the same time.\n");
+	fprintf(out,"//\n");
+	fprintf(out,"// long getindices(%s* objs,long n,bool* found) const\n",classname);
+	fprintf(out,"//   Looks up n records at once, as getindex() for each of objs[0] to objs[n-1].\n");
+	fprintf(out,"//   found[i] is set to whether a record matching objs[i] was found. The keys are\n");
+	fprintf(out,"//   searched for in sorted order, so the archive is read from beginning to end.\n");
+	fprintf(out,"//   Returns the number of records found. May be called from several threads at the\n");
+	fprintf(out,"//   same time.\n");
+	fprintf(out,"//\n");
+	fprintf(out,"// Sample program:\n");
+	fprintf(out,"//\n");
+	fprintf(out,"//   %sArchive ark;\n",classname);
+	fprintf(out,"//   %s data;\n",classname);
+	fprintf(out,"//   bool success;\n");
+	fprintf(out,"//\n");
+	fprintf(out,"//   // Look for a record with ");
+
+	for (i=0;i<indexlist.nobj;i++) {
+		Element& e=indexlist[i];
+		fprintf(out,"%s=%g",e.name,e.offset);
+		if (i<indexlist.nobj-1) fprintf(out,", ");
+	}
+
+	fprintf(out,":\n");
+	fprintf(out,"//\n");
+	fprintf(out,"//   success=ark.open(\"%s.bin\");\n",filebase);
+
+	for (i=0;i<indexlist.nobj;i++) {
+		Element& e=indexlist[i];
+		fprintf(out,"//   data.%s=%g;\n",e.name,e.offset);
+	}
+
+	fprintf(out,"//   if (success && ark.getindex(data)) printf(\"Found it!\\n\");\n");
+	fprintf(out,"//   else printf(\"Not found\\n\");\n");
+	fprintf(out,"//\n");
+	fprintf(out,"//   ark.close();\n\n");
+
+	fprintf(out,"#ifndef _MSC_VER\n");
+	fprintf(out,"#include <fcntl.h>\n");
+	fprintf(out,"#include <sys/mman.h>\n");
+	fprintf(out,"#include <sys/stat.h>\n");
+	fprintf(out,"#include <unistd.h>\n");
+	fprintf(out,"#endif\n");
+	fprintf(out,"#include <algorithm>\n");
+	fprintf(out,"#include <vector>\n\n\n");
+
+	fprintf(out,"struct %s {\n\n",classname);
+	fprintf(out,"	// Index part\n\n");
+
+	for (i=0;i<indexlist.nobj;i++)
+		fprintf(out,"	double %s;\n",indexlist[i].name);
+
+	fprintf(out,"\n	// Data part\n\n");
+
+	for (i=0;i<itemlist.nobj;i++)
+		fprintf(out,"	double %s[%d];\n",itemlist[i].name,itemlist[i].nval);
+
+	fprintf(out,"};\n\n\n");
+
+	fprintf(out,"const long %s_NRECORD=%d;\n",allcaps,datalist.nobj);
+	fprintf(out,"const int %s_DATA_LENGTH=%d;\n",allcaps,itemlist.nbyte);
+	fprintf(out,"const int %s_INDEX_LENGTH=%d;\n",allcaps,nkey+4);
+	fprintf(out,"const int %s_HEADERSIZE=%d;\n",allcaps,hsize);
+	fprintf(out,"const long %s_BLOCKSIZE=%d;\n",allcaps,BLOCKSIZE_FASTARCHIVE);
+	fprintf(out,"const long %s_NBLOCK=%ld;\n",allcaps,nblock);
+	fprintf(out,"static const unsigned char %s_HEADER[%s_HEADERSIZE-4]={",allcaps,allcaps);
+
+	for (i=0;i<hsize-4;i++) {
+		if (!(i%20)) fprintf(out,"\n\t");
+		fprintf(out,"0x%02X",(unsigned int)pheader[i]);
+		if (i<hsize-5) fprintf(out,",");
+	}
+	fprintf(out,"};\n\n\n");
+
+	fprintf(out,"class %sArchive {\n\n",classname);
+	fprintf(out,"private:\n\n");
+	fprintf(out,"	const unsigned char* pfile;\n");
+	fprintf(out,"	size_t filesize;\n");
+	fprintf(out,"	long recno;\n\n");
+
+	fprintf(out,"	struct KeyLess {\n");
+	fprintf(out,"		const unsigned char* keys;\n");
+	fprintf(out,"		KeyLess(const unsigned char* keys) : keys(keys) {}\n");
+	fprintf(out,"		bool operator()(long a,long b) const {\n");
+	fprintf(out,"			return memcmp(keys+a*%d,keys+b*%d,%d)<0;\n",nkey,nkey,nkey);
+	fprintf(out,"		}\n");
+	fprintf(out,"	};\n\n");
+
+	fprintf(out,"	static unsigned long readword(const unsigned char* p) {\n");
+	fprintf(out,"		return ((unsigned long)p[0]<<24)|((unsigned long)p[1]<<16)|((unsigned long)p[2]<<8)|p[3];\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	const unsigned char* indexrecord(long n) const {\n");
+	fprintf(out,"		return pfile+%s_HEADERSIZE+(size_t)%s_DATA_LENGTH*%s_NRECORD+(size_t)%s_INDEX_LENGTH*n;\n",
+		allcaps,allcaps,allcaps,allcaps);
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	const unsigned char* blockkey(long b) const {\n");
+	fprintf(out,"		return indexrecord(%s_NRECORD)+(size_t)%d*b;\n",allcaps,nkey);
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	const unsigned char* datarecord(const unsigned char* pindex) const {\n");
+	fprintf(out,"		return pfile+%s_HEADERSIZE+(size_t)%s_DATA_LENGTH*readword(pindex+%d);\n",
+		allcaps,allcaps,nkey);
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	static double getreal(const unsigned char* bits,long& bit,int nbit,double scalar,double offset) {\n\n");
+	fprintf(out,"		unsigned long val=0;\n");
+	fprintf(out,"		for (int i=0;i<nbit;i++,bit++)\n");
+	fprintf(out,"			val=(val<<1)|((bits[bit>>3]>>(7-(bit&7)))&1);\n\n");
+	fprintf(out,"		return val*scalar+offset;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	static bool putkey(unsigned char* key,long& bit,double fval,int nbit,double offset,double scalar) {\n\n");
+	fprintf(out,"		long ival=(long)((fval-offset)/scalar+0.5);\n");
+	fprintf(out,"		if (ival<0 || (double)ival>=(double)(1ULL<<nbit)) return false;\n\n");
+	fprintf(out,"		for (int i=nbit-1;i>=0;i--,bit++)\n");
+	fprintf(out,"			if ((ival>>i)&1) key[bit>>3]|=0x80>>(bit&7);\n\n");
+	fprintf(out,"		return true;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	static bool makekey(const %s& obj,unsigned char* key) {\n\n",classname);
+	fprintf(out,"		long bit=%d;\n",nkey*8-indexlist.nbit);
+	fprintf(out,"		memset(key,0,%d);\n\n",nkey);
+	fprintf(out,"		return ");
+	for (i=0;i<indexlist.nobj;i++) {
+		Element& e=indexlist[i];
+		if (i) fprintf(out," &&\n			");
+		fprintf(out,"putkey(key,bit,obj.%s,%d,%g,%g)",e.name,e.nbit,e.offset,e.scalar);
+	}
+	fprintf(out,";\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	void getrecord(const unsigned char* pindex,%s& obj) const {\n\n",classname);
+	fprintf(out,"		long bit=%d;\n",nkey*8-indexlist.nbit);
+	for (i=0;i<indexlist.nobj;i++) {
+		Element& e=indexlist[i];
+		fprintf(out,"		obj.%s=getreal(pindex,bit,%d,%g,%g);\n",e.name,e.nbit,e.scalar,e.offset);
+	}
+	fprintf(out,"\n");
+	fprintf(out,"		const unsigned char* pdata=datarecord(pindex);\n");
+	fprintf(out,"		bit=%d;\n",itemlist.nbyte*8-itemlist.nbit);
+	for (i=0;i<itemlist.nobj;i++) {
+		Element& e=itemlist[i];
+		fprintf(out,"		for (int i=0;i<%d;i++) obj.%s[i]=getreal(pdata,bit,%d,%g,%g);\n",
+			e.nval,e.name,e.nbit,e.scalar,e.offset);
+	}
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	long findblock(const unsigned char* key,long begin) const {\n\n");
+	fprintf(out,"		// Last block, from begin, with a first key not greater than key (or begin-1)\n\n");
+	fprintf(out,"		long end=%s_NBLOCK;\n",allcaps);
+	fprintf(out,"		while (begin<end) {\n");
+	fprintf(out,"			long middle=(begin+end)/2;\n");
+	fprintf(out,"			if (memcmp(blockkey(middle),key,%d)<=0) begin=middle+1;\n",nkey);
+	fprintf(out,"			else end=middle;\n");
+	fprintf(out,"		}\n\n");
+	fprintf(out,"		return begin-1;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	long find(const unsigned char* key,long block) const {\n\n");
+	fprintf(out,"		// Index record with key in block, or -1\n\n");
+	fprintf(out,"		long begin=block*%s_BLOCKSIZE;\n",allcaps);
+	fprintf(out,"		long end=std::min(begin+%s_BLOCKSIZE,%s_NRECORD);\n",allcaps,allcaps);
+	fprintf(out,"		while (begin<end) {\n");
+	fprintf(out,"			long middle=(begin+end)/2;\n");
+	fprintf(out,"			int c=memcmp(indexrecord(middle),key,%d);\n",nkey);
+	fprintf(out,"			if (c<0) begin=middle+1;\n");
+	fprintf(out,"			else if (c>0) end=middle;\n");
+	fprintf(out,"			else return middle;\n");
+	fprintf(out,"		}\n\n");
+	fprintf(out,"		return -1;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	%sArchive(const %sArchive&);\n",classname,classname);
+	fprintf(out,"	%sArchive& operator=(const %sArchive&);\n\n",classname,classname);
+
+	fprintf(out,"public:\n\n");
+
+	fprintf(out,"	%sArchive() {\n",classname);
+	fprintf(out,"		pfile=NULL;\n");
+	fprintf(out,"		filesize=0;\n");
+	fprintf(out,"		recno=0;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	~%sArchive() {\n",classname);
+	fprintf(out,"		close();\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	bool open(const char* filename) {\n\n");
+	fprintf(out,"		close();\n\n");
+	fprintf(out,"#ifdef _MSC_VER\n");
+	fprintf(out,"		FILE* in=fopen(filename,\"rb\");\n");
+	fprintf(out,"		if (!in) {\n");
+	fprintf(out,"			printf(\"Could not open %%s for input\\n\",filename);\n");
+	fprintf(out,"			return false;\n");
+	fprintf(out,"		}\n");
+	fprintf(out,"		fseek(in,0,SEEK_END);\n");
+	fprintf(out,"		filesize=ftell(in);\n");
+	fprintf(out,"		::rewind(in);\n");
+	fprintf(out,"		unsigned char* buffer=new unsigned char[filesize];\n");
+	fprintf(out,"		if (fread(buffer,1,filesize,in)!=filesize) filesize=0;\n");
+	fprintf(out,"		fclose(in);\n");
+	fprintf(out,"		pfile=buffer;\n");
+	fprintf(out,"#else\n");
+	fprintf(out,"		int fd=::open(filename,O_RDONLY);\n");
+	fprintf(out,"		if (fd==-1) {\n");
+	fprintf(out,"			printf(\"Could not open %%s for input\\n\",filename);\n");
+	fprintf(out,"			return false;\n");
+	fprintf(out,"		}\n");
+	fprintf(out,"		struct stat info;\n");
+	fprintf(out,"		void* mapped=MAP_FAILED;\n");
+	fprintf(out,"		if (fstat(fd,&info)==0 && info.st_size>0) {\n");
+	fprintf(out,"			filesize=info.st_size;\n");
+	fprintf(out,"			mapped=mmap(0,filesize,PROT_READ,MAP_SHARED,fd,0);\n");
+	fprintf(out,"		}\n");
+	fprintf(out,"		::close(fd);\n");
+	fprintf(out,"		if (mapped==MAP_FAILED) {\n");
+	fprintf(out,"			printf(\"Could not map %%s into memory\\n\",filename);\n");
+	fprintf(out,"			filesize=0;\n");
+	fprintf(out,"			return false;\n");
+	fprintf(out,"		}\n");
+	fprintf(out,"		pfile=(const unsigned char*)mapped;\n");
+	fprintf(out,"#endif\n\n");
+
+	fprintf(out,"		const unsigned char* pfooter=pfile+filesize-16;\n\n");
+	fprintf(out,"		if (filesize!=(size_t)%s_HEADERSIZE+(size_t)(%s_DATA_LENGTH+%s_INDEX_LENGTH)*%s_NRECORD+\n",
+		allcaps,allcaps,allcaps,allcaps);
+	fprintf(out,"				(size_t)%d*%s_NBLOCK+16 ||\n",nkey,allcaps);
+	fprintf(out,"			memcmp(pfile,%s_HEADER,%s_HEADERSIZE-4) ||\n",allcaps,allcaps);
+	fprintf(out,"			readword(pfooter)!=(unsigned long)%s_BLOCKSIZE ||\n",allcaps);
+	fprintf(out,"			readword(pfooter+4)!=(unsigned long)%s_NBLOCK ||\n",allcaps);
+	fprintf(out,"			readword(pfooter+8)!=(unsigned long)%s_NRECORD ||\n",allcaps);
+	fprintf(out,"			memcmp(pfooter+12,\"FAv2\",4)) {\n");
+	fprintf(out,"			printf(\"Format of %%s incompatible with this version of %s.h\\n\",filename);\n",filebase);
+	fprintf(out,"			close();\n");
+	fprintf(out,"			return false;\n");
+	fprintf(out,"		}\n\n");
+	fprintf(out,"		recno=0;\n\n");
+	fprintf(out,"		return true;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	bool open() {\n");
+	fprintf(out,"		return open(\"%s.bin\");\n",filebase);
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	void close() {\n");
+	fprintf(out,"		if (pfile) {\n");
+	fprintf(out,"#ifdef _MSC_VER\n");
+	fprintf(out,"			delete[] pfile;\n");
+	fprintf(out,"#else\n");
+	fprintf(out,"			munmap((void*)pfile,filesize);\n");
+	fprintf(out,"#endif\n");
+	fprintf(out,"			pfile=NULL;\n");
+	fprintf(out,"			filesize=0;\n");
+	fprintf(out,"		}\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	bool rewind() {\n\n");
+	fprintf(out,"		if (!pfile) return false;\n\n");
+	fprintf(out,"		recno=0;\n\n");
+	fprintf(out,"		return true;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	bool getnext(%s& obj) {\n\n",classname);
+	fprintf(out,"		if (!pfile || recno>=%s_NRECORD) return false;\n\n",allcaps);
+	fprintf(out,"		getrecord(indexrecord(recno++),obj);\n\n");
+	fprintf(out,"		return true;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	bool getindex(%s& obj) const {\n\n",classname);
+	fprintf(out,"		unsigned char key[%d];\n",nkey);
+	fprintf(out,"		if (!pfile || !makekey(obj,key)) return false;\n\n");
+	fprintf(out,"		long block=findblock(key,0);\n");
+	fprintf(out,"		long n=block>=0 ? find(key,block) : -1;\n");
+	fprintf(out,"		if (n<0) return false;\n\n");
+	fprintf(out,"		getrecord(indexrecord(n),obj);\n\n");
+	fprintf(out,"		return true;\n");
+	fprintf(out,"	}\n\n");
+
+	fprintf(out,"	long getindices(%s* objs,long n,bool* found) const {\n\n",classname);
+	fprintf(out,"		std::vector<unsigned char> keys(%d*(n>0 ? n : 1));\n",nkey);
+	fprintf(out,"		std::vector<long> order;\n");
+	fprintf(out,"		long i,nfound=0;\n\n");
+	fprintf(out,"		for (i=0;i<n;i++) {\n");
+	fprintf(out,"			found[i]=false;\n");
+	fprintf(out,"			if (pfile && makekey(objs[i],&keys[i*%d])) order.push_back(i);\n",nkey);
+	fprintf(out,"		}\n\n");
+	fprintf(out,"		std::sort(order.begin(),order.end(),KeyLess(&keys.front()));\n\n");
+	fprintf(out,"		// Keys are increasing, so each block is at or after the previous one\n");
+	fprintf(out,"		long block=0;\n");
+	fprintf(out,"		for (i=0;i<(long)order.size();i++) {\n");
+	fprintf(out,"			const unsigned char* key=&keys[order[i]*%d];\n",nkey);
+	fprintf(out,"			block=findblock(key,block);\n");
+	fprintf(out,"			if (block<0) {\n");
+	fprintf(out,"				block=0;\n");
+	fprintf(out,"				continue;\n");
+	fprintf(out,"			}\n");
+	fprintf(out,"			long r=find(key,block);\n");
+	fprintf(out,"			if (r>=0) {\n");
+	fprintf(out,"				getrecord(indexrecord(r),objs[order[i]]);\n");
+	fprintf(out,"				found[order[i]]=true;\n");
+	fprintf(out,"				nfound++;\n");
+	fprintf(out,"			}\n");
+	fprintf(out,"		}\n\n");
+	fprintf(out,"		return nfound;\n");
+	fprintf(out,"	}\n");
+	fprintf(out,"};\n");
+
+	fclose(out);
+}
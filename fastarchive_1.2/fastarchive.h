@@ -27,6 +27,8 @@
 ///////////////////////////////////////////////////////////////////////////////////////
 
 
+#include <vector>
+
 ///////////////////////////////////////////////////////////////////////////////////////
 // Class CFastArchive
 // Provides functionality for WRITING to a fast archive.
@@ -67,12 +69,29 @@
 //   Store the current record in the archive file. The values of all the index item(s)
 //   should have been previously set with setindex(). The values of all the item(s)
 //   should have been previously set with setitem().
+//
+// void setversion(int version);
+//   Selects the format of the archive, must be called after newarchive() and before
+//   the first call to storerecord(). Version 1 (the default) is the original format.
+//   Version 2 archives have a block index (the first key of every BLOCKSIZE_FASTARCHIVE
+//   records in the sorted index) in a footer at the end of the file, and the generated
+//   reader memory maps the archive and looks up records with a binary search on the
+//   block index and then within the block. The version 2 reader can also look up a
+//   list of keys in one call, and lookups may be done from several threads at once.
+//
+// void setthreads(int nthread);
+//   Number of threads used to compress (bit pack) the data records. Records are kept
+//   in memory until there are BLOCKSIZE_FASTARCHIVE records for each thread, the
+//   blocks are then compressed in parallel and written in the order they were stored.
+//   The archive is the same regardless of the number of threads.
 	
 const int MAXFILE=1024;
 const int MAXNAME=64;
 const int NUMSTRING=32;
 const int SEGSIZE_FASTARCHIVE=16;
 const unsigned char VERSION_KEY=1; // Change for updated versions
+const unsigned char VERSION_KEY_BLOCKINDEX=2; // Version with block index and mapped reader
+const int BLOCKSIZE_FASTARCHIVE=256; // Records per block in compression and block index
 
 // Flags
 const int FA_ALLOW_OVERFLOW=0x0001;
@@ -487,18 +506,29 @@ private:
 	unsigned char* pheader;
 	unsigned char* hptr;
 	long hsize;
+	unsigned char version;
+	int nthread;
+	std::vector<int> valuebits; // number of bits for each value in a data record
+	std::vector<unsigned long> pending; // values of stored records not yet written
+	long npending;
 
 	Element& finditem(ItemList& list,const char*& name);
 	int compare(unsigned char* a,unsigned char* b);
 	bool alphanumeric(const char* name);
 	void makesource();
+	void makesource_blockindex();
 	void writebin(long val,int nbyte);
 	void writenumstr(double dval);
 	void writeheader();
+	void writefooter();
+	void flushrecords();
 
 public:
 	CFastArchive() {
 		pfile=NULL;
+		version=VERSION_KEY;
+		nthread=1;
+		npending=0;
 	}
 	void closearchive();
 	~CFastArchive() {
@@ -510,4 +540,6 @@ public:
 	void setindex(const char* name,double val);
 	void setitem(const char* name,double* val);
 	void storerecord();
+	void setversion(int version);
+	void setthreads(int nthread);
 };
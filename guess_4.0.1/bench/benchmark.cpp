@@ -0,0 +1,52 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file benchmark.cpp
+/// \brief Timing of single calls to the model's kernels, for guess_bench
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "benchmark.h"
+
+double BenchmarkResult::calls_per_second() const {
+	return ns_per_call > 0 ? 1e9 / ns_per_call : 0;
+}
+
+std::string json_string(const std::string& s) {
+	std::string quoted = "\"";
+	for (size_t i = 0; i < s.size(); i++) {
+		const unsigned char c = s[i];
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			quoted += escaped;
+		}
+		else {
+			quoted += c;
+		}
+	}
+	return quoted + "\"";
+}
+
+void write_json_results(FILE* out, const std::vector<BenchmarkResult>& results) {
+	fprintf(out, "[");
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		fprintf(out, "%s\n    {\"name\": %s, \"calls\": %lld, \"seconds\": %.6g, "
+		        "\"ns_per_call\": %.6g, \"min_ns_per_call\": %.6g, \"max_ns_per_call\": %.6g, "
+		        "\"calls_per_s\": %.6g}",
+		        i > 0 ? "," : "", json_string(r.name).c_str(), r.calls, r.seconds,
+		        r.ns_per_call, r.min_ns_per_call, r.max_ns_per_call, r.calls_per_second());
+	}
+	fprintf(out, "\n  ]");
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file benchmark.h
+/// \brief Timing of single calls to the model's kernels, for guess_bench
+///
+/// A kernel is timed in batches of calls. The state it works on is reset
+/// between batches (untimed), so kernels which change their inputs, like
+/// the soil water and SOM pools, see about the same state in every run.
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_BENCHMARK_H
+#define LPJ_GUESS_BENCHMARK_H
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// Settings common to all benchmarks
+struct BenchmarkSettings {
+	/// Timed wall time per benchmark (s)
+	double seconds;
+
+	/// Number of samples the time is split into
+	/** The reported time per call is the median over the samples. */
+	int samples;
+};
+
+/// Timing of one kernel
+struct BenchmarkResult {
+	std::string name;
+
+	/// Number of timed calls
+	long long calls;
+
+	/// Total timed wall time (s)
+	double seconds;
+
+	/// Median time per call over the samples (ns)
+	double ns_per_call;
+
+	/// Fastest and slowest sample (ns per call)
+	double min_ns_per_call;
+	double max_ns_per_call;
+
+	double calls_per_second() const;
+};
+
+/// Times a kernel
+/** \param name     Name of the benchmark in the output
+ *  \param kernel   Function object making one call to the kernel
+ *  \param reset    Function object resetting the state the kernel works on,
+ *                  called before each batch and not timed
+ *  \param batch    Number of calls between resets
+ *  \param settings How long to run
+ */
+template<typename Kernel, typename Reset>
+BenchmarkResult run_benchmark(const char* name, Kernel kernel, Reset reset, int batch,
+                              const BenchmarkSettings& settings) {
+
+	typedef std::chrono::steady_clock clock;
+
+	const int samples = std::max(settings.samples, 1);
+	const clock::duration sample_time =
+		std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(settings.seconds / samples));
+
+	BenchmarkResult result;
+	result.name = name;
+	result.calls = 0;
+	result.seconds = 0;
+
+	std::vector<double> ns_per_call;
+
+	// The first sample warms up caches and branch predictors and isn't counted
+	for (int sample = -1; sample < samples; sample++) {
+
+		long long calls = 0;
+		clock::duration elapsed = clock::duration::zero();
+
+		while (elapsed < sample_time || calls == 0) {
+			reset();
+
+			const clock::time_point start = clock::now();
+			for (int i = 0; i < batch; i++) {
+				kernel();
+			}
+			elapsed += clock::now() - start;
+			calls += batch;
+		}
+
+		if (sample >= 0) {
+			const double seconds = std::chrono::duration<double>(elapsed).count();
+			ns_per_call.push_back(seconds * 1e9 / calls);
+			result.calls += calls;
+			result.seconds += seconds;
+		}
+	}
+
+	std::sort(ns_per_call.begin(), ns_per_call.end());
+	result.ns_per_call = ns_per_call[ns_per_call.size() / 2];
+	result.min_ns_per_call = ns_per_call.front();
+	result.max_ns_per_call = ns_per_call.back();
+
+	return result;
+}
+
+/// Does nothing, for kernels which don't change their inputs
+struct NoReset {
+	void operator()() const {}
+};
+
+/// Quotes and escapes a string for JSON
+std::string json_string(const std::string& s);
+
+/// Writes the results as a JSON array of objects, one per benchmark
+void write_json_results(FILE* out, const std::vector<BenchmarkResult>& results);
+
+#endif // LPJ_GUESS_BENCHMARK_H
@@ -0,0 +1,123 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file fixture.cpp
+/// \brief A grid cell with realistic vegetation and soil state, for guess_bench
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "fixture.h"
+#include "framework.h"
+#include "driver.h"
+#include <algorithm>
+
+namespace {
+
+// The site: southern Sweden, medium textured soil (see soilparameters)
+const double LON = 13.25;
+const double LAT = 55.75;
+const int SOILCODE = 2;
+
+// Monthly climate, roughly the 1961-1990 means for the site
+const double MTEMP[12] = { -0.8, -0.9, 1.8, 5.9, 11.1, 15.0, 16.5, 16.2, 12.8, 8.7, 4.1, 0.9 };
+const double MPREC[12] = { 46, 30, 39, 40, 42, 52, 67, 64, 66, 55, 64, 56 };
+const double MWET[12]  = { 17, 13, 14, 13, 12, 12, 13, 13, 15, 15, 17, 17 };
+const double MSUN[12]  = { 18, 27, 32, 41, 51, 50, 48, 47, 40, 31, 21, 15 };
+
+/// Atmospheric CO2 concentration (ppmv)
+const double CO2 = 370;
+
+/// Nitrogen deposition (kgN/ha/year)
+const double NDEP = 10;
+
+}
+
+BenchFixture::BenchFixture(int years, int day) {
+
+	if (run_landcover || run_landform) {
+		fail("guess_bench doesn't support run_landcover or run_landform");
+	}
+
+	date.init(1);
+
+	std::copy(MPREC, MPREC + 12, mprec);
+	std::copy(MWET, MWET + 12, mwet);
+
+	// Same as the framework does for each grid cell, and the
+	// input modules in getgridcell
+	gridcell = std::auto_ptr<Gridcell>(new Gridcell);
+	gridcell->set_coordinates(LON, LAT);
+	gridcell->climate.instype = SUNSHINE;
+	soilparameters(gridcell->soiltype, SOILCODE);
+	gridcell->climate.initdrivers(LAT);
+
+	// The stand's climate was cloned before the coordinates were known
+	get_stand().set_local_climate();
+	get_stand().local_climate.instype = SUNSHINE;
+
+	// Daily forcing, as the demo input module makes it
+	interp_monthly_means_conserve(MTEMP, dtemp);
+	interp_monthly_means_conserve(MSUN, dsun, 0, 100);
+
+	long seed = gridcell->seed;
+	prdaily(mprec, dprec, mwet, seed);
+
+	day = std::min(std::max(day, 0), date.year_length() - 1);
+
+	while (true) {
+		set_climate();
+		simulate_day(*gridcell, 0, 0);
+
+		if (date.year >= years - 1 && date.day == day) {
+			break;
+		}
+
+		date.next();
+	}
+}
+
+Gridcell& BenchFixture::get_gridcell() {
+	return *gridcell;
+}
+
+Stand& BenchFixture::get_stand() {
+	return *gridcell->begin();
+}
+
+const double* BenchFixture::get_mprec() const {
+	return mprec;
+}
+
+const double* BenchFixture::get_mwet() const {
+	return mwet;
+}
+
+void BenchFixture::set_climate() {
+
+	Climate& climate = gridcell->climate;
+
+	climate.temp = dtemp[date.day];
+	climate.prec = dprec[date.day];
+	climate.insol = dsun[date.day];
+	climate.co2 = CO2;
+	climate.dndep = NDEP / (365.0 * 10000.0);
+	climate.dtr = 0;
+
+	// No local differences within the grid cell
+	for (Gridcell::iterator itr = gridcell->begin(); itr != gridcell->end(); ++itr) {
+		Climate& local_climate = (*itr).local_climate;
+
+		local_climate.temp = climate.temp;
+		local_climate.prec = climate.prec;
+		local_climate.insol = climate.insol;
+		local_climate.co2 = climate.co2;
+		local_climate.dndep = climate.dndep;
+		local_climate.dtr = climate.dtr;
+	}
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file fixture.h
+/// \brief A grid cell with realistic vegetation and soil state, for guess_bench
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_BENCH_FIXTURE_H
+#define LPJ_GUESS_BENCH_FIXTURE_H
+
+#include "guess.h"
+#include <memory>
+
+/// A grid cell grown by the model itself from synthetic climate
+/** The climate is the same seasonal cycle every year, for a temperate
+ *  site with medium textured soil, with daily precipitation from the
+ *  weather generator (prdaily) and a fixed seed. The vegetation and soil
+ *  are grown by running the model's daily loop (simulate_day) for a number
+ *  of years, so the patches get a realistic mix of PFTs, cohorts and soil
+ *  pools, and the result is the same each time.
+ *
+ *  The simulation stops at the end of a given day of the last year, which
+ *  remains the current date, so the kernels see the state of that day.
+ *
+ *  The PFTs and settings come from the instruction file, which must have
+ *  been read. Land cover and landforms are not supported.
+ */
+class BenchFixture {
+public:
+	/// Grows the grid cell
+	/** \param years Number of years to simulate before the benchmarks
+	 *  \param day   Day of the last year to stop at (0-364)
+	 */
+	BenchFixture(int years, int day);
+
+	Gridcell& get_gridcell();
+
+	/// The (only) stand of the grid cell
+	Stand& get_stand();
+
+	/// Monthly precipitation (mm) and number of wet days, as given to prdaily
+	const double* get_mprec() const;
+	const double* get_mwet() const;
+
+private:
+	/// Sets today's forcing data on the grid cell and stand climate
+	void set_climate();
+
+	std::auto_ptr<Gridcell> gridcell;
+
+	double mprec[12];
+	double mwet[12];
+
+	double dtemp[Date::MAX_YEAR_LENGTH];
+	double dprec[Date::MAX_YEAR_LENGTH];
+	double dsun[Date::MAX_YEAR_LENGTH];
+
+	// Not copyable
+	BenchFixture(const BenchFixture&);
+	BenchFixture& operator=(const BenchFixture&);
+};
+
+#endif // LPJ_GUESS_BENCH_FIXTURE_H
@@ -0,0 +1,378 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file main.cpp
+/// \brief Main module for guess_bench, micro-benchmarks of the model's kernels
+///
+/// Times single calls to the functions which dominate the run time of the
+/// daily simulation, on the state of a grid cell grown by the model itself
+/// (see BenchFixture). The results are written as JSON, so the effect of
+/// an optimisation can be measured and compared between builds.
+///
+/// Usage:
+///
+///   guess_bench [-input <module>] [-years <n>] [-day <n>] [-time <seconds>]
+///               [-samples <n>] [-filter <name>] [-output <file>] <ins-file>
+///
+/// For instance, from the data/ins directory:
+///
+///   guess_bench -input demo global_demo.ins
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "guess.h"
+#include "benchmark.h"
+#include "fixture.h"
+#include "inputmodule.h"
+#include "outputmodule.h"
+#include "driver.h"
+#include "canexch.h"
+#include "soilwater.h"
+#include "somdynam.h"
+#include "ncompete.h"
+#include "bvoc.h"
+#include "archive.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace {
+
+/// Number of calls per batch for kernels which don't change their inputs
+const int BATCH = 1000;
+
+/// Arguments for a call to photosynthesis or assimilation_wstress,
+/// taken from an individual in the fixture
+struct PhotosynthesisCall {
+	const Pft* pft;
+	const Climate* climate;
+	double fpar;
+	double fpc;
+	double gcbase;
+	double vmax;
+	double nactive;
+};
+
+/// Serialized soil of each patch, to undo what the soil kernels do
+class SoilState {
+public:
+	SoilState(Stand& s)
+		: stand(s) {
+		for (unsigned int p = 0; p < stand.npatch(); p++) {
+			std::ostringstream os;
+			ArchiveOutStream aos(os);
+			stand[p].soil.serialize(aos);
+			states.push_back(os.str());
+		}
+	}
+
+	void operator()() {
+		for (unsigned int p = 0; p < stand.npatch(); p++) {
+			std::istringstream is(states[p]);
+			ArchiveInStream ais(is);
+			stand[p].soil.serialize(ais);
+		}
+	}
+
+private:
+	Stand& stand;
+	std::vector<std::string> states;
+};
+
+/// Whether the benchmark with the given name should run
+bool selected(const char* name, const std::string& filter) {
+	return filter.empty() || std::string(name).find(filter) != std::string::npos;
+}
+
+void print_usage(const char* command_name) {
+	fprintf(stderr, "\nUsage: %s [-input <module_name>] [-years <n>] [-day <n>] [-time <seconds>] "
+	        "[-samples <n>] [-filter <name>] [-output <file>] <instruction-script-filename>\n\n"
+	        "  -input    input module whose parameters the instruction file sets (default cru_ncep)\n"
+	        "  -years    number of years to grow the vegetation before the benchmarks (default 100)\n"
+	        "  -day      day of the last year whose state is used (default 195, mid-July)\n"
+	        "  -time     timed seconds per benchmark (default 1)\n"
+	        "  -samples  number of samples per benchmark, the median is reported (default 5)\n"
+	        "  -filter   only run the benchmarks whose names contain this string\n"
+	        "  -output   file for the JSON results (default guess_bench.json)\n",
+	        command_name);
+	exit(EXIT_FAILURE);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	set_shell(new CommandLineShell("guess_bench.log"));
+
+	std::string input_module_name = "cru_ncep";
+	std::string insfile;
+	std::string filter;
+	std::string output_file = "guess_bench.json";
+	int years = 100;
+	int day = 195;
+
+	BenchmarkSettings settings;
+	settings.seconds = 1;
+	settings.samples = 5;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string option = argv[i];
+		const bool has_value = i+1 < argc;
+
+		if (option == "-input" && has_value) {
+			input_module_name = argv[++i];
+		}
+		else if (option == "-years" && has_value) {
+			years = atoi(argv[++i]);
+		}
+		else if (option == "-day" && has_value) {
+			day = atoi(argv[++i]);
+		}
+		else if (option == "-time" && has_value) {
+			settings.seconds = atof(argv[++i]);
+		}
+		else if (option == "-samples" && has_value) {
+			settings.samples = atoi(argv[++i]);
+		}
+		else if (option == "-filter" && has_value) {
+			filter = argv[++i];
+		}
+		else if (option == "-output" && has_value) {
+			output_file = argv[++i];
+		}
+		else if (option[0] != '-' && insfile.empty()) {
+			insfile = option;
+		}
+		else {
+			print_usage(argv[0]);
+		}
+	}
+
+	if (years < 1 || settings.seconds <= 0 || settings.samples < 1 || insfile.empty()) {
+		print_usage(argv[0]);
+	}
+
+	// The input and output modules declare parameters which may be set in
+	// the instruction file, so they need to exist when it's read
+	std::auto_ptr<InputModule> input_module(InputModuleRegistry::get_instance().create_input_module(input_module_name.c_str()));
+	GuessOutput::OutputModuleContainer output_modules;
+	GuessOutput::OutputModuleRegistry::get_instance().create_all_modules(output_modules);
+
+	read_instruction_file(insfile.c_str());
+
+	if (ifbvoc) {
+		initbvoc();
+	}
+
+	if (date.subdaily > 1) {
+		fail("guess_bench only supports daily mode");
+	}
+
+	dprintf("Growing vegetation for %d years\n", years);
+
+	BenchFixture fixture(years, day);
+	Stand& stand = fixture.get_stand();
+	const Date today = date;
+
+	// Arguments for the individual level kernels, from all individuals
+	// in all patches
+	std::vector<PhotosynthesisCall> phot_calls;
+	std::vector<PhotosynthesisCall> wstress_calls;
+
+	// Individuals competing for nitrogen in each patch, and the nitrogen
+	// available to them
+	std::vector<std::vector<NCompetingIndividual> > ncompeting(stand.npatch());
+	std::vector<double> nmass_avail(stand.npatch());
+
+	// Fraction of each patch subject to evaporation from the soil surface
+	std::vector<double> fevap(stand.npatch());
+
+	for (unsigned int p = 0; p < stand.npatch(); p++) {
+		Patch& patch = stand[p];
+		Vegetation& vegetation = patch.vegetation;
+
+		double fpc_phen_total = 0;
+		double ndemand_total = 0;
+
+		for (unsigned int i = 0; i < vegetation.nobj; i++) {
+			Individual& indiv = vegetation[i];
+
+			PhotosynthesisCall call;
+			call.pft = &indiv.pft;
+			call.climate = &patch.get_climate();
+			call.fpar = indiv.fpar;
+			call.fpc = indiv.fpc;
+			call.gcbase = patch.pft[indiv.pft.id].gcbase;
+			call.vmax = indiv.photosynthesis.vm;
+			call.nactive = indiv.nactive / indiv.nextin;
+
+			phot_calls.push_back(call);
+
+			// npp only calls assimilation_wstress for water stressed individuals
+			// with leaves. If the PFT isn't stressed today, use a conductance
+			// which allows half the unstressed assimilation (see gpterm).
+			if (indiv.fpc > 0 && indiv.fpar > 0 && indiv.photosynthesis.adtmm > 0) {
+				if (negligible(call.gcbase)) {
+					const Climate& climate = patch.get_climate();
+					call.gcbase = 0.5 * 1.6 / CO2_CONV / 3600 * indiv.photosynthesis.adtmm / indiv.fpc /
+						climate.co2 / (1 - indiv.pft.lambda_max) / climate.daylength;
+				}
+				wstress_calls.push_back(call);
+			}
+
+			NCompetingIndividual competing;
+			competing.ndemand = indiv.ndemand;
+			competing.strength = indiv.densindiv > 0 ? nitrogen_uptake_strength(indiv) : 0;
+			competing.fnuptake = 1;
+			ncompeting[p].push_back(competing);
+
+			fpc_phen_total += indiv.fpc_today();
+			ndemand_total += indiv.ndemand;
+		}
+
+		// As in vmax_nitrogen_stress, but ncompete is only called when the
+		// demand exceeds what's available, so make sure it does
+		double avail = patch.soil.nmass_avail * min(1.0, patch.fpc_total) *
+			(patch.soil.wcont[0] * 0.9 + patch.soil.wcont[1] * 0.1);
+		nmass_avail[p] = min(avail, 0.5 * ndemand_total);
+
+		fevap[p] = max(1.0 - fpc_phen_total, 0.0);
+	}
+
+	dprintf("Benchmarking on day %d of year %d: %d patches, %d individuals\n\n",
+	        today.day, today.year + 1, (int)stand.npatch(), (int)phot_calls.size());
+
+	if (phot_calls.empty()) {
+		fail("No vegetation to benchmark on, try more years");
+	}
+
+	std::vector<BenchmarkResult> results;
+
+	// Round-robin counters for the kernels cycling through patches or individuals
+	size_t next = 0;
+	unsigned int next_patch = 0;
+
+	PhotosynthesisResult phot;
+	double lambda = 0;
+
+	if (selected("photosynthesis", filter)) {
+		results.push_back(run_benchmark("photosynthesis", [&]() {
+			const PhotosynthesisCall& call = phot_calls[next++ % phot_calls.size()];
+			const Climate& climate = *call.climate;
+			photosynthesis(climate.co2, climate.temp, climate.par, climate.daylength,
+			               call.fpar, call.pft->lambda_max, *call.pft,
+			               call.nactive, ifnlim, phot, -1);
+		}, NoReset(), BATCH, settings));
+	}
+
+	if (selected("assimilation_wstress", filter) && !wstress_calls.empty()) {
+		results.push_back(run_benchmark("assimilation_wstress", [&]() {
+			const PhotosynthesisCall& call = wstress_calls[next++ % wstress_calls.size()];
+			const Climate& climate = *call.climate;
+			assimilation_wstress(*call.pft, climate.co2, climate.temp, climate.par,
+			                     climate.daylength, call.fpar, call.fpc, call.gcbase,
+			                     call.vmax, phot, lambda, call.nactive, ifnlim);
+		}, NoReset(), BATCH, settings));
+	}
+
+	if (selected("fpar", filter)) {
+		results.push_back(run_benchmark("fpar", [&]() {
+			fpar(stand[next_patch++ % stand.npatch()]);
+		}, NoReset(), BATCH, settings));
+	}
+
+	if (selected("daylengthinsoleet", filter)) {
+		// Through all days of the year, so the per-day cache in
+		// Climate is filled as in a normal run
+		Climate& climate = stand.local_climate;
+		results.push_back(run_benchmark("daylengthinsoleet", [&]() {
+			date.day = (date.day + 1) % date.year_length();
+			daylengthinsoleet(climate);
+		}, NoReset(), BATCH, settings));
+
+		date = today;
+		daylengthinsoleet(climate);
+	}
+
+	if (selected("soiltemp", filter)) {
+		results.push_back(run_benchmark("soiltemp", [&]() {
+			Patch& patch = stand[next_patch++ % stand.npatch()];
+			soiltemp(patch.get_climate(), patch.soil);
+		}, NoReset(), BATCH, settings));
+	}
+
+	if (selected("hydrology_lpjf", filter)) {
+		// Repeated days with the same climate, reset after a month
+		SoilState soil_state(stand);
+		results.push_back(run_benchmark("hydrology_lpjf", [&]() {
+			const unsigned int p = next_patch++ % stand.npatch();
+			Patch& patch = stand[p];
+			Soil& soil = patch.soil;
+			hydrology_lpjf(patch, stand.local_climate, soil.rain_melt, soil.soiltype.perc_base,
+			               soil.soiltype.perc_exp, soil.soiltype.awc, fevap[p],
+			               soil.snowpack, soil.percolate, soil.max_rain_melt, soil.awcont, soil.wcont,
+			               soil.wcont_evap, soil.runoff, soil.dperc);
+		}, soil_state, 30 * stand.npatch(), settings));
+		soil_state();
+	}
+
+	if (selected("somfluxes", filter) && ifcentury) {
+		// Repeated days with the same litter input, reset after a year
+		SoilState soil_state(stand);
+		results.push_back(run_benchmark("somfluxes", [&]() {
+			somfluxes(stand[next_patch++ % stand.npatch()], false, false);
+		}, soil_state, date.year_length() * stand.npatch(), settings));
+		soil_state();
+	}
+
+	if (selected("ncompete", filter)) {
+		results.push_back(run_benchmark("ncompete", [&]() {
+			const unsigned int p = next_patch++ % stand.npatch();
+			ncompete(ncompeting[p], nmass_avail[p]);
+		}, NoReset(), BATCH, settings));
+	}
+
+	if (selected("prdaily", filter)) {
+		double mprec[12], mwet[12], dprec[Date::MAX_YEAR_LENGTH];
+		std::copy(fixture.get_mprec(), fixture.get_mprec() + 12, mprec);
+		std::copy(fixture.get_mwet(), fixture.get_mwet() + 12, mwet);
+		results.push_back(run_benchmark("prdaily", [&]() {
+			// Same seed every time, so every call does the same work
+			long seed = 12345678;
+			prdaily(mprec, dprec, mwet, seed);
+		}, NoReset(), 10, settings));
+	}
+
+	dprintf("%-22s %12s %14s %14s\n", "Kernel", "ns/call", "calls/s", "spread (%)");
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		dprintf("%-22s %12.1f %14.0f %14.1f\n", r.name.c_str(), r.ns_per_call, r.calls_per_second(),
+		        (r.max_ns_per_call - r.min_ns_per_call) / r.ns_per_call * 100);
+	}
+
+	FILE* out = fopen(output_file.c_str(), "w");
+	if (!out) {
+		fail("Could not open %s for output", output_file.c_str());
+	}
+
+	fprintf(out, "{\n  \"instruction_file\": %s,\n  \"years\": %d,\n  \"day\": %d,\n"
+	        "  \"patches\": %d,\n  \"individuals\": %d,\n  \"samples\": %d,\n  \"benchmarks\": ",
+	        json_string(insfile).c_str(), years, today.day, (int)stand.npatch(),
+	        (int)phot_calls.size(), settings.samples);
+	write_json_results(out, results);
+	fprintf(out, "\n}\n");
+	fclose(out);
+
+	dprintf("\nResults written to %s\n", output_file.c_str());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#!/bin/bash
+#
+# Compares the output files (*.out) of two runs of the same simulation, for
+# instance a run with FLOAT_FORCING against a regular double precision run.
+#
+# For each file a line is printed with the largest absolute and relative
+# difference of any value, and the column where the largest relative
+# difference was found. Relative differences are only counted for values
+# larger than the threshold (default 1e-6) in either run, so values which
+# are rounded to zero in the output don't dominate the report.
+#
+# With stochastic establishment or mortality, a tiny difference in the
+# input can make individual values diverge, so the largest relative
+# difference of the column means (over all grid cells and years) is also
+# printed, with its column.
+#
+# Usage: compare_outputs.sh <reference-dir> <other-dir> [threshold]
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <reference-dir> <other-dir> [threshold]" >&2
+    exit 1
+fi
+
+reference=$1
+other=$2
+threshold=${3:-1e-6}
+
+printf "%-20s %8s %10s %12s %12s %-8s %12s  %s\n" "file" "rows" "identical" "max abs" "max rel" "column" "mean rel" "column"
+
+for file in "$reference"/*.out ; do
+    name=$(basename "$file")
+
+    if [ ! -f "$other/$name" ]; then
+        printf "%-20s missing in %s\n" "$name" "$other"
+        continue
+    fi
+
+    if cmp -s "$file" "$other/$name" ; then
+        identical=yes
+    else
+        identical=no
+    fi
+
+    paste -d '\n' "$file" "$other/$name" | awk -v name="$name" -v identical=$identical -v threshold=$threshold '
+        function abs(x) { return x < 0 ? -x : x }
+
+        NR % 2 == 1 { split($0, a); next }
+
+        # Header line, keep the column names
+        NR == 2 { n = split($0, header); next }
+
+        {
+            n = split($0, b)
+            rows++
+            for (i = 1; i <= n; i++) {
+                sum_a[i] += a[i]
+                sum_b[i] += b[i]
+
+                diff = abs(a[i] - b[i])
+                if (diff > max_abs) {
+                    max_abs = diff
+                }
+                scale = abs(a[i]) > abs(b[i]) ? abs(a[i]) : abs(b[i])
+                if (scale > threshold && diff / scale > max_rel) {
+                    max_rel = diff / scale
+                    column = header[i]
+                }
+            }
+        }
+
+        END {
+            # Skip the coordinates and the year
+            for (i = 4; i <= n; i++) {
+                diff = abs(sum_a[i] - sum_b[i]) / rows
+                scale = (abs(sum_a[i]) > abs(sum_b[i]) ? abs(sum_a[i]) : abs(sum_b[i])) / rows
+                if (scale > threshold && diff / scale > max_mean_rel) {
+                    max_mean_rel = diff / scale
+                    mean_column = header[i]
+                }
+            }
+
+            printf "%-20s %8d %10s %12.3g %12.3g %-8s %12.3g  %s\n", name, rows, identical, max_abs, max_rel, column, max_mean_rel, mean_column
+        }'
+done
@@ -0,0 +1,7 @@
+# By including this file all files in ${headers} and ${source} is
+# added to bench_sources.
+foreach(file ${headers} ${source})
+  list(APPEND these_sources ${CMAKE_CURRENT_SOURCE_DIR}/${file})
+endforeach(file)
+
+set(bench_sources ${bench_sources} ${these_sources} PARENT_SCOPE)
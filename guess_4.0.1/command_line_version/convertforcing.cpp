@@ -0,0 +1,245 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file convertforcing.cpp
+/// \brief Main module for guess_forcing_cache, which writes a forcing cache
+///
+/// Reads the same instruction file as the model, and converts the NetCDF
+/// forcing data used by the SubPixel input module (sp) for the grid cells in
+/// the gridlist to a forcing cache (see forcingcache.h). The cache is then
+/// used instead of the NetCDF files by setting
+///
+///   param "file_forcing_cache" (str "<cache-file>")
+///
+/// in the instruction file.
+///
+/// Usage:
+///
+///   guess_forcing_cache [-input <module>] <ins-file> <cache-file>
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "guess.h"
+#include "forcingcache.h"
+#include "inputmodule.h"
+#include "outputmodule.h"
+#include "parameters.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+
+#ifdef HAVE_NETCDF
+#include "cfvariable.h"
+#include "guessnc.h"
+#endif
+
+namespace {
+
+void print_usage(const char* command_name) {
+	fprintf(stderr, "\nUsage: %s [-input <module_name>] <instruction-script-filename> <cache-file>\n\n"
+	        "  -input      input module used for the run (default sp)\n",
+	        command_name);
+	exit(EXIT_FAILURE);
+}
+
+#ifdef HAVE_NETCDF
+
+using GuessNC::CF::GridcellOrderedVariable;
+
+/// Opens a variable given by a file and a variable parameter
+/** \returns NULL if the file parameter is empty and the variable is optional */
+GridcellOrderedVariable* open_variable(const std::string& file_param, const std::string& variable_param,
+                                       bool optional, std::vector<ForcingCache::Variable>& cache_variables) {
+	if (optional && (!param.isparam(file_param.c_str()) || param[file_param.c_str()].str == "")) {
+		return 0;
+	}
+
+	ForcingCache::Variable v;
+	v.file = (const char*)param[file_param.c_str()].str;
+	v.variable = (const char*)param[variable_param.c_str()].str;
+
+	GridcellOrderedVariable* variable = 0;
+	try {
+		variable = new GridcellOrderedVariable(v.file.c_str(), v.variable.c_str());
+	}
+	catch (const std::runtime_error& e) {
+		fail(e.what());
+	}
+
+	v.location_size = variable->get_location_size();
+	if (!ForcingCache::get_file_stamp(v.file, v.file_mtime, v.file_size)) {
+		fail("Could not get the modification time and size of %s", v.file.c_str());
+	}
+	cache_variables.push_back(v);
+
+	return variable;
+}
+
+/// Writes the cache for the grid cells in the gridlist
+void convert_forcing(const char* cache_file) {
+
+	// The variables share the ids of files they have in common, which
+	// is only allowed holding the lock (see GuessNC::library_mutex)
+	GuessNC::LibraryLock lock;
+
+	// Same variables, in the same order, as SPInput reads
+
+	std::vector<ForcingCache::Variable> cache_variables;
+	std::vector<GridcellOrderedVariable*> forcing;
+	std::vector<GridcellOrderedVariable*> ndep;
+
+	const char* forcing_names[] = { "temp", "prec", "insol", "wetdays", "min_temp", "max_temp" };
+	for (size_t i = 0; i < sizeof(forcing_names)/sizeof(forcing_names[0]); ++i) {
+		const std::string name = forcing_names[i];
+		GridcellOrderedVariable* variable =
+			open_variable("file_" + name, "variable_" + name, i >= 3, cache_variables);
+		if (variable) {
+			forcing.push_back(variable);
+		}
+	}
+
+	const char* ndep_names[] = { "nhxdry", "nhxwet", "noydry", "noywet" };
+	for (size_t i = 0; i < sizeof(ndep_names)/sizeof(ndep_names[0]); ++i) {
+		const std::string name = ndep_names[i];
+		ndep.push_back(open_variable("file_ndep", "variable_" + name, false, cache_variables));
+	}
+
+	// The locations in the gridlist, as SPInput reads it
+
+	xtring file_gridlist = param["file_gridlist_cf"].str;
+	std::ifstream ifs(file_gridlist, std::ifstream::in);
+	if (!ifs.good()) {
+		fail("Could not open %s for input", (char*)file_gridlist);
+	}
+
+	std::vector<std::pair<int, int> > locations;
+	std::set<std::pair<int, int> > seen;
+
+	std::string line;
+	while (getline(ifs, line)) {
+		std::istringstream iss(line);
+		int x, y = 0;
+		if (forcing.front()->is_reduced() ? !(iss >> x) : !(iss >> x >> y)) {
+			continue;
+		}
+
+		if (seen.insert(std::make_pair(x, y)).second) {
+			locations.push_back(std::make_pair(x, y));
+		}
+	}
+
+	// Convert the data one location at a time
+
+	ForcingCacheWriter writer(cache_file, cache_variables);
+
+	std::vector<GridcellOrderedVariable*> all(forcing);
+	all.insert(all.end(), ndep.begin(), ndep.end());
+
+	// The cache always holds doubles, the variables may store floats
+	std::vector<std::vector<double> > widened(all.size());
+	std::vector<const double*> data(all.size());
+
+	int missing = 0;
+	for (size_t i = 0; i < locations.size(); ++i) {
+		const int x = locations[i].first;
+		const int y = locations[i].second;
+
+		// Like SPInput, missing N deposition is only an error for reduced grids
+		// (locations in reduced grids are (landid, 0), see ForcingCache)
+		bool ok = GuessNC::CF::load_data_for(forcing, x, y, x);
+		if (ok && !GuessNC::CF::load_data_for(ndep, x, y, x) && ndep.front()->is_reduced()) {
+			ok = false;
+		}
+
+		if (ok) {
+			for (size_t j = 0; j < all.size(); ++j) {
+				const GridcellOrderedVariable::value_type* values = all[j]->get_data();
+				widened[j].assign(values, values + all[j]->get_location_size());
+				data[j] = &widened[j].front();
+			}
+			writer.add_location(x, y, data);
+		}
+		else {
+			writer.add_missing_location(x, y);
+			++missing;
+		}
+
+		if ((i + 1) % 100 == 0 || i + 1 == locations.size()) {
+			dprintf("Converted %d of %d locations\n", (int)(i + 1), (int)locations.size());
+		}
+	}
+
+	writer.close();
+
+	if (missing > 0) {
+		dprintf("%d locations without valid data, they will be skipped by the model\n", missing);
+	}
+
+	for (size_t i = 0; i < all.size(); ++i) {
+		delete all[i];
+	}
+}
+
+#else
+
+void convert_forcing(const char* /*cache_file*/) {
+	fail("guess_forcing_cache needs to be built with NetCDF");
+}
+
+#endif // HAVE_NETCDF
+
+}
+
+int main(int argc, char* argv[]) {
+
+	set_shell(new CommandLineShell("guess_forcing_cache.log"));
+
+	std::string input_module_name = "sp";
+	std::string insfile;
+	std::string cache_file;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string option = argv[i];
+		const bool has_value = i+1 < argc;
+
+		if (option == "-input" && has_value) {
+			input_module_name = argv[++i];
+		}
+		else if (option[0] != '-' && insfile.empty()) {
+			insfile = option;
+		}
+		else if (option[0] != '-' && cache_file.empty()) {
+			cache_file = option;
+		}
+		else {
+			print_usage(argv[0]);
+		}
+	}
+
+	if (insfile.empty() || cache_file.empty()) {
+		print_usage(argv[0]);
+	}
+
+	// The input and output modules declare parameters which may be set in
+	// the instruction file, so they need to exist when it's read
+	std::auto_ptr<InputModule> input_module(InputModuleRegistry::get_instance().create_input_module(input_module_name.c_str()));
+	GuessOutput::OutputModuleContainer output_modules;
+	GuessOutput::OutputModuleRegistry::get_instance().create_all_modules(output_modules);
+
+	read_instruction_file(insfile.c_str());
+
+	convert_forcing(cache_file.c_str());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,414 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file partition.cpp
+/// \brief Main module for guess_partition, which splits a gridlist for parallel runs
+///
+/// Reads the same instruction file as the model, estimates the cost of each
+/// grid cell in the gridlist (see costmodel.h) and writes one gridlist per
+/// process, with about the same total cost in each.
+///
+/// Usage:
+///
+///   guess_partition -n <parts> [-input <module>] [-gridlist <file>] [-years <n>]
+///                   [-subdaily <n>] [-calibrate <log-file>]... [-output <pattern>]
+///                   <ins-file>
+///
+/// The log files given with -calibrate (which may be repeated) are guess.log
+/// files from an earlier run with the same setup, their grid cell wall times
+/// are used to fit the cost model. Grid cells which were simulated in that run get their
+/// measured time rather than the estimate.
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "guess.h"
+#include "costmodel.h"
+#include "inputmodule.h"
+#include "outputmodule.h"
+#include "parameters.h"
+#include "landform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <math.h>
+
+namespace {
+
+/// A grid cell in the gridlist, and its estimated cost
+struct GridlistEntry {
+	/// The line from the gridlist, written unchanged to the new gridlists
+	std::string line;
+
+	double lon;
+	double lat;
+	int landid;
+
+	int patches;
+	double cost;
+};
+
+void print_usage(const char* command_name) {
+	fprintf(stderr, "\nUsage: %s -n <parts> [-input <module_name>] [-gridlist <file>] [-years <n>] [-subdaily <n>] "
+	        "[-calibrate <log-file>]... [-output <pattern>] <instruction-script-filename>\n\n"
+	        "  -n          number of gridlists to write (number of processes)\n"
+	        "  -input      input module used for the run (default cru_ncep)\n"
+	        "  -gridlist   gridlist to split (default: the one in the instruction file)\n"
+	        "  -years      number of simulated years per grid cell\n"
+	        "              (default: as in the calibration logs, otherwise the spinup\n"
+	        "              and the years of forcing data, as the input module runs them)\n"
+	        "  -subdaily   number of time steps per day (default 1, daily mode)\n"
+	        "  -calibrate  guess.log file from an earlier run with grid cell wall times,\n"
+	        "              may be given several times\n"
+	        "  -output     file name pattern for the gridlists, %%d is replaced by\n"
+	        "              the part number (default run%%d/<gridlist file name>)\n",
+	        command_name);
+	exit(EXIT_FAILURE);
+}
+
+/// Reads all grid cell timing lines from a log file
+void read_timings(const char* path, std::vector<GridcellTiming>& timings) {
+	std::ifstream ifs(path);
+	if (!ifs.good()) {
+		fail("Could not open %s for input", path);
+	}
+
+	std::string line;
+	GridcellTiming timing;
+	while (getline(ifs, line)) {
+		if (parse_gridcell_timing(line.c_str(), timing)) {
+			timings.push_back(timing);
+		}
+	}
+}
+
+/// The most common number of simulated years in the timings
+int typical_years(const std::vector<GridcellTiming>& timings) {
+	std::map<int, int> counts;
+	int best = 0;
+	for (size_t i = 0; i < timings.size(); i++) {
+		if (++counts[timings[i].years] > counts[best]) {
+			best = timings[i].years;
+		}
+	}
+	return best;
+}
+
+/// Reads the gridlist, keeping each line as it is
+void read_gridlist(const char* path, std::vector<GridlistEntry>& gridlist) {
+	std::ifstream ifs(path);
+	if (!ifs.good()) {
+		fail("Could not open %s for input", path);
+	}
+
+	std::string line;
+	while (getline(ifs, line)) {
+		GridlistEntry entry;
+		entry.line = line;
+		entry.lon = entry.lat = 0;
+		entry.landid = 0;
+
+		// Either "lon lat [description]", or "landid [description]"
+		// for input modules reading reduced NetCDF files
+		std::istringstream iss(line);
+		double first;
+		if (!(iss >> first)) {
+			continue;
+		}
+		entry.lon = first;
+		entry.landid = (int)first;
+		iss >> entry.lat;
+
+		gridlist.push_back(entry);
+	}
+}
+
+/// Number of stands the model will create for each grid cell
+void count_stands(std::vector<GridlistEntry>& gridlist, std::vector<int>& nstands) {
+	nstands.assign(gridlist.size(), 1);
+
+	if (!run_landform) {
+		return;
+	}
+
+#ifdef HAVE_NETCDF
+	LandformInput landform_input;
+	landform_input.init();
+
+	for (size_t i = 0; i < gridlist.size(); i++) {
+		if (landform_input.loadlandform(gridlist[i].lon, gridlist[i].lat, gridlist[i].landid)) {
+			nstands[i] = (int)landform_input.get_landforms().size();
+		}
+		else {
+			// The model will skip it
+			nstands[i] = 0;
+		}
+	}
+#else
+	fail("guess_partition needs to be built with NetCDF to count landforms (run_landform is on)");
+#endif
+}
+
+/// Years simulated for each grid cell, as the model will run them
+/** With scenarios, the years each scenario simulates after the spinup
+ *  are added (see Scenario).
+ *
+ *  \param input_module The input module, initialised
+ *  \returns -1 if the input module doesn't know in advance
+ */
+int simulated_years(const std::string& input_module_name, const InputModule& input_module) {
+	int years = input_module.simulated_years();
+
+	for (unsigned int i = 0; i < scenariolist.nobj && years >= 0; i++) {
+		ScenarioParameters parameters(scenariolist[i]);
+
+		std::auto_ptr<InputModule> scenario_module(InputModuleRegistry::get_instance().create_input_module(input_module_name.c_str()));
+		scenario_module->init();
+
+		const int scenario_years = scenario_module->simulated_years();
+		years = scenario_years < 0 ? -1 : years + scenario_years - nyear_spinup;
+	}
+
+	return years;
+}
+
+/// Gives the grid cells the input module's coordinates, where it knows them
+/** The gridlists of some input modules contain positions in the forcing
+ *  files rather than coordinates (see InputModule::gridcell_coordinates),
+ *  while the landforms and the wall times in guess.log are looked up by
+ *  coordinates. Only done if the input module reads the same gridlist.
+ */
+void locate_gridcells(const InputModule& input_module, std::vector<GridlistEntry>& gridlist) {
+	if (input_module.gridlist_size() != (int)gridlist.size()) {
+		return;
+	}
+
+	for (size_t i = 0; i < gridlist.size(); i++) {
+		double lon, lat;
+		if (input_module.gridcell_coordinates((int)i, lon, lat)) {
+			gridlist[i].lon = lon;
+			gridlist[i].lat = lat;
+		}
+	}
+}
+
+/// Grid cell timings by position, rounded to 1e-4 degrees
+typedef std::map<std::pair<long, long>, const GridcellTiming*> TimingIndex;
+
+std::pair<long, long> timing_key(double lon, double lat) {
+	return std::make_pair(lround(lon * 1e4), lround(lat * 1e4));
+}
+
+/// Indexes the timings, keeping the first one for each grid cell
+void index_timings(const std::vector<GridcellTiming>& timings, TimingIndex& index) {
+	for (size_t i = 0; i < timings.size(); i++) {
+		index.insert(std::make_pair(timing_key(timings[i].lon, timings[i].lat), &timings[i]));
+	}
+}
+
+/// Finds a timing for the grid cell at (lon, lat), or NULL
+const GridcellTiming* find_timing(const TimingIndex& index, double lon, double lat) {
+	TimingIndex::const_iterator itr = index.find(timing_key(lon, lat));
+	return itr != index.end() ? itr->second : 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	set_shell(new CommandLineShell("guess_partition.log"));
+
+	int nparts = 0;
+	int years = 0;
+	int subdaily = 1;
+	std::string input_module_name = "cru_ncep";
+	std::string gridlist_option;
+	std::string output_pattern;
+	std::string insfile;
+	std::vector<std::string> calibration_logs;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string option = argv[i];
+		const bool has_value = i+1 < argc;
+
+		if (option == "-n" && has_value) {
+			nparts = atoi(argv[++i]);
+		}
+		else if (option == "-input" && has_value) {
+			input_module_name = argv[++i];
+		}
+		else if (option == "-gridlist" && has_value) {
+			gridlist_option = argv[++i];
+		}
+		else if (option == "-years" && has_value) {
+			years = atoi(argv[++i]);
+		}
+		else if (option == "-subdaily" && has_value) {
+			subdaily = atoi(argv[++i]);
+		}
+		else if (option == "-output" && has_value) {
+			output_pattern = argv[++i];
+		}
+		else if (option == "-calibrate" && has_value) {
+			calibration_logs.push_back(argv[++i]);
+		}
+		else if (option[0] != '-' && insfile.empty()) {
+			insfile = option;
+		}
+		else {
+			print_usage(argv[0]);
+		}
+	}
+
+	if (nparts < 1 || subdaily < 1 || insfile.empty()) {
+		print_usage(argv[0]);
+	}
+
+	// The input and output modules declare parameters which may be set in
+	// the instruction file, so they need to exist when it's read
+	std::auto_ptr<InputModule> input_module(InputModuleRegistry::get_instance().create_input_module(input_module_name.c_str()));
+	GuessOutput::OutputModuleContainer output_modules;
+	GuessOutput::OutputModuleRegistry::get_instance().create_all_modules(output_modules);
+
+	read_instruction_file(insfile.c_str());
+
+	// Reads the input module's gridlist, and finds out how much forcing data there is
+	input_module->init();
+
+	// Timings from an earlier run
+	std::vector<GridcellTiming> timings;
+	for (size_t i = 0; i < calibration_logs.size(); i++) {
+		read_timings(calibration_logs[i].c_str(), timings);
+	}
+
+	GridcellCostModel model;
+	if (model.calibrate(timings)) {
+		dprintf("Calibrated from %d grid cells: %g s + %g s per patch-year\n",
+		        (int)timings.size(), model.get_overhead(), model.get_per_work());
+	}
+
+	if (years < 1 && !timings.empty()) {
+		years = typical_years(timings);
+	}
+	else if (years < 1) {
+		years = simulated_years(input_module_name, *input_module);
+		if (years < 0) {
+			dprintf("Input module %s doesn't know how many years it will simulate, "
+			        "assuming nyear_spinup (use -years to set it)\n", input_module_name.c_str());
+			years = nyear_spinup;
+		}
+	}
+	dprintf("Estimating costs for %d simulated years\n", years);
+
+	// The gridlist, and the number of patches for each grid cell
+	xtring gridlist_file = gridlist_option.c_str();
+	if (gridlist_option.empty()) {
+		gridlist_file = param[param.isparam("file_gridlist_cf") ? "file_gridlist_cf" : "file_gridlist"].str;
+	}
+
+	std::vector<GridlistEntry> gridlist;
+	read_gridlist(gridlist_file, gridlist);
+
+	if (gridlist.empty()) {
+		fail("No grid cells in %s", (const char*)gridlist_file);
+	}
+
+	if (gridlist_option.empty()) {
+		locate_gridcells(*input_module, gridlist);
+	}
+
+	std::vector<int> nstands;
+	count_stands(gridlist, nstands);
+
+	TimingIndex timing_index;
+	index_timings(timings, timing_index);
+
+	std::vector<double> costs(gridlist.size());
+	int nmeasured = 0;
+	for (size_t i = 0; i < gridlist.size(); i++) {
+		gridlist[i].patches = nstands[i] * npatch;
+
+		const GridcellTiming* measured = find_timing(timing_index, gridlist[i].lon, gridlist[i].lat);
+		if (measured) {
+			gridlist[i].cost = measured->seconds;
+			++nmeasured;
+		}
+		else if (nstands[i] == 0) {
+			gridlist[i].cost = 0;
+		}
+		else {
+			gridlist[i].cost = model.cost(GridcellCostModel::work(gridlist[i].patches, years, subdaily));
+		}
+		costs[i] = gridlist[i].cost;
+	}
+
+	if (nmeasured > 0) {
+		dprintf("Using measured wall times for %d of %d grid cells\n", nmeasured, (int)gridlist.size());
+	}
+
+	const std::vector<int> part_of = partition_by_cost(costs, nparts);
+
+	// Write the gridlists, keeping the original order within each part
+	if (output_pattern.empty()) {
+		std::string filename = (const char*)gridlist_file;
+		size_t slash = filename.find_last_of("/\\");
+		if (slash != std::string::npos) {
+			filename = filename.substr(slash + 1);
+		}
+		output_pattern = "run%d/" + filename;
+	}
+
+	const size_t placeholder = output_pattern.find("%d");
+	if (placeholder == std::string::npos) {
+		fail("Output pattern %s doesn't contain %%d", output_pattern.c_str());
+	}
+
+	const char* unit = model.is_calibrated() ? "s" : "units";
+
+	dprintf("\n%6s %10s %14s\n", "Part", "Cells", "Cost");
+
+	double max_total = 0, sum_total = 0;
+	for (int part = 0; part < nparts; part++) {
+		std::ostringstream number;
+		number << part + 1;
+		std::string path = output_pattern;
+		path.replace(placeholder, 2, number.str());
+
+		std::ofstream ofs(path.c_str());
+		if (!ofs.good()) {
+			fail("Could not open %s for output", path.c_str());
+		}
+
+		int ncells = 0;
+		double total = 0;
+		for (size_t i = 0; i < gridlist.size(); i++) {
+			if (part_of[i] == part) {
+				ofs << gridlist[i].line << '\n';
+				++ncells;
+				total += gridlist[i].cost;
+			}
+		}
+
+		dprintf("%6d %10d %14.6g %s\n", part + 1, ncells, total, unit);
+
+		max_total = std::max(max_total, total);
+		sum_total += total;
+	}
+
+	if (max_total > 0) {
+		dprintf("\nSlowest part is %.1f%% above the average\n",
+		        (max_total / (sum_total / nparts) - 1) * 100);
+	}
+
+	return EXIT_SUCCESS;
+}
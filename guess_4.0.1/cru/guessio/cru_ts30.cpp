@@ -13,6 +13,7 @@
 
 #include "config.h"
 #include "cru_ts30.h"
+#include "shell.h"
 #include <stdio.h>
 #include <math.h>
 #include <vector>
@@ -21,47 +22,132 @@
 #include "cruncep_1901_2015.h"
 #include "cruncep_1901_2015misc.h"
 
-namespace CRU_TS30 {
- 
-bool searchcru(char* cruark,double dlon,double dlat,int& soilcode,
-               double mtemp[NYEAR_HIST][12],
-               double mprec[NYEAR_HIST][12],
-               double msun[NYEAR_HIST][12]) {
+namespace {
+
+/// Number of bits used for longitude and latitude in the archive index
+const int LON_BITS = 11;
+const int LAT_BITS = 10;
+
+/// Packs a coordinate as in the index of the archives
+/** The generated getindex() functions store lon and lat on a 0.25 degree grid,
+ *  offset by -180 and -90, in the lowest 21 bits of the first three bytes of
+ *  each index record.
+ *
+ *  \returns false if the coordinate can't be represented in the index */
+bool cell_key(double lon, double lat, long& key) {
+	const double ilon = (lon + 180) / 0.25 + 0.5;
+	const double ilat = (lat + 90) / 0.25 + 0.5;
+
+	if (ilon < 0 || ilon >= (1 << LON_BITS) || ilat < 0 || ilat >= (1 << LAT_BITS)) {
+		return false;
+	}
+
+	key = ((long)ilon << LAT_BITS) + (long)ilat;
+	return true;
+}
 
-	// !!!! NEW VERSION OF THIS FUNCTION - guess2008 - NEW VERSION OF THIS FUNCTION !!!!
-	// Please note the new function signature. 
+/// Reads the coordinates of all grid cells in an archive
+/** The index part of the archive comes after the header and the data, with
+ *  nrecord records of index_length bytes each. Fails if it can't be read.
+ */
+void read_cells(const char* filename, long headersize, long data_length,
+                long index_length, long nrecord, std::vector<bool>& cells) {
 
-	// Archive object. Definition in new header file, cru.h
+	FILE* file = fopen(filename, "rb");
+	if (!file) {
+		fail("Could not open %s for input", filename);
+	}
+
+	std::vector<unsigned char> index(index_length * nrecord);
+
+	if (fseek(file, headersize + data_length * nrecord, SEEK_SET) != 0 ||
+	    (nrecord > 0 && fread(&index.front(), index.size(), 1, file) != 1)) {
+		fclose(file);
+		fail("Could not read the index of %s", filename);
+	}
+	fclose(file);
+
+	cells.assign(1 << (LON_BITS + LAT_BITS), false);
+
+	for (long i = 0; i < nrecord; i++) {
+		const unsigned char* record = &index[i * index_length];
+		const long key = ((long)record[0] << 16) + ((long)record[1] << 8) + record[2];
+		cells[key & ((1 << (LON_BITS + LAT_BITS)) - 1)] = true;
+	}
+}
+
+/// Checks if a cell read by read_cells() is in the archive
+bool in_archive(const std::vector<bool>& cells, double lon, double lat) {
+	long key;
+	return cell_key(lon, lat, key) && key < (long)cells.size() && cells[key];
+}
+
+}
+
+namespace CRU_TS30 {
+
+struct CRUArchive::Archives {
 	Cruncep_1901_2015Archive ark;
+	Cruncep_1901_2015miscArchive ark_misc;
 
-	int y,m;
+	/// Grid cells in ark, indexed by cell_key()
+	std::vector<bool> cells;
 
-	// Try block to catch any unexpected errors
-	try {
+	/// Grid cells in ark_misc, empty if it isn't open
+	std::vector<bool> cells_misc;
+};
 
-		Cruncep_1901_2015 data; // struct to hold the data
+CRUArchive::CRUArchive(const char* cruark, const char* cruark_misc)
+	: archives(new Archives) {
 
-		bool success = ark.open(cruark);
+	if (!archives->ark.open(cruark)) {
+		fail("Could not open CRU archive %s", cruark);
+	}
+	read_cells(cruark, CRUNCEP_1901_2015_HEADERSIZE, CRUNCEP_1901_2015_DATA_LENGTH,
+	           CRUNCEP_1901_2015_INDEX_LENGTH, CRUNCEP_1901_2015_NRECORD, archives->cells);
 
-		if (success) {
-			bool flag = ark.rewind();
-			if (!flag) { 
-				ark.close(); // I.e. we opened it but we couldn't rewind
-				return false;
-			}
+	if (cruark_misc) {
+		if (!archives->ark_misc.open(cruark_misc)) {
+			fail("Could not open CRU archive %s", cruark_misc);
 		}
-		else
-			return false;
+		read_cells(cruark_misc, CRUNCEP_1901_2015MISC_HEADERSIZE, CRUNCEP_1901_2015MISC_DATA_LENGTH,
+		           CRUNCEP_1901_2015MISC_INDEX_LENGTH, CRUNCEP_1901_2015MISC_NRECORD, archives->cells_misc);
+	}
+}
+
+CRUArchive::~CRUArchive() {
+	archives->ark.close();
+	archives->ark_misc.close();
+}
+
+bool CRUArchive::has_cell(double dlon, double dlat) const {
+	return in_archive(archives->cells, dlon, dlat);
+}
+
+bool CRUArchive::searchcru(double dlon,double dlat,int& soilcode,
+                           double mtemp[NYEAR_HIST][12],
+                           double mprec[NYEAR_HIST][12],
+                           double msun[NYEAR_HIST][12]) {
 
+	// Don't search the file for cells which aren't there
+	if (!has_cell(dlon, dlat)) {
+		return false;
+	}
+
+	int y,m;
+
+	// Try block to catch any unexpected errors
+	try {
+
+		Cruncep_1901_2015 data; // struct to hold the data
 
 		// The CRU archive index hold lons & lats as whole doubles * 10
 		data.lon = dlon;
 		data.lat = dlat;
 
 		// Read the CRU data into the data struct
-		success =ark.getindex(data);
+		bool success = archives->ark.getindex(data);
 		if (!success) {
-			ark.close();
 			return false;
 		}
 
@@ -84,9 +170,6 @@ bool searchcru(char* cruark,double dlon,double dlat,int& soilcode,
 		}
 
 
-		// Close the archive
-		ark.close();
-
 		return true;
 	
 	}
@@ -98,15 +181,15 @@ bool searchcru(char* cruark,double dlon,double dlat,int& soilcode,
 
 
 
-bool searchcru_misc(char* cruark,double dlon,double dlat,int& elevation,
-                    double mfrs[NYEAR_HIST][12],
-                    double mwet[NYEAR_HIST][12],
-                    double mdtr[NYEAR_HIST][12]) {
-	
-	// Please note the new function signature. 
+bool CRUArchive::searchcru_misc(double dlon,double dlat,int& elevation,
+                                double mfrs[NYEAR_HIST][12],
+                                double mwet[NYEAR_HIST][12],
+                                double mdtr[NYEAR_HIST][12]) {
+
+	if (!in_archive(archives->cells_misc, dlon, dlat)) {
+		return false;
+	}
 
-	// Archive object
-	Cruncep_1901_2015miscArchive ark; 
 	int y,m;
 
 	// Try block to catch any unexpected errors
@@ -114,27 +197,13 @@ bool searchcru_misc(char* cruark,double dlon,double dlat,int& elevation,
 
 		Cruncep_1901_2015misc data;
 
-		bool success = ark.open(cruark);
-
-		if (success) {
-			bool flag = ark.rewind();
-			if (!flag) { 
-				ark.close(); // I.e. we opened it but we couldn't rewind
-				return false;
-			}
-		}
-		else
-			return false;
-
-
 		// The CRU archive index hold lons & lats as whole doubles * 10
 		data.lon = dlon;
 		data.lat = dlat;
 
 		// Read the CRU data into the data struct
-		success =ark.getindex(data);
+		bool success = archives->ark_misc.getindex(data);
 		if (!success) {
-			ark.close();
 			return false;
 		}
 
@@ -167,9 +236,6 @@ bool searchcru_misc(char* cruark,double dlon,double dlat,int& elevation,
 			}
 		}
 
-		// Close the archive
-		ark.close();
-
 		return true;
 	
 	}
@@ -180,14 +246,14 @@ bool searchcru_misc(char* cruark,double dlon,double dlat,int& elevation,
 }
 
 
-bool findnearestCRUdata(double searchradius, char* cruark, double& lon, double& lat, 
-                        int& scode, 
-                        double hist_mtemp1[NYEAR_HIST][12], 
-                        double hist_mprec1[NYEAR_HIST][12], 
-                        double hist_msun1[NYEAR_HIST][12]) {
+bool CRUArchive::findnearestCRUdata(double searchradius, double& lon, double& lat,
+                                    int& scode,
+                                    double hist_mtemp1[NYEAR_HIST][12],
+                                    double hist_mprec1[NYEAR_HIST][12],
+                                    double hist_msun1[NYEAR_HIST][12]) {
 
 	// First try the exact coordinate
-	if (searchcru(cruark, lon, lat, scode, hist_mtemp1, hist_mprec1, hist_msun1)) {
+	if (searchcru(lon, lat, scode, hist_mtemp1, hist_mprec1, hist_msun1)) {
 		return true;
 	}
 	
@@ -227,13 +293,14 @@ bool findnearestCRUdata(double searchradius, char* cruark, double& lon, double&
 	// Sort by increasing distance
 	std::sort(search_points.begin(), search_points.end());
 
-	// Find closest coordinate which can be found in CRU
+	// Find closest coordinate which can be found in CRU, using the index
+	// in memory so only the data for the found cell is read from file
 	for (unsigned int i = 0; i < search_points.size(); i++) {
 		point search_point = search_points[i].second;
 		double search_lon = search_point.first;
 		double search_lat = search_point.second;
 
-		if (searchcru(cruark, search_lon, search_lat, scode, 
+		if (searchcru(search_lon, search_lat, scode,
 		              hist_mtemp1, hist_mprec1, hist_msun1)) {
 			lon = search_lon;
 			lat = search_lat;
@@ -12,6 +12,8 @@
 #ifndef LPJ_GUESS_CRU_TS30_H
 #define LPJ_GUESS_CRU_TS30_H
 
+#include <memory>
+
 namespace CRU_TS30 {
 
 /// number of years of historical climate
@@ -21,25 +23,58 @@ const int NYEAR_HIST=115;
 /// calendar year corresponding to first year in CRU climate data set
 static const int FIRSTHISTYEAR=1901;
 
-/// Determine temp, precip, sunshine & soilcode
-bool searchcru(char* cruark,double dlon,double dlat,int& soilcode,
-               double mtemp[NYEAR_HIST][12],
-               double mprec[NYEAR_HIST][12],
-               double msun[NYEAR_HIST][12]);
-
-/// Determine elevation, frs frq, wet frq & DTR
-bool searchcru_misc(char* cruark,double dlon,double dlat,int& elevation,
-                    double mfrs[NYEAR_HIST][12],
-                    double mwet[NYEAR_HIST][12],
-                    double mdtr[NYEAR_HIST][12]);
-
-/// Returns CRU data from the nearest cell to (lon,lat) within a given search radius
-/** lon and lat are set to the coordinates of the found CRU gridcell, if found */
-bool findnearestCRUdata(double searchradius, char* cruark, double& lon, double& lat, 
-                        int& scode, 
-                        double hist_mtemp1[NYEAR_HIST][12], 
-                        double hist_mprec1[NYEAR_HIST][12], 
-                        double hist_msun1[NYEAR_HIST][12]);
+/// A CRU-NCEP archive which is kept open for the whole run
+/** The archive files are opened once, and the coordinates of all grid cells
+ *  in them are read into memory. Checking whether the archive has data for a
+ *  coordinate, including all the candidates tried by findnearestCRUdata(),
+ *  is then answered from memory, and only the data for a grid cell which is
+ *  known to be in the archive is read from file.
+ */
+class CRUArchive {
+public:
+	/// Opens the archives, calls fail() if they can't be opened
+	/** \param cruark      Archive with temperature, precipitation, radiation and soilcode
+	 *  \param cruark_misc Archive with elevation, frost days, wet days and DTR,
+	 *                     may be NULL if searchcru_misc() isn't used
+	 */
+	CRUArchive(const char* cruark, const char* cruark_misc = 0);
+
+	/// Closes the archives
+	~CRUArchive();
+
+	/// Checks if the archive has data for the grid cell at (dlon,dlat)
+	bool has_cell(double dlon, double dlat) const;
+
+	/// Determine temp, precip, sunshine & soilcode
+	bool searchcru(double dlon,double dlat,int& soilcode,
+	               double mtemp[NYEAR_HIST][12],
+	               double mprec[NYEAR_HIST][12],
+	               double msun[NYEAR_HIST][12]);
+
+	/// Determine elevation, frs frq, wet frq & DTR
+	bool searchcru_misc(double dlon,double dlat,int& elevation,
+	                    double mfrs[NYEAR_HIST][12],
+	                    double mwet[NYEAR_HIST][12],
+	                    double mdtr[NYEAR_HIST][12]);
+
+	/// Returns CRU data from the nearest cell to (lon,lat) within a given search radius
+	/** lon and lat are set to the coordinates of the found CRU gridcell, if found */
+	bool findnearestCRUdata(double searchradius, double& lon, double& lat,
+	                        int& scode,
+	                        double hist_mtemp1[NYEAR_HIST][12],
+	                        double hist_mprec1[NYEAR_HIST][12],
+	                        double hist_msun1[NYEAR_HIST][12]);
+
+private:
+	/// The generated archive classes, hidden since their headers can only be included once
+	struct Archives;
+
+	std::auto_ptr<Archives> archives;
+
+	// Not copyable
+	CRUArchive(const CRUArchive&);
+	CRUArchive& operator=(const CRUArchive&);
+};
 
 }
 
@@ -31,9 +31,6 @@ REGISTER_INPUT_MODULE("cru_ncep", CRUInput)
 // Anonymous namespace for variables and functions with file scope
 namespace {
 
-xtring file_cru;
-xtring file_cru_misc;
-
 /// Interpolates monthly data to quasi-daily values.
 void interp_climate(double* mtemp, double* mprec, double* msun, double* mdtr,
 					double* dtemp, double* dprec, double* dsun, double* ddtr) {
@@ -47,13 +44,7 @@ void interp_climate(double* mtemp, double* mprec, double* msun, double* mdtr,
 
 
 CRUInput::CRUInput()
-	: searchradius(0),
-	  spinup_mtemp(NYEAR_SPINUP_DATA),
-	  spinup_mprec(NYEAR_SPINUP_DATA),
-	  spinup_msun(NYEAR_SPINUP_DATA),
-	  spinup_mfrs(NYEAR_SPINUP_DATA),
-	  spinup_mwet(NYEAR_SPINUP_DATA),
-	  spinup_mdtr(NYEAR_SPINUP_DATA) {
+	: searchradius(0) {
 
 	// Declare instruction file parameters
 
@@ -84,11 +75,12 @@ void CRUInput::init() {
 	FILE* in_grid=fopen(file_gridlist,"r");
 	if (!in_grid) fail("initio: could not open %s for input",(char*)file_gridlist);
 
-	file_cru=param["file_cru"].str;
-	file_cru_misc=param["file_cru_misc"].str;
+	// Open the CRU archives once, and read their indices of grid cells
+	xtring file_cru=param["file_cru"].str;
+	xtring file_cru_misc=param["file_cru_misc"].str;
+	cru_archive = std::auto_ptr<CRU_TS30::CRUArchive>(new CRU_TS30::CRUArchive(file_cru, file_cru_misc));
 
 	gridlist.killall();
-	first_call = true;	
 
 	while (!eof) {
 
@@ -110,10 +102,11 @@ void CRUInput::init() {
 	// Read CO2 data from file
 	co2.load_file(param["file_co2"].str);
 
-	// Open landcover files
-	landcover_input.init();
-	// Open management files
-	management_input.init();
+	// Kept for the grid cells, param isn't safe to use from several threads
+	file_ndep=param["file_ndep"].str;
+
+	// Open landcover and management files
+	landuse_input.init();
 
 	date.set_first_calendar_year(FIRSTHISTYEAR - nyear_spinup);
 	// Set timers
@@ -129,8 +122,8 @@ void CRUInput::get_monthly_ndep(int calendar_year,
                                 double* mndrydep,
                                 double* mnwetdep) {
 
-	ndep.get_one_calendar_year(calendar_year,
-	                           mndrydep, mnwetdep);
+	thread_state.get().ndep.get_one_calendar_year(calendar_year,
+	                                              mndrydep, mnwetdep);
 }
 
 
@@ -148,121 +141,132 @@ bool CRUInput::getgridcell(Gridcell& gridcell) {
 
 	// See base class for documentation about this function's responsibilities
 
+	// Step through the gridlist, starting with the first grid cell
+	ThreadState& state = thread_state.get();
+	state.position++;
+
+	return load_gridcell(gridcell, state, true);
+}
+
+
+bool CRUInput::getgridcell_at(Gridcell& gridcell, int index) {
+
+	// See base class for documentation about this function's responsibilities
+
+	ThreadState& state = thread_state.get();
+	state.position = index;
+
+	return load_gridcell(gridcell, state, false);
+}
+
+
+bool CRUInput::load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead) {
+
 	int soilcode;
 	int elevation;
 
-	// Make sure we use the first gridcell in the first call to this function,
-	// and then step through the gridlist in subsequent calls.
-	if (first_call) {
-		gridlist.firstobj();
+	bool gridfound = false;
+	bool LUerror = false;
+	double lon;
+	double lat;
 
-		// Note that first_call is static, so this assignment is remembered
-		// across function calls.
-		first_call = false;
-	}
-	else gridlist.nextobj();
+	while(!gridfound) {
 
-	if (gridlist.isobj) {
+		if (state.position >= (int)gridlist.nobj) {
+			return false; // no more stands
+		}
 
-		bool gridfound = false;
-		bool LUerror = false;
-		double lon;
-		double lat;
+		const Coord& c = gridlist[state.position];
 
-		while(!gridfound) {
+		lon = c.lon;
+		lat = c.lat;
 
-			if(gridlist.isobj) {
+		{
+			std::lock_guard<std::mutex> lock(archive_mutex);
 
-				lon = gridlist.getobj().lon;
-				lat = gridlist.getobj().lat;
-				gridfound = CRU_TS30::findnearestCRUdata(searchradius, file_cru, lon, lat, soilcode,
-				                                         hist_mtemp, hist_mprec, hist_msun);
-			  
-				if (gridfound) // Get more historical CRU data for this grid cell
-					gridfound = CRU_TS30::searchcru_misc(file_cru_misc, lon, lat, elevation,
-					                                     hist_mfrs, hist_mwet, hist_mdtr);
+			gridfound = cru_archive->findnearestCRUdata(searchradius, lon, lat, soilcode,
+			                                            state.hist_mtemp, state.hist_mprec, state.hist_msun);
 
-				if (run_landcover && gridfound) {
-					LUerror = landcover_input.loadlandcover(lon, lat);
-					if(!LUerror)
-						LUerror = management_input.loadmanagement(lon, lat);
-				}
+			if (gridfound) // Get more historical CRU data for this grid cell
+				gridfound = cru_archive->searchcru_misc(lon, lat, elevation,
+				                                        state.hist_mfrs, state.hist_mwet, state.hist_mdtr);
+		}
 
-				if(!gridfound || LUerror) {
-					if(!gridfound)
-						dprintf("\nError: could not find stand at (%g,%g) in climate data files\n", gridlist.getobj().lon,gridlist.getobj().lat);
-					else if(LUerror)
-						dprintf("\nError: could not find stand at (%g,%g) in landcover/management data file(s)\n", gridlist.getobj().lon,gridlist.getobj().lat);
-					gridfound = false;
-					gridlist.nextobj();
-				}
-			}
-			else return false;
+		if (run_landcover && gridfound) {
+			LUerror = landuse_input.loadlanduse(lon, lat);
 		}
 
-		// Give sub-classes a chance to modify the data
-		adjust_raw_forcing_data(gridlist.getobj().lon,
-		                        gridlist.getobj().lat,
-		                        hist_mtemp, hist_mprec, hist_msun);
-
-		// Build spinup data sets
-		spinup_mtemp.get_data_from(hist_mtemp);
-		spinup_mprec.get_data_from(hist_mprec);
-		spinup_msun.get_data_from(hist_msun);
-
-		// Detrend spinup temperature data
-		spinup_mtemp.detrend_data();
-
-		// guess2008 - new spinup data sets
-		spinup_mfrs.get_data_from(hist_mfrs);
-		spinup_mwet.get_data_from(hist_mwet);
-		spinup_mdtr.get_data_from(hist_mdtr);
-
-		// We wont detrend dtr for now. Partly because dtr is at the moment only
-		// used for BVOC, so what happens during the spinup is not affecting
-		// results in the period thereafter, and partly because the detrending
-		// can give negative dtr values.
-		//spinup_mdtr.detrend_data();
-
-
-		dprintf("\nCommencing simulation for stand at (%g,%g)",gridlist.getobj().lon,
-			gridlist.getobj().lat);
-		if (gridlist.getobj().descrip!="") dprintf(" (%s)\n\n",
-			(char*)gridlist.getobj().descrip);
-		else dprintf("\n\n");
-		
-		// Tell framework the coordinates of this grid cell
-		gridcell.set_coordinates(gridlist.getobj().lon, gridlist.getobj().lat);
-		
-		// Get nitrogen deposition data. 
-		/* Since the historic data set does not reach decade 2010-2019, 
-		 * we need to use the RCP data for the last decade. */
-		ndep.getndep(param["file_ndep"].str, lon, lat, Lamarque::RCP60);
-
-		// The insolation data will be sent (in function getclimate, below)
-		// as incoming shortwave radiation, averages are over 24 hours
-		
-		gridcell.climate.instype = SWRAD_TS;
-
-		// Tell framework the soil type of this grid cell
-		soilparameters(gridcell.soiltype,soilcode);
-
-		// For Windows shell - clear graphical output
-		// (ignored on other platforms)
-		
-		clear_all_graphs();
-
-		return true; // simulate this stand
+		if(!gridfound || LUerror) {
+			if(!gridfound)
+				dprintf("\nError: could not find stand at (%g,%g) in climate data files\n", c.lon,c.lat);
+			else if(LUerror)
+				dprintf("\nError: could not find stand at (%g,%g) in landcover/management data file(s)\n", c.lon,c.lat);
+			gridfound = false;
+			if (!skip_ahead) {
+				return false;
+			}
+			state.position++;
+		}
 	}
 
-	return false; // no more stands
-}
+	const Coord& c = gridlist[state.position];
+
+	// Give sub-classes a chance to modify the data
+	adjust_raw_forcing_data(c.lon,
+	                        c.lat,
+	                        state.hist_mtemp, state.hist_mprec, state.hist_msun);
+
+	// Build spinup data sets
+	state.spinup_mtemp.get_data_from(state.hist_mtemp);
+	state.spinup_mprec.get_data_from(state.hist_mprec);
+	state.spinup_msun.get_data_from(state.hist_msun);
+
+	// Detrend spinup temperature data
+	state.spinup_mtemp.detrend_data();
+
+	// guess2008 - new spinup data sets
+	state.spinup_mfrs.get_data_from(state.hist_mfrs);
+	state.spinup_mwet.get_data_from(state.hist_mwet);
+	state.spinup_mdtr.get_data_from(state.hist_mdtr);
+
+	// We wont detrend dtr for now. Partly because dtr is at the moment only
+	// used for BVOC, so what happens during the spinup is not affecting
+	// results in the period thereafter, and partly because the detrending
+	// can give negative dtr values.
+	//spinup_mdtr.detrend_data();
+
+
+	dprintf("\nCommencing simulation for stand at (%g,%g)",c.lon,c.lat);
+	if (c.descrip!="") dprintf(" (%s)\n\n",(const char*)c.descrip);
+	else dprintf("\n\n");
 
+	// Tell framework the coordinates of this grid cell
+	gridcell.set_coordinates(c.lon, c.lat);
+
+	// Get nitrogen deposition data. 
+	/* Since the historic data set does not reach decade 2010-2019, 
+	 * we need to use the RCP data for the last decade. */
+	state.ndep.getndep(file_ndep, lon, lat, Lamarque::RCP60);
+
+	// The insolation data will be sent (in function getclimate, below)
+	// as incoming shortwave radiation, averages are over 24 hours
+
+	gridcell.climate.instype = SWRAD_TS;
+
+	// Tell framework the soil type of this grid cell
+	soilparameters(gridcell.soiltype,soilcode);
+
+	// For Windows shell - clear graphical output
+	// (ignored on other platforms)
+
+	clear_all_graphs();
+
+	return true; // simulate this stand
+}
 
 void CRUInput::getlandcover(Gridcell& gridcell) {
 
-	landcover_input.getlandcover(gridcell);
-	landcover_input.get_land_transitions(gridcell);
+	landuse_input.getlandcover(gridcell);
 }
 
 
@@ -274,6 +278,8 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 
 	Climate& climate = gridcell.climate;
 
+	ThreadState& state = thread_state.get();
+
 	if (date.day == 0) {
 
 		// First day of year ...
@@ -281,8 +287,8 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 		// Extract N deposition to use for this year,
 		// monthly means to be distributed into daily values further down
 		double mndrydep[12], mnwetdep[12];
-		ndep.get_one_calendar_year(date.year - nyear_spinup + FIRSTHISTYEAR,
-		                           mndrydep, mnwetdep);
+		state.ndep.get_one_calendar_year(date.year - nyear_spinup + FIRSTHISTYEAR,
+		                                 mndrydep, mnwetdep);
 
 		if (date.year < nyear_spinup) {
 
@@ -293,12 +299,12 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 				int year_offset = state_year % NYEAR_SPINUP_DATA;
 
 				for (int y=0;y<year_offset;y++) {
-					spinup_mtemp.nextyear();
-					spinup_mprec.nextyear();
-					spinup_msun.nextyear();
-					spinup_mfrs.nextyear();
-					spinup_mwet.nextyear();
-					spinup_mdtr.nextyear();
+					state.spinup_mtemp.nextyear();
+					state.spinup_mprec.nextyear();
+					state.spinup_msun.nextyear();
+					state.spinup_mfrs.nextyear();
+					state.spinup_mwet.nextyear();
+					state.spinup_mdtr.nextyear();
 				}
 			}
 
@@ -307,32 +313,32 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 			double mfrs[12],mwet[12],mdtr[12];
 
 			for (m=0;m<12;m++) {
-				mtemp[m] = spinup_mtemp[m];
-				mprec[m] = spinup_mprec[m];
-				msun[m]	 = spinup_msun[m];
+				mtemp[m] = state.spinup_mtemp[m];
+				mprec[m] = state.spinup_mprec[m];
+				msun[m]	 = state.spinup_msun[m];
 
-				mfrs[m] = spinup_mfrs[m];
-				mwet[m] = spinup_mwet[m];
-				mdtr[m] = spinup_mdtr[m];
+				mfrs[m] = state.spinup_mfrs[m];
+				mwet[m] = state.spinup_mwet[m];
+				mdtr[m] = state.spinup_mdtr[m];
 			}
 
 			// Interpolate monthly spinup data to quasi-daily values
-			interp_climate(mtemp,mprec,msun,mdtr,dtemp,dprec,dsun,ddtr);
+			interp_climate(mtemp,mprec,msun,mdtr,state.dtemp,state.dprec,state.dsun,state.ddtr);
 
 			// Only recalculate precipitation values using weather generator
 			// if rainonwetdaysonly is true. Otherwise we assume that it rains a little every day.
 			if (ifrainonwetdaysonly) {
 				// (from Dieter Gerten 021121)
-				prdaily(mprec, dprec, mwet, gridcell.seed);
+				prdaily(mprec, state.dprec, mwet, gridcell.seed);
 			}
 
-			spinup_mtemp.nextyear();
-			spinup_mprec.nextyear();
-			spinup_msun.nextyear();
+			state.spinup_mtemp.nextyear();
+			state.spinup_mprec.nextyear();
+			state.spinup_msun.nextyear();
 
-			spinup_mfrs.nextyear();
-			spinup_mwet.nextyear();
-			spinup_mdtr.nextyear();
+			state.spinup_mfrs.nextyear();
+			state.spinup_mwet.nextyear();
+			state.spinup_mdtr.nextyear();
 
 		}
 		else if (date.year < nyear_spinup + NYEAR_HIST) {
@@ -340,16 +346,16 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 			// Historical period
 
 			// Interpolate this year's monthly data to quasi-daily values
-			interp_climate(hist_mtemp[date.year-nyear_spinup],
-				hist_mprec[date.year-nyear_spinup],hist_msun[date.year-nyear_spinup],
-					   hist_mdtr[date.year-nyear_spinup],
-				       dtemp,dprec,dsun,ddtr);
+			interp_climate(state.hist_mtemp[date.year-nyear_spinup],
+				state.hist_mprec[date.year-nyear_spinup],state.hist_msun[date.year-nyear_spinup],
+					   state.hist_mdtr[date.year-nyear_spinup],
+				       state.dtemp,state.dprec,state.dsun,state.ddtr);
 
 			// Only recalculate precipitation values using weather generator
 			// if ifrainonwetdaysonly is true. Otherwise we assume that it rains a little every day.
 			if (ifrainonwetdaysonly) {
 				// (from Dieter Gerten 021121)
-				prdaily(hist_mprec[date.year-nyear_spinup], dprec, hist_mwet[date.year-nyear_spinup], gridcell.seed);
+				prdaily(state.hist_mprec[date.year-nyear_spinup], state.dprec, state.hist_mwet[date.year-nyear_spinup], gridcell.seed);
 			}
 		}
 		else {
@@ -358,23 +364,23 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 		}
 
 		// Distribute N deposition
-		distribute_ndep(mndrydep, mnwetdep, dprec, dndep);
+		distribute_ndep(mndrydep, mnwetdep, state.dprec, state.dndep);
 	}
 
 	// Send environmental values for today to framework
 
 	climate.co2 = co2[FIRSTHISTYEAR + date.year - nyear_spinup];
 
-	climate.temp  = dtemp[date.day];
-	climate.prec  = dprec[date.day];
-	climate.insol = dsun[date.day];
+	climate.temp  = state.dtemp[date.day];
+	climate.prec  = state.dprec[date.day];
+	climate.insol = state.dsun[date.day];
 
 	// Nitrogen deposition
-	climate.dndep = dndep[date.day];
+	climate.dndep = state.dndep[date.day];
 
 	// bvoc
 	if(ifbvoc){
-	  climate.dtr = ddtr[date.day];
+	  climate.dtr = state.ddtr[date.day];
 	}
 
 	// First day of year only ...
@@ -383,8 +389,10 @@ bool CRUInput::getclimate(Gridcell& gridcell) {
 
 		// Progress report to user and update timer
 
+		std::lock_guard<std::mutex> lock(progress_mutex);
+
 		if (tmute.getprogress()>=1.0) {
-			progress=(double)(gridlist.getobj().id*(nyear_spinup+NYEAR_HIST)
+			progress=(double)(state.position*(nyear_spinup+NYEAR_HIST)
 				+date.year)/(double)(gridlist.nobj*(nyear_spinup+NYEAR_HIST));
 			tprogress.setprogress(progress);
 			dprintf("%3d%% complete, %s elapsed, %s remaining\n",(int)(progress*100.0),
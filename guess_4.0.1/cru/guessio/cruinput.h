@@ -13,12 +13,15 @@
 #include "guess.h"
 #include "inputmodule.h"
 #include <vector>
+#include <memory>
 #include "gutil.h"
 #include "globalco2file.h"
 #include "spinupdata.h"
 #include "cru_ts30.h"
 #include "lamarquendep.h"
 #include "externalinput.h"
+#include "perthread.h"
+#include <mutex>
 
 /// An input module for CRU climate data
 /** This input module gets climate data from binary archives built from
@@ -42,6 +45,15 @@ public:
 	/// See base class for documentation about this function's responsibilities
 	bool getgridcell(Gridcell& gridcell);
 
+	/// See base class for documentation about this function's responsibilities
+	int gridlist_size() const { return gridlist.nobj; }
+
+	/// See base class for documentation about this function's responsibilities
+	int simulated_years() const { return nyear_spinup + NYEAR_HIST; }
+
+	/// See base class for documentation about this function's responsibilities
+	bool getgridcell_at(Gridcell& gridcell, int index);
+
 	/// See base class for documentation about this function's responsibilities
 	bool getclimate(Gridcell& gridcell);
 
@@ -49,7 +61,7 @@ public:
 	void getlandcover(Gridcell& gridcell);
 
 	/// Obtains land management data for one day
-	void getmanagement(Gridcell& gridcell) {management_input.getmanagement(gridcell);}
+	void getmanagement(Gridcell& gridcell) {landuse_input.getmanagement(gridcell);}
 
 	// Constants associated with historical climate data set
 
@@ -72,8 +84,8 @@ protected:
 	 *  distribution of monthly values to daily values.
 	 *
 	 *  The ndep values returned are for the current gridcell,
-	 *  i.e. the gridcell chosen in the most recent call to
-	 *  getgridcell().
+	 *  i.e. the gridcell chosen in the calling thread's most
+	 *  recent call to getgridcell() or getgridcell_at().
 	 *
 	 *  \param calendar_year The calendar (not simulation!) year for which to get ndep
 	 *  \param mndrydep      Pointer to array holding 12 doubles
@@ -112,24 +124,101 @@ private:
 		xtring descrip;
 	};
 
-	/// Land cover input module
-	LandcoverInput landcover_input;
-	/// Management input module
-	ManagementInput management_input;
+	/// What each thread keeps for the grid cell it is simulating
+	/** The module is shared by all threads simulating grid cells, everything
+	 *  else in it is read-only after init(). */
+	struct ThreadState {
+		ThreadState()
+			: position(-1),
+			  spinup_mtemp(NYEAR_SPINUP_DATA),
+			  spinup_mprec(NYEAR_SPINUP_DATA),
+			  spinup_msun(NYEAR_SPINUP_DATA),
+			  spinup_mfrs(NYEAR_SPINUP_DATA),
+			  spinup_mwet(NYEAR_SPINUP_DATA),
+			  spinup_mdtr(NYEAR_SPINUP_DATA) {}
+
+		/// Position in gridlist of the current grid cell, -1 before the first one
+		int position;
+
+		/// Monthly temperature for current grid cell and historical period
+		double hist_mtemp[NYEAR_HIST][12];
+
+		/// Monthly precipitation for current grid cell and historical period
+		double hist_mprec[NYEAR_HIST][12];
+
+		/// Monthly sunshine for current grid cell and historical period
+		double hist_msun[NYEAR_HIST][12];
+
+		/// Monthly frost days for current grid cell and historical period
+		double hist_mfrs[NYEAR_HIST][12];
+
+		/// Monthly precipitation days for current grid cell and historical period
+		double hist_mwet[NYEAR_HIST][12];
+
+		/// Monthly DTR (diurnal temperature range) for current grid cell and historical period
+		double hist_mdtr[NYEAR_HIST][12];
+
+		/// Nitrogen deposition forcing for current gridcell
+		Lamarque::NDepData ndep;
+
+		/// Spinup data for current grid cell - temperature
+		Spinup_data spinup_mtemp;
+		/// Spinup data for current grid cell - precipitation
+		Spinup_data spinup_mprec;
+		/// Spinup data for current grid cell - sunshine
+		Spinup_data spinup_msun;
+
+		/// Spinup data for current grid cell - frost days
+		Spinup_data spinup_mfrs;
+		/// Spinup data for current grid cell - precipitation days
+		Spinup_data spinup_mwet;
+		/// Spinup data for current grid cell - DTR (diurnal temperature range)
+		Spinup_data spinup_mdtr;
+
+		/// Daily temperature for current year
+		double dtemp[Date::MAX_YEAR_LENGTH];
+		/// Daily precipitation for current year
+		double dprec[Date::MAX_YEAR_LENGTH];
+		/// Daily sunshine for current year
+		double dsun[Date::MAX_YEAR_LENGTH];
+		// Daily diurnal temperature range for current year
+		double ddtr[Date::MAX_YEAR_LENGTH];
+		/// Daily N deposition for current year
+		double dndep[Date::MAX_YEAR_LENGTH];
+	};
+
+	PerThread<ThreadState> thread_state;
+
+	/// Sets up gridcell for the grid cell at state.position in the gridlist
+	/** If data can't be loaded for it, the function moves on to the next
+	 *  grid cell if skip_ahead is true, otherwise it returns false. */
+	bool load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead);
+
+	/// Land cover and management input
+	LanduseInput landuse_input;
 
 	/// search radius to use when finding CRU data
 	double searchradius;
 
+	/// The CRU archives, opened in init() and kept open for the run
+	std::auto_ptr<CRU_TS30::CRUArchive> cru_archive;
+
+	/// Serializes the searches in cru_archive from several threads
+	std::mutex archive_mutex;
+
+	/// Nitrogen deposition archive
+	xtring file_ndep;
+
 	/// A list of Coord objects containing coordinates of the grid cells to simulate
 	ListArray_id<Coord> gridlist;
 
-	/// Flag for getgridcell(). True indicates that the first gridcell has not been read yet by getgridcell()
-	bool first_call;
-
 	// Timers for keeping track of progress through the simulation
 	Timer tprogress,tmute;
 	static const int MUTESEC=20; // minimum number of sec to wait between progress messages
 
+	/// Serializes the progress reports from several threads
+	std::mutex progress_mutex;
+
 	/// Yearly CO2 data read from file
 	/**
 	 * This object is indexed with calendar years, so to get co2 value for
@@ -137,52 +226,6 @@ private:
 	 * more information.
 	 */
 	GlobalCO2File co2;
-
-	/// Monthly temperature for current grid cell and historical period
-	double hist_mtemp[NYEAR_HIST][12];
-
-	/// Monthly precipitation for current grid cell and historical period
-	double hist_mprec[NYEAR_HIST][12];
-
-	/// Monthly sunshine for current grid cell and historical period
-	double hist_msun[NYEAR_HIST][12];
-
-	/// Monthly frost days for current grid cell and historical period
-	double hist_mfrs[NYEAR_HIST][12];
-
-	/// Monthly precipitation days for current grid cell and historical period
-	double hist_mwet[NYEAR_HIST][12];
-
-	/// Monthly DTR (diurnal temperature range) for current grid cell and historical period
-	double hist_mdtr[NYEAR_HIST][12];
-
-	/// Nitrogen deposition forcing for current gridcell
-	Lamarque::NDepData ndep;
-
-	/// Spinup data for current grid cell - temperature
-	Spinup_data spinup_mtemp;
-	/// Spinup data for current grid cell - precipitation
-	Spinup_data spinup_mprec;
-	/// Spinup data for current grid cell - sunshine
-	Spinup_data spinup_msun;
-
-	/// Spinup data for current grid cell - frost days
-	Spinup_data spinup_mfrs;
-	/// Spinup data for current grid cell - precipitation days
-	Spinup_data spinup_mwet;
-	/// Spinup data for current grid cell - DTR (diurnal temperature range)
-	Spinup_data spinup_mdtr;
-
-	/// Daily temperature for current year
-	double dtemp[Date::MAX_YEAR_LENGTH];
-	/// Daily precipitation for current year
-	double dprec[Date::MAX_YEAR_LENGTH];
-	/// Daily sunshine for current year
-	double dsun[Date::MAX_YEAR_LENGTH];
-	// Daily diurnal temperature range for current year
-	double ddtr[Date::MAX_YEAR_LENGTH];
-	/// Daily N deposition for current year
-	double dndep[Date::MAX_YEAR_LENGTH];
 };
 
 #endif // LPJ_GUESS_CRUINPUT_H
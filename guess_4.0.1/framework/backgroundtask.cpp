@@ -0,0 +1,87 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file backgroundtask.cpp
+/// \brief A thread for doing work in the background, one task at a time
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "backgroundtask.h"
+
+BackgroundTask::BackgroundTask()
+	: stopping(false) {
+
+	thread = std::thread(&BackgroundTask::thread_main, this);
+}
+
+BackgroundTask::~BackgroundTask() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (task) {
+			done_signal.wait(lock);
+		}
+		stopping = true;
+	}
+	start_signal.notify_one();
+
+	thread.join();
+}
+
+void BackgroundTask::start(const std::function<void()>& new_task) {
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = new_task;
+	}
+	start_signal.notify_one();
+}
+
+void BackgroundTask::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (task) {
+		done_signal.wait(lock);
+	}
+
+	if (error) {
+		std::exception_ptr e = error;
+		error = std::exception_ptr();
+		std::rethrow_exception(e);
+	}
+}
+
+void BackgroundTask::thread_main() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		while (!task && !stopping) {
+			start_signal.wait(lock);
+		}
+
+		if (!task) {
+			// stopping, and nothing left to do
+			return;
+		}
+
+		lock.unlock();
+
+		std::exception_ptr task_error;
+		try {
+			task();
+		}
+		catch (...) {
+			task_error = std::current_exception();
+		}
+
+		lock.lock();
+		error = task_error;
+		task = nullptr;
+		done_signal.notify_all();
+	}
+}
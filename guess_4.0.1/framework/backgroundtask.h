@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file backgroundtask.h
+/// \brief A thread for doing work in the background, one task at a time
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_BACKGROUND_TASK_H
+#define LPJ_GUESS_BACKGROUND_TASK_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/// Runs tasks on a thread of its own while the calling thread does something else
+/** Used for instance by input modules to read the forcing data for the next
+ *  grid cell while the current one is simulated.
+ *
+ *  Only one task runs at a time, starting a new one waits for the previous
+ *  one to finish. The thread is started once and kept waiting between tasks.
+ */
+class BackgroundTask {
+public:
+	/// Starts the thread
+	BackgroundTask();
+
+	/// Waits for the current task to finish and stops the thread
+	/** An exception thrown by the task is ignored at this point. */
+	~BackgroundTask();
+
+	/// Runs task on the background thread
+	/** Waits for the previous task first, see wait(). */
+	void start(const std::function<void()>& task);
+
+	/// Waits until the current task (if any) is finished
+	/** If the task threw an exception, it is thrown again here. */
+	void wait();
+
+private:
+	/// The work done by the thread
+	void thread_main();
+
+	std::thread thread;
+
+	std::mutex mutex;
+
+	/// Signals the thread that a task has been started (or that it should stop)
+	std::condition_variable start_signal;
+
+	/// Signals wait() that the task is done
+	std::condition_variable done_signal;
+
+	/// The current task, empty when the thread is idle
+	std::function<void()> task;
+
+	/// Exception thrown by the last task, if any
+	std::exception_ptr error;
+
+	bool stopping;
+
+	// Not copyable
+	BackgroundTask(const BackgroundTask&);
+	BackgroundTask& operator=(const BackgroundTask&);
+};
+
+#endif // LPJ_GUESS_BACKGROUND_TASK_H
@@ -26,11 +26,32 @@ std::string tolower(const char* str) {
 	return result;
 }
 
+/// Parses the number of threads given after option argv[i]
+/** On success, i is moved past the number. */
+bool parse_thread_count(int argc, char** argv, int& i, int& count) {
+	if (i+1 >= argc) {
+		fprintf(stderr, "Missing argument after %s\n", argv[i]);
+		return false;
+	}
+
+	count = atoi(argv[i + 1]);
+	if (count < 1) {
+		fprintf(stderr, "Invalid number of threads: \"%s\"\n", argv[i + 1]);
+		return false;
+	}
+
+	++i; // skip the next argument
+	return true;
+}
+
 }
 
 CommandLineArguments::CommandLineArguments(int argc, char** argv)
 : help(false),
   parallel(false),
+  dynamic(false),
+  threads(1),
+  stand_threads(1),
   input_module("cru_ncep") {
 
 	driver_file = "";
@@ -56,6 +77,19 @@ bool CommandLineArguments::parse_arguments(int argc, char** argv) {
 			else if (option == "-parallel") {
 				parallel = true;
 			}
+			else if (option == "-dynamic") {
+				dynamic = true;
+			}
+			else if (option == "-threads") {
+				if (!parse_thread_count(argc, argv, i, threads)) {
+					return false;
+				}
+			}
+			else if (option == "-standthreads") {
+				if (!parse_thread_count(argc, argv, i, stand_threads)) {
+					return false;
+				}
+			}
       else if (option == "-landlab") {
         landlab_mode = true;
       }
@@ -111,7 +145,7 @@ bool CommandLineArguments::parse_arguments(int argc, char** argv) {
 }
 
 void CommandLineArguments::print_usage(const char* command_name) const {
-	fprintf(stderr, "\nUsage: %s [-parallel] [-landlab] [-input <module_name> [<GetClim-driver-file-path>] ] <instruction-script-filename> | -help\n",
+	fprintf(stderr, "\nUsage: %s [-parallel [-dynamic]] [-threads <n>] [-standthreads <n>] [-landlab] [-input <module_name> [<GetClim-driver-file-path>] ] <instruction-script-filename> | -help\n",
 			  command_name);
 	exit(EXIT_FAILURE);
 }
@@ -124,6 +158,18 @@ bool CommandLineArguments::get_parallel() const {
 	return parallel;
 }
 
+bool CommandLineArguments::get_dynamic() const {
+	return dynamic;
+}
+
+int CommandLineArguments::get_threads() const {
+	return threads;
+}
+
+int CommandLineArguments::get_stand_threads() const {
+	return stand_threads;
+}
+
 const char* CommandLineArguments::get_instruction_file() const {
 	return insfile.c_str();
 }
@@ -29,6 +29,15 @@ public:
 	/// Returns true if the user has specified the parallel option
 	bool get_parallel() const;
 
+	/// Returns true if grid cells should be handed out on demand in a parallel run (the -dynamic option)
+	bool get_dynamic() const;
+
+	/// Returns the number of threads simulating grid cells (1 unless -threads is used)
+	int get_threads() const;
+
+	/// Returns the number of threads simulating the stands of a grid cell (1 unless -standthreads is used)
+	int get_stand_threads() const;
+
 	/// Returns the chosen (or default) input module
 	const char* get_input_module() const;
 
@@ -51,6 +60,15 @@ private:
 	/// Whether the user requested a parallel run
 	bool parallel;
 
+	/// Whether rank 0 should hand out grid cells to the other processes on demand
+	bool dynamic;
+
+	/// Number of grid cells to simulate at once within this process
+	int threads;
+
+	/// Number of threads sharing the stands of each grid cell
+	int stand_threads;
+
   /// Wether the user requested to couple LPJ_GUESS with landlab
   bool landlab_mode;
 
@@ -0,0 +1,158 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file costmodel.cpp
+/// \brief Estimates of the simulation cost of grid cells, and cost-balanced gridlists
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "costmodel.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+/// Beginning of the log file line written for each finished grid cell
+const char* TIMING_PREFIX = "Gridcell wall time";
+
+/// Orders item indices by decreasing cost (ties in original order)
+struct MoreExpensive {
+	MoreExpensive(const std::vector<double>& c) : costs(c) {}
+
+	bool operator()(int a, int b) const {
+		if (costs[a] != costs[b]) {
+			return costs[a] > costs[b];
+		}
+		return a < b;
+	}
+
+	const std::vector<double>& costs;
+};
+
+}
+
+double GridcellTiming::work() const {
+	return GridcellCostModel::work(patches, years, subdaily);
+}
+
+std::string format_gridcell_timing(const GridcellTiming& timing) {
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "%s (%g,%g): %.3f s, %d patches, %d years, %d steps/day\n",
+	         TIMING_PREFIX, timing.lon, timing.lat, timing.seconds,
+	         timing.patches, timing.years, timing.subdaily);
+	return buffer;
+}
+
+bool parse_gridcell_timing(const char* line, GridcellTiming& timing) {
+	const char* start = strstr(line, TIMING_PREFIX);
+	if (!start) {
+		return false;
+	}
+
+	std::string format = std::string(TIMING_PREFIX) +
+		" (%lf,%lf): %lf s, %d patches, %d years, %d steps/day";
+
+	return sscanf(start, format.c_str(), &timing.lon, &timing.lat, &timing.seconds,
+	              &timing.patches, &timing.years, &timing.subdaily) == 6;
+}
+
+GridcellCostModel::GridcellCostModel()
+	: overhead(0),
+	  per_work(1),
+	  calibrated(false) {
+}
+
+double GridcellCostModel::work(int patches, int years, int subdaily) {
+	return (double)patches * years * std::max(subdaily, 1);
+}
+
+double GridcellCostModel::cost(double work) const {
+	return overhead + per_work * work;
+}
+
+bool GridcellCostModel::calibrate(const std::vector<GridcellTiming>& timings) {
+	if (timings.empty()) {
+		return false;
+	}
+
+	const double n = (double)timings.size();
+
+	double sum_x = 0, sum_y = 0;
+	for (size_t i = 0; i < timings.size(); i++) {
+		sum_x += timings[i].work();
+		sum_y += timings[i].seconds;
+	}
+
+	const double mean_x = sum_x / n;
+	const double mean_y = sum_y / n;
+
+	double var_x = 0, cov_xy = 0;
+	for (size_t i = 0; i < timings.size(); i++) {
+		const double dx = timings[i].work() - mean_x;
+		var_x += dx * dx;
+		cov_xy += dx * (timings[i].seconds - mean_y);
+	}
+
+	if (var_x > 1e-6 * mean_x * mean_x * n) {
+		per_work = cov_xy / var_x;
+		overhead = mean_y - per_work * mean_x;
+	}
+	else {
+		// All grid cells needed about the same work, can't tell
+		// overhead from work
+		overhead = -1;
+	}
+
+	if (overhead < 0 || per_work <= 0) {
+		// Fit through the origin instead
+		overhead = 0;
+		per_work = sum_x > 0 ? sum_y / sum_x : 0;
+	}
+
+	if (per_work <= 0) {
+		// No work at all, treat all grid cells as equally expensive
+		overhead = mean_y;
+		per_work = 0;
+	}
+
+	calibrated = true;
+	return true;
+}
+
+bool GridcellCostModel::is_calibrated() const {
+	return calibrated;
+}
+
+double GridcellCostModel::get_overhead() const {
+	return overhead;
+}
+
+double GridcellCostModel::get_per_work() const {
+	return per_work;
+}
+
+std::vector<int> partition_by_cost(const std::vector<double>& costs, int nparts) {
+	std::vector<int> order(costs.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = (int)i;
+	}
+	std::sort(order.begin(), order.end(), MoreExpensive(costs));
+
+	std::vector<int> part_of(costs.size(), 0);
+	std::vector<double> totals(std::max(nparts, 1), 0.0);
+
+	for (size_t i = 0; i < order.size(); i++) {
+		const int cheapest = (int)(std::min_element(totals.begin(), totals.end()) - totals.begin());
+		part_of[order[i]] = cheapest;
+		totals[cheapest] += costs[order[i]];
+	}
+
+	return part_of;
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file costmodel.h
+/// \brief Estimates of the simulation cost of grid cells, and cost-balanced gridlists
+///
+/// Used by the guess_partition tool to split a gridlist into parts which
+/// take about the same time to simulate, for parallel runs where each
+/// process simulates a fixed part of the gridlist.
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_COST_MODEL_H
+#define LPJ_GUESS_COST_MODEL_H
+
+#include <string>
+#include <vector>
+
+/// Simulation time of one grid cell from an earlier run
+/** Parsed from the line written to the log file at the end of
+ *  each grid cell (see format_gridcell_timing).
+ */
+struct GridcellTiming {
+	double lon;
+	double lat;
+
+	/// Wall time in seconds
+	double seconds;
+
+	/// Total number of patches in all stands of the grid cell
+	int patches;
+
+	/// Number of simulated years
+	int years;
+
+	/// Number of sub-daily time steps (1 in daily mode)
+	int subdaily;
+
+	/// The amount of work the grid cell needed, see GridcellCostModel::work()
+	double work() const;
+};
+
+/// Formats the log file line for a finished grid cell
+std::string format_gridcell_timing(const GridcellTiming& timing);
+
+/// Parses a log file line written by format_gridcell_timing
+/** \returns false if the line isn't a grid cell timing line */
+bool parse_gridcell_timing(const char* line, GridcellTiming& timing);
+
+/// Linear model of the wall time needed to simulate a grid cell
+/** Almost all of the time is spent in the daily loop through the
+ *  patches, so the model is
+ *
+ *    seconds = overhead + per_work * patches * years * subdaily
+ *
+ *  where patches is the total over all stands (one stand per landform,
+ *  and npatch patches per stand, which is forced to 1 in population mode).
+ *
+ *  Without calibration the estimates are in arbitrary units
+ *  (overhead 0, per_work 1), which is enough for balancing.
+ */
+class GridcellCostModel {
+public:
+	GridcellCostModel();
+
+	/// The amount of work needed to simulate a grid cell
+	static double work(int patches, int years, int subdaily);
+
+	/// Estimated cost of a grid cell needing the given amount of work
+	double cost(double work) const;
+
+	/// Fits the model to simulation times from an earlier run
+	/** Least squares fit of overhead and per_work. If the timings don't
+	 *  vary enough in work to separate the two, the overhead is set to zero.
+	 *
+	 *  \returns false (and leaves the model unchanged) if there are no timings
+	 */
+	bool calibrate(const std::vector<GridcellTiming>& timings);
+
+	/// Whether the estimates are in seconds
+	bool is_calibrated() const;
+
+	double get_overhead() const;
+
+	double get_per_work() const;
+
+private:
+	double overhead;
+	double per_work;
+	bool calibrated;
+};
+
+/// Splits a set of items into parts with about the same total cost
+/** Greedy largest-first bin packing: the items are handed out in order
+ *  of decreasing cost, each to the part with the lowest total so far.
+ *
+ *  \param costs  The cost of each item
+ *  \param nparts Number of parts
+ *  \returns The part (0 to nparts-1) for each item
+ */
+std::vector<int> partition_by_cost(const std::vector<double>& costs, int nparts);
+
+#endif // LPJ_GUESS_COST_MODEL_H
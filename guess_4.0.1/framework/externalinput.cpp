@@ -1173,4 +1173,68 @@ void ManagementInput::getmanagement(Gridcell& gridcell) {
 		if(readNfert || readNfert_st)		
 			getNfert(gridcell);
 	}
-}
\ No newline at end of file
+}
+std::mutex LanduseInput::mutex;
+
+void LanduseInput::init() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	landcover_input.init();
+	management_input.init();
+
+	init_thread = std::this_thread::get_id();
+}
+
+LanduseInput::Inputs& LanduseInput::inputs() {
+
+	Inputs& objects = thread_inputs.get();
+
+	if (!objects.landcover) {
+		if (std::this_thread::get_id() == init_thread) {
+			objects.landcover = &landcover_input;
+			objects.management = &management_input;
+		}
+		else {
+			// Created after the instruction file has been read, so they get the
+			// same parameter values as the first objects (see declare_parameter)
+			objects.landcover = new LandcoverInput;
+			objects.management = new ManagementInput;
+			objects.owned = true;
+			objects.landcover->init();
+			objects.management->init();
+		}
+	}
+
+	return objects;
+}
+
+bool LanduseInput::loadlanduse(double lon, double lat) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Inputs& objects = inputs();
+
+	bool LUerror = objects.landcover->loadlandcover(lon, lat);
+	if (!LUerror) {
+		LUerror = objects.management->loadmanagement(lon, lat);
+	}
+	return LUerror;
+}
+
+void LanduseInput::getlandcover(Gridcell& gridcell) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Inputs& objects = inputs();
+
+	objects.landcover->getlandcover(gridcell);
+	objects.landcover->get_land_transitions(gridcell);
+}
+
+void LanduseInput::getmanagement(Gridcell& gridcell) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	inputs().management->getmanagement(gridcell);
+}
@@ -9,6 +9,9 @@
 #define LPJ_GUESS_EXTERNALINPUT_H
 
 #include "indata.h"
+#include "perthread.h"
+#include <mutex>
+#include <thread>
 
 using namespace InData;
 
@@ -106,4 +109,59 @@ private:
 	void getNfert(Gridcell& gridcell);
 };
 
+/// Land cover and management input for an input module shared by several threads
+/** LandcoverInput and ManagementInput keep the data for the grid cell being
+ *  simulated, so each thread simulating grid cells needs objects of its own.
+ *  The thread calling init() uses the objects created with the input module,
+ *  which declare the instruction file parameters, other threads get their
+ *  own objects the first time they load a grid cell.
+ *
+ *  All calls are serialized, since the objects step through the global
+ *  stlist, pftlist and mtlist, and init() may change them.
+ */
+class LanduseInput {
+
+public:
+
+	/// Opens land cover and management input files
+	void init();
+	/// Loads land cover and management data for the calling thread's grid cell
+	/** \returns true if the data couldn't be loaded, like loadlandcover() */
+	bool loadlanduse(double lon, double lat);
+	/// Gets land cover fractions and transitions for a year
+	void getlandcover(Gridcell& gridcell);
+	/// Gets management data for a year
+	void getmanagement(Gridcell& gridcell);
+
+private:
+
+	/// The objects used by one thread
+	struct Inputs {
+		Inputs() : landcover(0), management(0), owned(false) {}
+		~Inputs() {
+			if (owned) {
+				delete landcover;
+				delete management;
+			}
+		}
+		LandcoverInput* landcover;
+		ManagementInput* management;
+		bool owned;
+	};
+
+	/// The calling thread's objects, opened if needed
+	Inputs& inputs();
+
+	/// Used by the thread which called init()
+	LandcoverInput landcover_input;
+	ManagementInput management_input;
+
+	std::thread::id init_thread;
+
+	PerThread<Inputs> thread_inputs;
+
+	/// Serializes all use of LandcoverInput and ManagementInput objects
+	static std::mutex mutex;
+};
+
 #endif // LPJ_GUESS_EXTERNALINPUT_H
\ No newline at end of file
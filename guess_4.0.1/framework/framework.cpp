@@ -17,6 +17,7 @@
 #include "commandlinearguments.h"
 #include "guessserializer.h"
 #include "parallel.h"
+#include "workerpool.h"
 
 #include "inputmodule.h"
 #include "driver.h"
@@ -28,8 +29,17 @@
 #include "landcover.h"
 #include "bvoc.h"
 #include "commonoutput.h"
+#include "costmodel.h"
+#include "profiler.h"
+#include "archive.h"
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 /// Prints the date and time together with the name of this simulation
 void print_logfile_heading() {
@@ -45,6 +55,105 @@ void print_logfile_heading() {
 	        dashed_line.c_str(), (char*)title, dashed_line.c_str());
 }
 
+/// Simulate one day for the patches of a given Stand
+/**
+ * Called by simulate_day once the day's climate for the stand has been
+ * set up. Only touches the stand itself, so different stands can be
+ * simulated in parallel as long as there are no land cover changes.
+ *
+ * \param stand               The stand to simulate
+ */
+void simulate_stand_day(Stand& stand) {
+
+	stand.firstobj();
+	while (stand.isobj) {
+		// START OF LOOP THROUGH PATCHES
+
+		// Get reference to this patch
+		Patch& patch = stand.getobj();
+		// Update daily soil drivers including soil temperature
+		{
+			GuessProfiler::Timer timer(GuessProfiler::DAILYACCOUNTING);
+			dailyaccounting_patch(patch);
+		}
+
+		// Determine nitrogen fertilisation amount
+		if(run_landcover)
+			nfert(patch);
+
+		if (stand.landcover == CROPLAND) {
+			// Calculate crop sowing dates
+			crop_sowing_patch(patch);
+			// Crop phenology
+			crop_phenology(patch);
+			// necessary updates after changing growingperiod status
+			update_patch_fpc(patch);
+		}
+
+      // cw SubPixel - we now pass stand.local_climate instead of gridcell.climate
+		// Leaf phenology for PFTs and individuals
+		{
+			GuessProfiler::Timer timer(GuessProfiler::LEAF_PHENOLOGY);
+			leaf_phenology(patch, stand.local_climate);	// gridcell.climate);
+		}
+		// Interception
+		{
+			GuessProfiler::Timer timer(GuessProfiler::INTERCEPTION);
+			interception(patch, stand.local_climate);   // gridcell.climate);
+			initial_infiltration(patch, stand.local_climate); // gridcell.climate);
+		}
+		// Photosynthesis, respiration, evapotranspiration
+		{
+			GuessProfiler::Timer timer(GuessProfiler::CANOPY_EXCHANGE);
+			canopy_exchange(patch, stand.local_climate); // gridcell.climate);
+		}
+		// Sum total required irrigation
+		irrigation(patch);
+		// Soil water accounting, snow pack accounting
+		{
+			GuessProfiler::Timer timer(GuessProfiler::SOILWATER);
+			soilwater(patch, stand.local_climate); // gridcell.climate);
+		}
+		// Daily C allocation (cropland)
+		{
+			GuessProfiler::Timer timer(GuessProfiler::GROWTH);
+			growth_daily(patch);
+		}
+		// Soil organic matter and litter dynamics
+		{
+			GuessProfiler::Timer timer(GuessProfiler::SOM_DYNAMICS);
+			som_dynamics(patch);
+		}
+
+		if (date.islastday && date.islastmonth) {
+
+			// LAST DAY OF YEAR
+			// Tissue turnover, allocation to new biomass and reproduction,
+			// updated allometry
+			GuessProfiler::Timer timer(GuessProfiler::GROWTH);
+			growth(stand, patch);
+		}
+		stand.nextobj();
+	}// End of loop through patches
+
+	// Update crop rotation status
+	crop_rotation(stand);
+
+	if (date.islastday && date.islastmonth) {
+		// LAST DAY OF YEAR
+		stand.firstobj();
+		while (stand.isobj) {
+
+			// For each patch ...
+			Patch& patch = stand.getobj();
+			// Establishment, mortality and disturbance by fire
+			GuessProfiler::Timer timer(GuessProfiler::VEGETATION_DYNAMICS);
+			vegetation_dynamics(stand, patch);
+			stand.nextobj();
+		}
+	}
+}
+
 /// Simulate one day for a given Gridcell
 /**
  * The climate object in the gridcell needs to be set up with
@@ -52,15 +161,22 @@ void print_logfile_heading() {
  *
  * \param gridcell            The gridcell to simulate
  * \param input_module        Used to get land cover fractions
+ * \param stand_pool          Threads for simulating the stands in parallel, or NULL
  */
-void simulate_day(Gridcell& gridcell, InputModule* input_module) {
+void simulate_day(Gridcell& gridcell, InputModule* input_module, WorkerPool* stand_pool) {
 
 	// Update daily climate drivers etc
     // cw SubPixel call dailaccounting on gridcell.climate
-	dailyaccounting_gridcell(gridcell, gridcell.climate);
+	{
+		GuessProfiler::Timer timer(GuessProfiler::DAILYACCOUNTING);
+		dailyaccounting_gridcell(gridcell, gridcell.climate);
+	}
 
 	// Calculate daylength, insolation and potential evapotranspiration
-	daylengthinsoleet(gridcell.climate);
+	{
+		GuessProfiler::Timer timer(GuessProfiler::DAYLENGTHINSOLEET);
+		daylengthinsoleet(gridcell.climate);
+	}
 
 	if (run_landcover) {
 		if (run[CROPLAND]) {
@@ -77,6 +193,49 @@ void simulate_day(Gridcell& gridcell, InputModule* input_module) {
 		}
 	}
 
+	// Without land cover changes (i.e. natural stands, one per landform
+	// in run_landform mode) the stands don't affect each other, so they
+	// can be simulated in parallel. Each stand goes through the same steps
+	// in the same order as below. On the first day of the year the daily
+	// accounting also resets grid cell level variables (and initialises
+	// some at the start of the simulation), so that day is simulated one
+	// stand at a time.
+	if (stand_pool && stand_pool->size() > 1 && !run_landcover && gridcell.size() > 1 &&
+	    date.day != 0) {
+
+		std::vector<Stand*> stands;
+
+		Gridcell::iterator gc_itr = gridcell.begin();
+		while (gc_itr != gridcell.end()) {
+			stands.push_back(&*gc_itr);
+			++gc_itr;
+		}
+
+		// date (and the profile) is one per thread, the pool's threads
+		// need today's date
+		const Date today = date;
+		GuessProfiler::Profile* profile = GuessProfiler::current_profile;
+
+		stand_pool->run((int)stands.size(), [&gridcell, &stands, &today, profile](int i) {
+			date = today;
+			GuessProfiler::current_profile = profile;
+
+			Stand& stand = *stands[i];
+			{
+				GuessProfiler::Timer timer(GuessProfiler::DAILYACCOUNTING);
+				dailyaccounting_stand(stand);
+				dailyaccounting_gridcell(gridcell, stand.local_climate);
+			}
+			{
+				GuessProfiler::Timer timer(GuessProfiler::DAYLENGTHINSOLEET);
+				daylengthinsoleet(stand.local_climate);
+			}
+
+			simulate_stand_day(stand);
+		});
+
+		return;
+	}
 
 	Gridcell::iterator gc_itr = gridcell.begin();
 	while (gc_itr != gridcell.end()) {
@@ -84,81 +243,579 @@ void simulate_day(Gridcell& gridcell, InputModule* input_module) {
 		// START OF LOOP THROUGH STANDS
 		Stand& stand = *gc_itr;
 
-		dailyaccounting_stand(stand);
+		{
+			GuessProfiler::Timer timer(GuessProfiler::DAILYACCOUNTING);
+			dailyaccounting_stand(stand);
 
-    // cw SubPixel call dailyaccounting on stand.local_climate
-    dailyaccounting_gridcell(gridcell, stand.local_climate);
-    daylengthinsoleet(stand.local_climate);
+			// cw SubPixel call dailyaccounting on stand.local_climate
+			dailyaccounting_gridcell(gridcell, stand.local_climate);
+		}
+		{
+			GuessProfiler::Timer timer(GuessProfiler::DAYLENGTHINSOLEET);
+			daylengthinsoleet(stand.local_climate);
+		}
 
-		stand.firstobj();
-		while (stand.isobj) {
-			// START OF LOOP THROUGH PATCHES
+		simulate_stand_day(stand);
 
-			// Get reference to this patch
-			Patch& patch = stand.getobj();
-			// Update daily soil drivers including soil temperature
-			dailyaccounting_patch(patch);
+		++gc_itr;
+	}	// End of loop through stands
+}
 
-			// Determine nitrogen fertilisation amount
-			if(run_landcover)
-				nfert(patch);
-
-			if (stand.landcover == CROPLAND) {
-				// Calculate crop sowing dates
-				crop_sowing_patch(patch);
-				// Crop phenology
-				crop_phenology(patch);
-				// necessary updates after changing growingperiod status
-				update_patch_fpc(patch);
-			}
 
-      // cw SubPixel - we now pass stand.local_climate instead of gridcell.climate
-			// Leaf phenology for PFTs and individuals
-      leaf_phenology(patch, stand.local_climate);	// gridcell.climate);
-			// Interception
-      interception(patch, stand.local_climate);   // gridcell.climate);
-      initial_infiltration(patch, stand.local_climate); // gridcell.climate);
-			// Photosynthesis, respiration, evapotranspiration
-      canopy_exchange(patch, stand.local_climate); // gridcell.climate);
-			// Sum total required irrigation
-			irrigation(patch);
-			// Soil water accounting, snow pack accounting
-      soilwater(patch, stand.local_climate); // gridcell.climate);
-			// Daily C allocation (cropland)
-			growth_daily(patch);
-			// Soil organic matter and litter dynamics
-			som_dynamics(patch);
+/// Calls getclimate on the input module, timed by the profiler
+bool get_climate(InputModule* input_module, Gridcell& gridcell) {
+	GuessProfiler::Timer timer(GuessProfiler::GETCLIMATE);
+	return input_module->getclimate(gridcell);
+}
+
+namespace {
+
+/// A scenario, and the modules its branch of each grid cell is simulated with
+struct ScenarioModules {
+	Scenario* scenario;
+	InputModule* input_module;
+	GuessOutput::OutputModuleContainer* output_modules;
+
+	/// Calendar year of the first simulation year, as set by the input module
+	int first_calendar_year;
+};
+
+/// Creates (and owns) the input and output modules of all the scenarios
+/** The modules are created and initialised with each scenario's
+ *  parameters (see ScenarioParameters).
+ */
+class ScenarioModuleList {
+public:
+	/// Creates the modules, after the ordinary modules have been initialised
+	ScenarioModuleList(const char* input_module_name,
+	                   GuessOutput::OutputModuleContainer& output_modules) {
+
+		// Initialising the input modules sets the calendar of the date,
+		// and the output modules set output_channel
+		const Date start_date = date;
 
-			if (date.islastday && date.islastmonth) {
+		for (unsigned int i = 0; i < scenariolist.nobj; i++) {
+			Scenario& scenario = scenariolist[i];
 
-				// LAST DAY OF YEAR
-				// Tissue turnover, allocation to new biomass and reproduction,
-				// updated allometry
-				growth(stand, patch);
+			if (scenario.strings.find("outputdirectory") == scenario.strings.end()) {
+				fail("Scenario \"%s\" needs an outputdirectory of its own", (char*)scenario.name);
 			}
-			stand.nextobj();
-		}// End of loop through patches
 
-		// Update crop rotation status
-		crop_rotation(stand);
+			ScenarioParameters parameters(scenario);
+
+			ScenarioModules m;
+			m.scenario = &scenario;
+
+			m.input_module = InputModuleRegistry::get_instance().create_input_module(input_module_name);
+			m.input_module->init();
+			m.first_calendar_year = date.get_calendar_year() - date.year;
+
+			m.output_modules = new GuessOutput::OutputModuleContainer;
+			GuessOutput::OutputModuleRegistry::get_instance().create_all_modules(*m.output_modules);
+			m.output_modules->init();
+
+			modules.push_back(m);
+		}
+
+		date = start_date;
+		GuessOutput::output_channel = output_modules.get_output_channel();
+	}
+
+	~ScenarioModuleList() {
+		for (size_t i = 0; i < modules.size(); i++) {
+			delete modules[i].input_module;
+			delete modules[i].output_modules;
+		}
+	}
+
+	bool empty() const {
+		return modules.empty();
+	}
+
+	size_t size() const {
+		return modules.size();
+	}
+
+	ScenarioModules& operator[](size_t i) {
+		return modules[i];
+	}
+
+	/// Calls outsimulation on the output modules of all scenarios
+	void outsimulation() {
+		GuessOutput::OutputChannel* channel = GuessOutput::output_channel;
+
+		for (size_t i = 0; i < modules.size(); i++) {
+			GuessOutput::output_channel = modules[i].output_modules->get_output_channel();
+			modules[i].output_modules->outsimulation();
+		}
+
+		GuessOutput::output_channel = channel;
+	}
+
+private:
+	std::vector<ScenarioModules> modules;
+
+	// Not copyable
+	ScenarioModuleList(const ScenarioModuleList&);
+	ScenarioModuleList& operator=(const ScenarioModuleList&);
+};
+
+/// A grid cell at the end of the spinup, which the scenarios start from
+struct BranchPoint {
+
+	/// Saves the grid cell and the current date
+	void save(Gridcell& gridcell) {
+		std::ostringstream stream;
+		ArchiveOutStream arch(stream);
+		serialize(arch, gridcell);
+		state = stream.str();
+		saved_date = date;
+	}
+
+	/// Replaces a grid cell (as loaded by an input module) with the saved one
+	void load(Gridcell& gridcell) const {
+		std::istringstream stream(state);
+		ArchiveInStream arch(stream);
+		serialize(arch, gridcell);
+	}
+
+	/// The serialized grid cell, empty until the spinup is done
+	std::string state;
+
+	/// The date on the first day after the spinup
+	Date saved_date;
+
+private:
+	/// The grid cell as in state files, and the stands' local climates
+	/** The local climates aren't in the state files, the stands get new
+	 *  ones, cloned from the grid cell's climate, when they are read in.
+	 *  That would make the branches differ from simulating the grid cell
+	 *  right through, so they are kept here.
+	 */
+	static void serialize(ArchiveStream& arch, Gridcell& gridcell) {
+		gridcell.serialize(arch);
+
+		for (Gridcell::iterator itr = gridcell.begin(); itr != gridcell.end(); ++itr) {
+			(*itr).local_climate.serialize(arch);
+		}
+	}
+};
+
+/// Simulates the days of a grid cell, until the input module has no more days
+/**
+ * \param gridcell       The gridcell to simulate, from the current date
+ * \param input_module   Input module which has loaded this grid cell
+ * \param output_modules Output modules to send results to
+ * \param serializer     For saving state at state_year, or NULL
+ * \param stand_pool     Threads for simulating the stands in parallel, or NULL
+ * \param branch_point   If not NULL, gets the grid cell as it is after the spinup
+ * \returns false if the user requested an abort
+ */
+bool simulate_days(Gridcell& gridcell,
+                   InputModule* input_module,
+                   GuessOutput::OutputModuleContainer& output_modules,
+                   GuessSerializer* serializer,
+                   WorkerPool* stand_pool,
+                   BranchPoint* branch_point) {
+
+	while (true) {
+
+		if (branch_point && branch_point->state.empty() && date.year >= nyear_spinup) {
+			// End of spinup, save the grid cell for the scenarios
+			branch_point->save(gridcell);
+		}
+
+		// Call input/output to obtain climate, insolation and CO2 for this
+		// day of the simulation. Function getclimate returns false if last year
+		// has already been simulated for this grid cell
+		if (!get_climate(input_module, gridcell)) {
+			break;
+		}
+
+		// START OF LOOP THROUGH SIMULATION DAYS
+		simulate_day(gridcell, input_module, stand_pool);
+
+		{
+			GuessProfiler::Timer timer(GuessProfiler::OUTDAILY);
+			output_modules.outdaily(gridcell);
+		}
 
 		if (date.islastday && date.islastmonth) {
 			// LAST DAY OF YEAR
-			stand.firstobj();
-			while (stand.isobj) {
-
-				// For each patch ...
-				Patch& patch = stand.getobj();
-				// Establishment, mortality and disturbance by fire
-				vegetation_dynamics(stand, patch);
-				stand.nextobj();
+			// Call output module to output results for end of year
+			// or end of simulation for this grid cell
+			{
+				GuessProfiler::Timer timer(GuessProfiler::OUTANNUAL);
+				output_modules.outannual(gridcell);
+			}
+
+			gridcell.balance.check_year(gridcell);
+
+			// cw SubPixel extra logging
+			if (date.year >= nyear_spinup + spoutput_startyear-1)
+        dprintf("End of year: %d (%d) co2:%.2f ndep:%.2f\n", date.year, date.get_calendar_year(), gridcell.climate.co2, gridcell.climate.andep * 10000 );
+
+			// Time to save state?
+			if (date.year == state_year-1 && save_state && serializer) {
+				dprintf(" <<<<< dump: %d (%d)\n", date.year, date.get_calendar_year());
+
+				serializer->serialize_gridcell(gridcell);
+			}
+
+			// Check whether to abort
+			if (abort_request_received()) {
+				return false;
 			}
 		}
 
-		++gc_itr;
-	}	// End of loop through stands
+		// Advance timer to next simulation day
+		date.next();
+
+		// End of loop through simulation days
+	}	//while (getclimate())
+
+	return true;
+}
+
+/// Simulates a scenario's branch of a grid cell, from the end of the spinup
+/**
+ * \param branch_point The grid cell at the end of the spinup
+ * \param index        The position of the grid cell in the gridlist
+ * \param scenario     The scenario and its modules
+ * \param stand_pool   Threads for simulating the stands in parallel, or NULL
+ * \param years        Incremented by the number of simulated years
+ * \returns false if the user requested an abort
+ */
+bool simulate_branch(const BranchPoint& branch_point,
+                     int index,
+                     ScenarioModules& scenario,
+                     WorkerPool* stand_pool,
+                     int& years) {
+
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	GuessProfiler::Profile profile;
+	GuessProfiler::current_profile = GuessProfiler::enabled ? &profile : 0;
+
+	date.init(1);
+	date.set_first_calendar_year(scenario.first_calendar_year);
+
+	Gridcell gridcell;
+
+	if (!scenario.input_module->getgridcell_at(gridcell, index)) {
+		dprintf("No data for scenario %s, skipping it for this grid cell\n", (char*)scenario.scenario->name);
+		GuessProfiler::current_profile = 0;
+		return true;
+	}
+
+	dprintf("Scenario %s\n", (char*)scenario.scenario->name);
+
+	GuessOutput::output_channel = scenario.output_modules->get_output_channel();
+
+	// As when restarting, the state replaces the grid cell from the input module
+	gridcell.climate.initdrivers(gridcell.get_lat());
+
+	branch_point.load(gridcell);
+
+	date = branch_point.saved_date;
+	date.set_first_calendar_year(scenario.first_calendar_year);
+
+	if (!simulate_days(gridcell, scenario.input_module, *scenario.output_modules,
+	                   0, stand_pool, 0)) {
+		GuessProfiler::current_profile = 0;
+		return false;
+	}
+
+	years += date.year - branch_point.saved_date.year;
+
+	gridcell.balance.check_period(gridcell);
+
+	if (GuessProfiler::current_profile) {
+		profile.add(GuessProfiler::TOTAL, std::chrono::steady_clock::now() - start_time);
+	}
+	scenario.output_modules->outgridcell(gridcell);
+	GuessProfiler::current_profile = 0;
+
+	return true;
 }
 
+}
+
+/// Simulates one grid cell from the first to the last simulation day
+/**
+ * The gridcell should already have been set up with a call to
+ * getgridcell (or getgridcell_at) in the input module.
+ *
+ * With scenarios, the grid cell is copied at the end of the spinup, and
+ * the copies are then simulated with the scenarios' modules.
+ *
+ * \param gridcell            The gridcell to simulate
+ * \param index               Position of the grid cell in the gridlist (only needed with scenarios)
+ * \param input_module        Input module which has loaded this grid cell
+ * \param output_modules      Output modules to send results to
+ * \param scenarios           The scenarios, or NULL
+ * \param serializer          For saving state at state_year, or NULL
+ * \param deserializer        For restarting from saved state, or NULL
+ * \param landform_serializer For the end of simulation dump in run_landform mode, or NULL
+ * \param stand_pool          Threads for simulating the stands in parallel, or NULL
+ * \returns false if the user requested an abort
+ */
+bool simulate_gridcell(Gridcell& gridcell,
+                       int index,
+                       InputModule* input_module,
+                       GuessOutput::OutputModuleContainer& output_modules,
+                       ScenarioModuleList* scenarios,
+                       GuessSerializer* serializer,
+                       GuessDeserializer* deserializer,
+                       GuessSerializer* landform_serializer,
+                       WorkerPool* stand_pool) {
+
+	// Wall time per grid cell is logged for the cost model (see costmodel.h)
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	// Time spent in each stage, if profiling is enabled
+	GuessProfiler::Profile profile;
+	GuessProfiler::current_profile = GuessProfiler::enabled ? &profile : 0;
+
+	// Initialise certain climate and soil drivers
+	gridcell.climate.initdrivers(gridcell.get_lat());
+
+	if (run_landcover && !restart) {
+		// Read landcover and cft fraction data from
+		// data files for the spinup period and create stands
+		landcover_init(gridcell, input_module);
+	}
+
+	if (restart) {
+		// Get the whole grid cell from file...
+		deserializer->deserialize_gridcell(gridcell);
+		// ...and jump to the restart year
+		date.year = state_year;
+
+    // cw SubPixel extra debugging
+    dprintf(" >>>>> read: %d (%d)\n", date.year, date.get_calendar_year());
+	}
+
+	const int first_year = date.year;
+
+	const bool branching = scenarios && !scenarios->empty();
+	BranchPoint branch_point;
+
+	if (!simulate_days(gridcell, input_module, output_modules, serializer, stand_pool,
+	                   branching ? &branch_point : 0)) {
+		GuessProfiler::current_profile = 0;
+		return false;
+	}
+
+  // cw SubPixel - end of sim autodump
+  //
+  // - triggered at the end of the sim (we always dump the state in run_landform)
+  // - dumping into a dedicated directory
+  if (run_landform) {
+      // reduce by one since ww already incremented the year
+      dprintf(" < autodump: %d (%d)\n", date.year-1, date.get_calendar_year()-1);
+      landform_serializer->serialize_gridcell(gridcell);
+  }
+
+	gridcell.balance.check_period(gridcell);
+
+	GridcellTiming timing;
+	timing.lon = gridcell.get_lon();
+	timing.lat = gridcell.get_lat();
+	timing.patches = 0;
+	for (Gridcell::iterator itr = gridcell.begin(); itr != gridcell.end(); ++itr) {
+		timing.patches += (*itr).npatch();
+	}
+	timing.years = date.year - first_year;
+	timing.subdaily = date.subdaily;
+
+	if (GuessProfiler::current_profile) {
+		profile.add(GuessProfiler::TOTAL, std::chrono::steady_clock::now() - start_time);
+	}
+	output_modules.outgridcell(gridcell);
+	GuessProfiler::current_profile = 0;
+
+	if (branching && !branch_point.state.empty()) {
+		for (size_t i = 0; i < scenarios->size(); i++) {
+			if (!simulate_branch(branch_point, index, (*scenarios)[i], stand_pool, timing.years)) {
+				GuessOutput::output_channel = output_modules.get_output_channel();
+				return false;
+			}
+		}
+
+		GuessOutput::output_channel = output_modules.get_output_channel();
+	}
+
+	// The cost of the grid cell includes the scenarios
+	timing.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	dprintf("%s", format_gridcell_timing(timing).c_str());
+
+	return true;
+}
+
+namespace {
+
+/// State shared by the threads simulating grid cells in parallel
+class GridcellScheduler {
+public:
+	/// Creates a scheduler for a gridlist with a given number of grid cells
+	/** \param order    The positions in the gridlist in the order to simulate
+	 *                  them, or empty for the order of the gridlist
+	 *                  (see InputModule::simulation_order())
+	 *  \param nthreads The number of threads simulating grid cells, which
+	 *                  decides how many grid cells may be buffered
+	 */
+	GridcellScheduler(int gridcells,
+	                  const std::vector<int>& order,
+	                  int nthreads,
+	                  GuessOutput::OutputChannel* output_channel)
+		: ngridcells(gridcells),
+		  order(order),
+		  max_pending(BUFFERED_PER_THREAD * nthreads),
+		  next_gridcell(0),
+		  next_to_write(0),
+		  aborted(false),
+		  file_channel(output_channel) {
+	}
+
+	/// Hands out the next grid cell to simulate
+	/** Waits while max_pending grid cells are simulated or waiting to be
+	 *  written, so a slow grid cell can't make the others pile up in memory.
+	 *
+	 *  \returns the position of the grid cell in the simulation order, or -1
+	 *           when there are no more grid cells, or if the simulation has
+	 *           been aborted
+	 */
+	int next() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!aborted && next_gridcell < ngridcells &&
+		       next_gridcell - next_to_write >= max_pending) {
+			written.wait(lock);
+		}
+		if (aborted || next_gridcell >= ngridcells) {
+			return -1;
+		}
+		return next_gridcell++;
+	}
+
+	/// The position in the gridlist of a grid cell handed out by next()
+	int gridlist_index(int position) const {
+		return order.empty() ? position : order[position];
+	}
+
+	/// Passes on the output for a finished grid cell
+	/** The output is written when all grid cells handed out before it are
+	 *  finished, so the output files end up in the same order as when
+	 *  simulating one grid cell at a time in the simulation order. That is
+	 *  the gridlist order, unless the input module simulates the gridlist
+	 *  in another order (the rows are told apart by their coordinates).
+	 *
+	 *  \param position The position of the grid cell in the simulation order
+	 *  \param rows     The output for the grid cell, or NULL if it was skipped
+	 */
+	void commit(int position, GuessOutput::RowBufferOutputChannel* rows) {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		finished[position] = rows;
+
+		std::map<int, GuessOutput::RowBufferOutputChannel*>::iterator itr;
+		while ((itr = finished.find(next_to_write)) != finished.end()) {
+			if (itr->second) {
+				itr->second->flush();
+				delete itr->second;
+				file_channel->gridcell_finished();
+			}
+			finished.erase(itr);
+			++next_to_write;
+		}
+
+		written.notify_all();
+	}
+
+	/// Tells the other threads to stop simulating new grid cells
+	void abort() {
+		std::lock_guard<std::mutex> lock(mutex);
+		aborted = true;
+		written.notify_all();
+	}
+
+	bool was_aborted() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return aborted;
+	}
+
+	/// The real output channel to which buffered output is flushed
+	GuessOutput::OutputChannel* output_channel() const {
+		return file_channel;
+	}
+
+private:
+	/// Grid cells each thread may be ahead of the oldest unfinished one
+	static const int BUFFERED_PER_THREAD = 4;
+
+	std::mutex mutex;
+
+	/// Signalled when output has been written, or the simulation aborted
+	std::condition_variable written;
+
+	int ngridcells;
+	std::vector<int> order;
+	int max_pending;
+	int next_gridcell;
+	int next_to_write;
+	bool aborted;
+	GuessOutput::OutputChannel* file_channel;
+	std::map<int, GuessOutput::RowBufferOutputChannel*> finished;
+};
+
+/// The work done by each thread when simulating grid cells in parallel
+void simulate_gridcells_in_thread(GridcellScheduler& scheduler,
+                                  InputModule* input_module,
+                                  Date start_date,
+                                  GuessOutput::OutputModuleContainer& output_modules,
+                                  GuessSerializer* serializer,
+                                  GuessDeserializer* deserializer,
+                                  GuessSerializer* landform_serializer,
+                                  int stand_threads) {
+
+	// Each thread has its own date, start from the state the input
+	// module left it in after initialisation (e.g. first calendar year)
+	date = start_date;
+
+	WorkerPool stand_pool(stand_threads);
+
+	int position;
+	while ((position = scheduler.next()) != -1) {
+
+		const int index = scheduler.gridlist_index(position);
+
+		// Output for this grid cell is kept in memory until it's
+		// the grid cell's turn to be written to the output files
+		GuessOutput::RowBufferOutputChannel* rows =
+			new GuessOutput::RowBufferOutputChannel(scheduler.output_channel());
+		GuessOutput::output_channel = rows;
+
+		date.init(1);
+
+		Gridcell gridcell;
+
+		if (!input_module->getgridcell_at(gridcell, index)) {
+			// Couldn't load data for this grid cell, skip it
+			delete rows;
+			rows = 0;
+		}
+		else if (!simulate_gridcell(gridcell, index, input_module, output_modules, 0,
+		                            serializer, deserializer, landform_serializer,
+		                            &stand_pool)) {
+			scheduler.abort();
+		}
+
+		GuessOutput::output_channel = 0;
+		scheduler.commit(position, rows);
+	}
+}
+
+}
 
 int framework(const CommandLineArguments& args) {
 
@@ -185,6 +842,12 @@ int framework(const CommandLineArguments& args) {
 	input_module->init();
 	output_modules.init();
 
+	// Modules for the scenarios, if any
+	ScenarioModuleList scenarios(input_module_name, output_modules);
+
+	// The order to simulate the gridlist in, empty for the order it's given in
+	const std::vector<int> order = input_module->simulation_order();
+
 	print_logfile_heading();
 
 	// Nitrogen limitation
@@ -232,94 +895,160 @@ int framework(const CommandLineArguments& args) {
 		deserializer = auto_ptr<GuessDeserializer>(new GuessDeserializer(state_path));
 	}
 
-	while (true) {
+	if (args.get_dynamic()) {
 
-		// START OF LOOP THROUGH GRID CELLS
+		// GRID CELLS HANDED OUT ON DEMAND BY RANK 0
 
-		// Initialise global variable date
-		// (argument nyear not used in this implementation)
-		date.init(1);
+		if (!args.get_parallel() || GuessParallel::get_num_processes() < 2) {
+			fail("The -dynamic option needs a parallel run with at least two processes");
+		}
 
-		// Create and initialise a new Gridcell object for each locality
-		Gridcell gridcell;
+		if (args.get_threads() > 1) {
+			fail("The -dynamic and -threads options can't be combined");
+		}
 
-		// Call input module to obtain latitude and driver data for this grid cell.
-		if (!input_module->getgridcell(gridcell)) {
-			break;
+		// All processes read the full gridlist, grid cells are
+		// identified by their position in it
+		if (input_module->gridlist_size() < 0) {
+			fail("Input module %s doesn't support the -dynamic option", input_module_name);
+		}
+
+		if (GuessParallel::get_rank() == 0) {
+			dprintf("Handing out grid cells to the other processes\n");
+			return GuessParallel::distribute_gridcells(input_module->gridlist_size()) ? 0 : 99;
+		}
+
+		WorkerPool stand_pool(args.get_stand_threads());
+
+		int first, count;
+		while (GuessParallel::request_gridcells(first, count)) {
+			for (int position = first; position < first + count; position++) {
+
+				const int index = order.empty() ? position : order[position];
+
+				date.init(1);
+
+				Gridcell gridcell;
+
+				if (!input_module->getgridcell_at(gridcell, index)) {
+					// Couldn't load data for this grid cell, skip it
+					continue;
+				}
+
+				if (!simulate_gridcell(gridcell, index, input_module.get(), output_modules, &scenarios,
+				                       serializer.get(), deserializer.get(), landform_serializer.get(),
+				                       &stand_pool)) {
+					GuessParallel::abandon_gridcells();
+					return 99;
+				}
+			}
 		}
 
-		// Initialise certain climate and soil drivers
-		gridcell.climate.initdrivers(gridcell.get_lat());
+		output_modules.outsimulation();
+		scenarios.outsimulation();
+
+		return 0;
+	}
+
+	if (args.get_threads() > 1 || !order.empty()) {
 
-		if (run_landcover && !restart) {
-			// Read landcover and cft fraction data from
-			// data files for the spinup period and create stands
-			landcover_init(gridcell, input_module.get());
+		// SIMULATE SEVERAL GRID CELLS AT ONCE, OR OUT OF GRIDLIST ORDER
+
+		// In both cases output is buffered per grid cell, and written
+		// in simulation order by the scheduler
+
+		const int nthreads = args.get_threads();
+
+		const char* option = nthreads > 1 ? "the -threads option" : "gridlist_order";
+
+		if (input_module->gridlist_size() < 0) {
+			fail("Input module %s doesn't support the -threads option", input_module_name);
 		}
 
-		if (restart) {
-			// Get the whole grid cell from file...
-			deserializer->deserialize_gridcell(gridcell);
-			// ...and jump to the restart year
-			date.year = state_year;
+		if (printseparatestands) {
+			fail("printseparatestands can't be used with %s", option);
+		}
 
-      // cw SubPixel extra debugging
-      dprintf(" >>>>> read: %d (%d)\n", date.year, date.get_calendar_year());
+		if (!scenarios.empty()) {
+			fail("Scenarios can't be used with %s", option);
 		}
 
-		// Call input/output to obtain climate, insolation and CO2 for this
-		// day of the simulation. Function getclimate returns false if last year
-		// has already been simulated for this grid cell
+		if (nthreads > 1) {
+			dprintf("Simulating grid cells with %d threads\n", nthreads);
+		}
 
-		while (input_module->getclimate(gridcell)) {
+		// The threads share the input module, which keeps the data for
+		// each thread's grid cell separately (see InputModule::getgridcell_at)
+		GridcellScheduler scheduler(input_module->gridlist_size(), order, nthreads,
+		                            GuessOutput::output_channel);
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < nthreads; i++) {
+			threads.push_back(std::thread(simulate_gridcells_in_thread,
+			                              std::ref(scheduler),
+			                              input_module.get(),
+			                              date,
+			                              std::ref(output_modules),
+			                              serializer.get(),
+			                              deserializer.get(),
+			                              landform_serializer.get(),
+			                              args.get_stand_threads()));
+		}
 
-			// START OF LOOP THROUGH SIMULATION DAYS
-			simulate_day(gridcell, input_module.get());
+		for (int i = 0; i < nthreads; i++) {
+			threads[i].join();
+		}
 
-			output_modules.outdaily(gridcell);
+		if (scheduler.was_aborted()) {
+			return 99;
+		}
 
-			if (date.islastday && date.islastmonth) {
-				// LAST DAY OF YEAR
-				// Call output module to output results for end of year
-				// or end of simulation for this grid cell
-				output_modules.outannual(gridcell);
+		output_modules.outsimulation();
 
-				gridcell.balance.check_year(gridcell);
+		return 0;
+	}
 
-				// cw SubPixel extra logging
-				if (date.year >= nyear_spinup + spoutput_startyear-1)
-          dprintf("End of year: %d (%d) co2:%.2f ndep:%.2f\n", date.year, date.get_calendar_year(), gridcell.climate.co2, gridcell.climate.andep * 10000 );
+	WorkerPool stand_pool(args.get_stand_threads());
 
-				// Time to save state?
-				if (date.year == state_year-1 && save_state) {
-					dprintf(" <<<<< dump: %d (%d)\n", date.year, date.get_calendar_year());
+	// The scenarios' input modules load the same grid cell by its position in the gridlist
+	if (!scenarios.empty() && input_module->gridlist_size() < 0) {
+		fail("Input module %s doesn't support scenarios", input_module_name);
+	}
 
-					serializer->serialize_gridcell(gridcell);
-				}
+	int index = -1;
 
-				// Check whether to abort
-				if (abort_request_received()) {
-					return 99;
-				}
-			}
+	while (true) {
 
-			// Advance timer to next simulation day
-			date.next();
+		// START OF LOOP THROUGH GRID CELLS
 
-			// End of loop through simulation days
-		}	//while (getclimate())
+		// Initialise global variable date
+		// (argument nyear not used in this implementation)
+		date.init(1);
+
+		// Create and initialise a new Gridcell object for each locality
+		Gridcell gridcell;
 
-    // cw SubPixel - end of sim autodump
-    //
-    // - triggered at the end of the sim (we always dump the state in run_landform)
-    // - dumping into a dedicated directory
-    if (run_landform) {
-        // reduce by one since ww already incremented the year
-        dprintf(" < autodump: %d (%d)\n", date.year-1, date.get_calendar_year()-1);
-        landform_serializer->serialize_gridcell(gridcell);
-    }
+		// Call input module to obtain latitude and driver data for this grid cell.
+		if (scenarios.empty()) {
+			if (!input_module->getgridcell(gridcell)) {
+				break;
+			}
+		}
+		else {
+			if (++index >= input_module->gridlist_size()) {
+				break;
+			}
+			if (!input_module->getgridcell_at(gridcell, index)) {
+				// Couldn't load data for this grid cell, skip it
+				continue;
+			}
+		}
 
-		gridcell.balance.check_period(gridcell);
+		if (!simulate_gridcell(gridcell, index, input_module.get(), output_modules, &scenarios,
+		                       serializer.get(), deserializer.get(), landform_serializer.get(),
+		                       &stand_pool)) {
+			return 99;
+		}
 
 	}		// End of loop through grid cells
 
@@ -327,5 +1056,8 @@ int framework(const CommandLineArguments& args) {
 
 	// END OF SIMULATION
 
+	output_modules.outsimulation();
+	scenarios.outsimulation();
+
 	return 0;
 }
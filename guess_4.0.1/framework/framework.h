@@ -10,6 +10,9 @@
 #define LPJ_GUESS_FRAMEWORK_H
 
 class CommandLineArguments;
+class Gridcell;
+class InputModule;
+class WorkerPool;
 
 /// The 'mission control' of the model
 /** 
@@ -22,4 +25,14 @@ class CommandLineArguments;
  */
 int framework(const CommandLineArguments& args);
 
+/// Simulates one day for a grid cell
+/** The climate object in the gridcell, and the local climate of each
+ *  stand, need to be set up with the day's forcing data first.
+ *
+ *  \param gridcell     The grid cell to simulate
+ *  \param input_module Used to get land cover fractions (not needed without run_landcover)
+ *  \param stand_pool   Threads for simulating the stands in parallel, or NULL
+ */
+void simulate_day(Gridcell& gridcell, InputModule* input_module, WorkerPool* stand_pool);
+
 #endif // LPJ_GUESS_FRAMEWORK_H
@@ -15,13 +15,15 @@
 #include <sstream>
 #include "config.h"
 #include "guess.h"
+#include <map>
+#include <mutex>
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // GLOBAL VARIABLES WITH EXTERNAL LINKAGE
 // These variables are declared in the framework header file, and defined here.
 // They are accessible throughout the model code.
 
-Date date; // object describing timing stage of simulation
+thread_local Date date; // object describing timing stage of simulation (one per thread, see framework)
 int npft; // number of possible PFTs
 int nst;  // number of possible stand types
 int nst_lc[NLANDCOVERTYPES];  // number of possible stand types in each land cover type
@@ -59,15 +61,160 @@ void PhotosynthesisResult::serialize(ArchiveStream& arch) {
 ////////////////////////////////////////////////////////////////////////////////
 
 
+namespace {
+
+/// Copies a fixed size array
+template<typename T, size_t N>
+void copy_array(const T (&from)[N], T (&to)[N]) {
+	std::copy(from, from + N, to);
+}
+
+/// Copies a fixed size two-dimensional array
+template<typename T, size_t N, size_t M>
+void copy_array(const T (&from)[N][M], T (&to)[N][M]) {
+	for (size_t i = 0; i < N; i++) {
+		copy_array(from[i], to[i]);
+	}
+}
+
+/// Cached solar geometries, by latitude and year length
+typedef std::map<std::pair<double, int>, std::shared_ptr<const SolarGeometry> > SolarGeometryCache;
+
+/// Maximum number of cached solar geometries
+/** The cache is emptied when it's full. Climate objects keep the
+ *  geometries they use, so it only means some will be calculated again.
+ */
+const size_t MAX_CACHED_SOLAR_GEOMETRIES = 4096;
+
+SolarGeometryCache solar_geometry_cache;
+std::mutex solar_geometry_mutex;
+
+}
+
+std::shared_ptr<const SolarGeometry> get_solar_geometry(double lat, int year_length) {
+
+	const std::pair<double, int> key(lat, year_length);
+
+	std::lock_guard<std::mutex> lock(solar_geometry_mutex);
+
+	SolarGeometryCache::iterator itr = solar_geometry_cache.find(key);
+	if (itr != solar_geometry_cache.end()) {
+		return itr->second;
+	}
+
+	// See daylengthinsoleet in the driver module for the equations
+
+	const double QOO = 1360.0;
+
+	const double sinelat = sin(lat * DEGTORAD);
+	const double cosinelat = cos(lat * DEGTORAD);
+
+	std::shared_ptr<SolarGeometry> geometry(new SolarGeometry);
+	memset(geometry.get(), 0, sizeof(SolarGeometry));
+	geometry->year_length = year_length;
+
+	for (int day = 0; day < year_length; day++) {
+
+		geometry->qo[day] = QOO * (1.0 + 2.0 * 0.01675 *
+		                           cos(2.0 * PI * ((double)day + 0.5) / year_length)); // Eqn 2
+		double delta = -23.4 * DEGTORAD * cos(2.0 * PI * ((double)day + 10.5) / year_length);
+			// Eqn 4, solar declination angle (radians)
+		geometry->u[day] = sinelat * sin(delta); // Eqn 9
+		geometry->v[day] = cosinelat * cos(delta); // Eqn 10
+
+		if (geometry->u[day] >= geometry->v[day])
+			geometry->hh[day] = PI; // polar day
+		else if (geometry->u[day] <= -geometry->v[day])
+			geometry->hh[day] = 0.0; // polar night
+		else geometry->hh[day] =
+			acos(-geometry->u[day] / geometry->v[day]); // Eqn 11
+
+		geometry->sinehh[day] = sin(geometry->hh[day]);
+
+		// Calculate daylength in hours from hh
+		geometry->daylength[day] = 24.0 * geometry->hh[day] / PI;
+	}
+
+	if (solar_geometry_cache.size() >= MAX_CACHED_SOLAR_GEOMETRIES) {
+		solar_geometry_cache.clear();
+	}
+	solar_geometry_cache[key] = geometry;
+
+	return geometry;
+}
+
 // cw SubPixel clone function for climate
 void Climate::clone(Gridcell& gridcell, Climate& local_climate) {
-    // Serialize this climate to an in-memory stream
-    std::stringstream ss;
-    ArchiveOutStream aos(ss);
-    serialize(aos);
-    // ...and deserialize to that climate
-    ArchiveInStream ais(ss);
-    local_climate.serialize(ais);
+	// Copies the same members as serialize(), but directly rather than
+	// through an archive since this is done for every stand created.
+	// Keep the two in sync.
+	Climate& to = local_climate;
+
+	to.temp = temp;
+	to.rad = rad;
+	to.par = par;
+	to.prec = prec;
+	to.daylength = daylength;
+	to.co2 = co2;
+	to.lat = lat;
+	to.insol = insol;
+	to.instype = instype;
+	to.eet = eet;
+	to.mtemp = mtemp;
+	copy_array(m_rad, to.m_rad);
+	copy_array(m_gdd5, to.m_gdd5);
+	copy_array(m_prec, to.m_prec);
+	copy_array(m_temp, to.m_temp);
+	copy_array(m_ndepo, to.m_ndepo);
+	to.mtemp_min20 = mtemp_min20;
+	to.mtemp_max20 = mtemp_max20;
+	to.mtemp_max = mtemp_max;
+	to.gdd5 = gdd5;
+	to.agdd5 = agdd5;
+	to.chilldays = chilldays;
+	to.ifsensechill = ifsensechill;
+	to.gtemp = gtemp;
+	to.dtemp_31 = dtemp_31;
+	to.dprec_31 = dprec_31;
+	to.deet_31 = deet_31;
+	copy_array(mtemp_min_20, to.mtemp_min_20);
+	copy_array(mtemp_max_20, to.mtemp_max_20);
+	to.mtemp_min = mtemp_min;
+	to.atemp_mean = atemp_mean;
+	to.sinelat = sinelat;
+	to.cosinelat = cosinelat;
+	to.solar_geometry = solar_geometry;
+	to.andep = andep;
+	to.dndep = dndep;
+	copy_array(dprec_10, to.dprec_10);
+	copy_array(sprec_2, to.sprec_2);
+	to.maxtemp = maxtemp;
+	copy_array(mtemp_20, to.mtemp_20);
+	copy_array(mprec_20, to.mprec_20);
+	copy_array(mpet_20, to.mpet_20);
+	copy_array(mprec_pet_20, to.mprec_pet_20);
+	copy_array(mprec_petmin_20, to.mprec_petmin_20);
+	copy_array(mprec_petmax_20, to.mprec_petmax_20);
+	copy_array(mtemp20, to.mtemp20);
+	copy_array(mprec20, to.mprec20);
+	copy_array(mpet20, to.mpet20);
+	copy_array(mprec_pet20, to.mprec_pet20);
+	to.mprec_petmin20 = mprec_petmin20;
+	to.mprec_petmax20 = mprec_petmax20;
+	copy_array(hmtemp_20, to.hmtemp_20);
+	copy_array(hmprec_20, to.hmprec_20);
+	copy_array(hmeet_20, to.hmeet_20);
+	to.seasonality = seasonality;
+	to.seasonality_lastyear = seasonality_lastyear;
+	to.prec_seasonality = prec_seasonality;
+	to.prec_seasonality_lastyear = prec_seasonality_lastyear;
+	to.prec_range = prec_range;
+	to.prec_range_lastyear = prec_range_lastyear;
+	to.temp_seasonality = temp_seasonality;
+	to.temp_seasonality_lastyear = temp_seasonality_lastyear;
+	to.var_prec = var_prec;
+	to.var_temp = var_temp;
+	to.aprec = aprec;
 }
 
 void Climate::serialize(ArchiveStream& arch) {
@@ -103,11 +250,33 @@ void Climate::serialize(ArchiveStream& arch) {
 		& mtemp_min
 		& atemp_mean
 		& sinelat
-		& cosinelat
-		& qo & u & v & hh & sinehh
-		& daylength_save
-		& doneday
-		& andep
+		& cosinelat;
+
+	// The solar geometry is shared, and calculated again from the latitude
+	// after reading, but is still in the archive so the format of state
+	// files stays the same
+	SolarGeometry geometry;
+	bool doneday[Date::MAX_YEAR_LENGTH];
+
+	if (arch.save()) {
+		if (solar_geometry) {
+			geometry = *solar_geometry;
+		}
+		else {
+			memset(&geometry, 0, sizeof(geometry));
+		}
+		std::fill_n(doneday, Date::MAX_YEAR_LENGTH, solar_geometry.get() != 0);
+	}
+
+	arch & geometry.qo & geometry.u & geometry.v & geometry.hh & geometry.sinehh
+		& geometry.daylength
+		& doneday;
+
+	if (!arch.save()) {
+		solar_geometry.reset();
+	}
+
+	arch & andep
 		& dndep
 		& dprec_10
 		& sprec_2
@@ -805,9 +974,8 @@ void Stand::init_stand_lu(StandType& st, double fraction) {
 	bool naturalveg = st.naturalveg == "ALL";
 	bool naturalgrass = st.naturalveg == "ALL" || st.naturalveg == "GRASSONLY";
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pftx = pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pftx = pftlist[p];
 
 		if(!st.restrictpfts && pftx.landcover == lc
 			|| !st.restrictpfts && naturalveg && pftx.landcover == NATURAL // Allow all natural pft:s to grow in e.g. forests
@@ -823,7 +991,6 @@ void Stand::init_stand_lu(StandType& st, double fraction) {
 		else {
 			pft[pftx.id].active = false;
 		}
-		pftlist.nextobj();
 	}
 
 	if(date.get_calendar_year() >= st.firstmanageyear) {
@@ -906,9 +1073,8 @@ void Stand::init_stand_lu(StandType& st, double fraction) {
 							pft[id].reestab = true;
 						}
 						else if(st.reestab == "ALL") {
-							pftlist.firstobj();
-							while (pftlist.isobj) {
-								Pft& pftx = pftlist.getobj();
+							for (int p = 0; p < npft; p++) {
+								Pft& pftx = pftlist[p];
 								// Options here are only relevant when planted trees (FOREST) and regenerated growth (FOREST and/or NATURAL) needs to be distinguished in the output
 								// 1. reestablishment by both forest and natural pfts
 	//							if(pftx.landcover == lc || st.naturalveg == "ALL" && pftx.landcover == NATURAL) {
@@ -919,7 +1085,6 @@ void Stand::init_stand_lu(StandType& st, double fraction) {
 									pft[pftx.id].active = true;
 									pft[pftx.id].reestab = true;
 								}
-								pftlist.nextobj();
 							}
 						}
 					}
@@ -933,9 +1098,8 @@ void Stand::init_stand_lu(StandType& st, double fraction) {
 		else if(mt.planting_system == "SELECTION") {
 
 			if(mt.selection != "") {
-				pftlist.firstobj();
-				while (pftlist.isobj) {
-					Pft& pftx = pftlist.getobj();
+				for (int p = 0; p < npft; p++) {
+					Pft& pftx = pftlist[p];
 
 					if(mt.pftinselection((const char*)pftx.name)) {
 
@@ -947,7 +1111,6 @@ void Stand::init_stand_lu(StandType& st, double fraction) {
 					else if(pftx.lifeform == TREE) {	// Whether grass is allowed is specified in the generic code above
 						pft[pftx.id].active = false;
 					}
-					pftlist.nextobj();
 				}
 			}
 			else {
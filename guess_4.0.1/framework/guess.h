@@ -40,6 +40,7 @@
 #include "gutil.h"
 #include <vector>
 #include <algorithm>
+#include <memory>
 #include "shell.h"
 #include "guessmath.h"
 #include "archive.h"
@@ -223,7 +224,9 @@ class Patchpft;
 // throughout the code
 
 /// Object describing timing stage of simulation
-extern Date date;
+/** Each thread has its own copy, so that several grid cells can be
+ *  simulated at once (see the -threads option to the framework). */
+extern thread_local Date date;
 
 /// Number of possible PFTs
 extern int npft;
@@ -566,6 +569,37 @@ struct PhotosynthesisResult : public Serializable {
 };
 
 
+/// Solar geometry for each day of the year at a given latitude
+/** Used by function daylengthinsoleet. Only depends on the latitude and
+ *  the length of the year, so it is calculated once and shared by all
+ *  Climate objects at the same latitude (see get_solar_geometry).
+ */
+struct SolarGeometry {
+
+	/// number of days in the year the geometry was calculated for
+	int year_length;
+
+	/// Solar constant corrected for the earth's distance to the sun (W/m2)
+	double qo[Date::MAX_YEAR_LENGTH];
+	/// sin(lat) * sin(delta), where delta is the solar declination
+	double u[Date::MAX_YEAR_LENGTH];
+	/// cos(lat) * cos(delta)
+	double v[Date::MAX_YEAR_LENGTH];
+	/// half-day length in angular units (radians)
+	double hh[Date::MAX_YEAR_LENGTH];
+	/// sin(hh)
+	double sinehh[Date::MAX_YEAR_LENGTH];
+	/// day length (h)
+	double daylength[Date::MAX_YEAR_LENGTH];
+};
+
+/// The solar geometry for a latitude
+/** Calculated on the first request for a latitude and year length, and
+ *  cached for later requests. Thread safe.
+ */
+std::shared_ptr<const SolarGeometry> get_solar_geometry(double lat, int year_length);
+
+
 /// The Climate for a grid cell
 /** Stores all static and variable data relating to climate parameters, as well as
  *  latitude, atmospheric CO2 concentration and daylength for a grid cell. Includes
@@ -681,14 +715,8 @@ public:
 
 	double sinelat;
 	double cosinelat;
-	double qo[Date::MAX_YEAR_LENGTH];
-	double u[Date::MAX_YEAR_LENGTH];
-	double v[Date::MAX_YEAR_LENGTH];
-	double hh[Date::MAX_YEAR_LENGTH];
-	double sinehh[Date::MAX_YEAR_LENGTH];
-	double daylength_save[Date::MAX_YEAR_LENGTH];
-	/// indicates whether saved values exist for this day
-	bool doneday[Date::MAX_YEAR_LENGTH];
+	/// solar geometry for this latitude, NULL until daylengthinsoleet is first called
+	std::shared_ptr<const SolarGeometry> solar_geometry;
 
 	/// diurnal temperature range, used in daily/monthly BVOC (deg C)
 	double dtr;
@@ -866,7 +894,7 @@ public:
 		atemp_mean = 0.0;
 
 		lat = latitude;
-		std::fill_n(doneday, Date::MAX_YEAR_LENGTH, false);
+		solar_geometry.reset();
 		sinelat = sin(lat * DEGTORAD);
 		cosinelat = cos(lat * DEGTORAD);
 
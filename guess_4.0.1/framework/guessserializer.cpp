@@ -17,6 +17,7 @@
 #include "archive.h"
 #include "partitionedmapserializer.h"
 #include "driver.h"
+#include <mutex>
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // Functors used by PartidionedMap(De)serializer to read/write coordinates
@@ -182,6 +183,9 @@ struct GuessSerializer::Impl {
 	                         std::pair<double, double>,
 	                         GridcellSerializer,
 	                         CoordSerializer> pms;
+
+	/// Serializes calls from threads simulating grid cells in parallel
+	std::mutex mutex;
 };
 
 
@@ -204,6 +208,7 @@ GuessSerializer::~GuessSerializer() {
 }
 
 void GuessSerializer::serialize_gridcell(const Gridcell& gridcell) {
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
 	try {
 		pimpl->pms.serialize_element(std::make_pair(gridcell.get_lon(), gridcell.get_lat()),
 		                             gridcell);
@@ -231,6 +236,9 @@ struct GuessDeserializer::Impl {
 	                           GridcellDeserializer,
 	                           CoordDeserializer,
 	                           sizeof(double)*2> pmd;
+
+	/// Serializes calls from threads simulating grid cells in parallel
+	std::mutex mutex;
 };
 
 GuessDeserializer::GuessDeserializer(const char* directory) {
@@ -250,6 +258,7 @@ GuessDeserializer::~GuessDeserializer() {
 }
 
 void GuessDeserializer::deserialize_gridcell(Gridcell& gridcell) {
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
 	try {
 		pimpl->pmd.deserialize_element(std::make_pair(gridcell.get_lon(), gridcell.get_lat()),
 		                               gridcell);
@@ -260,6 +269,7 @@ void GuessDeserializer::deserialize_gridcell(Gridcell& gridcell) {
 }
 
 void GuessDeserializer::deserialize_gridcells(const std::vector<Gridcell*>& gridcells) {
+	std::lock_guard<std::mutex> lock(pimpl->mutex);
 	try {
 		std::vector<std::pair<double, double> > coords;
 
@@ -28,6 +28,7 @@ public:
 	virtual ~GuessSerializer();
 
 	/// Adds the state for a gridcell to the state file
+	/** May be called from several threads at once. */
 	void serialize_gridcell(const Gridcell& gridcell);
 
 private:
@@ -16,6 +16,15 @@
 #include "inputmodule.h"
 #include "guess.h"
 
+///////////////////////////////////////////////////////////////////////////////////////
+/// InputModule
+///
+
+bool InputModule::getgridcell_at(Gridcell& gridcell, int index) {
+	fail("This input module can't load grid cells by their position in the gridlist\n");
+	return false;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// InputModuleRegistry
 ///
@@ -12,6 +12,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 class Gridcell;
 
@@ -52,6 +53,60 @@ public:
 	 */
 	virtual bool getgridcell(Gridcell& gridcell) = 0;
 
+	/// Number of grid cells in the gridlist
+	/** Input modules which support getgridcell_at() must return the number
+	 *  of entries in the gridlist (available after init()). The default
+	 *  implementation returns -1, meaning that random access to the gridlist
+	 *  isn't supported, and thus not running several grid cells at once
+	 *  (see the -threads command line option).
+	 */
+	virtual int gridlist_size() const { return -1; }
+
+	/// Number of years simulated for each grid cell, including the spinup
+	/** Available after init(). Used for instance by guess_partition to
+	 *  estimate how long a run will take. The default implementation
+	 *  returns -1, meaning that the number isn't known in advance.
+	 */
+	virtual int simulated_years() const { return -1; }
+
+	/// Longitude and latitude of the grid cell at position index in the gridlist
+	/** Available after init(). Input modules whose gridlists don't contain
+	 *  the coordinates (e.g. positions in the forcing files) can look them
+	 *  up, as used for instance by guess_partition to find the grid cells
+	 *  in guess.log. The default implementation returns false, meaning that
+	 *  the coordinates aren't known.
+	 */
+	virtual bool gridcell_coordinates(int /*index*/, double& /*lon*/, double& /*lat*/) const {
+		return false;
+	}
+
+	/// Obtains coordinates and soil static parameters for a given grid cell
+	/** Like getgridcell(), but for the grid cell at position index (starting
+	 *  from 0) in the gridlist. Unlike getgridcell(), this function never skips
+	 *  ahead to another grid cell, if the data for the grid cell can't be found
+	 *  the function returns false. Subsequent calls to getclimate() give data
+	 *  for this grid cell.
+	 *
+	 *  When simulating several grid cells at once, the framework calls this
+	 *  function and getclimate() etc. on the same input module from several
+	 *  threads at the same time, so the module must keep the data for each
+	 *  thread's grid cell separately (see PerThread), and serialize its use
+	 *  of libraries which aren't thread safe (e.g. GuessNC::library_mutex()).
+	 */
+	virtual bool getgridcell_at(Gridcell& gridcell, int index);
+
+	/// The order to simulate the gridlist in
+	/** Input modules which support getgridcell_at() may return the positions
+	 *  in the gridlist in the order they should be simulated, for instance to
+	 *  read the forcing data in the order it's stored. The framework then asks
+	 *  for the grid cells with getgridcell_at() in this order, and writes the
+	 *  output in this order too (keeping the output of a whole gridlist in
+	 *  memory to write it in gridlist order isn't an option). The default
+	 *  implementation returns an empty vector, meaning that the gridlist is
+	 *  simulated in the given order.
+	 */
+	virtual std::vector<int> simulation_order() const { return std::vector<int>(); }
+
 	/// Obtains climate data (including atmospheric CO2 and insolation) for this day
 	/** The function should return false if the simulation is complete for this grid cell,
 	 *  otherwise true. This will normally require querying the year and day member
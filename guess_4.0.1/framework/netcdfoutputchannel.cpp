@@ -0,0 +1,411 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file netcdfoutputchannel.cpp
+/// \brief An output channel writing CF-NetCDF files
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+
+#ifdef HAVE_NETCDF
+
+#include "guess.h"
+#include "netcdfoutputchannel.h"
+#include "guessnc.h"
+#include <netcdf.h>
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+namespace GuessOutput {
+
+namespace {
+
+/// Days in a year, LPJ-GUESS has no leap years
+const int DAYS_PER_YEAR = 365;
+
+/// Chunk size along the time dimension for annual tables
+const size_t ANNUAL_TIME_CHUNK = 1024;
+
+/// Chunk size along the time dimension for daily tables
+const size_t DAILY_TIME_CHUNK = 8 * DAYS_PER_YEAR;
+
+/// Chunk size for the coordinate variables along landid
+const size_t LANDID_CHUNK = 1024;
+
+/// Fails with the NetCDF library's error message if status indicates an error
+void check(int status, const std::string& filename, const char* what) {
+	if (status != NC_NOERR) {
+		fail("NetCDF error in %s: %s: %s", filename.c_str(), what, nc_strerror(status));
+	}
+}
+
+/// Writes a text attribute, fails on error
+void put_text(int ncid, int varid, const char* name, const std::string& value,
+              const std::string& filename) {
+	check(nc_put_att_text(ncid, varid, name, value.size(), value.c_str()),
+	      filename, "Failed to write attribute");
+}
+
+/// Makes a valid and unique NetCDF variable name from a column title
+std::string variable_name(const std::string& title, std::set<std::string>& taken) {
+	std::string name = title;
+	for (size_t i = 0; i < name.size(); i++) {
+		if (name[i] == '/' || name[i] == ' ') {
+			name[i] = '_';
+		}
+	}
+	if (name.empty()) {
+		name = "column";
+	}
+
+	std::string unique = name;
+	for (int i = 2; taken.count(unique); i++) {
+		char suffix[20];
+		sprintf(suffix, "_%d", i);
+		unique = name + suffix;
+	}
+
+	taken.insert(unique);
+	return unique;
+}
+
+}
+
+NetCDFOutputChannel::NetCDFOutputChannel(const char* out_dir, int deflate_level)
+	: output_directory(out_dir),
+	  deflate_level(deflate_level) {
+}
+
+NetCDFOutputChannel::~NetCDFOutputChannel() {
+	for (size_t i = 0; i < files.size(); i++) {
+		if (files[i]) {
+			close_file(*files[i]);
+			delete files[i];
+		}
+	}
+}
+
+Table NetCDFOutputChannel::create_table(const TableDescriptor& descriptor) {
+	Table table;
+
+	if (descriptor.name() == "") {
+		return table;
+	}
+
+	// cmass.out becomes cmass.nc
+	std::string name = descriptor.name();
+	const size_t extension = name.rfind(".out");
+	if (extension != std::string::npos && extension + 4 == name.size()) {
+		name.erase(extension);
+	}
+
+	File* file = new File;
+	file->name = output_directory + name + ".nc";
+	file->defined = false;
+	file->type = ANNUAL;
+	file->first_year = 0;
+	file->times_written = 0;
+	file->lon = file->lat = 0;
+
+	GuessNC::LibraryLock lock;
+
+	int status = nc_create(file->name.c_str(), NC_NETCDF4 | NC_CLOBBER, &file->ncid);
+	if (status != NC_NOERR) {
+		fail("Could not open %s for output\n%s", file->name.c_str(), nc_strerror(status));
+	}
+
+	put_text(file->ncid, NC_GLOBAL, "Conventions", "CF-1.6", file->name);
+	put_text(file->ncid, NC_GLOBAL, "featureType", "timeSeries", file->name);
+	put_text(file->ncid, NC_GLOBAL, "title", descriptor.name(), file->name);
+	put_text(file->ncid, NC_GLOBAL, "source", "LPJ-GUESS", file->name);
+
+	table = OutputChannel::create_table(descriptor);
+	files.push_back(file);
+
+	return table;
+}
+
+void NetCDFOutputChannel::close_table(Table& table) {
+
+	// do nothing for unused tables
+	if (table.invalid() || !files[table.id()]) {
+		return;
+	}
+
+	close_file(*files[table.id()]);
+	delete files[table.id()];
+	files[table.id()] = NULL;
+}
+
+void NetCDFOutputChannel::gridcell_finished() {
+	for (size_t i = 0; i < files.size(); i++) {
+		if (files[i]) {
+			write_rows(*files[i]);
+		}
+	}
+}
+
+void NetCDFOutputChannel::finish_row(const Table& table,
+                                     double lon,
+                                     double lat,
+                                     int year) {
+	finish_row(table, lon, lat, year, 0, ANNUAL, 0, 0);
+}
+
+void NetCDFOutputChannel::finish_row(const Table& table,
+                                     double lon,
+                                     double lat,
+                                     int year,
+                                     int day) {
+	finish_row(table, lon, lat, year, day, DAILY, 0, 0);
+}
+
+void NetCDFOutputChannel::finish_row(const Table& table,
+                                     double lon,
+                                     double lat,
+                                     int year,
+                                     int day,
+                                     int stand) {
+	finish_row(table, lon, lat, year, 0, STAND, stand, 0);
+}
+
+void NetCDFOutputChannel::finish_row(const Table& table,
+                                     double lon,
+                                     double lat,
+                                     int year,
+                                     int day,
+                                     int stand,
+                                     int patch) {
+	finish_row(table, lon, lat, year, 0, PATCH, stand, patch);
+}
+
+void NetCDFOutputChannel::finish_row(const Table& table,
+                                     double lon,
+                                     double lat,
+                                     int year,
+                                     int day,
+                                     FileType type,
+                                     int stand,
+                                     int patch) {
+	// do nothing for unused tables
+	if (table.invalid() || !files[table.id()]) {
+		return;
+	}
+
+	File& file = *files[table.id()];
+
+	// make sure all columns have been added
+	const std::vector<double>& row = get_current_row(table);
+	const TableDescriptor& td = get_table_descriptor(table);
+	const size_t ncolumns = td.columns().size();
+
+	if (row.size() < ncolumns) {
+		fail("Too few values in a row in table %s\n%d : %d", td.name().c_str(), (int)row.size(), (int)ncolumns);
+	}
+
+	if (!file.defined) {
+		define(file, td, type, year);
+	}
+	else if (type != file.type) {
+		fail("Table %s mixes annual, daily, stand and patch rows, "
+		     "which can't be written to NetCDF", td.name().c_str());
+	}
+
+	if (year < file.first_year || day < 0 || day >= DAYS_PER_YEAR || stand < 0 || patch < 0) {
+		fail("Table %s has a row for year %d, day %d, stand %d, patch %d, which "
+		     "can't be written to NetCDF (the first year in the table is %d)",
+		     td.name().c_str(), year, day, stand, patch, file.first_year);
+	}
+
+	// rows are written one grid cell at a time
+	if (!file.rows.empty() && (lon != file.lon || lat != file.lat)) {
+		write_rows(file);
+	}
+	file.lon = lon;
+	file.lat = lat;
+
+	Row r;
+	r.time = (size_t)(year - file.first_year) * (type == DAILY ? DAYS_PER_YEAR : 1) + day;
+	r.stand = stand;
+	r.patch = patch;
+	file.rows.push_back(r);
+	file.values.insert(file.values.end(), row.begin(), row.begin() + ncolumns);
+
+	// start on a new row
+	clear_current_row(table);
+}
+
+void NetCDFOutputChannel::define(File& file, const TableDescriptor& td, FileType type, int year) {
+	file.type = type;
+	file.first_year = year;
+
+	GuessNC::LibraryLock lock;
+
+	const int ncid = file.ncid;
+
+	// dimensions, all unlimited since we don't know the number of grid
+	// cells, years, stands or patches in advance
+	int landid_dim, time_dim;
+	check(nc_def_dim(ncid, "landid", NC_UNLIMITED, &landid_dim), file.name, "Failed to define landid");
+	check(nc_def_dim(ncid, "time", NC_UNLIMITED, &time_dim), file.name, "Failed to define time");
+
+	std::vector<int> dims;
+	dims.push_back(landid_dim);
+	dims.push_back(time_dim);
+
+	if (type == STAND || type == PATCH) {
+		int stand_dim;
+		check(nc_def_dim(ncid, "stand", NC_UNLIMITED, &stand_dim), file.name, "Failed to define stand");
+		dims.push_back(stand_dim);
+	}
+	if (type == PATCH) {
+		int patch_dim;
+		check(nc_def_dim(ncid, "patch", NC_UNLIMITED, &patch_dim), file.name, "Failed to define patch");
+		dims.push_back(patch_dim);
+	}
+
+	// the coordinates
+	check(nc_def_var(ncid, "lon", NC_DOUBLE, 1, &landid_dim, &file.lon_var), file.name, "Failed to define lon");
+	check(nc_def_var_chunking(ncid, file.lon_var, NC_CHUNKED, &LANDID_CHUNK), file.name, "Failed to set chunking");
+	put_text(ncid, file.lon_var, "standard_name", "longitude", file.name);
+	put_text(ncid, file.lon_var, "units", "degrees_east", file.name);
+
+	check(nc_def_var(ncid, "lat", NC_DOUBLE, 1, &landid_dim, &file.lat_var), file.name, "Failed to define lat");
+	check(nc_def_var_chunking(ncid, file.lat_var, NC_CHUNKED, &LANDID_CHUNK), file.name, "Failed to set chunking");
+	put_text(ncid, file.lat_var, "standard_name", "latitude", file.name);
+	put_text(ncid, file.lat_var, "units", "degrees_north", file.name);
+
+	const size_t time_chunk = type == DAILY ? DAILY_TIME_CHUNK : ANNUAL_TIME_CHUNK;
+
+	char units[100];
+	sprintf(units, "days since %d-01-01 00:00:00", year);
+
+	check(nc_def_var(ncid, "time", NC_DOUBLE, 1, &time_dim, &file.time_var), file.name, "Failed to define time");
+	check(nc_def_var_chunking(ncid, file.time_var, NC_CHUNKED, &time_chunk), file.name, "Failed to set chunking");
+	put_text(ncid, file.time_var, "standard_name", "time", file.name);
+	put_text(ncid, file.time_var, "units", units, file.name);
+	put_text(ncid, file.time_var, "calendar", "365_day", file.name);
+	put_text(ncid, file.time_var, "axis", "T", file.name);
+
+	// one variable for each column, a chunk holds one grid cell
+	std::vector<size_t> chunks(dims.size(), 1);
+	chunks[1] = time_chunk;
+
+	std::set<std::string> taken;
+	taken.insert("lon");
+	taken.insert("lat");
+	taken.insert("time");
+
+	for (size_t i = 0; i < td.columns().size(); i++) {
+		const std::string& title = td.columns()[i].title();
+
+		int var;
+		check(nc_def_var(ncid, variable_name(title, taken).c_str(), NC_DOUBLE,
+		                 (int)dims.size(), &dims.front(), &var),
+		      file.name, ("Failed to define variable for column " + title).c_str());
+		check(nc_def_var_chunking(ncid, var, NC_CHUNKED, &chunks.front()), file.name, "Failed to set chunking");
+		if (deflate_level > 0) {
+			check(nc_def_var_deflate(ncid, var, 1, 1, deflate_level), file.name, "Failed to set compression");
+		}
+		put_text(ncid, var, "long_name", title, file.name);
+		put_text(ncid, var, "coordinates", "lat lon", file.name);
+
+		file.vars.push_back(var);
+	}
+
+	check(nc_enddef(ncid), file.name, "Failed to define variables");
+
+	file.defined = true;
+}
+
+void NetCDFOutputChannel::write_rows(File& file) {
+	if (file.rows.empty()) {
+		return;
+	}
+
+	const std::vector<Row>& rows = file.rows;
+	const size_t ncolumns = file.vars.size();
+
+	// the smallest block of (time, stand, patch) holding all rows,
+	// everything in it which isn't in a row gets the fill value
+	size_t min_time = rows.front().time, max_time = min_time;
+	int min_stand = rows.front().stand, max_stand = min_stand;
+	int min_patch = rows.front().patch, max_patch = min_patch;
+
+	for (size_t i = 1; i < rows.size(); i++) {
+		min_time = std::min(min_time, rows[i].time);
+		max_time = std::max(max_time, rows[i].time);
+		min_stand = std::min(min_stand, rows[i].stand);
+		max_stand = std::max(max_stand, rows[i].stand);
+		min_patch = std::min(min_patch, rows[i].patch);
+		max_patch = std::max(max_patch, rows[i].patch);
+	}
+
+	GuessNC::LibraryLock lock;
+
+	// a new grid cell gets the next landid
+	const std::pair<double, double> coords(file.lon, file.lat);
+	std::map<std::pair<double, double>, int>::iterator itr = file.landids.find(coords);
+	if (itr == file.landids.end()) {
+		const size_t landid = file.landids.size();
+		itr = file.landids.insert(std::make_pair(coords, (int)landid)).first;
+
+		check(nc_put_var1_double(file.ncid, file.lon_var, &landid, &file.lon), file.name, "Failed to write lon");
+		check(nc_put_var1_double(file.ncid, file.lat_var, &landid, &file.lat), file.name, "Failed to write lat");
+	}
+
+	// time values up to the last row
+	if (max_time >= file.times_written) {
+		std::vector<double> times;
+		for (size_t t = file.times_written; t <= max_time; t++) {
+			times.push_back(file.type == DAILY ? t : (double)t * DAYS_PER_YEAR);
+		}
+
+		const size_t start = file.times_written;
+		const size_t count = times.size();
+		check(nc_put_vara_double(file.ncid, file.time_var, &start, &count, &times.front()),
+		      file.name, "Failed to write time");
+		file.times_written = max_time + 1;
+	}
+
+	const size_t start[] = { (size_t)itr->second, min_time, (size_t)min_stand, (size_t)min_patch };
+	const size_t count[] = { 1, max_time - min_time + 1,
+	                         (size_t)(max_stand - min_stand + 1), (size_t)(max_patch - min_patch + 1) };
+
+	std::vector<double> block(count[1] * count[2] * count[3]);
+
+	for (size_t c = 0; c < ncolumns; c++) {
+		std::fill(block.begin(), block.end(), NC_FILL_DOUBLE);
+
+		for (size_t i = 0; i < rows.size(); i++) {
+			const size_t pos = ((rows[i].time - min_time) * count[2] + (rows[i].stand - min_stand)) * count[3] +
+				(rows[i].patch - min_patch);
+			block[pos] = file.values[i * ncolumns + c];
+		}
+
+		check(nc_put_vara_double(file.ncid, file.vars[c], start, count, &block.front()),
+		      file.name, "Failed to write values");
+	}
+
+	file.rows.clear();
+	file.values.clear();
+}
+
+void NetCDFOutputChannel::close_file(File& file) {
+	write_rows(file);
+
+	GuessNC::LibraryLock lock;
+	check(nc_close(file.ncid), file.name, "Failed to close file");
+}
+
+}
+
+#endif // HAVE_NETCDF
@@ -0,0 +1,155 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file netcdfoutputchannel.h
+/// \brief An output channel writing CF-NetCDF files
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_NETCDF_OUTPUT_CHANNEL_H
+#define LPJ_GUESS_NETCDF_OUTPUT_CHANNEL_H
+
+#ifdef HAVE_NETCDF
+
+#include "outputchannel.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GuessOutput {
+
+/// An output channel for compressed CF-NetCDF files
+/** Creates one NetCDF-4 file for each output table, named as the text file
+ *  would be but with the extension .nc instead of .out.
+ *
+ *  Each column in the table becomes a variable with the dimensions
+ *  (landid, time), and for tables with a row per stand or patch also
+ *  (landid, time, stand) or (landid, time, stand, patch). All dimensions
+ *  are unlimited, so nothing needs to be known about the simulation when
+ *  the files are created. The grid cells get a landid in the order their
+ *  output arrives, with their coordinates in the lon(landid) and
+ *  lat(landid) variables (a CF time series feature type). Time is given
+ *  in days since the first year in the table, with a 365 day calendar.
+ *
+ *  The rows of a grid cell are kept in memory until the grid cell is
+ *  finished, and then written with one call per variable, so the values
+ *  of one grid cell end up in one compressed chunk per variable.
+ */
+class NetCDFOutputChannel : public OutputChannel {
+public:
+	/// Creates a NetCDFOutputChannel
+	/** \param out_dir All output files are placed in this directory.
+	 *  \param deflate_level Compression level (0-9), 0 for no compression
+	 */
+	NetCDFOutputChannel(const char* out_dir, int deflate_level);
+
+	/// Destructor - writes buffered rows and closes all files
+	~NetCDFOutputChannel();
+
+	/// Creates an output file
+	/** \see OutputChannel::create_table */
+	Table create_table(const TableDescriptor& descriptor);
+
+	/// Writes the table's buffered rows and closes its file
+	void close_table(Table& table);
+
+	/// Writes the buffered rows of all tables
+	void gridcell_finished();
+
+	/// Stores the values of the current row, annual output
+	void finish_row(const Table& table, double lon, double lat,
+	                int year);
+
+	/// Stores the values of the current row, daily output
+	void finish_row(const Table& table, double lon, double lat,
+	                int year, int day);
+
+	/// Stores the values of the current row, annual output per stand
+	void finish_row(const Table& table, double lon, double lat,
+	                int year, int day, int stand);
+
+	/// Stores the values of the current row, annual output per patch
+	void finish_row(const Table& table, double lon, double lat,
+	                int year, int day, int stand, int patch);
+
+private:
+	/// Which dimensions the variables in a file have, decided by the first row
+	enum FileType { ANNUAL, DAILY, STAND, PATCH };
+
+	/// A row kept in memory until its grid cell is finished
+	struct Row {
+		size_t time;
+		int stand;
+		int patch;
+	};
+
+	/// An open NetCDF file and the rows buffered for it
+	struct File {
+		std::string name;
+		int ncid;
+
+		/// Whether dimensions and variables have been defined
+		bool defined;
+
+		FileType type;
+
+		/// Calendar year at time 0
+		int first_year;
+
+		int time_var;
+		int lon_var;
+		int lat_var;
+
+		/// One variable for each column
+		std::vector<int> vars;
+
+		/// Number of values written to the time variable
+		size_t times_written;
+
+		/// The landid of each grid cell with output in the file
+		std::map<std::pair<double, double>, int> landids;
+
+		/// The grid cell of the buffered rows
+		double lon, lat;
+
+		std::vector<Row> rows;
+
+		/// The values of the buffered rows, one row after another
+		std::vector<double> values;
+	};
+
+	/// Help function to the variants of finish_row above
+	void finish_row(const Table& table, double lon, double lat,
+	                int year, int day, FileType type, int stand, int patch);
+
+	/// Defines dimensions and variables, when the first row has arrived
+	void define(File& file, const TableDescriptor& td, FileType type, int year);
+
+	/// Writes the buffered rows of a file
+	void write_rows(File& file);
+
+	/// Writes buffered rows and closes a file
+	void close_file(File& file);
+
+	const std::string output_directory;
+
+	const int deflate_level;
+
+	/// Open files, NULL for closed ones
+	std::vector<File*> files;
+
+	// Not copyable
+	NetCDFOutputChannel(const NetCDFOutputChannel&);
+	NetCDFOutputChannel& operator=(const NetCDFOutputChannel&);
+};
+
+}
+
+#endif // HAVE_NETCDF
+
+#endif // LPJ_GUESS_NETCDF_OUTPUT_CHANNEL_H
@@ -15,9 +15,138 @@
 #include "config.h"
 #include "guess.h"
 #include "outputchannel.h"
+#include "backgroundtask.h"
+#include <float.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdexcept>
 
 namespace GuessOutput {
 
+namespace {
+
+/// Appends printf style formatted text to a string
+void append(std::string& str, const char* format, ...) {
+	 char buf[256];
+
+	 va_list args;
+	 va_start(args, format);
+	 int length = vsnprintf(buf, sizeof(buf), format, args);
+	 va_end(args);
+
+	 if (length < 0) {
+		  return;
+	 }
+	 else if (length < (int)sizeof(buf)) {
+		  str.append(buf, length);
+	 }
+	 else {
+		  // didn't fit in buf, format again directly into the string
+		  size_t old_size = str.size();
+		  str.resize(old_size + length + 1);
+		  va_start(args, format);
+		  vsnprintf(&str[old_size], length + 1, format, args);
+		  va_end(args);
+		  str.resize(old_size + length);
+	 }
+}
+
+/// Appends an integer formatted like printf's "%<width>d"
+void format_int(std::string& out, int value, int width) {
+	 char digits[16];
+	 int pos = sizeof(digits);
+
+	 long long n = value;
+	 const bool negative = n < 0;
+	 if (negative) {
+		  n = -n;
+	 }
+
+	 do {
+		  digits[--pos] = '0' + (char)(n % 10);
+		  n /= 10;
+	 } while (n > 0);
+
+	 if (negative) {
+		  digits[--pos] = '-';
+	 }
+
+	 const int length = (int)sizeof(digits) - pos;
+	 if (length < width) {
+		  out.append(width - length, ' ');
+	 }
+	 out.append(digits + pos, length);
+}
+
+/// Highest precision converted by format_fixed itself, 10^15 is exact
+const int MAX_FAST_PRECISION = 15;
+
+const double POWERS_OF_TEN[MAX_FAST_PRECISION + 1] = {
+	 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+	 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+/// Largest scaled value for which format_fixed does the conversion, 2^52
+/** Below this the fractional part of a double is exact, and the integer
+ *  part fits in an unsigned long long. */
+const double MAX_FAST_SCALED = 4503599627370496.0;
+
+}
+
+void format_fixed(std::string& out, double value, int width, int precision) {
+
+	 // NaN and infinity fail the comparison and go to snprintf
+	 if (precision >= 0 && precision <= MAX_FAST_PRECISION &&
+	     fabs(value) < MAX_FAST_SCALED) {
+
+		  // the product is within half an ulp of the exact value, so
+		  // unless we're that close to a tie it rounds the same way
+		  const double scaled = fabs(value) * POWERS_OF_TEN[precision];
+
+		  if (scaled < MAX_FAST_SCALED) {
+				unsigned long long n = (unsigned long long)scaled;
+				const double fraction = scaled - (double)n;
+
+				if (fabs(fraction - 0.5) > scaled * DBL_EPSILON) {
+					 if (fraction > 0.5) {
+						  n++;
+					 }
+
+					 char digits[32];
+					 int pos = sizeof(digits);
+
+					 for (int i = 0; i < precision; i++) {
+						  digits[--pos] = '0' + (char)(n % 10);
+						  n /= 10;
+					 }
+					 if (precision > 0) {
+						  digits[--pos] = '.';
+					 }
+					 do {
+						  digits[--pos] = '0' + (char)(n % 10);
+						  n /= 10;
+					 } while (n > 0);
+
+					 // like printf, also -0.0 and negative values rounded to 0
+					 if (signbit(value)) {
+						  digits[--pos] = '-';
+					 }
+
+					 const int length = (int)sizeof(digits) - pos;
+					 if (length < width) {
+						  out.append(width - length, ' ');
+					 }
+					 out.append(digits + pos, length);
+					 return;
+				}
+		  }
+	 }
+
+	 char format[32];
+	 snprintf(format, sizeof(format), "%%%d.%df", width, precision);
+	 append(out, format, value);
+}
+
 ColumnDescriptor::ColumnDescriptor(const char* title, 
                                    int width, 
                                    int precision) 
@@ -133,27 +262,35 @@ void OutputChannel::clear_current_row(const Table& table) {
 }
 
 FileOutputChannel::FileOutputChannel(const char* out_dir,
-                                     int coords_precision)
-		  : output_directory(out_dir) {
+                                     int coords_precision,
+                                     size_t buffer_size,
+                                     bool flush_gridcells)
+		  : output_directory(out_dir),
+			 coords_precision(coords_precision),
+			 buffer_size(buffer_size),
+			 flush_gridcells(flush_gridcells) {
 
 	 // calculate suitable width for the coords columns,
 	 // longitudes take at most 4 characters (-180) before the decimal 
 	 // point, add the decimal point, coords_precision and a little margin:
 	 const int LON_MAX_LEN = 4;
 	 const int MARGIN = 2;
-	 int coords_width = LON_MAX_LEN+1+coords_precision+MARGIN;
+	 coords_width = LON_MAX_LEN+1+coords_precision+MARGIN;
 
 	 xtring str;
 	 str.printf("%%%ds", coords_width);
 	 coords_title_format = (char*)str;
-
-	 str.printf("%%%d.%df", coords_width, coords_precision);
-	 coords_format = (char*)str;
 }
 
 FileOutputChannel::~FileOutputChannel() {
+	 if (buffer_size > 0) {
+		  write_buffers(true, true);
+	 }
+
 	 for (size_t i = 0; i < files.size(); i++) {
-		  fclose(files[i]);
+		  if (files[i] != NULL) {
+				fclose(files[i]);
+		  }
 	 }
 }
 
@@ -172,7 +309,20 @@ Table FileOutputChannel::create_table(const TableDescriptor& descriptor) {
 		  else {
 				table = OutputChannel::create_table(descriptor);
 				files.push_back(file);
+				file_names.push_back(full_path);
 				printed_header.push_back(false);
+				buffers.push_back(std::string());
+
+				// the format of each column, so it doesn't need to be
+				// looked up for every value
+				const ColumnDescriptors& columns = descriptor.columns();
+				column_formats.push_back(std::vector<std::pair<int, int> >());
+				for (size_t i = 0; i < columns.size(); i++) {
+					 column_formats.back().push_back(std::make_pair(columns[i].width(), columns[i].precision()));
+				}
+				if (buffer_size > 0) {
+					 buffers.back().reserve(buffer_size);
+				}
 		  }
 	 }
 
@@ -225,8 +375,90 @@ void FileOutputChannel::close_table(Table& table) {
 		  return;
 	 }
 
-	 FILE* file = files[table.id()];
+	 const int id = table.id();
+
+	 // the writer may still be writing to the file
+	 if (writer.get()) {
+		  write_buffers(false, true);
+	 }
+
+	 FILE* file = files[id];
+	 if (file == NULL) {
+		  return;
+	 }
+
+	 if (!buffers[id].empty() &&
+	     fwrite(buffers[id].data(), 1, buffers[id].size(), file) != buffers[id].size()) {
+		  fail("Failed to write to %s", file_names[id].c_str());
+	 }
+	 std::string().swap(buffers[id]);
+
 	 fclose(file);
+	 files[id] = NULL;
+}
+
+void FileOutputChannel::gridcell_finished() {
+	 if (flush_gridcells) {
+		  write_buffers(true, true);
+	 }
+}
+
+void FileOutputChannel::write_buffers(bool all, bool flush) {
+	 if (!writer.get()) {
+		  writer = std::auto_ptr<BackgroundTask>(new BackgroundTask);
+	 }
+
+	 // the previous batch must be written before pending can be reused
+	 try {
+		  writer->wait();
+	 }
+	 catch (const std::runtime_error& e) {
+		  fail(e.what());
+	 }
+
+	 pending.clear();
+	 for (size_t i = 0; i < buffers.size(); i++) {
+		  if (files[i] != NULL && !buffers[i].empty() &&
+		      (all || buffers[i].size() >= buffer_size)) {
+				pending.push_back(std::make_pair((int)i, std::string()));
+				pending.back().second.swap(buffers[i]);
+				buffers[i].reserve(buffer_size);
+		  }
+	 }
+
+	 if (pending.empty() && !flush) {
+		  return;
+	 }
+
+	 writer->start(std::bind(&FileOutputChannel::write_pending, this, flush));
+
+	 if (flush) {
+		  try {
+				writer->wait();
+		  }
+		  catch (const std::runtime_error& e) {
+				fail(e.what());
+		  }
+	 }
+}
+
+void FileOutputChannel::write_pending(bool flush) {
+	 for (size_t i = 0; i < pending.size(); i++) {
+		  const int id = pending[i].first;
+		  const std::string& data = pending[i].second;
+
+		  if (fwrite(data.data(), 1, data.size(), files[id]) != data.size()) {
+				throw std::runtime_error("Failed to write to " + file_names[id]);
+		  }
+	 }
+
+	 if (flush) {
+		  for (size_t i = 0; i < files.size(); i++) {
+				if (files[i] != NULL) {
+					 fflush(files[i]);
+				}
+		  }
+	 }
 }
 
 void FileOutputChannel::finish_row(const Table& table, 
@@ -243,7 +475,10 @@ void FileOutputChannel::finish_row(const Table& table,
 		  return;
 	 }
 
-	 FILE* file = files[table.id()];
+	 // format the row (and the header) into the file's buffer, or into
+	 // a temporary string if we're writing each row directly
+	 std::string unbuffered;
+	 std::string& out = buffer_size > 0 ? buffers[table.id()] : unbuffered;
 
 	 // make sure all columns have been added
 	 const std::vector<double>& row = get_current_row(table);
@@ -256,84 +491,205 @@ void FileOutputChannel::finish_row(const Table& table,
 	 // print the header if this is the first output for this file
 	 if (!printed_header[table.id()]) {
 		  // print title for coordinates and time columns
-		  fprintf(file, coords_title_format.c_str(), "Lon");
-		  fprintf(file, coords_title_format.c_str(), "Lat");
-		  fprintf(file, "%8s", "Year");
+		  append(out, coords_title_format.c_str(), "Lon");
+		  append(out, coords_title_format.c_str(), "Lat");
+		  append(out, "%8s", "Year");
 		  if (print_day) {
-				fprintf(file, "%8s", "Day");
+				append(out, "%8s", "Day");
 		  }
          
           // cw stand and patch
           // cw stand and patch
           if (stand != -1){
-              fprintf(file, "%8s", "Stand");
+              append(out, "%8s", "Stand");
           }
           if (patch != -1){
-              fprintf(file, "%8s", "Patch");
+              append(out, "%8s", "Patch");
           }
 
 		  // print each column title
 		  int nbr_cols = (int) get_table_descriptor(table).columns().size();
 		  for (int i = 0; i < nbr_cols; i++) {
-				fputs(format_header(table, i), file);
+				out += format_header(table, i);
 		  }
-		  fprintf(file, "\n");
+		  append(out, "\n");
 
 		  printed_header[table.id()] = true;
 	 }
 
 	 // print out coordinates and time
-	 fprintf(file, coords_format.c_str(), lon);
-	 fprintf(file, coords_format.c_str(), lat);
-	 fprintf(file, "%8d", year);
+	 format_fixed(out, lon, coords_width, coords_precision);
+	 format_fixed(out, lat, coords_width, coords_precision);
+	 format_int(out, year, 8);
 	 if (print_day) {
-		  fprintf(file, "%8d", day);
+		  format_int(out, day, 8);
 	 }
     
      // cw stand and patch
      if (stand != -1){
-          fprintf(file, "%8d", stand);
+          format_int(out, stand, 8);
      }
      if (patch != -1){
-          fprintf(file, "%8d", patch);
+          format_int(out, patch, 8);
      }
 
 	 // print out the values
-	 for (size_t i = 0; i < row.size(); i++) {
-		  fprintf(file, format(table, (int)i), row[i]);
+	 const std::vector<std::pair<int, int> >& formats = column_formats[table.id()];
+	 for (size_t i = 0; i < formats.size(); i++) {
+		  format_fixed(out, row[i], formats[i].first, formats[i].second);
+	 }
+	 out += '\n';
+
+	 if (buffer_size == 0) {
+		  FILE* file = files[table.id()];
+		  if (fwrite(out.data(), 1, out.size(), file) != out.size()) {
+				fail("Failed to write to %s", file_names[table.id()].c_str());
+		  }
+		  fflush(file);
+	 }
+	 else if (out.size() >= buffer_size) {
+		  write_buffers(false, false);
 	 }
-	 fprintf(file, "\n");
-	 fflush(file);
 
 	 // start on a new row
 	 clear_current_row(table);
 }
 
 
-const char* FileOutputChannel::format(const Table& table, int column) {
+std::string FileOutputChannel::format_header(const Table& table, int column) {
 	 const TableDescriptor& td = get_table_descriptor(table);
 	 const ColumnDescriptor& cd = td.columns()[column];
 
-	 // NB: not thread safe
-	 static char buf[100];
+	 char format[100];
+	 char buf[100];
 
-	 sprintf(buf, "%%%d.%df", cd.width(), cd.precision());
+	 sprintf(format, "%%%ds", cd.width());
+	 snprintf(buf, sizeof(buf), format, cd.title().c_str());
 
 	 return buf;
 }
 
-const char* FileOutputChannel::format_header(const Table& table, int column) {
-	 const TableDescriptor& td = get_table_descriptor(table);
-	 const ColumnDescriptor& cd = td.columns()[column];
+RowBufferOutputChannel::RowBufferOutputChannel(OutputChannel* target_channel)
+		  : target(target_channel) {
+}
+
+Table RowBufferOutputChannel::create_table(const TableDescriptor& descriptor) {
+	 fail("Tables can't be created in a RowBufferOutputChannel (%s)",
+	      descriptor.name().c_str());
+	 return Table();
+}
 
-	 // NB: not thread safe
-	 static char format[100];
-	 static char buf[100];
+void RowBufferOutputChannel::close_table(Table& /*table*/) {
+	 fail("Tables can't be closed in a RowBufferOutputChannel");
+}
 
-	 sprintf(format, "%%%ds", cd.width());
-	 sprintf(buf, format, cd.title().c_str());
+void RowBufferOutputChannel::add_value(const Table& table, double d) {
+	 // do nothing for unused tables
+	 if (table.invalid()) {
+		  return;
+	 }
+
+	 if (table.id() >= (int)current_rows.size()) {
+		  current_rows.resize(table.id()+1);
+	 }
+	 current_rows[table.id()].push_back(d);
+}
+
+void RowBufferOutputChannel::finish_row(const Table& table,
+                                        double lon,
+                                        double lat,
+                                        int year) {
+	 buffer_row(table, ANNUAL, lon, lat, year, -1, -1, -1);
+}
+
+void RowBufferOutputChannel::finish_row(const Table& table,
+                                        double lon,
+                                        double lat,
+                                        int year,
+                                        int day) {
+	 buffer_row(table, DAILY, lon, lat, year, day, -1, -1);
+}
+
+void RowBufferOutputChannel::finish_row(const Table& table,
+                                        double lon,
+                                        double lat,
+                                        int year,
+                                        int day,
+                                        int stand) {
+	 buffer_row(table, STAND, lon, lat, year, day, stand, -1);
+}
+
+void RowBufferOutputChannel::finish_row(const Table& table,
+                                        double lon,
+                                        double lat,
+                                        int year,
+                                        int day,
+                                        int stand,
+                                        int patch) {
+	 buffer_row(table, PATCH, lon, lat, year, day, stand, patch);
+}
+
+void RowBufferOutputChannel::buffer_row(const Table& table,
+                                        RowType type,
+                                        double lon,
+                                        double lat,
+                                        int year,
+                                        int day,
+                                        int stand,
+                                        int patch) {
+	 // do nothing for unused tables
+	 if (table.invalid()) {
+		  return;
+	 }
+
+	 BufferedRow row;
+	 row.table = table.id();
+	 row.type = type;
+	 row.lon = lon;
+	 row.lat = lat;
+	 row.year = year;
+	 row.day = day;
+	 row.stand = stand;
+	 row.patch = patch;
+	 row.first_value = values.size();
+
+	 if (table.id() < (int)current_rows.size()) {
+		  std::vector<double>& current = current_rows[table.id()];
+		  values.insert(values.end(), current.begin(), current.end());
+		  current.clear();
+	 }
+	 row.nbr_values = values.size() - row.first_value;
+
+	 rows.push_back(row);
+}
+
+void RowBufferOutputChannel::flush() {
+	 for (size_t i = 0; i < rows.size(); i++) {
+		  const BufferedRow& row = rows[i];
+		  Table table(row.table);
+
+		  for (size_t v = 0; v < row.nbr_values; v++) {
+				target->add_value(table, values[row.first_value+v]);
+		  }
+
+		  switch (row.type) {
+		  case ANNUAL:
+				target->finish_row(table, row.lon, row.lat, row.year);
+				break;
+		  case DAILY:
+				target->finish_row(table, row.lon, row.lat, row.year, row.day);
+				break;
+		  case STAND:
+				target->finish_row(table, row.lon, row.lat, row.year, row.day, row.stand);
+				break;
+		  case PATCH:
+				target->finish_row(table, row.lon, row.lat, row.year, row.day, row.stand, row.patch);
+				break;
+		  }
+	 }
 
-	 return buf;	 
+	 rows.clear();
+	 values.clear();
 }
 
 OutputRows::OutputRows(OutputChannel* output_channel, 
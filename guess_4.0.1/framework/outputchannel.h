@@ -10,9 +10,13 @@
 #ifndef LPJ_GUESS_OUTPUT_CHANNEL_H
 #define LPJ_GUESS_OUTPUT_CHANNEL_H
 
+#include <stdio.h>
+#include <memory>
 #include <string>
 #include <vector>
 
+class BackgroundTask;
+
 namespace GuessOutput {
 
 /// Describes one column in an output table
@@ -143,6 +147,12 @@ public:
     
 	 virtual void close_table(Table& table) = 0;
 
+	 /// Called when all output for a grid cell has been sent to the channel
+	 /** Lets channels which keep output in memory decide whether to write
+	  *  it now. Does nothing by default.
+	  */
+	 virtual void gridcell_finished() {}
+
 protected:
 	 /// Get the table descriptor for a table
 	 const TableDescriptor& get_table_descriptor(const Table& table) const;
@@ -159,26 +169,51 @@ private:
 	 std::vector<std::vector<double> > values;
 };
 
+/// Appends a number formatted like printf's "%<width>.<precision>f"
+/** Gives exactly the same text as printf, but most values are converted
+ *  with integer arithmetic instead, which is considerably faster. Values
+ *  which printf could round differently (too large, too many decimals, or
+ *  very close to halfway between two results) are passed on to snprintf.
+ */
+void format_fixed(std::string& out, double value, int width, int precision);
+
 /// An output channel for regular text files with fixed width columns
 /** This output channel creates one text file for each output table.
+ *
+ *  The rows can either be written and flushed one at a time, or formatted
+ *  into a buffer for each file which is written by a background thread
+ *  in large writes once it's full. Buffered output is written when a table
+ *  is closed and when the channel is destroyed (also when the simulation
+ *  is aborted), and optionally after each grid cell, so that a crash
+ *  loses at most the output of the grid cell being simulated.
  */
 class FileOutputChannel : public OutputChannel {
 public:
 	 /// Creates a FileOutputChannel
 	 /** \param out_dir All output files are placed in this directory.
 	  *  \param coords_precision Precision to use when printing coordinates
+	  *  \param buffer_size Bytes of output to keep in memory for each file
+	  *                     before it's written, 0 writes and flushes each
+	  *                     row directly
+	  *  \param flush_gridcells Whether to write and flush all files when
+	  *                         a grid cell is finished
 	  */
-	 FileOutputChannel(const char* out_dir, int coords_precision);
+	 FileOutputChannel(const char* out_dir, int coords_precision,
+	                   size_t buffer_size = 0, bool flush_gridcells = false);
 
-	 /// Destructor - closes all opened files
+	 /// Destructor - writes buffered output and closes all opened files
 	 ~FileOutputChannel();
 
 	 /// Creates an output file
 	 /** \see OutputChannel::create_table */
 	 Table create_table(const TableDescriptor& descriptor);
 
+	 /// Writes the table's buffered output and closes its file
 	 void close_table(Table& table);
 
+	 /// Writes and flushes all files, if flush_gridcells was given
+	 void gridcell_finished();
+
 	 /// Prints the values of the current row to the file
 	 /** \see OutputChannel::finish_row */
 	 void finish_row(const Table& table, double lon, double lat,
@@ -201,21 +236,139 @@ private:
 	 void finish_row(const Table& table, double lon, double lat,
 	                 int year, int day, bool print_day, int stand, int patch);
 
-	 /// Returns the printf style format string to be used for a column
-	 const char* format(const Table& table, int column);
-
 	 /// Formats a column title
-	 const char* format_header(const Table& table, int column);
+	 std::string format_header(const Table& table, int column);
+
+	 /// Hands buffered output over to the writer thread
+	 /** \param all   Write all buffers, not only the full ones
+	  *  \param flush Flush the files after writing and wait until it's done
+	  */
+	 void write_buffers(bool all, bool flush);
+
+	 /// Writes out the files handed over by write_buffers, runs on the writer thread
+	 void write_pending(bool flush);
 
 	 const std::string output_directory;
 
 	 std::string coords_title_format;
-	 std::string coords_format;
+
+	 /// Width and precision of the coordinate columns
+	 int coords_width;
+	 int coords_precision;
+
+	 /// Width and precision of each column, for each file
+	 /** Taken from the table descriptor when the table is created. */
+	 std::vector<std::vector<std::pair<int, int> > > column_formats;
 
 	 std::vector<FILE*> files;
 
+	 /// Name of each file, for error messages
+	 std::vector<std::string> file_names;
+
 	 /// Whether the header has been printed for each file
 	 std::vector<bool> printed_header;
+
+	 /// Formatted rows not yet handed over to the writer, for each file
+	 std::vector<std::string> buffers;
+
+	 /// Output handed over to the writer thread, with the index of the file
+	 /** Only used by the writer thread while it's writing. */
+	 std::vector<std::pair<int, std::string> > pending;
+
+	 /// See constructor
+	 size_t buffer_size;
+
+	 /// See constructor
+	 bool flush_gridcells;
+
+	 /// Thread writing buffered output, created when the first buffer is handed over
+	 std::auto_ptr<BackgroundTask> writer;
+
+	 // Not copyable
+	 FileOutputChannel(const FileOutputChannel&);
+	 FileOutputChannel& operator=(const FileOutputChannel&);
+};
+
+/// An output channel which keeps finished rows in memory
+/** Used when several grid cells are simulated at once. Each thread sends
+ *  its output to its own RowBufferOutputChannel, and the framework passes
+ *  the rows on to the real output channel with flush() once a grid cell is
+ *  done, so that the output ends up in the same order as when simulating
+ *  one grid cell at a time.
+ *
+ *  The tables are created in the target channel, and the same Table
+ *  handles are then used with this channel. Values are checked against
+ *  the table descriptors when they are flushed to the target.
+ */
+class RowBufferOutputChannel : public OutputChannel {
+public:
+	 /// Creates a RowBufferOutputChannel
+	 /** \param target_channel The channel to which flush() sends the rows
+	  */
+	 RowBufferOutputChannel(OutputChannel* target_channel);
+
+	 /// Not supported, tables should be created in the target channel
+	 Table create_table(const TableDescriptor& descriptor);
+
+	 /// Not supported, tables should be closed in the target channel
+	 void close_table(Table& table);
+
+	 /// Adds a value to the next row of output for a given table
+	 void add_value(const Table& table, double d);
+
+	 /// Stores the current row in the buffer
+	 /** \see OutputChannel::finish_row */
+	 void finish_row(const Table& table, double lon, double lat,
+	                 int year);
+
+	 /// Stores the current row in the buffer
+	 /** \see OutputChannel::finish_row */
+	 void finish_row(const Table& table, double lon, double lat,
+	                 int year, int day);
+
+	 /// Stores the current row in the buffer
+	 void finish_row(const Table& table, double lon, double lat,
+	                 int year, int day, int stand);
+
+	 /// Stores the current row in the buffer
+	 void finish_row(const Table& table, double lon, double lat,
+	                 int year, int day, int stand, int patch);
+
+	 /// Sends all buffered rows to the target channel and empties the buffer
+	 void flush();
+
+private:
+	 /// Which variant of finish_row a buffered row came from
+	 enum RowType { ANNUAL, DAILY, STAND, PATCH };
+
+	 /// A finished row, the values are stored in the values member
+	 struct BufferedRow {
+		  int table;
+		  RowType type;
+		  double lon;
+		  double lat;
+		  int year;
+		  int day;
+		  int stand;
+		  int patch;
+		  size_t first_value;
+		  size_t nbr_values;
+	 };
+
+	 /// Help function to the finish_row variants above
+	 void buffer_row(const Table& table, RowType type, double lon, double lat,
+	                 int year, int day, int stand, int patch);
+
+	 OutputChannel* target;
+
+	 /// Values added so far to the current row of each table
+	 std::vector<std::vector<double> > current_rows;
+
+	 /// Finished rows, in the order they were finished
+	 std::vector<BufferedRow> rows;
+
+	 /// Values for all finished rows
+	 std::vector<double> values;
 };
 
 /// A convenience class for managing the output of one row to multiple tables.
@@ -14,19 +14,111 @@
 
 #include "config.h"
 #include "outputmodule.h"
+#include "netcdfoutputchannel.h"
 #include "parameters.h"
 #include "guess.h"
+#include <sstream>
 
 namespace GuessOutput {
 
-OutputChannel* output_channel;
+thread_local OutputChannel* output_channel;
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// OutputSchedule
+///
+
+OutputSchedule::OutputSchedule()
+	: first_year(0),
+	  step(1) {
+}
+
+OutputSchedule::OutputSchedule(int first_year, int step)
+	: first_year(first_year),
+	  step(step) {
+}
+
+bool OutputSchedule::active(const Date& date) const {
+	return date.year >= first_year && date.get_calendar_year() % step == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// TableSelection
+///
+
+TableSelection::TableSelection(const std::string& list) {
+	std::string separated = list;
+	for (size_t i = 0; i < separated.size(); ++i) {
+		if (separated[i] == ',') {
+			separated[i] = ' ';
+		}
+	}
+
+	std::istringstream is(separated);
+	std::string name;
+	while (is >> name) {
+		names.insert(table_name(name));
+	}
+}
+
+bool TableSelection::selected(const std::string& file) const {
+	if (file == "") {
+		return false;
+	}
+	if (names.empty()) {
+		return true;
+	}
+
+	const std::string name = table_name(file);
+	if (names.count(name)) {
+		matched.insert(name);
+		return true;
+	}
+	return false;
+}
+
+std::vector<std::string> TableSelection::unmatched() const {
+	std::vector<std::string> result;
+	for (std::set<std::string>::const_iterator itr = names.begin(); itr != names.end(); ++itr) {
+		if (!matched.count(*itr)) {
+			result.push_back(*itr);
+		}
+	}
+	return result;
+}
+
+std::string TableSelection::table_name(const std::string& file) {
+	std::string name = file;
+
+	const size_t slash = name.find_last_of("/\\");
+	if (slash != std::string::npos) {
+		name = name.substr(slash + 1);
+	}
+
+	const std::string extension = ".out";
+	if (name.size() > extension.size() &&
+	    name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+		name = name.substr(0, name.size() - extension.size());
+	}
+	return name;
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////
 /// OutputModule
 ///
 
-void OutputModule::create_output_table(Table& table, const char* file, const ColumnDescriptors& columns) {
+void OutputModule::create_output_table(Table& table, const char* file, const ColumnDescriptors& columns,
+                                       TableRows rows) {
+	 if (container && !container->selection.selected(file)) {
+		  table = Table();
+		  return;
+	 }
+
 	 table = output_channel->create_table(TableDescriptor(file, columns));
+
+	 if (container && !table.invalid()) {
+		  OutputModuleContainer::CreatedTable created = { file, columns.size(), rows };
+		  container->created_tables.push_back(created);
+	 }
 }
 
 void OutputModule::close_output_table(Table& table) {
@@ -39,9 +131,26 @@ void OutputModule::close_output_table(Table& table) {
 ///
 
 OutputModuleContainer::OutputModuleContainer()
-	: coordinates_precision(2) {
+	: channel(0),
+	  coordinates_precision(2),
+	  output_buffer_size(1024),
+	  output_flush_gridcell(false),
+	  output_format("text"),
+	  output_deflate_level(4) {
 	declare_parameter("outputdirectory", &outputdirectory, 300, "Directory for the output files");
 	declare_parameter("coordinates_precision", &coordinates_precision, 0, 10, "Digits after decimal point in coordinates in output");
+	declare_parameter("output_buffer_size", &output_buffer_size, 0, 1048576,
+	                  "Kilobytes of output kept in memory for each output file before "
+	                  "it is written by a background thread, 0 writes each row directly");
+	declare_parameter("output_flush_gridcell", &output_flush_gridcell,
+	                  "Whether to write all buffered output when a grid cell is finished (0,1)");
+	declare_parameter("output_format", &output_format, 10,
+	                  "Format of the output files, text (default) or netcdf");
+	declare_parameter("output_deflate_level", &output_deflate_level, 0, 9,
+	                  "Compression level for NetCDF output, 0 for none");
+	declare_parameter("output_tables", &output_tables, 2000,
+	                  "Output files to create (without directory, .out is optional), "
+	                  "separated by spaces or commas, empty for all files given in the .ins file");
 }
 
 OutputModuleContainer::~OutputModuleContainer() {
@@ -49,11 +158,16 @@ OutputModuleContainer::~OutputModuleContainer() {
 		delete modules[i];
 	}
 
-	delete output_channel;
+	if (output_channel == channel) {
+		output_channel = 0;
+	}
+
+	delete channel;
 }
 
 void OutputModuleContainer::add(OutputModule* output_module) {
 	modules.push_back(output_module);
+	output_module->container = this;
 }
 
 void OutputModuleContainer::init() {
@@ -63,23 +177,109 @@ void OutputModuleContainer::init() {
 	}
 
 	// Create the output channel
-	output_channel = new FileOutputChannel(outputdirectory.c_str(),
-	                                       coordinates_precision);
+	if (output_format == "" || output_format == "text") {
+		channel = new FileOutputChannel(outputdirectory.c_str(),
+		                                coordinates_precision,
+		                                (size_t)output_buffer_size * 1024,
+		                                output_flush_gridcell);
+	}
+	else if (output_format == "netcdf") {
+#ifdef HAVE_NETCDF
+		channel = new NetCDFOutputChannel(outputdirectory.c_str(),
+		                                  output_deflate_level);
+#else
+		fail("output_format netcdf needs LPJ-GUESS to be built with NetCDF");
+#endif
+	}
+	else {
+		fail("Unknown output_format: %s (should be text or netcdf)", output_format.c_str());
+	}
+	output_channel = channel;
+
+	selection = TableSelection(output_tables);
+	created_tables.clear();
 
 	for (size_t i = 0; i < modules.size(); ++i) {
 		modules[i]->init();
 	}
+
+	std::vector<std::string> unmatched = selection.unmatched();
+	for (size_t i = 0; i < unmatched.size(); ++i) {
+		dprintf("Warning: %s in output_tables is not an output file given in the .ins file\n",
+		        unmatched[i].c_str());
+	}
+
+	report_tables();
+}
+
+void OutputModuleContainer::report_tables() const {
+	if (created_tables.empty()) {
+		dprintf("No output tables\n");
+		return;
+	}
+
+	const char* units[] = { "grid cell", "grid cell", "stand", "patch" };
+	const int rows_per_year[] = { 1, Date::MAX_YEAR_LENGTH, 1, 1 };
+	const int NUNITS = sizeof(units)/sizeof(units[0]);
+
+	size_t totals[NUNITS] = { 0 };
+
+	dprintf("Output tables, values per year:\n");
+	for (size_t i = 0; i < created_tables.size(); ++i) {
+		const CreatedTable& table = created_tables[i];
+
+		if (table.rows == ROWS_OTHER) {
+			dprintf("  %-30s %10d per row, not written every year\n",
+			        table.file.c_str(), (int)table.columns);
+			continue;
+		}
+
+		const size_t values = table.columns * rows_per_year[table.rows];
+		totals[table.rows == ROWS_DAILY ? ROWS_ANNUAL : table.rows] += values;
+
+		dprintf("  %-30s %10d per %s\n", table.file.c_str(), (int)values, units[table.rows]);
+	}
+
+	for (int i = 0; i < NUNITS; ++i) {
+		if (totals[i] > 0) {
+			dprintf("  %-30s %10d per %s\n", "Total", (int)totals[i], units[i]);
+		}
+	}
+}
+
+OutputChannel* OutputModuleContainer::get_output_channel() const {
+	return channel;
 }
 
 void OutputModuleContainer::outannual(Gridcell& gridcell) {
 	for (size_t i = 0; i < modules.size(); ++i) {
-		modules[i]->outannual(gridcell);
+		if (modules[i]->get_schedule().active(date)) {
+			modules[i]->outannual(gridcell);
+		}
 	}
 }
 
 void OutputModuleContainer::outdaily(Gridcell& gridcell) {
 	for (size_t i = 0; i < modules.size(); ++i) {
-		modules[i]->outdaily(gridcell);
+		if (modules[i]->get_schedule().active(date)) {
+			modules[i]->outdaily(gridcell);
+		}
+	}
+}
+
+void OutputModuleContainer::outgridcell(Gridcell& gridcell) {
+	for (size_t i = 0; i < modules.size(); ++i) {
+		modules[i]->outgridcell(gridcell);
+	}
+
+	if (output_channel) {
+		output_channel->gridcell_finished();
+	}
+}
+
+void OutputModuleContainer::outsimulation() {
+	for (size_t i = 0; i < modules.size(); ++i) {
+		modules[i]->outsimulation();
 	}
 }
 
@@ -13,12 +13,86 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 #include "outputchannel.h"
 
 class Gridcell;
+class Date;
 
 namespace GuessOutput {
 
+/// The years in which an output module writes output
+/** An output module which only writes output for some years sets its
+ *  schedule in init(), and the framework then only calls its outannual
+ *  and outdaily in those years, instead of the module computing all its
+ *  output every year only to throw it away (during the spinup for instance).
+ */
+class OutputSchedule {
+public:
+	/// Output every simulated year, including the spinup
+	OutputSchedule();
+
+	/// Output from a given simulation year, optionally only every step:th year
+	/** \param first_year First year with output, counted like date.year
+	 *                    (0 is the first year of the spinup)
+	 *  \param step       Only calendar years divisible by step have output
+	 */
+	OutputSchedule(int first_year, int step = 1);
+
+	/// Whether there is output in the current year of date
+	bool active(const Date& date) const;
+
+private:
+	int first_year;
+	int step;
+};
+
+/// The output tables wanted in a run, from the output_tables parameter
+/** The parameter lists the wanted tables by their file names, separated by
+ *  spaces or commas, with or without the .out extension (for instance
+ *  "cmass.out anpp mlai"). Only tables which also have a file name in the
+ *  instruction file can be selected, the list just picks some of them.
+ *  An empty list selects all tables.
+ */
+class TableSelection {
+public:
+	/// Parses a list of file names, an empty list selects everything
+	TableSelection(const std::string& list = "");
+
+	/// Whether the table with a given file name should be created
+	/** Returns false for an empty file name. */
+	bool selected(const std::string& file) const;
+
+	/// The names in the list which haven't matched any table
+	std::vector<std::string> unmatched() const;
+
+private:
+	/// Removes the directory and the .out extension from a file name
+	static std::string table_name(const std::string& file);
+
+	/// The table names in the list, empty to select all tables
+	std::set<std::string> names;
+
+	/// The names which have been asked for in selected()
+	mutable std::set<std::string> matched;
+};
+
+/// How many rows a table gets, for the table report printed at startup
+enum TableRows {
+	/// One row per grid cell and year
+	ROWS_ANNUAL,
+	/// One row per grid cell and day
+	ROWS_DAILY,
+	/// One row per stand and year
+	ROWS_STAND,
+	/// One row per patch and year
+	ROWS_PATCH,
+	/// Not written every year (once per grid cell or simulation)
+	ROWS_OTHER
+};
+
+class OutputModuleContainer;
+
 /// Base class for output modules
 /**
  *  An output module should inherit from this class and implement
@@ -30,6 +104,8 @@ namespace GuessOutput {
  */
 class OutputModule {
 public:
+	OutputModule() : container(0) {}
+
 	virtual ~OutputModule() {};
 
 	/// Called after the instruction file has been read
@@ -54,14 +130,46 @@ public:
 	/** Similar to outannual but called every day */
 	virtual void outdaily(Gridcell& gridcell) = 0;
 
+	/// Called by the framework when the simulation of a grid cell is finished
+	/** Most output modules have nothing more to write by then, so the default
+	 *  implementation does nothing. */
+	virtual void outgridcell(Gridcell& /*gridcell*/) {}
+
+	/// Called by the framework when all grid cells have been simulated
+	/** Called once per process, on the main thread. */
+	virtual void outsimulation() {}
+
+	/// The years in which the framework calls outannual and outdaily
+	const OutputSchedule& get_schedule() const { return schedule; }
+
 protected:
 
+	/// Sets the years with output, should be called from init()
+	/** By default outannual and outdaily are called every year. */
+	void set_schedule(const OutputSchedule& output_schedule) { schedule = output_schedule; }
+
 	/// Help function to define_output_tables, creates one output table
+	/** The table is left invalid if file is empty or the table isn't
+	 *  selected with the output_tables parameter, so after creating its
+	 *  tables a module can skip the calculations for invalid tables.
+	 *
+	 *  \param rows How often the table gets a row, only used in the
+	 *              table report printed at startup
+	 */
 	void create_output_table(Table& table,
 	                         const char* file,
-	                         const ColumnDescriptors& columns);
+	                         const ColumnDescriptors& columns,
+	                         TableRows rows = ROWS_ANNUAL);
 
 	void close_output_table(Table& table);
+
+private:
+	friend class OutputModuleContainer;
+
+	OutputSchedule schedule;
+
+	/// The container the module has been added to, if any
+	OutputModuleContainer* container;
 };
 
 
@@ -84,27 +192,78 @@ public:
 	 */
 	void add(OutputModule* output_module);
 
-	/// Calls init on all output modules
-	/** Should be called after the instruction file has been read */
+	/// Creates the output channel and calls init on all output modules
+	/** Should be called after the instruction file has been read.
+	 *  The output channel becomes the current output_channel.
+	 */
 	void init();
 
-	/// Calls outannual on all output modules
+	/// The output channel for the files in outputdirectory
+	/** Set output_channel to this before sending results to the modules,
+	 *  when there are several containers (see Scenario).
+	 */
+	OutputChannel* get_output_channel() const;
+
+	/// Calls outannual on the output modules with output this year
 	void outannual(Gridcell& gridcell);
 
-	/// Calls outdaily on all output modules
+	/// Calls outdaily on the output modules with output this year
 	void outdaily(Gridcell& gridcell);
 
+	/// Calls outgridcell on all output modules
+	/** Then tells the current output channel that the grid cell is finished. */
+	void outgridcell(Gridcell& gridcell);
+
+	/// Calls outsimulation on all output modules
+	void outsimulation();
+
 private:
+	friend class OutputModule;
+
+	/// A table created by one of the modules, for the table report
+	struct CreatedTable {
+		std::string file;
+		size_t columns;
+		TableRows rows;
+	};
+
+	/// Prints the number of values per year in each created table
+	void report_tables() const;
 
 	/// The output modules
 	std::vector<OutputModule*> modules;
 
+	/// Output channel created by init
+	OutputChannel* channel;
+
 	/// Instruction file parameter deciding where to create output files
 	std::string outputdirectory;
 
 	/// Instruction file parameter deciding precision of coordinates in output
 	/** The parameter controls the number of digits after the decimal point */
 	int coordinates_precision;
+
+	/// Instruction file parameter, kilobytes of output buffered for each file
+	/** 0 writes and flushes each row directly (see FileOutputChannel). */
+	int output_buffer_size;
+
+	/// Instruction file parameter, whether to write buffered output after each grid cell
+	bool output_flush_gridcell;
+
+	/// Instruction file parameter, text for FileOutputChannel or netcdf for NetCDFOutputChannel
+	std::string output_format;
+
+	/// Instruction file parameter, compression level for NetCDF output
+	int output_deflate_level;
+
+	/// Instruction file parameter, the wanted tables (see TableSelection)
+	std::string output_tables;
+
+	/// The tables selected by output_tables, parsed in init
+	TableSelection selection;
+
+	/// The tables created by the modules in init
+	std::vector<CreatedTable> created_tables;
 };
 
 
@@ -182,8 +341,11 @@ int x = dummy();\
  *  existing outannual functions). Should be a member of
  *  OutputModuleContainer, which is already responsible for
  *  creating and destroying the output_channel.
+ *
+ *  Each thread has its own pointer, threads simulating grid cells
+ *  in parallel send their output to a RowBufferOutputChannel.
  */
-extern OutputChannel* output_channel;
+extern thread_local OutputChannel* output_channel;
 
 }
 
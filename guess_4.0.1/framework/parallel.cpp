@@ -22,6 +22,7 @@
 #include "config.h"
 #include "parallel.h"
 #include "shell.h"
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -31,10 +32,31 @@ bool parallel = false;
 
 #ifdef HAVE_MPI
 
+/// Whether grid cells are handed out by rank 0 (the -dynamic option)
+bool dynamic = false;
+
+/// Whether this process has left the dynamic scheduling of grid cells
+/** Set when rank 0 has finished handing out grid cells, or when a
+ *  worker has been told there are none left or has abandoned them. */
+bool scheduling_finished = false;
+
 /// A class whose only purpose is to terminate the MPI library when deleted
 class FinalizeCaller {
 public:
 	~FinalizeCaller() {
+		// A process which exits in the middle of dynamic scheduling
+		// (typically by calling fail()) would leave the others waiting
+		// for it forever. A worker tells rank 0 so the others can stop
+		// after their current batch, if rank 0 exits nobody is left
+		// to hand out grid cells so the whole job is aborted.
+		if (dynamic && !scheduling_finished) {
+			int rank;
+			MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+			if (rank == 0) {
+				MPI_Abort(MPI_COMM_WORLD, 99);
+			}
+			abandon_gridcells();
+		}
 		MPI_Finalize();
 	}
 };
@@ -42,6 +64,17 @@ public:
 /// The auto pointer will delete the object some time after main() is finished
 std::auto_ptr<FinalizeCaller> destructor;
 
+/// Message tags for the dynamic scheduling of grid cells
+enum SchedulingTag {
+	/// Worker to rank 0, one int: WORKER_READY or WORKER_ABORTED
+	TAG_REQUEST = 1,
+	/// Rank 0 to worker, two ints: first gridlist index and batch size
+	TAG_BATCH
+};
+
+const int WORKER_READY = 0;
+const int WORKER_ABORTED = 1;
+
 #endif
 
 void init(int& argc, char**& argv) {
@@ -56,14 +89,18 @@ void init(int& argc, char**& argv) {
 
 	// Unfortunately, since MPI initialization must be done before
 	// we parse our options with CommandLineArguments, we need to
-	// look for the -parallel option here by ourselves.
+	// look for the -parallel option here by ourselves (and -dynamic,
+	// see FinalizeCaller).
 	// The file-global variable parallel is initiated = false;
 	for (int i = 0; i < argc; ++i) {
 		if (std::string(argv[i]) == "-parallel") {
 			parallel = true;
-			break;
+		}
+		else if (std::string(argv[i]) == "-dynamic") {
+			dynamic = true;
 		}
 	}
+	dynamic = dynamic && parallel;
 
 	if (parallel) {
 		MPI_Init(&argc, &argv);
@@ -97,4 +134,87 @@ int get_num_processes() {
 #endif
 }
 
+int gridcell_batch_size(int remaining, int nworkers) {
+	if (remaining <= 0) {
+		return 0;
+	}
+	return std::max(1, remaining / (4 * std::max(1, nworkers)));
+}
+
+bool distribute_gridcells(int ngridcells) {
+#ifdef HAVE_MPI
+	const int nworkers = get_num_processes() - 1;
+
+	int next_gridcell = 0;
+	int nbatches = 0;
+	int active_workers = nworkers;
+	bool aborted = false;
+
+	while (active_workers > 0) {
+		int message;
+		MPI_Status status;
+		MPI_Recv(&message, 1, MPI_INT, MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status);
+
+		if (message == WORKER_ABORTED) {
+			// The worker expects no answer, and nobody else gets more work
+			dprintf("Process %d aborted the simulation\n", status.MPI_SOURCE);
+			aborted = true;
+			--active_workers;
+			continue;
+		}
+
+		int batch[2] = { next_gridcell, 0 };
+		if (!aborted) {
+			batch[1] = gridcell_batch_size(ngridcells - next_gridcell, nworkers);
+		}
+
+		if (batch[1] > 0) {
+			next_gridcell += batch[1];
+			++nbatches;
+		}
+		else {
+			// The worker will stop asking once told there is nothing left
+			--active_workers;
+		}
+
+		MPI_Send(batch, 2, MPI_INT, status.MPI_SOURCE, TAG_BATCH, MPI_COMM_WORLD);
+	}
+
+	scheduling_finished = true;
+
+	dprintf("Handed out %d grid cells to %d processes in %d batches\n",
+	        next_gridcell, nworkers, nbatches);
+
+	return !aborted;
+#else
+	return true;
+#endif
+}
+
+bool request_gridcells(int& first, int& count) {
+#ifdef HAVE_MPI
+	int message = WORKER_READY;
+	MPI_Send(&message, 1, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+
+	int batch[2];
+	MPI_Recv(batch, 2, MPI_INT, 0, TAG_BATCH, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+	first = batch[0];
+	count = batch[1];
+	scheduling_finished = count <= 0;
+	return count > 0;
+#else
+	first = count = 0;
+	return false;
+#endif
+}
+
+void abandon_gridcells() {
+#ifdef HAVE_MPI
+	int message = WORKER_ABORTED;
+	MPI_Send(&message, 1, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+	scheduling_finished = true;
+#endif
+}
+
 }
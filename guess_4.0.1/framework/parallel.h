@@ -35,6 +35,48 @@ int get_rank();
 /** Returns 1 when no MPI library is available/used. */
 int get_num_processes();
 
+/// Number of grid cells to hand out in one go with dynamic scheduling
+/** Hands out a quarter of a fair share of the remaining grid cells,
+ *  so batches are large (few messages) early in the run, and single
+ *  grid cells towards the end, when an unlucky batch of expensive
+ *  grid cells would otherwise keep one process busy long after the
+ *  others have finished.
+ *
+ *  \param remaining Number of grid cells not yet handed out
+ *  \param nworkers  Number of processes simulating grid cells
+ *  \returns Zero if there are no grid cells left
+ */
+int gridcell_batch_size(int remaining, int nworkers);
+
+/// Hands out grid cells to the other processes until all are simulated
+/** Called by rank 0 when the model is run with dynamic scheduling
+ *  (the -dynamic option). Instead of each process simulating its own
+ *  part of the gridlist, the other processes (the workers) all read
+ *  the full gridlist and ask rank 0 for a new batch of grid cells
+ *  each time they have finished the previous one.
+ *
+ *  Returns when every worker has been told there is no more work,
+ *  or has reported that it aborted.
+ *
+ *  \param ngridcells Number of grid cells in the gridlist
+ *  \returns false if one of the workers aborted the simulation
+ */
+bool distribute_gridcells(int ngridcells);
+
+/// Asks rank 0 for a batch of grid cells to simulate
+/** Also tells rank 0 that the previous batch is finished.
+ *
+ *  \param first Set to the gridlist index of the first grid cell in the batch
+ *  \param count Set to the number of grid cells in the batch
+ *  \returns false when there are no more grid cells to simulate
+ */
+bool request_gridcells(int& first, int& count);
+
+/// Tells rank 0 that this worker won't ask for more grid cells
+/** Used instead of request_gridcells when the simulation is aborted,
+ *  rank 0 then stops handing out grid cells to the other workers. */
+void abandon_gridcells();
+
 }
 
 #endif // LPJ_GUESS_PARALLEL_H
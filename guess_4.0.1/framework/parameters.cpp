@@ -21,6 +21,7 @@
 #include "guess.h"
 #include "plib.h"
 #include <map>
+#include <string.h>
 
 // Definitions of parameters defined globally in parameters.h,
 // for documentation, see parameters.h
@@ -47,6 +48,7 @@ bool ifcdebt;
 bool ifcentury;
 bool ifnlim;
 int freenyears;
+equilsomtype equilsom_method;
 
 // cw a pft specific parameter
 // double nrelocfrac;
@@ -163,12 +165,12 @@ bool Paramlist::isparam(xtring name) {
 ///////////////////////////////////////////////////////////////////////////////////////
 // ENUM DECLARATIONS OF INTEGER CONSTANTS FOR PLIB INTERFACE
 
-enum {BLOCK_GLOBAL,BLOCK_PFT,BLOCK_PARAM,BLOCK_ST,BLOCK_MT};
+enum {BLOCK_GLOBAL,BLOCK_PFT,BLOCK_PARAM,BLOCK_ST,BLOCK_MT,BLOCK_SCENARIO};
 enum {CB_NONE,CB_VEGMODE,CB_CHECKGLOBAL,CB_LIFEFORM,CB_LANDCOVER,CB_PHENOLOGY,CB_LEAFPHYSIOGNOMY,CB_SELECTION,	
 	CB_STLANDCOVER, CB_STINTERCROP, CB_STNATURALVEG, CB_CHECKST, CB_CHECKMT,
 	CB_MTPLANTINGSYSTEM, CB_MTHARVESTSYSTEM, CB_MTPFT, CB_STREESTAB, CB_MTSELECTION, CB_MTHYDROLOGY,
 	CB_PLANTINGSYSTEM, CB_HARVESTSYSTEM, CB_PFT, CB_STSELECTION, CB_STHYDROLOGY, CB_MANAGEMENT1, CB_MANAGEMENT2, CB_MANAGEMENT3,
-	CB_PATHWAY,CB_ROOTDIST,CB_EST,CB_CHECKPFT,CB_STRPARAM,CB_NUMPARAM,CB_WATERUPTAKE};
+	CB_PATHWAY,CB_ROOTDIST,CB_EST,CB_CHECKPFT,CB_STRPARAM,CB_NUMPARAM,CB_WATERUPTAKE,CB_EQUILSOM,CB_CHECKSCENARIO};
 
 // File local variables
 namespace {
@@ -182,6 +184,12 @@ xtring strparam;
 double numparam;
 bool ifhelp=false;
 
+// The list custom parameters are added to, the scenario's own inside a scenario block
+Paramlist* pparamlist = &param;
+
+// The scenario block currently being parsed, merged into scenariolist when done
+Scenario parsed_scenario;
+
 // 'include' parameter for currently scanned PFT
 bool includepft;
 bool includest;
@@ -370,34 +378,167 @@ struct boolParam {
 
 std::vector<boolParam> boolParams;
 
+/// Looks for an earlier declaration of a parameter
+/** Returns the index of the parameter in params, or -1 if not found. */
+template<typename ParamType>
+int find_declared(const std::vector<ParamType>& params, const char* name) {
+	for (size_t i = 0; i < params.size(); ++i) {
+		if (!strcmp(params[i].name, name)) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
 } // namespace
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // The following declare_parameter allow other modules to declare instruction file
 // parameters. The information is simply stored and then sent to plib in
 // plib_declarations with calls to declareitem().
+//
+// A parameter which has already been declared is not declared again, the new
+// variable is instead given the current value of the first one. This allows
+// the framework to create further instances of a module (e.g. one input module
+// per thread) after the instruction file has been read.
 
 void declare_parameter(const char* name, xtring* param, int maxlen, const char* help) {
-	xtringParams.push_back(xtringParam(name, param, maxlen, help));
+	int i = find_declared(xtringParams, name);
+	if (i >= 0) {
+		*param = *xtringParams[i].param;
+	}
+	else {
+		xtringParams.push_back(xtringParam(name, param, maxlen, help));
+	}
 }
 
 void declare_parameter(const char* name, std::string* param, int maxlen, const char* help) {
-	stringParams.push_back(stringParam(name, param, maxlen, help));
+	int i = find_declared(stringParams, name);
+	if (i >= 0) {
+		*param = *stringParams[i].param;
+	}
+	else {
+		stringParams.push_back(stringParam(name, param, maxlen, help));
+	}
 }
 
 void declare_parameter(const char* name, int* param, int min, int max, const char* help) {
-	intParams.push_back(intParam(name, param, min, max, help));
+	int i = find_declared(intParams, name);
+	if (i >= 0) {
+		*param = *intParams[i].param;
+	}
+	else {
+		intParams.push_back(intParam(name, param, min, max, help));
+	}
 }
 
 void declare_parameter(const char* name, double* param, double min, double max, const char* help) {
-	doubleParams.push_back(doubleParam(name, param, min, max, help));
+	int i = find_declared(doubleParams, name);
+	if (i >= 0) {
+		*param = *doubleParams[i].param;
+	}
+	else {
+		doubleParams.push_back(doubleParam(name, param, min, max, help));
+	}
 }
 
 void declare_parameter(const char* name, bool* param, const char* help) {
-	boolParams.push_back(boolParam(name, param, help));
+	int i = find_declared(boolParams, name);
+	if (i >= 0) {
+		*param = *boolParams[i].param;
+	}
+	else {
+		boolParams.push_back(boolParam(name, param, help));
+	}
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////
+// Implementation of the scenarios
+
+ListArray<Scenario> scenariolist;
+
+namespace {
+
+/// Adds (or overwrites) the custom parameters in one list to another
+void copy_params(Paramlist& from, Paramlist& to) {
+	from.firstobj();
+	while (from.isobj) {
+		Paramtype& p = from.getobj();
+		to.addparam(p.name, p.str);
+		to.addparam(p.name, p.num);
+		from.nextobj();
+	}
+}
+
+/// Sets declared parameters to given values
+/** \param params The declared parameters of one type
+ *  \param values New values, by name
+ *  \param old    If not NULL, gets the values the parameters had before
+ */
+template<typename ParamType, typename T>
+void set_declared(const std::vector<ParamType>& params,
+                  const std::map<std::string, T>& values,
+                  std::map<std::string, T>* old) {
+	typename std::map<std::string, T>::const_iterator itr;
+	for (itr = values.begin(); itr != values.end(); ++itr) {
+		int i = find_declared(params, itr->first.c_str());
+		if (i >= 0) {
+			if (old) {
+				(*old)[itr->first] = *params[i].param;
+			}
+			*params[i].param = itr->second;
+		}
+	}
+}
+
+/// Removes values for items which weren't given in the scenario block just parsed
+template<typename T>
+void erase_unparsed(std::map<std::string, T>& values) {
+	typename std::map<std::string, T>::iterator itr = values.begin();
+	while (itr != values.end()) {
+		if (!itemparsed(itr->first.c_str())) {
+			values.erase(itr++);
+		}
+		else {
+			++itr;
+		}
+	}
+}
+
+/// Adds (or overwrites) the values of one map in another
+template<typename T>
+void merge_values(const std::map<std::string, T>& from, std::map<std::string, T>& to) {
+	typename std::map<std::string, T>::const_iterator itr;
+	for (itr = from.begin(); itr != from.end(); ++itr) {
+		to[itr->first] = itr->second;
+	}
+}
+
+} // namespace
+
+ScenarioParameters::ScenarioParameters(Scenario& scenario) {
+	set_declared(xtringParams, scenario.xtrings, &saved.xtrings);
+	set_declared(stringParams, scenario.strings, &saved.strings);
+	set_declared(intParams, scenario.ints, &saved.ints);
+	set_declared(doubleParams, scenario.doubles, &saved.doubles);
+	set_declared(boolParams, scenario.bools, &saved.bools);
+
+	copy_params(param, saved.param);
+	copy_params(scenario.param, param);
+}
+
+ScenarioParameters::~ScenarioParameters() {
+	set_declared(xtringParams, saved.xtrings, (std::map<std::string, xtring>*)0);
+	set_declared(stringParams, saved.strings, (std::map<std::string, std::string>*)0);
+	set_declared(intParams, saved.ints, (std::map<std::string, int>*)0);
+	set_declared(doubleParams, saved.doubles, (std::map<std::string, double>*)0);
+	set_declared(boolParams, saved.bools, (std::map<std::string, bool>*)0);
+
+	param.killall();
+	copy_params(saved.param, param);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 // The following code uses functionality from the PLIB library to process an
 // instruction script (ins) file containing simulation settings and PFT parameters.
@@ -470,6 +611,8 @@ void plib_declarations(int id,xtring setname) {
 			"Whether plant growth limited by available nitrogen");
 		declareitem("freenyears",&freenyears,0,1000,1,CB_NONE,
 			"Number of years to spinup without nitrogen limitation");
+		declareitem("equilsom",&strparam,16,CB_EQUILSOM,
+			"How CENTURY SOM pools reach equilibrium (\"SPIN\", \"ANALYTIC\", \"VALIDATE\")");
 
 		declareitem("ifsmoothgreffmort",&ifsmoothgreffmort,1,CB_NONE,
 			"Whether to vary mort_greff smoothly with growth efficiency (0,1)");
@@ -529,6 +672,7 @@ void plib_declarations(int id,xtring setname) {
 		declareitem("param",BLOCK_PARAM,CB_NONE,"Header for custom parameter block");
 		declareitem("st",BLOCK_ST,CB_NONE,"Header for block defining StandType");
 		declareitem("mt",BLOCK_MT,CB_NONE,"Header for block defining Management");
+		declareitem("scenario",BLOCK_SCENARIO,CB_NONE,"Header for block defining a scenario");
 
 		for (size_t i = 0; i < xtringParams.size(); ++i) {
 			const xtringParam& p = xtringParams[i];
@@ -935,6 +1079,51 @@ void plib_declarations(int id,xtring setname) {
 
 		break;
 
+	case BLOCK_SCENARIO:
+
+		// The values are parsed into parsed_scenario, and then
+		// merged into the scenario with the same name (CB_CHECKSCENARIO)
+		parsed_scenario.name = setname;
+		parsed_scenario.xtrings.clear();
+		parsed_scenario.strings.clear();
+		parsed_scenario.ints.clear();
+		parsed_scenario.doubles.clear();
+		parsed_scenario.bools.clear();
+		parsed_scenario.param.killall();
+
+		pparamlist = &parsed_scenario.param;
+
+		declareitem("param",BLOCK_PARAM,CB_NONE,"Header for custom parameter block");
+
+		for (size_t i = 0; i < xtringParams.size(); ++i) {
+			const xtringParam& p = xtringParams[i];
+			declareitem(p.name, &parsed_scenario.xtrings[p.name], p.maxlen, 0, p.help);
+		}
+
+		for (size_t i = 0; i < stringParams.size(); ++i) {
+			const stringParam& p = stringParams[i];
+			declareitem(p.name, &parsed_scenario.strings[p.name], p.maxlen, 0, p.help);
+		}
+
+		for (size_t i = 0; i < intParams.size(); ++i) {
+			const intParam& p = intParams[i];
+			declareitem(p.name, &parsed_scenario.ints[p.name], p.min, p.max, 1, 0, p.help);
+		}
+
+		for (size_t i = 0; i < doubleParams.size(); ++i) {
+			const doubleParam& p = doubleParams[i];
+			declareitem(p.name, &parsed_scenario.doubles[p.name], p.min, p.max, 1, 0, p.help);
+		}
+
+		for (size_t i = 0; i < boolParams.size(); ++i) {
+			const boolParam& p = boolParams[i];
+			declareitem(p.name, &parsed_scenario.bools[p.name], 1, 0, p.help);
+		}
+
+		callwhendone(CB_CHECKSCENARIO);
+
+		break;
+
 	case BLOCK_PARAM:
 
 		paramname=setname;
@@ -982,6 +1171,16 @@ void plib_callback(int callback) {
 				"Unknown water uptake mode (valid types: \"WCONT\", \"ROOTDIST\", \"SMART\", \"SPECIESSPECIFIC\")");
 		}
 		break;
+	case CB_EQUILSOM:
+		if (strparam.upper() == "SPIN") equilsom_method = EQUILSOM_SPIN;
+		else if (strparam.upper() == "ANALYTIC") equilsom_method = EQUILSOM_ANALYTIC;
+		else if (strparam.upper() == "VALIDATE") equilsom_method = EQUILSOM_VALIDATE;
+		else {
+			sendmessage("Error",
+				"Unknown equilsom method (valid types: \"SPIN\", \"ANALYTIC\", \"VALIDATE\")");
+			plibabort();
+		}
+		break;
 	case CB_LIFEFORM:
 		if (strparam.upper()=="TREE") ppft->lifeform=TREE;
 		else if (strparam.upper()=="GRASS") ppft->lifeform=GRASS;
@@ -1130,10 +1329,10 @@ void plib_callback(int callback) {
 		ppft->rootdist[NSOILLAYER-1]+=1.0-numval;
 		break;
 	case CB_STRPARAM:
-		param.addparam(paramname,strparam);
+		pparamlist->addparam(paramname,strparam);
 		break;
 	case CB_NUMPARAM:
-		param.addparam(paramname,numparam);
+		pparamlist->addparam(paramname,numparam);
 		break;
 	case CB_CHECKGLOBAL:
 		if (!itemparsed("title")) badins("title");
@@ -1153,6 +1352,7 @@ void plib_callback(int callback) {
 		if (!itemparsed("ifcentury")) badins("ifcentury");
 		if (!itemparsed("ifnlim")) badins("ifnlim");
 		if (!itemparsed("freenyears")) badins("freenyears");
+		if (!itemparsed("equilsom")) equilsom_method = EQUILSOM_SPIN;
 
 		if (nyear_spinup <= freenyears) {
 			sendmessage("Error", "freenyears must be smaller than nyear_spinup");
@@ -1737,6 +1937,38 @@ void plib_callback(int callback) {
 		}
 
 		break;
+
+	case CB_CHECKSCENARIO:
+		{
+			pparamlist = &param;
+
+			erase_unparsed(parsed_scenario.xtrings);
+			erase_unparsed(parsed_scenario.strings);
+			erase_unparsed(parsed_scenario.ints);
+			erase_unparsed(parsed_scenario.doubles);
+			erase_unparsed(parsed_scenario.bools);
+
+			// Was this scenario already defined?
+			Scenario* pscenario = 0;
+			for (unsigned int i = 0; i < scenariolist.nobj; ++i) {
+				if (scenariolist[i].name == parsed_scenario.name) {
+					pscenario = &scenariolist[i];
+				}
+			}
+
+			if (pscenario == 0) {
+				pscenario = &scenariolist.createobj();
+				pscenario->name = parsed_scenario.name;
+			}
+
+			merge_values(parsed_scenario.xtrings, pscenario->xtrings);
+			merge_values(parsed_scenario.strings, pscenario->strings);
+			merge_values(parsed_scenario.ints, pscenario->ints);
+			merge_values(parsed_scenario.doubles, pscenario->doubles);
+			merge_values(parsed_scenario.bools, pscenario->bools);
+			copy_params(parsed_scenario.param, pscenario->param);
+		}
+		break;
 	}
 }
 
@@ -1780,6 +2012,8 @@ void read_instruction_file(const char* insfilename) {
 	}
 
 	param.killall();
+	scenariolist.killall();
+	pparamlist = &param;
 
 	// Initialise simulation settings and PFT parameters from instruction script
 	if (!plib(insfilename)) {
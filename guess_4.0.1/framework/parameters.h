@@ -29,6 +29,7 @@
 #define LPJ_GUESS_PARAMETERS_H
 
 #include "gutil.h"
+#include <map>
 #include <string>
 
 
@@ -55,6 +56,11 @@ typedef enum {URBAN, CROPLAND, PASTURE, FOREST, NATURAL, PEATLAND, BARREN, NLAND
   */
 typedef enum {WR_WCONT, WR_ROOTDIST, WR_SMART, WR_SPECIESSPECIFIC} wateruptaketype;
 
+/// Methods of bringing the CENTURY SOM pools to equilibrium during the spinup
+/** \see equilsom in somdynam.cpp
+  */
+typedef enum {EQUILSOM_SPIN, EQUILSOM_ANALYTIC, EQUILSOM_VALIDATE} equilsomtype;
+
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // Global instruction file parameters
@@ -131,6 +137,8 @@ extern bool ifnlim;
 
 /// number of years to allow spinup without nitrogen limitation
 extern int freenyears;
+/// how CENTURY SOM pools are brought to equilibrium during the spinup
+extern equilsomtype equilsom_method;
 /// fraction of nitrogen relocated by plants from roots and leaves
 
 // cw now pft specific
@@ -325,6 +333,70 @@ private:
 /** Contains all the custom parameters after reading in the instruction file */
 extern Paramlist param;
 
+///////////////////////////////////////////////////////////////////////////////////////
+// Scenarios
+//
+
+/// A scenario simulated from the state of each grid cell at the end of the spinup
+/** Scenarios are defined in the instruction file with blocks like:
+ *
+ * \code
+ *     scenario "rcp45" (
+ *         outputdirectory "./rcp45/"
+ *         ndep_timeseries "rcp45"
+ *         param "file_co2" (str "co2_rcp45.txt")
+ *     )
+ * \endcode
+ *
+ * A scenario block may set the parameters declared with declare_parameter
+ * (typically those of the input and output modules) and custom "param"
+ * items, everything else is the same as for the rest of the instruction file.
+ *
+ * The framework spins each grid cell up once, then simulates the years after
+ * the spinup once with the ordinary settings and once for each scenario,
+ * starting from a copy of the grid cell. Each scenario has its own input and
+ * output modules, created with the scenario's settings (\see ScenarioParameters).
+ */
+struct Scenario {
+	/// Name of the scenario in the instruction file
+	xtring name;
+
+	/// Values of the declared parameters set in the scenario block, by name
+	std::map<std::string, xtring> xtrings;
+	std::map<std::string, std::string> strings;
+	std::map<std::string, int> ints;
+	std::map<std::string, double> doubles;
+	std::map<std::string, bool> bools;
+
+	/// Custom parameters set in the scenario block
+	Paramlist param;
+};
+
+/// The scenarios defined in the instruction file
+extern ListArray<Scenario> scenariolist;
+
+/// Gives the parameters the values of a scenario while the object exists
+/** The declared parameters are set in the variables of the modules which
+ *  first declared them, modules created meanwhile get the same values
+ *  (see declare_parameter below). The custom parameters of the scenario
+ *  are added to the global Paramlist object. Everything is restored by
+ *  the destructor.
+ */
+class ScenarioParameters {
+public:
+	ScenarioParameters(Scenario& scenario);
+
+	~ScenarioParameters();
+
+private:
+	/// The values the parameters had before
+	Scenario saved;
+
+	// Not copyable
+	ScenarioParameters(const ScenarioParameters&);
+	ScenarioParameters& operator=(const ScenarioParameters&);
+};
+
 /// Reads in the instruction file
 /** Uses PLIB library functions to read instructions from file specified by
  * 'insfilename'.
@@ -337,6 +409,9 @@ void printhelp();
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // Interface for declaring parameters from other modules
+//
+// Declaring a parameter which has already been declared doesn't declare it again,
+// instead the new variable gets the current value of the earlier declared one.
 
 /// Declares an xtring parameter
 /** \param name     The name of the parameter
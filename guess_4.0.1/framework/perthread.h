@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file perthread.h
+/// \brief One instance of an object for each thread using it
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_PER_THREAD_H
+#define LPJ_GUESS_PER_THREAD_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/// Keeps a separate, default constructed T for each thread calling get()
+/** Used for instance by input modules, which are shared by all threads
+ *  simulating grid cells (see the -threads option), to keep the data for the
+ *  grid cell each thread is working on. Everything else in the module is
+ *  shared and read-only after init().
+ *
+ *  The objects are created the first time a thread calls get(), and live
+ *  until the PerThread object is destroyed, so the threads must be joined
+ *  before that. A thread started after another one has finished may get
+ *  the finished thread's object (the thread ids can be reused).
+ */
+template <typename T>
+class PerThread {
+public:
+	PerThread()
+		: id(next_id()) {
+	}
+
+	~PerThread() {
+		for (typename std::map<std::thread::id, T*>::iterator itr = objects.begin();
+		     itr != objects.end(); ++itr) {
+			delete itr->second;
+		}
+	}
+
+	/// The calling thread's object
+	T& get() {
+		// Most calls come from the same thread for the same object
+		// (e.g. getclimate() every day), so the last lookup is
+		// remembered per thread to avoid taking the mutex
+		static thread_local unsigned long cached_id = 0;
+		static thread_local T* cached = 0;
+
+		if (cached_id != id) {
+			std::lock_guard<std::mutex> lock(mutex);
+			T*& object = objects[std::this_thread::get_id()];
+			if (!object) {
+				object = new T;
+			}
+			cached = object;
+			cached_id = id;
+		}
+		return *cached;
+	}
+
+private:
+	/// Identifies this object in the threads' caches, never reused
+	static unsigned long next_id() {
+		static std::atomic<unsigned long> counter(0);
+		return ++counter;
+	}
+
+	const unsigned long id;
+
+	std::mutex mutex;
+
+	std::map<std::thread::id, T*> objects;
+
+	// Not copyable
+	PerThread(const PerThread&);
+	PerThread& operator=(const PerThread&);
+};
+
+#endif // LPJ_GUESS_PER_THREAD_H
@@ -0,0 +1,68 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file profiler.cpp
+/// \brief Timing of the stages of the daily simulation
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "profiler.h"
+
+namespace GuessProfiler {
+
+bool enabled = false;
+
+thread_local Profile* current_profile = 0;
+
+const char* stage_name(Stage stage) {
+	static const char* names[NSTAGES] = {
+		"DailyAcc",
+		"DayLen",
+		"Phenol",
+		"Intercep",
+		"CanExch",
+		"Fpar",
+		"PhotoNS",
+		"Wdemand",
+		"Npp",
+		"Soilwat",
+		"Somdyn",
+		"Growth",
+		"Vegdyn",
+		"Climate",
+		"OutDaily",
+		"OutAnn",
+		"Total"
+	};
+	return names[stage];
+}
+
+Profile::Profile() {
+	for (int i = 0; i < NSTAGES; i++) {
+		nanoseconds[i] = 0;
+	}
+}
+
+void Profile::add(Stage stage, std::chrono::steady_clock::duration duration) {
+	nanoseconds[stage].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+	                             std::memory_order_relaxed);
+}
+
+void Profile::add(const Profile& other) {
+	for (int i = 0; i < NSTAGES; i++) {
+		nanoseconds[i].fetch_add(other.nanoseconds[i].load(std::memory_order_relaxed),
+		                         std::memory_order_relaxed);
+	}
+}
+
+double Profile::seconds(Stage stage) const {
+	return nanoseconds[stage].load(std::memory_order_relaxed) * 1e-9;
+}
+
+}
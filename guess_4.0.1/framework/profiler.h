@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file profiler.h
+/// \brief Timing of the stages of the daily simulation
+///
+/// Opt-in instrumentation of the model's hot path. The framework creates a
+/// Profile for each grid cell when profiling is enabled (see ProfileOutput),
+/// and the stages of the simulation are timed by putting a Timer on the
+/// stack around each call. When profiling is disabled, a Timer only costs
+/// a check of a thread local pointer.
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_PROFILER_H
+#define LPJ_GUESS_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+
+namespace GuessProfiler {
+
+/// The timed stages
+/** Sub-steps of canopy_exchange (FPAR to NPP) are also included in the
+ *  time for CANOPY_EXCHANGE. */
+enum Stage {
+	DAILYACCOUNTING,
+	DAYLENGTHINSOLEET,
+	LEAF_PHENOLOGY,
+	INTERCEPTION,
+	CANOPY_EXCHANGE,
+	FPAR,
+	PHOTOSYNTHESIS_NOSTRESS,
+	WDEMAND,
+	NPP,
+	SOILWATER,
+	SOM_DYNAMICS,
+	GROWTH,
+	VEGETATION_DYNAMICS,
+	GETCLIMATE,
+	OUTDAILY,
+	OUTANNUAL,
+	/// Everything done for the grid cell, including what isn't timed separately
+	TOTAL,
+	NSTAGES
+};
+
+/// Short name of a stage, used as column title in the output
+const char* stage_name(Stage stage);
+
+/// Time spent in each stage
+/** Several threads may add time to the same profile (when the stands
+ *  of a grid cell are simulated in parallel). */
+class Profile {
+public:
+	Profile();
+
+	/// Adds time spent in a stage
+	void add(Stage stage, std::chrono::steady_clock::duration duration);
+
+	/// Adds all the times of another profile to this one
+	void add(const Profile& other);
+
+	/// Time spent in a stage, in seconds
+	double seconds(Stage stage) const;
+
+private:
+	std::atomic<long long> nanoseconds[NSTAGES];
+
+	// Not copyable
+	Profile(const Profile&);
+	Profile& operator=(const Profile&);
+};
+
+/// Whether the framework should profile the grid cells
+/** Set by the output module writing the profiles, if any of its
+ *  output files are requested. */
+extern bool enabled;
+
+/// The profile of the grid cell being simulated by this thread, or NULL
+extern thread_local Profile* current_profile;
+
+/// Times a stage from construction to destruction
+/** The time is added to current_profile, if there is one when the timer is created. */
+class Timer {
+public:
+	Timer(Stage s)
+		: stage(s),
+		  profile(current_profile) {
+		if (profile) {
+			start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~Timer() {
+		if (profile) {
+			profile->add(stage, std::chrono::steady_clock::now() - start);
+		}
+	}
+
+private:
+	Stage stage;
+	Profile* profile;
+	std::chrono::steady_clock::time_point start;
+};
+
+}
+
+#endif // LPJ_GUESS_PROFILER_H
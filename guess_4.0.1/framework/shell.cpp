@@ -18,12 +18,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory>
+#include <mutex>
 
 namespace {
 
 /// The global Shell object
 std::auto_ptr<Shell> current_shell;
 
+/// Makes sure messages from different threads aren't mixed up
+std::mutex shell_mutex;
+
 }
 
 void dprintf(xtring format,...) {
@@ -37,6 +41,7 @@ void dprintf(xtring format,...) {
 	xtring output;
 	formatf(output,format,v);
 
+	std::lock_guard<std::mutex> lock(shell_mutex);
 	current_shell->log_message(output);
 }
 
@@ -52,6 +57,7 @@ void fail(xtring format,...) {
 	xtring output;
 	formatf(output,format,v);
 
+	std::lock_guard<std::mutex> lock(shell_mutex);
 	current_shell->fail(output);
 }
 
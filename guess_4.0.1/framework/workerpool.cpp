@@ -0,0 +1,110 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file workerpool.cpp
+/// \brief A fixed set of threads for running the iterations of a loop in parallel
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(int nthreads)
+	: current_task(0),
+	  ntasks(0),
+	  next_task(0),
+	  finished_tasks(0),
+	  generation(0),
+	  stopping(false) {
+
+	for (int i = 1; i < nthreads; i++) {
+		threads.push_back(std::thread(&WorkerPool::thread_main, this));
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	start_signal.notify_all();
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+int WorkerPool::size() const {
+	return (int)threads.size() + 1;
+}
+
+void WorkerPool::run(int n, const std::function<void(int)>& task) {
+
+	if (threads.empty() || n <= 1) {
+		// No point in waking up the threads
+		for (int i = 0; i < n; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_task = &task;
+		ntasks = n;
+		next_task = 0;
+		finished_tasks = 0;
+		++generation;
+	}
+	start_signal.notify_all();
+
+	// Help out, and then wait for the other threads to finish
+	work();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (finished_tasks < ntasks) {
+		done_signal.wait(lock);
+	}
+	current_task = 0;
+}
+
+void WorkerPool::thread_main() {
+	unsigned long last_generation = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping && generation == last_generation) {
+				start_signal.wait(lock);
+			}
+			if (stopping) {
+				return;
+			}
+			last_generation = generation;
+		}
+
+		work();
+	}
+}
+
+void WorkerPool::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (current_task && next_task < ntasks) {
+		int i = next_task++;
+		const std::function<void(int)>& task = *current_task;
+
+		lock.unlock();
+		task(i);
+		lock.lock();
+
+		if (++finished_tasks == ntasks) {
+			done_signal.notify_all();
+		}
+	}
+}
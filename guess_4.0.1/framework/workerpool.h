@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file workerpool.h
+/// \brief A fixed set of threads for running the iterations of a loop in parallel
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_WORKER_POOL_H
+#define LPJ_GUESS_WORKER_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Runs the iterations of a loop on several threads
+/** The threads are started once and then kept waiting between calls to run(),
+ *  so the pool is cheap enough to use for short loops which are run very
+ *  often, like the daily loop through the stands of a grid cell.
+ *
+ *  The thread calling run() takes part in the work, so a pool of size n
+ *  starts n-1 extra threads.
+ */
+class WorkerPool {
+public:
+	/// Creates the pool and starts its threads
+	/** \param nthreads Number of threads to use, including the calling thread */
+	WorkerPool(int nthreads);
+
+	/// Stops and joins the threads
+	~WorkerPool();
+
+	/// Calls task(i) for each i from 0 to n-1, spread out over the threads
+	/** Returns when all n calls have finished. The order in which the
+	 *  iterations are run is undefined, so they need to be independent.
+	 */
+	void run(int n, const std::function<void(int)>& task);
+
+	/// Number of threads in the pool, including the calling thread
+	int size() const;
+
+private:
+	/// The work done by each extra thread
+	void thread_main();
+
+	/// Runs iterations of the current loop until there are none left
+	void work();
+
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+
+	/// Signals the threads that a new loop has started (or that they should stop)
+	std::condition_variable start_signal;
+
+	/// Signals run() that all iterations are done
+	std::condition_variable done_signal;
+
+	/// The current loop
+	const std::function<void(int)>* current_task;
+
+	/// Number of iterations in the current loop
+	int ntasks;
+
+	/// Next iteration to hand out
+	int next_task;
+
+	/// Number of finished iterations
+	int finished_tasks;
+
+	/// Incremented for each call to run(), so the threads can tell a new loop has started
+	unsigned long generation;
+
+	bool stopping;
+
+	// Not copyable
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+};
+
+#endif // LPJ_GUESS_WORKER_POOL_H
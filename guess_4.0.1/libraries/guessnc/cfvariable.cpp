@@ -35,14 +35,39 @@ bool classic_numeric_type(nc_type type) {
 
 namespace CF {
 
+namespace {
+
+/// Reads data from a variable, converted to doubles
+int get_varm(int ncid, int varid, const size_t* start, const size_t* count,
+             const ptrdiff_t* imap, double* values) {
+	return nc_get_varm_double(ncid, varid, start, count, 0, imap, values);
+}
+
+/// Reads data from a variable, converted to floats
+int get_varm(int ncid, int varid, const size_t* start, const size_t* count,
+             const ptrdiff_t* imap, float* values) {
+	return nc_get_varm_float(ncid, varid, start, count, 0, imap, values);
+}
+
+}
+
 GridcellOrderedVariable::
 GridcellOrderedVariable(const char* filename, 
-                        const char* variable) {
+                        const char* variable)
+	: filename(filename),
+	  values(0),
+	  location_x(0),
+	  location_y(0),
+	  window_start(0),
+	  window_size(0),
+	  streaming_first_window(0),
+	  streaming_window(0),
+	  tile_cache_bytes(DEFAULT_TILE_CACHE_BYTES) {
 
 	// Constructor - opens the file and figures out how time works
 
 	// Open the file
-	ncid_file = open_ncdf(filename);
+	ncid_file = open_shared_ncdf(filename);
 
 	// Get a handle to the main variable
 	int status = nc_inq_varid(ncid_file, variable, &ncid_var);
@@ -91,6 +116,9 @@ GridcellOrderedVariable(const char* filename,
 	// Figure out if there is an extra dimension
 	find_extra_dimension();
 
+	// Figure out how many locations to read from the file at a time
+	find_tile_shape();
+
 	// Verify that the variable has no dimensions apart from those
 	// which we have already identified and know how to interpret
 	std::vector<int> dims;
@@ -174,13 +202,9 @@ void GridcellOrderedVariable::find_time_dimension() {
 	// We've now found the time dimension and coordinate variable
 	// read in time data and store the time unit specification
 
-	size_t nbr_timesteps;
-	status = nc_inq_dimlen(ncid_file, ncid_t_dimension, &nbr_timesteps);
-
-	// Read in the time variable
-	time.resize(nbr_timesteps);
-
-	status = nc_get_var_double(ncid_file, ncid_timecoord, &time.front());
+	// Read in the time variable, only read from the file once for all
+	// variables in the file
+	get_all_values(ncid_file, ncid_timecoord, time);
 
 	// Get information about calendar and time unit
 	std::string calendar_attribute;
@@ -428,69 +452,237 @@ void GridcellOrderedVariable::find_extra_dimension() {
 }
 
 
-bool GridcellOrderedVariable::load_data_for(size_t x, size_t y) {
-	data.resize(get_timesteps() * extra_dimension_size);
+void GridcellOrderedVariable::find_tile_shape() {
+
+	int status;
+
+	if (reduced) {
+		status = nc_inq_dimlen(ncid_file, ncid_landid_dimension, &x_size);
+		handle_error(status, "Failed to get land dimension length");
+		y_size = 1;
+	}
+	else {
+		status = nc_inq_dimlen(ncid_file, ncid_x_dimension, &x_size);
+		handle_error(status, "Failed to get x-dimension length");
+
+		status = nc_inq_dimlen(ncid_file, ncid_y_dimension, &y_size);
+		handle_error(status, "Failed to get y-dimension length");
+	}
+
+	// Contiguous (and classic format) files are read one location at a time,
+	// chunked files a chunk's worth of locations at a time, since a whole
+	// chunk needs to be read and decompressed to get at any of it.
+	tile_x = 1;
+	tile_y = 1;
+
+#ifdef NC_CHUNKED
+	std::vector<int> dims;
+	get_dimensions(ncid_file, ncid_var, dims);
+
+	int storage;
+	std::vector<size_t> chunk_sizes(dims.size());
+	status = nc_inq_var_chunking(ncid_file, ncid_var, &storage, &chunk_sizes.front());
+	handle_error(status, "Failed to get chunking of variable " + variable_name);
+
+	if (storage == NC_CHUNKED) {
+		if (reduced) {
+			tile_x = chunk_sizes[landid_dimension_index];
+		}
+		else {
+			tile_x = chunk_sizes[x_dimension_index];
+			tile_y = chunk_sizes[y_dimension_index];
+		}
+	}
+#endif
+
+	// Keep the tiles small enough for a few of them to fit in the cache,
+	// a chunk can cover the whole grid if the file is chunked by time.
+	// Only the first window is cached (see load_location).
+	const size_t timesteps = first_window_size();
+	const size_t location_bytes = 
+		std::max(timesteps * extra_dimension_size, size_t(1)) * sizeof(value_type);
+
+	const size_t max_tile_bytes = tile_cache_bytes / 4;
 
+	while (tile_x * tile_y * location_bytes > max_tile_bytes && tile_x * tile_y > 1) {
+		if (tile_x >= tile_y) {
+			tile_x = (tile_x + 1) / 2;
+		}
+		else {
+			tile_y = (tile_y + 1) / 2;
+		}
+	}
+
+	max_tiles = std::max(tile_cache_bytes / (tile_x * tile_y * location_bytes), size_t(1));
+}
+
+
+bool GridcellOrderedVariable::load_data_for(size_t x, size_t y) {
 	if (!location_exists(x, y)) {
+		data.resize(first_window_size() * extra_dimension_size);
+		values = &data.front();
+		window_start = 0;
+		window_size = first_window_size();
 		return false;
 	}
 
-	size_t start[4];
-	start[x_dimension_index] = x;
-	start[y_dimension_index] = y;
-	start[t_dimension_index] = 0;
+	return load_location(x, y, 0, first_window_size());
+}
 
-	size_t count[4];
-	count[x_dimension_index] = 1;
-	count[y_dimension_index] = 1;
-	count[t_dimension_index] = get_timesteps();
 
-	ptrdiff_t imap[4];
-	imap[x_dimension_index] = 1;
-	imap[y_dimension_index] = 1;
-	imap[t_dimension_index] = extra_dimension_size;
+bool GridcellOrderedVariable::load_data_for(size_t landid) {
+	if (!location_exists(landid)) {
+		data.resize(first_window_size() * extra_dimension_size);
+		values = &data.front();
+		window_start = 0;
+		window_size = first_window_size();
+		return false;
+	}
 
-	if (ncid_extra_dimension != -1) {
-		start[extra_dimension_index] = 0;
-		count[extra_dimension_index] = extra_dimension_size;
-		imap[extra_dimension_index] = 1;
+	return load_location(landid, 0, 0, first_window_size());
+}
+
+
+bool GridcellOrderedVariable::load_location(size_t x, size_t y, size_t t, size_t nt) {
+
+	if (t == 0) {
+		// Copy the location's data out of the tile it belongs to
+		const Tile& tile = get_tile(x, y, t, nt);
+
+		const size_t location_size = nt * extra_dimension_size;
+		const size_t location = (y - tile.y) * tile.nx + (x - tile.x);
+
+		std::vector<value_type>::const_iterator first = tile.values.begin() + location * location_size;
+		data.assign(first, first + location_size);
+	}
+	else {
+		// Later windows are only wanted for this location, while it's being
+		// simulated, so they're read on their own instead of into the cache
+		check_library_locked(ncid_file);
+		read_block(x, y, 1, 1, t, nt, data);
 	}
+	values = &data.front();
 
-	int status = nc_get_varm_double(ncid_file, ncid_var, start, count, 0, imap, &data.front());
-	handle_error(status, 
-	             std::string("Failed to read data from variable ") + variable_name);
+	location_x = x;
+	location_y = y;
+	window_start = t;
+	window_size = nt;
 
 	// Check if the data for this location contains a missing value
 	double missing_value;
 	if (get_attribute(ncid_file, ncid_var, "missing_value", missing_value)) {
-		if (std::find(data.begin(), data.end(), missing_value) != data.end()) {
+		// Compared as stored, the raw values are converted to value_type when read
+		if (std::find(data.begin(), data.end(), (value_type)missing_value) != data.end()) {
+			return false;
+		}
+
+		// When streaming, the rest of the record is checked when the
+		// location is opened, rather than failing in the middle of a run
+		if (t == 0 && nt < time.size() &&
+		    has_missing_values(x, y, nt, (value_type)missing_value)) {
 			return false;
 		}
 	}
 
 	unpack_data();
-	
+
 	return true;
 }
 
 
-bool GridcellOrderedVariable::load_data_for(size_t landid) {
-	data.resize(get_timesteps());
+bool GridcellOrderedVariable::has_missing_values(size_t x, size_t y, size_t t,
+                                                 value_type missing_value) {
 
-	if (!location_exists(landid)) {
-		return false;
+	check_library_locked(ncid_file);
+
+	const size_t window = streaming_window ? streaming_window : time.size();
+
+	std::vector<value_type> buffer;
+	for (; t < time.size(); t += window) {
+		read_block(x, y, 1, 1, t, std::min(window, time.size() - t), buffer);
+
+		if (std::find(buffer.begin(), buffer.end(), missing_value) != buffer.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+const GridcellOrderedVariable::Tile& GridcellOrderedVariable::get_tile(size_t x, size_t y,
+                                                                      size_t t, size_t nt) {
+
+	// Most recently used tile first, so neighbouring locations are found quickly
+	for (std::list<Tile>::iterator itr = tiles.begin(); itr != tiles.end(); ++itr) {
+		if (x >= itr->x && x < itr->x + itr->nx &&
+		    y >= itr->y && y < itr->y + itr->ny &&
+		    t == itr->t && nt == itr->nt) {
+			tiles.splice(tiles.begin(), tiles, itr);
+			return tiles.front();
+		}
+	}
+
+	// Not cached, so the file is read (which needs the lock if it's shared)
+	check_library_locked(ncid_file);
+
+	// Drop the least recently used tile before reading a new one
+	if (tiles.size() >= max_tiles) {
+		tiles.pop_back();
 	}
 
-	size_t start[3];
-	start[landid_dimension_index] = landid;
-	start[t_dimension_index] = 0;
+	tiles.push_front(Tile());
+	Tile& tile = tiles.front();
 
-	size_t count[3];
-	count[landid_dimension_index] = 1;
-	count[t_dimension_index] = get_timesteps();
+	tile.x = x - x % tile_x;
+	tile.y = y - y % tile_y;
+	tile.nx = std::min(tile_x, x_size - tile.x);
+	tile.ny = std::min(tile_y, y_size - tile.y);
+	tile.t = t;
+	tile.nt = nt;
 
-	ptrdiff_t imap[3];
-	imap[landid_dimension_index] = 1;
+	try {
+		read_block(tile.x, tile.y, tile.nx, tile.ny, t, nt, tile.values);
+	}
+	catch (...) {
+		tiles.pop_front();
+		throw;
+	}
+
+	return tile;
+}
+
+
+void GridcellOrderedVariable::read_block(size_t x, size_t y, size_t nx, size_t ny,
+                                         size_t t, size_t nt,
+                                         std::vector<value_type>& block) const {
+
+	// The block is stored location by location, each location with its
+	// timesteps (and extra dimension values) in a row, as in data
+	const size_t location_size = nt * extra_dimension_size;
+	block.resize(nx * ny * location_size);
+
+	size_t start[4];
+	size_t count[4];
+	ptrdiff_t imap[4];
+
+	if (reduced) {
+		start[landid_dimension_index] = x;
+		count[landid_dimension_index] = nx;
+		imap[landid_dimension_index] = location_size;
+	}
+	else {
+		start[x_dimension_index] = x;
+		start[y_dimension_index] = y;
+
+		count[x_dimension_index] = nx;
+		count[y_dimension_index] = ny;
+
+		imap[x_dimension_index] = location_size;
+		imap[y_dimension_index] = nx * location_size;
+	}
+
+	start[t_dimension_index] = t;
+	count[t_dimension_index] = nt;
 	imap[t_dimension_index] = extra_dimension_size;
 
 	if (ncid_extra_dimension != -1) {
@@ -499,20 +691,36 @@ bool GridcellOrderedVariable::load_data_for(size_t landid) {
 		imap[extra_dimension_index] = 1;
 	}
 
-	int status = nc_get_varm_double(ncid_file, ncid_var, start, count, 0, imap, &data.front());
-	handle_error(status,
+	int status = get_varm(ncid_file, ncid_var, start, count, imap, &block.front());
+	handle_error(status, 
 	             std::string("Failed to read data from variable ") + variable_name);
+}
 
-	// Check if the data for this location contains a missing value
-	double missing_value;
-	if (get_attribute(ncid_file, ncid_var, "missing_value", missing_value)) {
-		if (std::find(data.begin(), data.end(), missing_value) != data.end()) {
-			return false;
+bool load_data_for(const std::vector<GridcellOrderedVariable*>& variables,
+                   size_t x, size_t y, size_t landid) {
+
+	std::vector<bool> done(variables.size(), false);
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		if (done[i]) {
+			continue;
 		}
-	}
 
-	unpack_data();
+		// This variable and the rest of the variables in its file
+		const std::string filename = variables[i]->get_filename();
+		for (size_t j = i; j < variables.size(); ++j) {
+			if (done[j] || variables[j]->get_filename() != filename) {
+				continue;
+			}
 
+			const bool ok = variables[j]->is_reduced() ?
+				variables[j]->load_data_for(landid) : variables[j]->load_data_for(x, y);
+			if (!ok) {
+				return false;
+			}
+			done[j] = true;
+		}
+	}
 	return true;
 }
 
@@ -521,7 +729,7 @@ bool GridcellOrderedVariable::is_reduced() const {
 }
 
 GridcellOrderedVariable::~GridcellOrderedVariable() {
-	close_ncdf(ncid_file);
+	close_shared_ncdf(ncid_file);
 }
 
 
@@ -607,16 +815,97 @@ int GridcellOrderedVariable::get_timesteps() const {
 }
 
 double GridcellOrderedVariable::get_value(int timestep) const {
-	return data[timestep * extra_dimension_size];
+	return values[(timestep - window_start) * extra_dimension_size];
 }
 
-void GridcellOrderedVariable::get_values(int timestep, std::vector<double>& values) const {
-	if (values.size() < extra_dimension_size) {
-		values.resize(extra_dimension_size);
+void GridcellOrderedVariable::get_values(int timestep, std::vector<double>& result) const {
+	if (result.size() < extra_dimension_size) {
+		result.resize(extra_dimension_size);
 	}
 
 	for (size_t i = 0; i < extra_dimension_size; ++i) {
-		values[i] = data[timestep * extra_dimension_size + i];
+		result[i] = values[(timestep - window_start) * extra_dimension_size + i];
+	}
+}
+
+size_t GridcellOrderedVariable::get_location_size() const {
+	return get_timesteps() * extra_dimension_size;
+}
+
+const GridcellOrderedVariable::value_type* GridcellOrderedVariable::get_data() const {
+	return values;
+}
+
+void GridcellOrderedVariable::set_data(const double* location_data) {
+#ifdef FLOAT_FORCING
+	data.assign(location_data, location_data + get_location_size());
+	values = &data.front();
+#else
+	values = location_data;
+#endif
+	window_start = 0;
+	window_size = time.size();
+}
+
+void GridcellOrderedVariable::set_streaming(size_t first_window, size_t window) {
+	streaming_first_window = first_window;
+	streaming_window = window;
+
+	// The tiles hold a window's worth of timesteps, so they can cover more locations
+	tiles.clear();
+	find_tile_shape();
+}
+
+void GridcellOrderedVariable::set_tile_cache_size(size_t bytes) {
+	tile_cache_bytes = bytes;
+
+	tiles.clear();
+	find_tile_shape();
+}
+
+size_t GridcellOrderedVariable::get_tile_cache_size() const {
+	return tile_cache_bytes;
+}
+
+size_t GridcellOrderedVariable::get_tile_cache_usage() const {
+	size_t bytes = 0;
+	for (std::list<Tile>::const_iterator itr = tiles.begin(); itr != tiles.end(); ++itr) {
+		bytes += itr->values.size() * sizeof(value_type);
+	}
+	return bytes;
+}
+
+size_t GridcellOrderedVariable::get_cached_tiles() const {
+	return tiles.size();
+}
+
+size_t GridcellOrderedVariable::first_window_size() const {
+	if (streaming_first_window == 0) {
+		return time.size();
+	}
+	return std::min(streaming_first_window, time.size());
+}
+
+bool GridcellOrderedVariable::window_contains(int first_timestep, int timesteps) const {
+	const int last = std::min(first_timestep + timesteps, get_timesteps());
+
+	return first_timestep >= last ||
+		(first_timestep >= (int)window_start && last <= (int)(window_start + window_size));
+}
+
+void GridcellOrderedVariable::load_window(int first_timestep) {
+	if (first_timestep < 0 || first_timestep >= get_timesteps()) {
+		throw CFError(variable_name, "Attempted to load timesteps outside of the record");
+	}
+
+	const size_t window = streaming_window ? streaming_window : time.size();
+	const size_t nt = std::min(window, time.size() - first_timestep);
+
+	if (!load_location(location_x, location_y, first_timestep, nt)) {
+		std::ostringstream os;
+		os << "Missing values in timesteps " << first_timestep << " to " << first_timestep + nt - 1
+		   << " of location " << location_x << ", " << location_y;
+		throw CFError(variable_name, os.str());
 	}
 }
 
@@ -671,6 +960,10 @@ std::string GridcellOrderedVariable::get_variable_name() const {
 	return variable_name;
 }
 
+std::string GridcellOrderedVariable::get_filename() const {
+	return filename;
+}
+
 std::string GridcellOrderedVariable::get_standard_name() const {
 	std::string attribute;
 	if (get_attribute(ncid_file, ncid_var, "standard_name", attribute)) {
@@ -733,6 +1026,11 @@ bool GridcellOrderedVariable::same_spatial_coordinates(int ncid_my_coordvar,
 	const GridcellOrderedVariable& other, 
 	int ncid_other_coordvar) const {
 
+	// Variables in the same file with the same coordinate variable
+	if (ncid_file == other.ncid_file && ncid_my_coordvar == ncid_other_coordvar) {
+		return true;
+	}
+
 	// Compare dimensions
 	std::vector<int> mydims;
 	get_dimensions(ncid_file, ncid_my_coordvar, mydims);
@@ -744,8 +1042,6 @@ bool GridcellOrderedVariable::same_spatial_coordinates(int ncid_my_coordvar,
 		return false;
 	}
 
-	std::vector<size_t> dim_sizes(mydims.size());
-
 	for (size_t i = 0; i < mydims.size(); ++i) {
 		size_t mydimlen, otherdimlen;
 
@@ -760,24 +1056,13 @@ bool GridcellOrderedVariable::same_spatial_coordinates(int ncid_my_coordvar,
 		if (mydimlen != otherdimlen) {
 			return false;
 		}
-
-		dim_sizes[i] = mydimlen;
 	}
 
 	// Compare data for the coordinate variables
-	size_t total_size = std::accumulate(dim_sizes.begin(), dim_sizes.end(), 1, std::multiplies<size_t>());
-
-	std::vector<double> mydata(total_size), otherdata(total_size);
-
-	std::vector<size_t> start(mydims.size(), 0);
+	std::vector<double> mydata, otherdata;
 
-	const std::string error_message("Failed to get data for coordinate variable associated with variable ");
-
-	int status = nc_get_vara_double(ncid_file, ncid_my_coordvar, &start[0], &dim_sizes[0], &mydata[0]);
-	handle_error(status, error_message + variable_name);
-
-	status = nc_get_vara_double(other.ncid_file, ncid_other_coordvar, &start[0], &dim_sizes[0], &otherdata[0]);
-	handle_error(status, error_message + variable_name);
+	get_all_values(ncid_file, ncid_my_coordvar, mydata);
+	get_all_values(other.ncid_file, ncid_other_coordvar, otherdata);
 
 	return mydata == otherdata;
 }
@@ -791,6 +1076,15 @@ bool GridcellOrderedVariable::same_spatial_domain(const GridcellOrderedVariable&
 		same_spatial_coordinates(ncid_lon, other, other.ncid_lon);
 }
 
+void GridcellOrderedVariable::swap_data(GridcellOrderedVariable& other) {
+	data.swap(other.data);
+	std::swap(values, other.values);
+	std::swap(location_x, other.location_x);
+	std::swap(location_y, other.location_y);
+	std::swap(window_start, other.window_start);
+	std::swap(window_size, other.window_size);
+}
+
 #ifdef NC_STRING
 void GridcellOrderedVariable::
 get_extra_dimension(std::vector<std::string>& coordinate_values) const {
@@ -799,24 +1093,30 @@ get_extra_dimension(std::vector<std::string>& coordinate_values) const {
 
 void GridcellOrderedVariable::unpack_data() {
 
-	// First, multiply all data by scale_factor (if present)
+	// First multiply by scale_factor, then add add_offset (if present).
+	// Done in double precision, so data stored as float is only rounded once.
 
 	double factor;
-	if (get_attribute(ncid_file, ncid_var, "scale_factor", factor)) {
+	const bool has_factor = get_attribute(ncid_file, ncid_var, "scale_factor", factor);
 
-		for (size_t i = 0; i < data.size(); ++i) {
-			data[i] *= factor;
-		}
+	double offset;
+	const bool has_offset = get_attribute(ncid_file, ncid_var, "add_offset", offset);
+
+	if (!has_factor && !has_offset) {
+		return;
 	}
 
-	// Then add add_offset (if present)
+	for (size_t i = 0; i < data.size(); ++i) {
+		double value = data[i];
 
-	double offset;
-	if (get_attribute(ncid_file, ncid_var, "add_offset", offset)) {
+		if (has_factor) {
+			value *= factor;
+		}
+		if (has_offset) {
+			value += offset;
+		}
 
-		for (size_t i = 0; i < data.size(); ++i) {
-			data[i] += offset;
-		}		
+		data[i] = (value_type)value;
 	}
 }
 
@@ -829,7 +1129,7 @@ GridcellOrderedVariableNoTime(const char* filename,
     // Constructor - opens the file and figures out how time works
     
     // Open the file
-    ncid_file = open_ncdf(filename);
+    ncid_file = open_shared_ncdf(filename);
     
     // Get a handle to the main variable
     int status = nc_inq_varid(ncid_file, variable, &ncid_var);
@@ -1097,23 +1397,11 @@ bool GridcellOrderedVariableNoTime::load_data_for(size_t x, size_t y) {
     start[x_dimension_index] = x;
     start[y_dimension_index] = y;
     
-    size_t count[3];
-    count[x_dimension_index] = 1;
-    count[y_dimension_index] = 1;
-    
-    ptrdiff_t imap[3];
-    imap[x_dimension_index] = 1;
-    imap[y_dimension_index] = 1;
-    
     if (ncid_extra_dimension != -1) {
         start[extra_dimension_index] = 0;
-        count[extra_dimension_index] = extra_dimension_size;
-        imap[extra_dimension_index] = 1;
     }
     
-    int status = nc_get_varm_double(ncid_file, ncid_var, start, count, 0, imap, &data.front());
-    handle_error(status,
-                 std::string("Failed to read data from variable ") + variable_name);
+    read_location(start);
     
     // Check if the data for this location contains a missing value
     
@@ -1148,38 +1436,20 @@ bool GridcellOrderedVariableNoTime::load_data_for(size_t landid) {
     size_t start[2];
     start[landid_dimension_index] = landid;
     
-    size_t count[2];
-    count[landid_dimension_index] = 1;
-    
-    ptrdiff_t imap[2];
-    imap[landid_dimension_index] = 1;
-    
     if (ncid_extra_dimension != -1) {
         // 3d
         start[extra_dimension_index] = 0;
-        count[extra_dimension_index] = extra_dimension_size;
-        imap[extra_dimension_index] = 1;
         
-        int status = nc_get_varm_double(ncid_file, ncid_var, start, count, 0, imap, &data.front());
-        handle_error(status,
-                     std::string("Failed to read data from variable ") + variable_name);
+        read_location(start);
 
         return true;
         
         
     } else {
         // 2d
-        double _lon;
-        double _lat;
-        get_coords_for(landid, _lon, _lat);
-        
         data.resize(1, 0.0);
-        const size_t index[] = { landid };
         
-        int status = nc_get_var1_double(ncid_file, ncid_var, index, &data.front());
-        
-        handle_error(status,
-                     std::string("Failed to read data from variable ") + variable_name);
+        read_location(start);
         
         unpack_data();
         return true;
@@ -1189,12 +1459,71 @@ bool GridcellOrderedVariableNoTime::load_data_for(size_t landid) {
     return true;
 }
 
+void GridcellOrderedVariableNoTime::load_all_data() {
+    
+    std::vector<int> dims;
+    get_dimensions(ncid_file, ncid_var, dims);
+    
+    // Row major order, the last dimension varies fastest
+    all_data_strides.resize(dims.size());
+    size_t total_size = 1;
+    for (size_t d = dims.size(); d-- > 0; ) {
+        size_t len;
+        int status = nc_inq_dimlen(ncid_file, dims[d], &len);
+        handle_error(status, "Failed to get dimension length for " + variable_name);
+        
+        all_data_strides[d] = total_size;
+        total_size *= len;
+    }
+    
+    all_data.resize(total_size);
+    
+    if (total_size > 0) {
+        int status = nc_get_var_double(ncid_file, ncid_var, &all_data.front());
+        handle_error(status,
+                     std::string("Failed to read data from variable ") + variable_name);
+    }
+}
+
+void GridcellOrderedVariableNoTime::read_location(const size_t* start) {
+    
+    const size_t ndims = (reduced ? 1 : 2) + (ncid_extra_dimension != -1 ? 1 : 0);
+    
+    if (!all_data.empty()) {
+        size_t offset = 0;
+        for (size_t d = 0; d < ndims; ++d) {
+            offset += start[d] * all_data_strides[d];
+        }
+        
+        const size_t step = ncid_extra_dimension != -1 ? all_data_strides[extra_dimension_index] : 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = all_data[offset + i * step];
+        }
+        return;
+    }
+    
+    size_t count[3];
+    ptrdiff_t imap[3];
+    for (size_t d = 0; d < ndims; ++d) {
+        count[d] = 1;
+        imap[d] = 1;
+    }
+    
+    if (ncid_extra_dimension != -1) {
+        count[extra_dimension_index] = data.size();
+    }
+    
+    int status = nc_get_varm_double(ncid_file, ncid_var, start, count, 0, imap, &data.front());
+    handle_error(status,
+                 std::string("Failed to read data from variable ") + variable_name);
+}
+
 bool GridcellOrderedVariableNoTime::is_reduced() const {
     return reduced;
 }
 
 GridcellOrderedVariableNoTime::~GridcellOrderedVariableNoTime() {
-    close_ncdf(ncid_file);
+    close_shared_ncdf(ncid_file);
 }
 
 
@@ -1425,6 +1754,11 @@ bool GridcellOrderedVariableNoTime::same_spatial_coordinates(int ncid_my_coordva
                                                        const GridcellOrderedVariableNoTime& other,
                                                        int ncid_other_coordvar) const {
     
+    // Variables in the same file with the same coordinate variable
+    if (ncid_file == other.ncid_file && ncid_my_coordvar == ncid_other_coordvar) {
+        return true;
+    }
+    
     // Compare dimensions
     std::vector<int> mydims;
     get_dimensions(ncid_file, ncid_my_coordvar, mydims);
@@ -1436,8 +1770,6 @@ bool GridcellOrderedVariableNoTime::same_spatial_coordinates(int ncid_my_coordva
         return false;
     }
     
-    std::vector<size_t> dim_sizes(mydims.size());
-    
     for (size_t i = 0; i < mydims.size(); ++i) {
         size_t mydimlen, otherdimlen;
         
@@ -1452,24 +1784,13 @@ bool GridcellOrderedVariableNoTime::same_spatial_coordinates(int ncid_my_coordva
         if (mydimlen != otherdimlen) {
             return false;
         }
-        
-        dim_sizes[i] = mydimlen;
     }
     
     // Compare data for the coordinate variables
-    size_t total_size = std::accumulate(dim_sizes.begin(), dim_sizes.end(), 1, std::multiplies<size_t>());
-    
-    std::vector<double> mydata(total_size), otherdata(total_size);
-    
-    std::vector<size_t> start(mydims.size(), 0);
-    
-    const std::string error_message("Failed to get data for coordinate variable associated with variable ");
-    
-    int status = nc_get_vara_double(ncid_file, ncid_my_coordvar, &start[0], &dim_sizes[0], &mydata[0]);
-    handle_error(status, error_message + variable_name);
+    std::vector<double> mydata, otherdata;
     
-    status = nc_get_vara_double(other.ncid_file, ncid_other_coordvar, &start[0], &dim_sizes[0], &otherdata[0]);
-    handle_error(status, error_message + variable_name);
+    get_all_values(ncid_file, ncid_my_coordvar, mydata);
+    get_all_values(other.ncid_file, ncid_other_coordvar, otherdata);
     
     return mydata == otherdata;
 }
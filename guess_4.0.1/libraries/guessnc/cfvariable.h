@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <string>
+#include <list>
 #include "cftime.h"
 
 namespace GuessNC {
@@ -16,6 +17,17 @@ namespace CF {
 /** Expected to be used for dealing with one gridcell at a time, so the NetCDF
  *  file should also be stored in that order to get acceptable performance.
  *
+ *  For chunked (NetCDF4) files, the data is read a tile of neighbouring
+ *  locations at a time, matching the spatial shape of the file's chunks.
+ *  The most recently used tiles are kept in memory (see set_tile_cache_size),
+ *  so files chunked by time instead of by location can also be read
+ *  reasonably fast, as long as neighbouring gridcells are simulated after
+ *  each other.
+ *
+ *  Long records can be streamed (see set_streaming), so only a window of
+ *  timesteps for the current location is kept in memory at a time. Then only
+ *  the first window of each location is read in tiles and cached.
+ *
  *  Limitations on top of CF:
  *
  *   * Main variable and time coordinate must be numeric NetCDF classic data types.
@@ -27,6 +39,17 @@ namespace CF {
 class GridcellOrderedVariable {
 public:
 
+#ifdef FLOAT_FORCING
+	/// Type used to store the data, see the FLOAT_FORCING option in CMakeLists.txt
+	/** Values are widened to double when they're retrieved with get_value
+	 *  and get_values.
+	 */
+	typedef float value_type;
+#else
+	/// Type used to store the data
+	typedef double value_type;
+#endif
+
 	/// Constructor
 	/** \param filename The NetCDF file to open
 	 *  \param variable The name of the variable to read from
@@ -84,6 +107,9 @@ public:
 	/** Use this function to retrieve values in a 3 dimensional data set,
 	 *  where each (lat,lon,time) triple corresponds to a single scalar value.
 	 *
+	 *  When streaming, the timestep must be in the loaded window
+	 *  (see window_contains).
+	 *
 	 *  \see get_values for data sets with an extra dimension
 	 *
 	 *  If this function is used with a data set with an extra dimension,
@@ -117,6 +143,9 @@ public:
 	/// Returns the main variable's name
 	std::string get_variable_name() const;
 
+	/// Returns the name of the file the variable was opened from
+	std::string get_filename() const;
+
 	/// Returns the main variable's standard name
 	/** Can be used to identify the variable */
 	std::string get_standard_name() const;
@@ -146,6 +175,92 @@ public:
 	/// Checks if another GridcellOrderedVariable has the same spatial domain as this one
 	bool same_spatial_domain(const GridcellOrderedVariable& other) const;
 
+	/// Exchanges the data loaded for the current location with another variable
+	/** The other variable should be the same variable opened a second time,
+	 *  so one of them can load the data for the next location (for instance
+	 *  on a background thread) while the data of the other is being used.
+	 *  No NetCDF calls are made.
+	 */
+	void swap_data(GridcellOrderedVariable& other);
+
+	/// Number of values for each location (timesteps times size of the extra dimension)
+	size_t get_location_size() const;
+
+	/// The data for the currently loaded location, get_location_size() values
+	/** Laid out as all values in the extra dimension for the first timestep,
+	 *  then the next timestep and so on. Unpacked, but may contain
+	 *  missing values if load_data_for returned false.
+	 *
+	 *  When streaming, only the loaded window is available, starting
+	 *  with its first timestep.
+	 */
+	const value_type* get_data() const;
+
+	/// Uses data from elsewhere instead of loading it from the file
+	/** The data must be laid out as returned by get_data() and stay valid
+	 *  until the next call to load_data_for or set_data. It isn't copied,
+	 *  so a memory mapped forcing cache (see ForcingCache) can be used
+	 *  without reading the NetCDF file.
+	 *
+	 *  When the data is stored as float, it is copied (and narrowed).
+	 */
+	void set_data(const double* location_data);
+
+	/// Reads a window of timesteps at a time instead of the whole record
+	/** load_data_for then reads the first first_window timesteps, and the
+	 *  following timesteps are read with load_window when they're needed,
+	 *  which bounds the memory used for each location regardless of the
+	 *  length of the record.
+	 *
+	 *  If the variable has missing values, load_data_for checks the whole
+	 *  record of the location for them (reading it window by window, without
+	 *  keeping it), so a location with missing values is found before it's
+	 *  simulated. The later windows are then read again by load_window.
+	 *
+	 *  Only the first window goes through the tile cache, the later windows
+	 *  are read one location at a time.
+	 *
+	 *  \param first_window Timesteps to read with load_data_for, 0 for all
+	 *  \param window       Timesteps to read with load_window
+	 */
+	void set_streaming(size_t first_window, size_t window);
+
+	/// Checks if the given timesteps of the current location are in memory
+	/** Timesteps beyond the end of the record are ignored. Always true
+	 *  unless streaming.
+	 */
+	bool window_contains(int first_timestep, int timesteps) const;
+
+	/// Reads a window of timesteps starting at first_timestep for the current location
+	/** Replaces the previously loaded window. Throws if the window contains
+	 *  missing values (which load_data_for has already checked for, unless
+	 *  the file has changed since).
+	 */
+	void load_window(int first_timestep);
+
+	/// Memory used for the tile cache by default
+	static const size_t DEFAULT_TILE_CACHE_BYTES = 32 * 1024 * 1024;
+
+	/// Sets how much memory the tile cache may use
+	/** The tiles are kept to at most a quarter of the cache, so at least a
+	 *  few of them fit, but a single tile of one location is always read
+	 *  even if it is bigger than the cache. With 0 the locations are read
+	 *  one at a time, and only the current one is kept.
+	 *
+	 *  Empties the cache. Input modules opening several variables can
+	 *  share their memory between them.
+	 */
+	void set_tile_cache_size(size_t bytes);
+
+	/// Memory the tile cache may use, see set_tile_cache_size
+	size_t get_tile_cache_size() const;
+
+	/// Memory currently used by the cached tiles
+	size_t get_tile_cache_usage() const;
+
+	/// Number of tiles currently cached
+	size_t get_cached_tiles() const;
+
 private:
 
 	/** Called by constructor to figure out all we need to know about
@@ -169,6 +284,54 @@ private:
 	 */
 	void find_extra_dimension();
 
+	/** Called by constructor to decide the size of the tiles read from
+	 *  the file, and how many of them to keep in memory.
+	 *
+	 *  Assumes all dimensions already found.
+	 */
+	void find_tile_shape();
+
+	/// A block of neighbouring locations, read from the file in one go
+	/** For a reduced grid, x is the land id and y is always 0. */
+	struct Tile {
+		/// First location in the block
+		size_t x, y;
+
+		/// Number of locations in each direction
+		size_t nx, ny;
+
+		/// First timestep and number of timesteps in the block
+		size_t t, nt;
+
+		/// Data for the timesteps for each location, one location after the other
+		std::vector<value_type> values;
+	};
+
+	/// Gets the tile with a given location and timesteps, from the cache or the file
+	const Tile& get_tile(size_t x, size_t y, size_t t, size_t nt);
+
+	/// Reads a block of locations and timesteps from the file, without caching it
+	/** For a reduced grid, x is the land id, y is 0 and ny is 1.
+	 *  The block is stored like the values of a Tile.
+	 */
+	void read_block(size_t x, size_t y, size_t nx, size_t ny, size_t t, size_t nt,
+	                std::vector<value_type>& block) const;
+
+	/// Gets the data for a window of an existing location and unpacks it
+	/** The first window is copied from its tile, later ones are read directly.
+	 *  For a reduced grid, x is the land id and y is 0.
+	 *  \returns whether the location has only valid (non-missing) values,
+	 *           in the whole record when reading the first window.
+	 */
+	bool load_location(size_t x, size_t y, size_t t, size_t nt);
+
+	/// Checks the timesteps from t onwards of a location for missing values
+	/** Reads a streaming window at a time. */
+	bool has_missing_values(size_t x, size_t y, size_t t, value_type missing_value);
+
+	/// Number of timesteps read by load_data_for
+	size_t first_window_size() const;
+
 	/** Unpacks the raw data according to scale_factor and add_offset
 	 *  arguments, if present.
 	 */
@@ -188,8 +351,23 @@ private:
 	/// Name of main variable (for error messages)
 	std::string variable_name;
 
-	/// Data for all timesteps for current location
-	std::vector<double> data;
+	/// Name of the NetCDF file
+	std::string filename;
+
+	/// Data for all timesteps for current location, when read from the file
+	std::vector<value_type> data;
+
+	/// The current location's data, in data or given to set_data
+	const value_type* values;
+
+	/// The current location, for reading more windows of its data
+	size_t location_x, location_y;
+
+	/// First timestep and number of timesteps in values
+	size_t window_start, window_size;
+
+	/// Timesteps to read with load_data_for and load_window, 0 if not streaming
+	size_t streaming_first_window, streaming_window;
 
 	/// Time offsets for all timesteps
 	/** The times are relative to a starting time given in time_spec.
@@ -239,8 +417,41 @@ private:
 	/// The size of the 'extra' dimension (for instance height)
 	/** Set to 1 if there is no extra dimension */
 	size_t extra_dimension_size;
+
+	// Number of locations along the x and y dimensions
+	// (land ids and 1 for a reduced grid)
+
+	size_t x_size;
+	size_t y_size;
+
+	/// Memory the tile cache may use
+	size_t tile_cache_bytes;
+
+	// Size of the tiles in number of locations
+
+	size_t tile_x;
+	size_t tile_y;
+
+	/// Maximum number of tiles in the cache
+	size_t max_tiles;
+
+	/// The cached tiles, most recently used first
+	std::list<Tile> tiles;
 };
 
+
+/// Loads the data for a location into several variables, one file at a time
+/** NetCDF can't read several variables in one call, so this is done in one
+ *  pass over the files instead: variables in the same file are read after
+ *  each other, before moving on to the next file, whatever order they're
+ *  given in. Variables with a reduced grid are read at landid, others at
+ *  (x, y).
+ *
+ *  \returns false as soon as a variable has no valid data for the location
+ *           (see GridcellOrderedVariable::load_data_for)
+ */
+bool load_data_for(const std::vector<GridcellOrderedVariable*>& variables,
+                   size_t x, size_t y, size_t landid);
     
 // cw SubPixel
 /// Class for reading data from a NetCDF file (without time dimension)
@@ -297,6 +508,13 @@ public:
      */
     bool load_data_for(size_t landid);
     
+    /// Reads the variable for all locations into memory in one go
+    /** After this, load_data_for takes the data from memory instead of
+     *  reading it from the file location by location. Meant for small files
+     *  which are read for every grid cell.
+     */
+    void load_all_data();
+    
     /// Are locations identified with one or two indices?
     /** In a variable with a reduced horizontal grid, the locations are
      *  identified with a simple land id. Otherwise an (x,y)-pair is used.
@@ -400,6 +618,10 @@ private:
      */
     void unpack_data();
     
+    /// Reads the raw data for a location into data, from the file or all_data
+    /** \param start Index in each of the main variable's dimensions, 0 for the extra dimension */
+    void read_location(const size_t* start);
+    
     /// Help function for same_spatial_domain, compares either the lat coordinate variable or lon
     bool same_spatial_coordinates(int ncid_my_coordvar,
                                   const GridcellOrderedVariableNoTime& other,
@@ -417,6 +639,11 @@ private:
     /// Data for all timesteps for current location
     std::vector<double> data;
     
+    /// Raw data for all locations, if load_all_data() has been called
+    std::vector<double> all_data;
+    
+    /// Distance in all_data between neighbours in each of the main variable's dimensions
+    std::vector<size_t> all_data_strides;
     
     // The order of the dimensions in the main variable
     
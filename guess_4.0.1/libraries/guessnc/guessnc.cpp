@@ -7,9 +7,42 @@
 
 #include "guessnc.h"
 #include <netcdf.h>
+#include <map>
+#include <assert.h>
 
 namespace GuessNC {
 
+namespace {
+
+/// A file opened with open_shared_ncdf
+struct SharedFile {
+	/// Number of open_shared_ncdf calls not yet closed
+	int users;
+
+	/// Values read by get_all_values, by variable id
+	std::map<int, std::vector<double> > values;
+};
+
+/// The files opened with open_shared_ncdf, by file name and by id
+struct SharedFiles {
+	std::map<std::string, int> ids;
+	std::map<int, SharedFile> files;
+};
+
+SharedFiles& shared_files() {
+	static SharedFiles files;
+	return files;
+}
+
+/// Protects shared_files(), which may be used without holding library_mutex()
+/// by code only using the NetCDF library from one thread
+std::mutex& shared_files_mutex() {
+	static std::mutex m;
+	return m;
+}
+
+}
+
 void handle_error(int status, const std::string& message) {
 	// todo: simplify formatting message for more helpful messages?
 	if (status != NC_NOERR) {
@@ -32,6 +65,81 @@ void close_ncdf(int ncid) {
 	handle_error(status, "Failed to close NetCDF file");
 }
 
+int open_shared_ncdf(const char* fname) {
+	std::lock_guard<std::mutex> lock(shared_files_mutex());
+	SharedFiles& shared = shared_files();
+
+	std::map<std::string, int>::iterator itr = shared.ids.find(fname);
+	if (itr != shared.ids.end()) {
+		shared.files[itr->second].users++;
+		return itr->second;
+	}
+
+	int ncid = open_ncdf(fname);
+	shared.ids[fname] = ncid;
+	shared.files[ncid].users = 1;
+	return ncid;
+}
+
+void close_shared_ncdf(int ncid) {
+	std::lock_guard<std::mutex> lock(shared_files_mutex());
+	SharedFiles& shared = shared_files();
+
+	std::map<int, SharedFile>::iterator itr = shared.files.find(ncid);
+	if (itr == shared.files.end()) {
+		throw GuessNCError("Attempted to close a NetCDF file which isn't open");
+	}
+
+	if (--itr->second.users > 0) {
+		return;
+	}
+
+	shared.files.erase(itr);
+	for (std::map<std::string, int>::iterator i = shared.ids.begin(); i != shared.ids.end(); ++i) {
+		if (i->second == ncid) {
+			shared.ids.erase(i);
+			break;
+		}
+	}
+
+	close_ncdf(ncid);
+}
+
+void get_all_values(int ncid_file, int ncid_var, std::vector<double>& values) {
+	std::lock_guard<std::mutex> lock(shared_files_mutex());
+	SharedFiles& shared = shared_files();
+
+	std::map<int, SharedFile>::iterator file = shared.files.find(ncid_file);
+	if (file != shared.files.end()) {
+		std::map<int, std::vector<double> >::const_iterator itr = file->second.values.find(ncid_var);
+		if (itr != file->second.values.end()) {
+			values = itr->second;
+			return;
+		}
+	}
+
+	std::vector<int> dims;
+	get_dimensions(ncid_file, ncid_var, dims);
+
+	size_t size = 1;
+	for (size_t i = 0; i < dims.size(); ++i) {
+		size_t len;
+		int status = nc_inq_dimlen(ncid_file, dims[i], &len);
+		handle_error(status, "Failed to get dimension length of " + get_variable_name(ncid_file, ncid_var));
+		size *= len;
+	}
+
+	values.resize(size);
+	if (size > 0) {
+		int status = nc_get_var_double(ncid_file, ncid_var, &values.front());
+		handle_error(status, "Failed to read values of " + get_variable_name(ncid_file, ncid_var));
+	}
+
+	if (file != shared.files.end()) {
+		file->second.values[ncid_var] = values;
+	}
+}
+
 bool get_attribute(int ncid_file, int ncid_var,
                    const std::string& attr_name, std::string& value) {
 	nc_type type;
@@ -115,6 +223,43 @@ std::string get_variable_name(int ncid_file, int ncid_var) {
 	return name;
 }
 
+std::mutex& library_mutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+namespace {
+
+/// Number of LibraryLocks held by the calling thread (0 or 1)
+thread_local int library_locks = 0;
+
+}
+
+LibraryLock::LibraryLock()
+	: lock(library_mutex()) {
+	++library_locks;
+}
+
+LibraryLock::~LibraryLock() {
+	--library_locks;
+}
+
+bool library_locked() {
+	return library_locks > 0;
+}
+
+void check_library_locked(int ncid) {
+#ifndef NDEBUG
+	std::lock_guard<std::mutex> lock(shared_files_mutex());
+	SharedFiles& shared = shared_files();
+
+	std::map<int, SharedFile>::const_iterator itr = shared.files.find(ncid);
+	assert(itr == shared.files.end() || itr->second.users < 2 || library_locked());
+#else
+	(void)ncid;
+#endif
+}
+
 } // namespace GuessNC 
 
 #endif // HAVE_NETCDF
@@ -6,6 +6,7 @@
 #include "cftime.h"
 #include "cfvariable.h"
 
+#include <mutex>
 #include <stdexcept>
 #include <string>
 
@@ -32,6 +33,29 @@ int open_ncdf(const char* fname);
 /** Throws a GuessNCError if NetCDF library reports an error */
 void close_ncdf(int ncid);
 
+/// Opens a NetCDF file for reading, sharing the id with others who opened it
+/** Files are kept in a pool, so a file which is already open isn't opened
+ *  again (which is slow on parallel file systems), instead the same id is
+ *  returned. Each call must be matched with a call to close_shared_ncdf.
+ *
+ *  The users of a shared id may be on different threads, so they must
+ *  follow the locking rule (see library_mutex).
+ *
+ *  Throws GuessNCError if the file couldn't be opened
+ */
+int open_shared_ncdf(const char* fname);
+
+/// Closes a file opened with open_shared_ncdf, when it's no longer used
+/** Throws a GuessNCError if NetCDF library reports an error */
+void close_shared_ncdf(int ncid);
+
+/// Gets all values of a variable
+/** For files opened with open_shared_ncdf, the values are only read
+ *  from the file the first time, and then shared between all users of
+ *  the file. Meant for small variables, like coordinate variables.
+ */
+void get_all_values(int ncid_file, int ncid_var, std::vector<double>& values);
+
 /// Gets the value of a string attribute for a variable
 /** \returns false if the attribute didn't exist, or wasn't a string */
 bool get_attribute(int ncid_file, int ncid_var, 
@@ -52,6 +76,44 @@ bool get_coordinate_variable(int ncid_file, int ncid_dim, int& ncid_coord_var);
 /// Gets the name of a variable with a given id
 std::string get_variable_name(int ncid_file, int ncid_var);
 
+/// Mutex to hold while using the NetCDF library
+/** The NetCDF library isn't thread safe, not even for different files,
+ *  so code using it from more than one thread needs to take turns.
+ *
+ *  The locking rule: every use of a file id which may be used from more
+ *  than one thread must be made holding the mutex, through a LibraryLock.
+ *  Ids from open_shared_ncdf are such ids as soon as the file has more than
+ *  one user, for instance the variables an input module reads on its
+ *  background thread share the ids with those used for the current grid
+ *  cell. Sharing them is safe only because of this rule, which is checked
+ *  (in debug builds) by check_library_locked.
+ */
+std::mutex& library_mutex();
+
+/// Holds library_mutex() while in scope
+class LibraryLock {
+public:
+	LibraryLock();
+
+	~LibraryLock();
+
+private:
+	std::lock_guard<std::mutex> lock;
+
+	// Not copyable
+	LibraryLock(const LibraryLock&);
+	LibraryLock& operator=(const LibraryLock&);
+};
+
+/// Whether the calling thread holds library_mutex() with a LibraryLock
+bool library_locked();
+
+/// Asserts that the locking rule (see library_mutex) is followed for a file id
+/** Called before reading from files which may be opened with
+ *  open_shared_ncdf. Does nothing in release builds.
+ */
+void check_library_locked(int ncid);
+
 }
 
 #endif // HAVE_NETCDF
@@ -775,10 +775,12 @@ void unixtime(xtring& result) {
 }
 
 
-FILE** pin;
-xtring inxtr;
-bool iseol=false;
-char cbuf;
+// State of the file being read by readfor (one per thread, input modules
+// may read text files from several threads at once)
+thread_local FILE** pin;
+thread_local xtring inxtr;
+thread_local bool iseol=false;
+thread_local char cbuf;
 
 inline char xgetc() {
 
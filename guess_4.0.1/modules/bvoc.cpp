@@ -57,9 +57,8 @@ void initbvoc(){
 	const double daylength = 12;
 
 	PhotosynthesisResult phot;
- 	pftlist.firstobj();
- 	while (pftlist.isobj) {
- 		Pft& pft = pftlist.getobj();
+ 	for (int p = 0; p < npft; p++) {
+ 		Pft& pft = pftlist[p];
 
 		double par = frabs_Q * Qstand * 3600 * daylength / alphaa(pft) / CQ;
 				// par for the standard condition, J m-2 d-1
@@ -72,7 +71,6 @@ void initbvoc(){
 		pft.eps_iso *= coeff;
 		pft.eps_mon *= coeff;
 
-		pftlist.nextobj();
 	}
 }
 
@@ -41,6 +41,7 @@
 #include "q10.h"
 #include "bvoc.h"
 #include "ncompete.h"
+#include "profiler.h"
 #include <assert.h>
 
 // Anonymous namespace for variables with file scope
@@ -2154,10 +2155,16 @@ void canopy_exchange(Patch& patch, Climate& climate) {
 	init_canexch(patch, climate, vegetation);
 
 	// Canopy exchange processes
-	fpar(patch);
+	{
+		GuessProfiler::Timer timer(GuessProfiler::FPAR);
+		fpar(patch);
+	}
 
 	// Calculates no-stress daily values of photosynthesis and gpterm
-	photosynthesis_nostress(patch, climate);
+	{
+		GuessProfiler::Timer timer(GuessProfiler::PHOTOSYNTHESIS_NOSTRESS);
+		photosynthesis_nostress(patch, climate);
+	}
 
 	// Nitrogen demand
 	ndemand(patch, vegetation);
@@ -2168,10 +2175,16 @@ void canopy_exchange(Patch& patch, Climate& climate) {
 	// Only these processes are affected in diurnal mode
 	for (Day day; day.period != date.subdaily; day.next()) {
 
-		wdemand(patch, climate, vegetation, day);
+		{
+			GuessProfiler::Timer timer(GuessProfiler::WDEMAND);
+			wdemand(patch, climate, vegetation, day);
+		}
 		aet_water_stress(patch, vegetation, day);
 		water_scalar(patch, vegetation, day);
-		npp(patch, climate, vegetation, day);
+		{
+			GuessProfiler::Timer timer(GuessProfiler::NPP);
+			npp(patch, climate, vegetation, day);
+		}
 	}
 	leaf_senescence(vegetation);
 
@@ -29,6 +29,21 @@ void photosynthesis(double co2, double temp, double par, double daylength,
 /// Nitrogen- and landuse specific alpha a
 double alphaa(const Pft& pft);
 
+// Internal functions of the module, only declared here for the benchmarks
+// (see bench/main.cpp), not intended to be called by the framework
+
+/// Fraction of PAR absorbed by each individual and the patch
+void fpar(Patch& patch);
+
+/// Net C-assimilation under water-stressed conditions (demand>supply)
+void assimilation_wstress(const Pft& pft, double co2, double temp, double par,
+			double daylength, double fpar, double fpc, double gcbase,
+			double vmax, PhotosynthesisResult& phot_result, double& lambda,
+			double nactive, bool ifnlimvmax);
+
+/// Individual nitrogen uptake strength, based on the surface of its fine roots
+double nitrogen_uptake_strength(const Individual& indiv);
+
 // Constants for photosynthesis calculations
 
 /// conversion factor for solar radiation at 550 nm from J/m2 to mol_quanta/m2 (E=mol quanta); mol J-1
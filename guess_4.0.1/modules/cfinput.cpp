@@ -20,6 +20,7 @@
 #include "guess.h"
 #include "driver.h"
 #include "guessstring.h"
+#include "gridlistorder.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -257,10 +258,73 @@ void check_same_spatial_domains(const std::vector<GuessNC::CF::GridcellOrderedVa
 	}
 }
 
+// Opens the same variables a second time
+std::vector<GuessNC::CF::GridcellOrderedVariable*>
+reopen_variables(const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables) {
+
+	std::vector<GuessNC::CF::GridcellOrderedVariable*> result;
+	for (size_t i = 0; i < variables.size(); ++i) {
+		result.push_back(new GridcellOrderedVariable(variables[i]->get_filename().c_str(),
+		                                             variables[i]->get_variable_name().c_str()));
+	}
+	return result;
+}
+
+// Timesteps needed for a year of data, counting a skipped leap day and
+// the previous year's last timestep which may be used again
+int timesteps_per_year(const GuessNC::CF::GridcellOrderedVariable* cf_var) {
+	return is_daily(cf_var) ? 367 : 13;
+}
+
+// Makes the variables read their data a few years at a time
+void set_streaming(const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables,
+                   int nyear_spinup_data, int window_years) {
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		const int per_year = timesteps_per_year(variables[i]);
+
+		// The spinup data may start a year into the record
+		const int first_window = (nyear_spinup_data + 1) * per_year;
+
+		variables[i]->set_streaming(max(first_window, window_years * per_year),
+		                            window_years * per_year);
+	}
+}
+
+// Shares the memory for tile caches between variables reading from the files
+void share_tile_cache(const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables,
+                      int megabytes) {
+
+	const size_t bytes = size_t(megabytes) * 1024 * 1024;
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		variables[i]->set_tile_cache_size(bytes / variables.size());
+	}
+}
+
+// Makes sure a streamed variable has the timesteps for the current year in memory
+void load_year_window(GuessNC::CF::GridcellOrderedVariable* cf_var, int historic_timestep) {
+
+	const int first_timestep = max(0, historic_timestep);
+
+	if (!cf_var->window_contains(first_timestep, timesteps_per_year(cf_var))) {
+		GuessNC::LibraryLock lock;
+		try {
+			cf_var->load_window(first_timestep);
+		}
+		catch (const std::runtime_error& e) {
+			fail(e.what());
+		}
+	}
+}
+
 }
 
 CFInput::CFInput()
-	: cf_temp(0),
+	: gridlist_order("file"),
+	  forcing_window_years(0),
+	  tile_cache_mb(256),
+	  cf_temp(0),
 	  cf_prec(0),
 	  cf_insol(0),
 	  cf_wetdays(0),
@@ -270,6 +334,11 @@ CFInput::CFInput()
 
 	declare_parameter("ndep_timeseries", &ndep_timeseries, 10, "Nitrogen deposition time series to use (historic, rcp26, rcp45, rcp60 or rcp85");
 
+	declare_parameter("gridlist_order", &gridlist_order, 10, "Order to simulate the gridlist in (file, hilbert or morton)");
+
+	declare_parameter("forcing_window_years", &forcing_window_years, 0, 1000, "Years of forcing data to read at a time (0 reads the whole record for each grid cell)");
+
+	declare_parameter("tile_cache_mb", &tile_cache_mb, 0, 100000, "Memory for caching neighbouring grid cells read from chunked NetCDF files (MB per thread)");
 }
 
 CFInput::~CFInput() {
@@ -288,12 +357,102 @@ CFInput::~CFInput() {
 	cf_max_temp = 0;
 }
 
+CFInput::ThreadState::ThreadState()
+	: position(0),
+	  cf_temp(0),
+	  cf_prec(0),
+	  cf_insol(0),
+	  cf_wetdays(0),
+	  cf_min_temp(0),
+	  cf_max_temp(0),
+	  previous_position(-1),
+	  prefetch_step(1) {
+
+	prefetched.index = -1;
+}
+
+CFInput::ThreadState::~ThreadState() {
+	// Stop the background thread before deleting the variables it uses
+	prefetcher.reset();
+
+	GuessNC::LibraryLock lock;
+
+	for (size_t i = 0; i < prefetch_variables.size(); ++i) {
+		delete prefetch_variables[i];
+	}
+
+	delete cf_temp;
+	delete cf_prec;
+	delete cf_insol;
+	delete cf_wetdays;
+	delete cf_min_temp;
+	delete cf_max_temp;
+}
+
+CFInput::ThreadState& CFInput::thread_data() {
+
+	ThreadState& state = thread_state.get();
+
+	if (state.prefetcher.get()) {
+		return state;
+	}
+
+	// First use on this thread, open the variables for it
+	{
+		GuessNC::LibraryLock lock;
+
+		try {
+			std::vector<GridcellOrderedVariable*> variables = reopen_variables(all_variables());
+			GridcellOrderedVariable** members[] = { &state.cf_temp, &state.cf_prec, &state.cf_insol,
+			                                        &state.cf_wetdays, &state.cf_min_temp, &state.cf_max_temp };
+			const GridcellOrderedVariable* originals[] = { cf_temp, cf_prec, cf_insol,
+			                                               cf_wetdays, cf_min_temp, cf_max_temp };
+			size_t next = 0;
+			for (size_t i = 0; i < sizeof(members)/sizeof(members[0]); ++i) {
+				if (originals[i]) {
+					*members[i] = variables[next++];
+				}
+			}
+
+			state.prefetch_variables = reopen_variables(all_variables());
+
+			if (forcing_window_years > 0) {
+				set_streaming(state.all_variables(), NYEAR_SPINUP_DATA, forcing_window_years);
+				set_streaming(state.prefetch_variables, NYEAR_SPINUP_DATA, forcing_window_years);
+			}
+
+			// Only the variables used by the background thread read whole grid cells,
+			// the others only read later windows of the current one when streaming,
+			// which doesn't go through the tile cache
+			std::vector<GridcellOrderedVariable*> readers = state.prefetch_variables;
+
+			std::vector<GridcellOrderedVariable*> current = state.all_variables();
+			share_tile_cache(current, 0);
+			share_tile_cache(readers, tile_cache_mb);
+		}
+		catch (const std::runtime_error& e) {
+			fail(e.what());
+		}
+	}
+
+	state.prefetcher = std::auto_ptr<BackgroundTask>(new BackgroundTask);
+
+	return state;
+}
+
 void CFInput::init() {
 
+	// Other input modules may be reading NetCDF files in the background
+	GuessNC::LibraryLock lock;
+
 	// Read CO2 data from file
 	co2.load_file(param["file_co2"].str);
 
-	file_cru = param["file_cru"].str;
+	// Kept for the grid cells, param isn't safe to use from several threads
+	file_ndep = param["file_ndep"].str;
+
+	// Open the CRU archive once, and read its index of grid cells
+	cru_archive = std::auto_ptr<CRU_TS30::CRUArchive>(new CRU_TS30::CRUArchive(param["file_cru"].str));
 
 	// Try to open the NetCDF files
 	try {
@@ -341,6 +500,8 @@ void CFInput::init() {
 
 	extensive_precipitation = cf_prec->get_standard_name() == "precipitation_amount";
 
+	insol_type = cf_standard_name_to_insoltype(cf_insol->get_standard_name());
+
 	// Read list of localities and store in gridlist member variable
 
 	// Retrieve name of grid list file as read from ins file
@@ -381,12 +542,22 @@ void CFInput::init() {
 		gridlist.push_back(c);
 	}
 
-	current_gridcell = gridlist.begin();
+	// Simulate along a curve through the grid cells' positions in the files, if asked for
+	std::vector<std::pair<int, int> > positions;
+	for (size_t i = 0; i < gridlist.size(); ++i) {
+		const Coord& c = gridlist[i];
+		positions.push_back(cf_temp->is_reduced() ? std::make_pair(c.landid, 0) : std::make_pair(c.rlon, c.rlat));
+	}
 
-	// Open landcover files
-	landcover_input.init();
-	// Open management files
-	management_input.init();
+	order = GridlistOrder::simulation_order(gridlist_order, positions);
+
+	order_position.assign(order.size(), 0);
+	for (size_t i = 0; i < order.size(); ++i) {
+		order_position[order[i]] = (int)i;
+	}
+
+	// Open landcover and management files
+	landuse_input.init();
 
 	date.set_first_calendar_year(cf_temp->get_date_time(0).get_year() - nyear_spinup);
 
@@ -398,29 +569,113 @@ void CFInput::init() {
 	tmute.settimer(MUTESEC);
 }
 
+int CFInput::simulated_years() const {
+	// The spinup, then each calendar year in the forcing data
+	return nyear_spinup + last_day_to_simulate(cf_temp).get_year() -
+		cf_temp->get_date_time(0).get_year() + 1;
+}
+
+bool CFInput::gridcell_coordinates(int index, double& lon, double& lat) const {
+	const Coord& c = gridlist[index];
+
+	GuessNC::LibraryLock lock;
+	try {
+		if (cf_temp->is_reduced()) {
+			cf_temp->get_coords_for(c.landid, lon, lat);
+		}
+		else {
+			cf_temp->get_coords_for(c.rlon, c.rlat, lon, lat);
+		}
+	}
+	catch (const std::runtime_error&) {
+		// Not in the forcing files, the model will skip it
+		return false;
+	}
+	return true;
+}
+
 bool CFInput::getgridcell(Gridcell& gridcell) {
+	ThreadState& state = thread_data();
+	state.prefetch_step = 1;
+	return load_gridcell(gridcell, state, true);
+}
+
+bool CFInput::getgridcell_at(Gridcell& gridcell, int index) {
+	ThreadState& state = thread_data();
+
+	// Guess that the grid cells are asked for in steps of the same size
+	// along the simulation order
+	const int position = simulation_position(index);
+	if (state.previous_position >= 0 && position > state.previous_position) {
+		state.prefetch_step = position - state.previous_position;
+	}
+	else {
+		state.prefetch_step = 1;
+	}
+	state.previous_position = position;
+
+	state.position = index;
+	return load_gridcell(gridcell, state, false);
+}
+
+int CFInput::simulation_position(int index) const {
+	return order.empty() ? index : order_position[index];
+}
+
+int CFInput::guess_next_gridcell(const ThreadState& state, int index) const {
+	const int position = simulation_position(index) + state.prefetch_step;
+	if (position >= (int)gridlist.size()) {
+		return -1;
+	}
+	return order.empty() ? position : order[position];
+}
+
+bool CFInput::load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead) {
+
+	// Get data for next gridcell, or if that fails, skip ahead until
+	// we find one that works. Usually the data has already been loaded
+	// in the background while the previous grid cell was simulated.
+	while (state.position < (int)gridlist.size()) {
+		if (state.prefetched.index != state.position) {
+			start_prefetch(state, state.position);
+		}
+		wait_for_prefetch(state);
+		state.prefetched.index = -1;
 
-	double lon, lat;
-	double cru_lon, cru_lat;
-	int soilcode;
+		if (state.prefetched.message != "") {
+			dprintf("%s", (char*)state.prefetched.message);
+		}
 
-	// Load data for next gridcell, or if that fails, skip ahead until
-	// we find one that works.
-	while (current_gridcell != gridlist.end() &&
-	       !load_data_from_files(lon, lat, cru_lon, cru_lat, soilcode)) {
-		++current_gridcell;
+		if (state.prefetched.ok) {
+			break;
+		}
+		if (!skip_ahead) {
+			return false;
+		}
+		++state.position;
 	}
 
-	if (current_gridcell == gridlist.end()) {
+	if (state.position >= (int)gridlist.size()) {
 		// simulation finished
 		return false;
 	}
 
+	const Coord& c = gridlist[state.position];
+
+	// Take over the data from the variables used by the background thread
+	std::vector<GridcellOrderedVariable*> variables = state.all_variables();
+	for (size_t i = 0; i < variables.size(); ++i) {
+		variables[i]->swap_data(*state.prefetch_variables[i]);
+	}
+
+	const double lon = state.prefetched.lon;
+	const double lat = state.prefetched.lat;
+	const double cru_lon = state.prefetched.cru_lon;
+	const double cru_lat = state.prefetched.cru_lat;
+	const int soilcode = state.prefetched.soilcode;
+
 	if (run_landcover) {
-		bool LUerror = false;
-		LUerror = landcover_input.loadlandcover(cru_lon, cru_lat);
-		if (!LUerror)
-			LUerror = management_input.loadmanagement(cru_lon, cru_lat);
+		bool LUerror = landuse_input.loadlanduse(cru_lon, cru_lat);
 		if (LUerror) {
 			dprintf("\nError: could not find stand at (%g,%g) in landcover/management data file(s)\n", cru_lon, cru_lat);
 			return false;
@@ -431,89 +686,115 @@ bool CFInput::getgridcell(Gridcell& gridcell) {
 
 	// Load spinup data for all variables
 
-	load_spinup_data(cf_temp, spinup_temp);
-	load_spinup_data(cf_prec, spinup_prec);
-	load_spinup_data(cf_insol, spinup_insol);
+	load_spinup_data(state.cf_temp, state.spinup_temp);
+	load_spinup_data(state.cf_prec, state.spinup_prec);
+	load_spinup_data(state.cf_insol, state.spinup_insol);
 
-	if (cf_wetdays) {
-		load_spinup_data(cf_wetdays, spinup_wetdays);
+	if (state.cf_wetdays) {
+		load_spinup_data(state.cf_wetdays, state.spinup_wetdays);
 	}
 
-	if (cf_min_temp) {
-		load_spinup_data(cf_min_temp, spinup_min_temp);
+	if (state.cf_min_temp) {
+		load_spinup_data(state.cf_min_temp, state.spinup_min_temp);
 	}
 
-	if (cf_max_temp) {
-		load_spinup_data(cf_max_temp, spinup_max_temp);
+	if (state.cf_max_temp) {
+		load_spinup_data(state.cf_max_temp, state.spinup_max_temp);
 	}
 
-	spinup_temp.detrend_data();
+	state.spinup_temp.detrend_data();
 
-	gridcell.climate.instype = cf_standard_name_to_insoltype(cf_insol->get_standard_name());
+	gridcell.climate.instype = insol_type;
 
 	// Get nitrogen deposition, using the found CRU coordinates
-	ndep.getndep(param["file_ndep"].str, cru_lon, cru_lat,
-	             Lamarque::parse_timeseries(ndep_timeseries));
+	state.ndep.getndep(file_ndep, cru_lon, cru_lat,
+	                   Lamarque::parse_timeseries(ndep_timeseries));
 
 	// Setup the soil type
 	soilparameters(gridcell.soiltype, soilcode);
 
-	historic_timestep_temp = -1;
-	historic_timestep_prec = -1;
-	historic_timestep_insol = -1;
-	historic_timestep_wetdays = -1;
-	historic_timestep_min_temp = -1;
-	historic_timestep_max_temp = -1;
+	state.historic_timestep_temp = -1;
+	state.historic_timestep_prec = -1;
+	state.historic_timestep_insol = -1;
+	state.historic_timestep_wetdays = -1;
+	state.historic_timestep_min_temp = -1;
+	state.historic_timestep_max_temp = -1;
 
 	dprintf("\nCommencing simulation for gridcell at (%g,%g)\n", lon, lat);
-	if (current_gridcell->descrip != "") {
-		dprintf("Description: %s\n", current_gridcell->descrip.c_str());
+	if (c.descrip != "") {
+		dprintf("Description: %s\n", c.descrip.c_str());
 	}
 	dprintf("Using soil code and Nitrogen deposition for (%3.1f,%3.1f)\n", cru_lon, cru_lat);
 
+	// Start loading the grid cell which will probably be asked for next
+	const int next = guess_next_gridcell(state, state.position);
+	if (next >= 0) {
+		start_prefetch(state, next);
+	}
+
 	return true;
 }
 
-bool CFInput::load_data_from_files(double& lon, double& lat,
+void CFInput::start_prefetch(ThreadState& state, int index) {
+	wait_for_prefetch(state);
+	state.prefetched.index = index;
+	state.prefetcher->start([this, &state, index]() {
+		prefetch(state, index);
+	});
+}
+
+void CFInput::prefetch(ThreadState& state, int index) {
+
+	GuessNC::LibraryLock lock;
+
+	Prefetched& prefetched = state.prefetched;
+	prefetched.message = "";
+	prefetched.ok = load_data_from_files(state, gridlist[index],
+	                                     prefetched.lon, prefetched.lat,
+	                                     prefetched.cru_lon, prefetched.cru_lat,
+	                                     prefetched.soilcode, prefetched.message);
+}
+
+void CFInput::wait_for_prefetch(ThreadState& state) {
+	try {
+		state.prefetcher->wait();
+	}
+	catch (const std::runtime_error& e) {
+		fail(e.what());
+	}
+}
+
+bool CFInput::load_data_from_files(ThreadState& state, const Coord& c,
+                                   double& lon, double& lat,
                                    double& cru_lon, double& cru_lat,
-                                   int& soilcode) {
+                                   int& soilcode, xtring& message) {
+
+	int rlon = c.rlon;
+	int rlat = c.rlat;
+	int landid = c.landid;
 
-	int rlon = current_gridcell->rlon;
-	int rlat = current_gridcell->rlat;
-	int landid = current_gridcell->landid;
+	const std::vector<GridcellOrderedVariable*>& prefetch_variables = state.prefetch_variables;
 
 	// Try to load the data from the NetCDF files
 
-	if (cf_temp->is_reduced()) {
-		if (!cf_temp->load_data_for(landid) ||
-		    !cf_prec->load_data_for(landid) ||
-		    !cf_insol->load_data_for(landid) ||
-		    (cf_wetdays && !cf_wetdays->load_data_for(landid)) ||
-		    (cf_min_temp && !cf_min_temp->load_data_for(landid)) ||
-		    (cf_max_temp && !cf_max_temp->load_data_for(landid))) {
-			dprintf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
-			return false;
+	if (!load_data_for(prefetch_variables, rlon, rlat, landid)) {
+		if (prefetch_variables.front()->is_reduced()) {
+			message.printf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
 		}
-	}
-	else {
-		if (!cf_temp->load_data_for(rlon, rlat) ||
-		    !cf_prec->load_data_for(rlon, rlat) ||
-		    !cf_insol->load_data_for(rlon, rlat) ||
-		    (cf_wetdays && !cf_wetdays->load_data_for(rlon, rlat)) ||
-		    (cf_min_temp && !cf_min_temp->load_data_for(rlon, rlat)) ||
-		    (cf_max_temp && !cf_max_temp->load_data_for(rlon, rlat))) {
-			dprintf("Failed to load data for (%d, %d) from NetCDF files, skipping.\n", rlon, rlat);
-			return false;
+		else {
+			message.printf("Failed to load data for (%d, %d) from NetCDF files, skipping.\n", rlon, rlat);
 		}
+		return false;
 	}
 
 	// Get lon/lat for the gridcell
 
-	if (cf_temp->is_reduced()) {
-		cf_temp->get_coords_for(landid, lon, lat);
+	GridcellOrderedVariable* temp = prefetch_variables.front();
+	if (temp->is_reduced()) {
+		temp->get_coords_for(landid, lon, lat);
 	}
 	else {
-		cf_temp->get_coords_for(rlon, rlat, lon, lat);
+		temp->get_coords_for(rlon, rlat, lon, lat);
 	}
 
 	// Find nearest CRU grid cell in order to get the soilcode
@@ -524,10 +805,10 @@ bool CFInput::load_data_from_files(double& lon, double& lat,
 
 	const double searchradius = 1;
 
-	if (!CRU_TS30::findnearestCRUdata(searchradius, file_cru, cru_lon, cru_lat, soilcode,
-	                                  dummy, dummy, dummy)) {
-		dprintf("Failed to find soil code from CRU archive, close to coordinates (%g,%g), skipping.\n",
-		        cru_lon, cru_lat);
+	if (!cru_archive->findnearestCRUdata(searchradius, cru_lon, cru_lat, soilcode,
+	                                     dummy, dummy, dummy)) {
+		message.printf("Failed to find soil code from CRU archive, close to coordinates (%g,%g), skipping.\n",
+		               cru_lon, cru_lat);
 		return false;
 	}
 
@@ -541,6 +822,10 @@ void CFInput::get_yearly_data(std::vector<double>& data,
 	// Extract all values for this year, for one variable,
 	// either from spinup dataset or historical dataset
 
+	if (forcing_window_years > 0) {
+		load_year_window(cf_historic, historic_timestep);
+	}
+
 	int calendar_year = date.get_calendar_year();
 
 	if (is_daily(cf_historic)) {
@@ -657,18 +942,20 @@ void CFInput::populate_daily_array(double* daily,
 	}
 }
 
-void CFInput::populate_daily_prec_array(long& seed) {
+void CFInput::populate_daily_prec_array(ThreadState& state, long& seed) {
 
 	// Get the data from spinup and/or historic
 	std::vector<double> prec_data;
-	get_yearly_data(prec_data, spinup_prec, cf_prec, historic_timestep_prec);
+	get_yearly_data(prec_data, state.spinup_prec, state.cf_prec, state.historic_timestep_prec);
 
 	std::vector<double> wetdays_data;
-	if (cf_wetdays) {
-		get_yearly_data(wetdays_data, spinup_wetdays, cf_wetdays, historic_timestep_wetdays);
+	if (state.cf_wetdays) {
+		get_yearly_data(wetdays_data, state.spinup_wetdays, state.cf_wetdays, state.historic_timestep_wetdays);
 	}
 
-	if (is_daily(cf_prec)) {
+	double* dprec = state.dprec;
+
+	if (is_daily(state.cf_prec)) {
 		// Simply copy from data to daily, and if needed convert from
 		// precipitation rate to precipitation amount
 
@@ -691,7 +978,7 @@ void CFInput::populate_daily_prec_array(long& seed) {
 			}
 		}
 
-		if (cf_wetdays) {
+		if (state.cf_wetdays) {
 			prdaily(&prec_data.front(), dprec, &wetdays_data.front(), seed);
 		}
 		else {
@@ -700,59 +987,59 @@ void CFInput::populate_daily_prec_array(long& seed) {
 	}
 }
 
-void CFInput::populate_daily_arrays(long& seed) {
+void CFInput::populate_daily_arrays(ThreadState& state, long& seed) {
 	// Extract daily values for all days in this year, either from
 	// spinup dataset or historical dataset
 
-	populate_daily_array(dtemp, spinup_temp, cf_temp, historic_timestep_temp, 0);
-	populate_daily_prec_array(seed);
-	populate_daily_array(dinsol, spinup_insol, cf_insol, historic_timestep_insol, 0,
-	                     max_insolation(cf_standard_name_to_insoltype(cf_insol->get_standard_name())));
+	populate_daily_array(state.dtemp, state.spinup_temp, state.cf_temp, state.historic_timestep_temp, 0);
+	populate_daily_prec_array(state, seed);
+	populate_daily_array(state.dinsol, state.spinup_insol, state.cf_insol, state.historic_timestep_insol, 0,
+	                     max_insolation(insol_type));
 
-	if (cf_min_temp) {
-		populate_daily_array(dmin_temp, spinup_min_temp, cf_min_temp, historic_timestep_min_temp, 0);
+	if (state.cf_min_temp) {
+		populate_daily_array(state.dmin_temp, state.spinup_min_temp, state.cf_min_temp, state.historic_timestep_min_temp, 0);
 	}
 
-	if (cf_max_temp) {
-		populate_daily_array(dmax_temp, spinup_max_temp, cf_max_temp, historic_timestep_max_temp, 0);
+	if (state.cf_max_temp) {
+		populate_daily_array(state.dmax_temp, state.spinup_max_temp, state.cf_max_temp, state.historic_timestep_max_temp, 0);
 	}
 
 	// Convert to units the model expects
-	bool cloud_fraction_to_sunshine = (cf_standard_name_to_insoltype(cf_insol->get_standard_name()) == SUNSHINE);
+	bool cloud_fraction_to_sunshine = (insol_type == SUNSHINE);
 	for (int i = 0; i < date.year_length(); ++i) {
-		dtemp[i] -= K2degC;
+		state.dtemp[i] -= K2degC;
 
-		if (cf_min_temp) {
-			dmin_temp[i] -= K2degC;
+		if (state.cf_min_temp) {
+			state.dmin_temp[i] -= K2degC;
 		}
 
-		if (cf_max_temp) {
-			dmax_temp[i] -= K2degC;
+		if (state.cf_max_temp) {
+			state.dmax_temp[i] -= K2degC;
 		}
 
 		if (cloud_fraction_to_sunshine) {
 			// Invert from cloudiness to sunshine,
 			// and convert fraction (0-1) to percent (0-100)
-			dinsol[i] = (1-dinsol[i]) * 100.0;
+			state.dinsol[i] = (1-state.dinsol[i]) * 100.0;
 		}
 	}
 
 	// Move to next year in spinup dataset
 
-	spinup_temp.nextyear();
-	spinup_prec.nextyear();
-	spinup_insol.nextyear();
+	state.spinup_temp.nextyear();
+	state.spinup_prec.nextyear();
+	state.spinup_insol.nextyear();
 
-	if (cf_wetdays) {
-		spinup_wetdays.nextyear();
+	if (state.cf_wetdays) {
+		state.spinup_wetdays.nextyear();
 	}
 
-	if (cf_min_temp) {
-		spinup_min_temp.nextyear();
+	if (state.cf_min_temp) {
+		state.spinup_min_temp.nextyear();
 	}
 
-	if (cf_max_temp) {
-		spinup_max_temp.nextyear();
+	if (state.cf_max_temp) {
+		state.spinup_max_temp.nextyear();
 	}
 
 	// Get monthly ndep values and convert to daily
@@ -760,47 +1047,48 @@ void CFInput::populate_daily_arrays(long& seed) {
 	double mndrydep[12];
 	double mnwetdep[12];
 
-	ndep.get_one_calendar_year(date.get_calendar_year(),
-	                           mndrydep, mnwetdep);
+	state.ndep.get_one_calendar_year(date.get_calendar_year(),
+	                                 mndrydep, mnwetdep);
 
 	// Distribute N deposition
-	distribute_ndep(mndrydep, mnwetdep, dprec, dndep);
+	distribute_ndep(mndrydep, mnwetdep, state.dprec, state.dndep);
 }
 
 void CFInput::getlandcover(Gridcell& gridcell) {
 
-	landcover_input.getlandcover(gridcell);
-	landcover_input.get_land_transitions(gridcell);
+	landuse_input.getlandcover(gridcell);
 }
 
 bool CFInput::getclimate(Gridcell& gridcell) {
 
 	Climate& climate = gridcell.climate;
 
+	ThreadState& state = thread_data();
+
 	GuessNC::CF::DateTime last_date = last_day_to_simulate(cf_temp);
 
 	if (later_day(date, last_date)) {
-		++current_gridcell;
+		++state.position;
 		return false;
 	}
 
 	climate.co2 = co2[date.get_calendar_year()];
 
 	if (date.day == 0) {
-		populate_daily_arrays(gridcell.seed);
+		populate_daily_arrays(state, gridcell.seed);
 	}
 
-	climate.temp = dtemp[date.day];
-	climate.prec = dprec[date.day];
-	climate.insol = dinsol[date.day];
+	climate.temp = state.dtemp[date.day];
+	climate.prec = state.dprec[date.day];
+	climate.insol = state.dinsol[date.day];
 
 	// Nitrogen deposition
-	climate.dndep = dndep[date.day];
+	climate.dndep = state.dndep[date.day];
 
 	// bvoc
 	if(ifbvoc){
 		if (cf_min_temp && cf_max_temp) {
-			climate.dtr = dmax_temp[date.day] - dmin_temp[date.day];
+			climate.dtr = state.dmax_temp[date.day] - state.dmin_temp[date.day];
 		}
 		else {
 			fail("When BVOC is switched on, valid paths for minimum and maximum temperature must be given.");
@@ -813,6 +1101,8 @@ bool CFInput::getclimate(Gridcell& gridcell) {
 
 		// Progress report to user and update timer
 
+		std::lock_guard<std::mutex> lock(progress_mutex);
+
 		if (tmute.getprogress()>=1.0) {
 
 			int first_historic_year = cf_temp->get_date_time(0).get_year();
@@ -821,7 +1111,7 @@ bool CFInput::getclimate(Gridcell& gridcell) {
 
 			int years_to_simulate = nyear_spinup + historic_years;
 
-			int cells_done = distance(gridlist.begin(), current_gridcell);
+			int cells_done = simulation_position(state.position);
 
 			double progress=(double)(cells_done*years_to_simulate+date.year)/
 				(double)(gridlist.size()*years_to_simulate);
@@ -896,9 +1186,14 @@ bool is_null(const GuessNC::CF::GridcellOrderedVariable* ptr) {
 	return ptr == 0;
 }
 
-}
-
-std::vector<GuessNC::CF::GridcellOrderedVariable*> CFInput::all_variables() const {
+// Collects the variables which are in use
+std::vector<GuessNC::CF::GridcellOrderedVariable*>
+used_variables(GuessNC::CF::GridcellOrderedVariable* cf_temp,
+               GuessNC::CF::GridcellOrderedVariable* cf_prec,
+               GuessNC::CF::GridcellOrderedVariable* cf_insol,
+               GuessNC::CF::GridcellOrderedVariable* cf_wetdays,
+               GuessNC::CF::GridcellOrderedVariable* cf_min_temp,
+               GuessNC::CF::GridcellOrderedVariable* cf_max_temp) {
 	std::vector<GuessNC::CF::GridcellOrderedVariable*> result;
 	result.push_back(cf_temp);
 	result.push_back(cf_prec);
@@ -914,4 +1209,14 @@ std::vector<GuessNC::CF::GridcellOrderedVariable*> CFInput::all_variables() cons
 	return result;
 }
 
+}
+
+std::vector<GuessNC::CF::GridcellOrderedVariable*> CFInput::all_variables() const {
+	return used_variables(cf_temp, cf_prec, cf_insol, cf_wetdays, cf_min_temp, cf_max_temp);
+}
+
+std::vector<GuessNC::CF::GridcellOrderedVariable*> CFInput::ThreadState::all_variables() const {
+	return used_variables(cf_temp, cf_prec, cf_insol, cf_wetdays, cf_min_temp, cf_max_temp);
+}
+
 #endif // HAVE_NETCDF
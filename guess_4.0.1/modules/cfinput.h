@@ -14,6 +14,8 @@
 
 #include "cruinput.h"
 #include "guessnc.h"
+#include "backgroundtask.h"
+#include "perthread.h"
 #include <memory>
 #include <limits>
 
@@ -28,6 +30,21 @@ public:
 	/// See base class for documentation about this function's responsibilities
 	bool getgridcell(Gridcell& gridcell);
 
+	/// See base class for documentation about this function's responsibilities
+	int gridlist_size() const { return (int)gridlist.size(); }
+
+	/// See base class for documentation about this function's responsibilities
+	int simulated_years() const;
+
+	/// See base class for documentation about this function's responsibilities
+	bool gridcell_coordinates(int index, double& lon, double& lat) const;
+
+	/// See base class for documentation about this function's responsibilities
+	bool getgridcell_at(Gridcell& gridcell, int index);
+
+	/// See base class for documentation about this function's responsibilities
+	std::vector<int> simulation_order() const { return order; }
+
 	/// See base class for documentation about this function's responsibilities
 	bool getclimate(Gridcell& gridcell);
 	
@@ -35,16 +52,14 @@ public:
 	void getlandcover(Gridcell& gridcell);
 
 	/// Obtains land management data for one day
-	void getmanagement(Gridcell& gridcell) {management_input.getmanagement(gridcell);}
+	void getmanagement(Gridcell& gridcell) {landuse_input.getmanagement(gridcell);}
 
 	static const int NYEAR_SPINUP_DATA=30;
 
 private:
 
-	/// Land cover input module
-	LandcoverInput landcover_input;
-	/// Management input module
-	ManagementInput management_input;
+	/// Land cover and management input
+	LanduseInput landuse_input;
 
 	struct Coord {
 
@@ -59,16 +74,206 @@ private:
 	/// The grid cells to simulate
 	std::vector<Coord> gridlist;
 
-	/// The current grid cell to simulate
-	std::vector<Coord>::iterator current_gridcell;
+	/// Which order to simulate the gridlist in (file, hilbert or morton)
+	/** The grid cells can be simulated along a curve through their positions in
+	 *  the NetCDF files (rlon and rlat, or landid for reduced grids), which for
+	 *  chunked files means reading mostly neighbouring chunks one after the other.
+	 *  The output files then also get the grid cells in that order.
+	 */
+	std::string gridlist_order;
+
+	/// Years of forcing data to keep in memory for each variable, 0 for the whole record
+	/** With long daily records the data for a grid cell can take a lot of
+	 *  memory, so it can be read a few years at a time as the simulation
+	 *  proceeds (see GridcellOrderedVariable::set_streaming). The years used
+	 *  to build the spinup are always read in one go.
+	 */
+	int forcing_window_years;
+
+	/// Memory for the variables' tile caches on each thread, in MB
+	/** Chunked files are read a chunk's worth of neighbouring grid cells at
+	 *  a time, which are kept in memory for the following grid cells (see
+	 *  GridcellOrderedVariable::set_tile_cache_size). The memory is shared
+	 *  between the variables reading from the files. When streaming, only
+	 *  the first window (the spinup years) is cached.
+	 */
+	int tile_cache_mb;
+
+	/// Gridlist positions in the order to simulate them, empty for the given order
+	std::vector<int> order;
+
+	/// Where each grid cell comes in order, empty if order is
+	std::vector<int> order_position;
+
+	/// What is loaded for a grid cell apart from the variables' data
+	struct Prefetched {
+		/// Position in gridlist, -1 if nothing has been started
+		int index;
+
+		/// Whether the data could be loaded for the grid cell
+		bool ok;
+
+		double lon;
+		double lat;
+		double cru_lon;
+		double cru_lat;
+		int soilcode;
+
+		/// Why the data couldn't be loaded, printed by the simulating thread
+		xtring message;
+	};
+
+	/// What each thread keeps for the grid cell it is simulating
+	/** The module is shared by all threads simulating grid cells, everything
+	 *  else in it is read-only after init(). Each thread reads the files
+	 *  with variables of its own, opened the first time they're needed (see
+	 *  thread_data()), but the files themselves are only opened once (see
+	 *  GuessNC::open_shared_ncdf).
+	 */
+	struct ThreadState {
+		ThreadState();
+
+		/// Stops the background thread and closes the variables
+		~ThreadState();
+
+		/// The current grid cell to simulate, position in gridlist
+		int position;
+
+		// The variables, holding the data for the current grid cell
+		// (null if not used, same as in the module)
+
+		GuessNC::CF::GridcellOrderedVariable* cf_temp;
+
+		GuessNC::CF::GridcellOrderedVariable* cf_prec;
+
+		GuessNC::CF::GridcellOrderedVariable* cf_insol;
+
+		GuessNC::CF::GridcellOrderedVariable* cf_wetdays;
+
+		GuessNC::CF::GridcellOrderedVariable* cf_min_temp;
+
+		GuessNC::CF::GridcellOrderedVariable* cf_max_temp;
+
+		/// Same variables as above, opened a second time
+		/** Used for loading the next grid cell on the background thread
+		 *  while the current one is simulated. */
+		std::vector<GuessNC::CF::GridcellOrderedVariable*> prefetch_variables;
+
+		// Spinup data for each variable
+
+		GenericSpinupData spinup_temp;
+
+		GenericSpinupData spinup_prec;
+
+		GenericSpinupData spinup_insol;
+
+		GenericSpinupData spinup_wetdays;
+
+		GenericSpinupData spinup_min_temp;
+
+		GenericSpinupData spinup_max_temp;
+
+		/// The latest grid cell started by start_prefetch()
+		/** Only to be used by the calling thread after waiting for prefetcher. */
+		Prefetched prefetched;
+
+		/// Where the previous grid cell asked for with getgridcell_at() comes in the simulation order
+		int previous_position;
+
+		/// How far ahead in the simulation order to prefetch after the current grid cell
+		/** One when the grid cells are asked for in order, otherwise a guess
+		 *  based on the previous calls to getgridcell_at(). */
+		int prefetch_step;
 
-	/// Loads data from NetCDF files for current grid cell
-	/** Returns the coordinates for the current grid cell, for
-	 *  the closest CRU grid cell and the soilcode for the cell.
+		/// Thread doing all NetCDF reading for this thread's grid cells
+		/** The NetCDF library isn't thread safe, so the background thread
+		 *  does all the reading (holding GuessNC::library_mutex()), and the
+		 *  simulating thread only uses data already loaded. */
+		std::auto_ptr<BackgroundTask> prefetcher;
+
+		/// Temperature for current gridcell and current year (deg C)
+		double dtemp[Date::MAX_YEAR_LENGTH];
+
+		/// Precipitation for current gridcell and current year (mm/day)
+		double dprec[Date::MAX_YEAR_LENGTH];
+
+		/// Insolation for current gridcell and current year (\see instype)
+		double dinsol[Date::MAX_YEAR_LENGTH];
+
+		/// Daily N deposition for one year
+		double dndep[Date::MAX_YEAR_LENGTH];
+
+		/// Minimum temperature for current gridcell and current year (deg C)
+		double dmin_temp[Date::MAX_YEAR_LENGTH];
+
+		/// Maximum temperature for current gridcell and current year (deg C)
+		double dmax_temp[Date::MAX_YEAR_LENGTH];
+
+		// Current timestep in CF files
+
+		int historic_timestep_temp;
+
+		int historic_timestep_prec;
+
+		int historic_timestep_insol;
+
+		int historic_timestep_wetdays;
+
+		int historic_timestep_min_temp;
+
+		int historic_timestep_max_temp;
+
+		/// Nitrogen deposition forcing for current gridcell
+		Lamarque::NDepData ndep;
+
+		/// \returns all (used) variables holding data for the current grid cell
+		std::vector<GuessNC::CF::GridcellOrderedVariable*> all_variables() const;
+
+	private:
+		// Not copyable
+		ThreadState(const ThreadState&);
+		ThreadState& operator=(const ThreadState&);
+	};
+
+	/// The calling thread's state, with its variables opened
+	ThreadState& thread_data();
+
+	/// Sets up gridcell for the current grid cell in the gridlist
+	/** Used by getgridcell() and getgridcell_at(). If data can't be loaded
+	 *  for the current grid cell, the function moves on to the next one if
+	 *  skip_ahead is true, otherwise it returns false. */
+	bool load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead);
+
+	/// Loads data from NetCDF files for a grid cell into state.prefetch_variables
+	/** Returns the coordinates for the grid cell, for
+	 *  the closest CRU grid cell and the soilcode for the cell. Runs on the
+	 *  background thread, so instead of printing why the data couldn't be
+	 *  loaded, it is returned in message.
 	 *  \returns whether it was possible to load data and find nearby CRU cell */
-	bool load_data_from_files(double& lon, double& lat,
+	bool load_data_from_files(ThreadState& state, const Coord& c,
+	                          double& lon, double& lat,
 	                          double& cru_lon, double& cru_lat,
-	                          int& soilcode);
+	                          int& soilcode, xtring& message);
+
+	/// Starts loading everything needed from the files for a grid cell
+	/** The data is loaded on the thread's background thread, into
+	 *  state.prefetch_variables and state.prefetched. Waits for the
+	 *  previous grid cell first, if any.
+	 *
+	 *  \param index Position of the grid cell in gridlist
+	 */
+	void start_prefetch(ThreadState& state, int index);
+
+	/// Loads everything needed from the files for a grid cell
+	/** Runs on the background thread, see start_prefetch(). Errors are
+	 *  thrown, to be reported by wait_for_prefetch() on the simulating
+	 *  thread, nothing is printed and fail() is never called here.
+	 */
+	void prefetch(ThreadState& state, int index);
+
+	/// Waits for the background thread to finish the grid cell it is loading
+	/** Calls fail() if the background thread ran into an error. */
+	void wait_for_prefetch(ThreadState& state);
 
 	/// Gets the first few years of data from cf_var and puts it into spinup_data
 	void load_spinup_data(const GuessNC::CF::GridcellOrderedVariable* cf_var,
@@ -92,10 +297,10 @@ private:
 
 	/// Same as populate_daily_array, but for precipitation which is special
 	/** Uses number of wet days if available and handles extensive/intensive conversion */
-	void populate_daily_prec_array(long& seed);
+	void populate_daily_prec_array(ThreadState& state, long& seed);
 
-	/// Fills dtemp, dprec, etc. with forcing data for the current year
-	void populate_daily_arrays(long& seed);
+	/// Fills dtemp, dprec, etc. in state with forcing data for the current year
+	void populate_daily_arrays(ThreadState& state, long& seed);
 
 	/// \returns all (used) variables
 	std::vector<GuessNC::CF::GridcellOrderedVariable*> all_variables() const;
@@ -108,7 +313,8 @@ private:
 	 */
 	GlobalCO2File co2;
 
-	// The variables
+	// The variables, used for their metadata (each thread
+	// reads the data with variables of its own, see ThreadState)
 
 	GuessNC::CF::GridcellOrderedVariable* cf_temp;
 
@@ -122,62 +328,26 @@ private:
 
 	GuessNC::CF::GridcellOrderedVariable* cf_max_temp;
 
-	// Spinup data for each variable
-
-	GenericSpinupData spinup_temp;
-
-	GenericSpinupData spinup_prec;
-
-	GenericSpinupData spinup_insol;
-
-	GenericSpinupData spinup_wetdays;
-
-	GenericSpinupData spinup_min_temp;
-
-	GenericSpinupData spinup_max_temp;
-
-	/// Temperature for current gridcell and current year (deg C)
-	double dtemp[Date::MAX_YEAR_LENGTH];
-
-	/// Precipitation for current gridcell and current year (mm/day)
-	double dprec[Date::MAX_YEAR_LENGTH];
-
-	/// Insolation for current gridcell and current year (\see instype)
-	double dinsol[Date::MAX_YEAR_LENGTH];
+	/// Where a grid cell comes in the simulation order (see order)
+	int simulation_position(int index) const;
 
-	/// Daily N deposition for one year
-	double dndep[Date::MAX_YEAR_LENGTH];
+	/// The grid cell which will probably be asked for after a given one, or -1
+	int guess_next_gridcell(const ThreadState& state, int index) const;
 
-	/// Minimum temperature for current gridcell and current year (deg C)
-	double dmin_temp[Date::MAX_YEAR_LENGTH];
-
-	/// Maximum temperature for current gridcell and current year (deg C)
-	double dmax_temp[Date::MAX_YEAR_LENGTH];
+	/// Insolation type of the insolation variable
+	insoltype insol_type;
 
 	/// Whether the forcing data for precipitation is an extensive quantity
 	/** If given as an amount (kg m-2) per timestep it is extensive, if it's
 	 *  given as a mean rate (kg m-2 s-1) it is an intensive quantity */
 	bool extensive_precipitation;
 
-	// Current timestep in CF files
-
-	int historic_timestep_temp;
-
-	int historic_timestep_prec;
-
-	int historic_timestep_insol;
-
-	int historic_timestep_wetdays;
+	/// CRU binary archive, used for the soil code
+	/** Only used holding GuessNC::library_mutex(). */
+	std::auto_ptr<CRU_TS30::CRUArchive> cru_archive;
 
-	int historic_timestep_min_temp;
-
-	int historic_timestep_max_temp;
-
-	/// Path to CRU binary archive
-	xtring file_cru;
-
-	/// Nitrogen deposition forcing for current gridcell
-	Lamarque::NDepData ndep;
+	/// Nitrogen deposition archive
+	xtring file_ndep;
 
 	/// Nitrogen deposition time series to use (historic,rcp26,...)
 	std::string ndep_timeseries;
@@ -185,6 +355,12 @@ private:
 	// Timers for keeping track of progress through the simulation
 	Timer tprogress,tmute;
 	static const int MUTESEC=20; // minimum number of sec to wait between progress messages
+
+	/// Serializes the progress reports from several threads
+	std::mutex progress_mutex;
+
+	/// Declared last, so the threads' background threads are stopped first
+	PerThread<ThreadState> thread_state;
 };
 
 #endif // HAVE_NETCDF
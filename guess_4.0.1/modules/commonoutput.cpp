@@ -93,6 +93,32 @@ CommonOutput::~CommonOutput() {
 void CommonOutput::init() {
 
 	define_output_tables();
+
+	// no output during the spinup
+	set_schedule(OutputSchedule(nyear_spinup));
+
+	// Skip the sums which aren't written to any table. Note that the plots
+	// in the Windows shell are only updated for the sums still calculated.
+
+	monthly_sums_needed =
+		!out_mnpp.invalid() || !out_mlai.invalid() || !out_mgpp.invalid() ||
+		!out_mra.invalid() || !out_maet.invalid() || !out_mpet.invalid() ||
+		!out_mevap.invalid() || !out_mrunoff.invalid() || !out_mintercep.invalid() ||
+		!out_mrh.invalid() || !out_mnee.invalid() || !out_mwcont_upper.invalid() ||
+		!out_mwcont_lower.invalid() || !out_miso.invalid() || !out_mmon.invalid();
+
+	patch_sums_needed = monthly_sums_needed ||
+		!out_cflux.invalid() || !out_doc.invalid() || !out_cpool.invalid() ||
+		!out_firert.invalid() || !out_runoff.invalid() || !out_nsources.invalid() ||
+		!out_npool.invalid() || !out_nflux.invalid() || !out_ngases.invalid();
+
+	pft_sums_needed =
+		!out_cmass.invalid() || !out_anpp.invalid() || !out_agpp.invalid() ||
+		!out_fpc.invalid() || !out_aaet.invalid() || !out_dens.invalid() ||
+		!out_lai.invalid() || !out_clitter.invalid() || !out_speciesheights.invalid() ||
+		!out_aiso.invalid() || !out_amon.invalid() || !out_nmass.invalid() ||
+		!out_cton_leaf.invalid() || !out_nlitter.invalid() || !out_nuptake.invalid() ||
+		!out_vmaxnlim.invalid() || !out_cpool.invalid() || !out_npool.invalid();
 }
 
 /** This function specifies all columns in all output tables, their names,
@@ -116,16 +142,14 @@ void CommonOutput::define_output_tables() {
 	// create a vector with the crop pft names
 	std::vector<std::string> crop_pfts;
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		 Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		 Pft& pft=pftlist[p];
 
 		 pfts.push_back((char*)pft.name);
 
 		 if(pft.landcover==CROPLAND)
 			 crop_pfts.push_back((char*)pft.name);
 
-		 pftlist.nextobj();
 	}
 
 	// create a vector with the landcover column titles
@@ -403,19 +427,16 @@ void output_vegetation(Gridcell& gridcell, Pftlist& pftlist) {
 			Stand& stand = *gc_itr;
 
 			npft_tree = npft_grass = 0;
-			pftlist.firstobj();
-			while (pftlist.isobj) {
-				Pft& pft = pftlist.getobj();
+			for (int p = 0; p < npft; p++) {
+				Pft& pft = pftlist[p];
 				if (pft.lifeform == TREE) npft_tree++;
 				else if (pft.lifeform == GRASS) npft_grass++;
-				pftlist.nextobj();
 			}
 			npft_total = npft_tree + npft_grass;
 			fwrite(&npft_total, sizeof(int), 1, out);
 			fwrite(&npft_tree, sizeof(int), 1, out);
-			pftlist.firstobj();
-			while (pftlist.isobj) {
-				Pft& pft = pftlist.getobj();
+			for (int p = 0; p < npft; p++) {
+				Pft& pft = pftlist[p];
 				if (pft.lifeform == TREE) {
 					sprintf(pftname, "%s", (char*)(pft.name.left(15)));
 					fwrite(pftname, sizeof(char), 16, out);
@@ -424,18 +445,15 @@ void output_vegetation(Gridcell& gridcell, Pftlist& pftlist) {
 					//fwrite(&pft.ifconifer, sizeof(bool), 1, out);
 					//fwrite(pft.preferredrgb, sizeof(double), 3, out);
 				}
-				pftlist.nextobj();
 			}
-			pftlist.firstobj();
-			while (pftlist.isobj) {
-				Pft& pft = pftlist.getobj();
+			for (int p = 0; p < npft; p++) {
+				Pft& pft = pftlist[p];
 				if (pft.lifeform == GRASS) {
 					sprintf(pftname, "%s", (char*)(pft.name.left(15)));
 					fwrite(pftname, sizeof(char), 16, out);
 					fwrite(&rgb, sizeof(double), 3, out);
 					//fwrite(pft.preferredrgb, sizeof(double), 3, out);
 				}
-				pftlist.nextobj();
 			}
 			int npatch = stand.npatch();
 			fwrite(&npatch, sizeof(int), 1, out);
@@ -497,9 +515,8 @@ void get_stand_age_structure(Gridcell& gridcell,double* densindiv,int& nageclass
 	}
 	else nageclass = 0;
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pft = pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pft = pftlist[p];
 
 		// Determine area fraction of stands where this pft is active:
 		active_fraction = 0.0;
@@ -559,7 +576,6 @@ void get_stand_age_structure(Gridcell& gridcell,double* densindiv,int& nageclass
 			}
 			++gc_itr;
 		}
-		pftlist.nextobj();
 	}
 }
 
@@ -570,11 +586,12 @@ void get_stand_age_structure(Gridcell& gridcell,double* densindiv,int& nageclass
   * If only yearly output between, say 1961 and 1990 is requred, use:
   *  if (date.get_calendar_year() >= 1961 && date.get_calendar_year() <= 1990)
   *  (assuming the input module has set the first calendar year in the date object)	
+  *
+  * There is no output during the spinup, outannual() isn't called at all
+  * then (see the schedule set in init()).
   */
 void outlimit(OutputRows& out, const Table& table, double d) {
-
-	if (date.year>=nyear_spinup)
-		out.add_value(table, d);
+	out.add_value(table, d);
 }
 
 /// Output of simulation results at the end of each year
@@ -723,10 +740,9 @@ void CommonOutput::outannual(Gridcell& gridcell) {
 
 	// *** Loop through PFTs ***
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
+	for (int p = 0; p < npft && pft_sums_needed; p++) {
 
-		Pft& pft=pftlist.getobj();
+		Pft& pft=pftlist[p];
 		Gridcellpft& gridcellpft=gridcell.pft[pft.id];
 
 		// Sum C biomass, NPP, LAI and BVOC fluxes across patches and PFTs
@@ -992,7 +1008,6 @@ void CommonOutput::outannual(Gridcell& gridcell) {
 
 		outlimit(out,out_speciesheights, height);
 
-		pftlist.nextobj();
 
 	} // *** End of PFT loop ***
 
@@ -1017,7 +1032,7 @@ void CommonOutput::outannual(Gridcell& gridcell) {
 	Gridcell::iterator gc_itr = gridcell.begin();
 
 	// Loop through Stands
-	while (gc_itr != gridcell.end()) {
+	while (gc_itr != gridcell.end() && patch_sums_needed) {
 		Stand& stand = *gc_itr;
 		stand.firstobj();
 
@@ -1100,6 +1115,11 @@ void CommonOutput::outannual(Gridcell& gridcell) {
 				}
 			}
 
+			if (!monthly_sums_needed) {
+				stand.nextobj();
+				continue;
+			}
+
 			// Monthly output variables
 
 			for (m=0;m<12;m++) {
@@ -1439,9 +1459,8 @@ void CommonOutput::outannual(Gridcell& gridcell) {
 
 					get_stand_age_structure(gridcell, densindiv, nageclass, true);
 
-					pftlist.firstobj();
-					while (pftlist.isobj) {
-						Pft& pft = pftlist.getobj();
+					for (int p = 0; p < npft; p++) {
+						Pft& pft = pftlist[p];
 
 						if (pft.lifeform == TREE) {
 
@@ -1451,7 +1470,6 @@ void CommonOutput::outannual(Gridcell& gridcell) {
 								densindiv[pft.id*nageclass+c]*1e4); // includes conversion from /m2 --> /ha
 						}
 
-						pftlist.nextobj();
 					}
 
 					delete[] densindiv;
@@ -67,6 +67,17 @@ private:
 	
 	// climate
 	Table out_climate;
+
+	// Which parts of outannual are needed for the created tables, set in init
+
+	/// The loop summing vegetation per PFT, for the PFT tables and VegC/VegN in cpool and npool
+	bool pft_sums_needed;
+
+	/// The loop summing fluxes, soil pools and runoff across patches
+	bool patch_sums_needed;
+
+	/// The monthly sums in the patch loop
+	bool monthly_sums_needed;
 };
 
 }
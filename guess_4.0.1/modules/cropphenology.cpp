@@ -216,7 +216,7 @@ void heat_units(Patch& patch, Pft& pft) {
 	}
 
 	// account for response to photoperiod
-	ppftcrop.prf = (1 - pft.psens) * min(1.0, max(0.0, (climate.daylength_save[date.day] - pft.pb) / (pft.ps - pft.pb))) + pft.psens;
+	ppftcrop.prf = (1 - pft.psens) * min(1.0, max(0.0, (climate.daylength - pft.pb) / (pft.ps - pft.pb))) + pft.psens;
 	hu *= ppftcrop.prf;
 
 	if (date.day == ppftcrop.sdate) {
@@ -284,7 +284,7 @@ void development_stage(Patch& patch, Pft& pft) {
 		ppftcrop.vdsum_alloc = min(1.0, vd5 / (pow(22.5, 5.0) + vd5));
 	}
 
-	double daylength = max(0.0, climate.daylength_save[date.day] - pft.photo[0]);
+	double daylength = max(0.0, climate.daylength - pft.photo[0]);
 	double e = exp(-pft.photo[1] * daylength);
 	double fP = min(1.0, pft.photo[2] > 0 ? e : 1.0 - e);
 
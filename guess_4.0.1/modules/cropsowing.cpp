@@ -311,10 +311,9 @@ void calc_sowing_windows(Gridcell& gridcell) {
 	}
 
 	// Set gridcell-level sowing windows for crop pft:s
-	pftlist.firstobj();
-	while(pftlist.isobj) {
+	for (int p = 0; p < npft; p++) {
 
-		Pft& pft = pftlist.getobj();
+		Pft& pft = pftlist[p];
 		Gridcellpft& gridcellpft = gridcell.pft[pft.id];
 
 		if (pft.phenology == CROPGREEN) {
@@ -400,7 +399,6 @@ void calc_sowing_windows(Gridcell& gridcell) {
 			}
 
 		}
-		pftlist.nextobj();
 	}
 }
 
@@ -620,10 +618,9 @@ void crop_sowing_gridcell(Gridcell& gridcell) {
 		climate.maxtemp = climate.temp;
 
 	// Loop through PFTs
-	pftlist.firstobj();
-	while (pftlist.isobj) {
+	for (int p = 0; p < npft; p++) {
 
-		Pft& pft = pftlist.getobj();
+		Pft& pft = pftlist[p];
 		Gridcellpft& gridcellpft = gridcell.pft[pft.id];
 
 		if (pft.landcover == CROPLAND) {
@@ -644,7 +641,6 @@ void crop_sowing_gridcell(Gridcell& gridcell) {
 			}
 		}
 
-		pftlist.nextobj();
 	}
 
 	if (date.islastmonth && date.islastday) {
@@ -778,14 +774,13 @@ void crop_sowing_date(Patch& patch, Pft& pft) {
 /// handles sowing date calculations for crop pft:s on patch level
 void crop_sowing_patch(Patch& patch) {
 
-	pftlist.firstobj();
 	Gridcell& gridcell = patch.stand.get_gridcell();
 	Climate& climate = gridcell.climate;
 
 	// Loop through PFTs
-	while(pftlist.isobj) {
+	for (int p = 0; p < npft; p++) {
 
-		Pft& pft = pftlist.getobj();
+		Pft& pft = pftlist[p];
 		Patchpft& patchpft = patch.pft[pft.id];
 		Gridcellpft& gridcellpft = gridcell.pft[pft.id];
 
@@ -849,7 +844,6 @@ void crop_sowing_patch(Patch& patch) {
 				}
 			}
 		}
-		pftlist.nextobj();
 	}
 }
 
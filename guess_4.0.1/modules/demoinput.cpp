@@ -28,9 +28,6 @@ namespace {
 // File names for temperature, precipitation, sunshine and soil code driver files
 xtring file_temp,file_prec,file_sun,file_soil;
 
-// LPJ soil code
-int soilcode;
-
 /// Interpolates monthly data to quasi-daily values.
 void interp_climate(double* mtemp, double* mprec, double* msun, double* mdtr,
 					double* dtemp, double* dprec, double* dsun, double* ddtr) {
@@ -49,8 +46,8 @@ DemoInput::DemoInput()
 	declare_parameter("nyear", &nyear, 1, 10000, "Number of simulation years to run after spinup");
 }
 
-bool DemoInput::read_from_file(Coord coord, xtring fname, const char* format,
-                               double monthly[12], bool soil /* = false */) {
+bool DemoInput::read_from_file(const Coord& coord, xtring fname, const char* format,
+                               double monthly[12], int* soilcode /* = 0 */) {
 	double dlon, dlat;
 	int elev;
 	FILE* in = fopen(fname, "r");
@@ -60,10 +57,10 @@ bool DemoInput::read_from_file(Coord coord, xtring fname, const char* format,
 
 	bool foundgrid = false;
 	while (!feof(in) && !foundgrid) {
-		if (!soil) {
+		if (!soilcode) {
 			readfor(in, format, &dlon, &dlat, &elev, monthly);
 		} else {
-			readfor(in, format, &dlon, &dlat, &soilcode);
+			readfor(in, format, &dlon, &dlat, soilcode);
 		}
 		foundgrid = equal(coord.lon, dlon) && equal(coord.lat, dlat);
 	}
@@ -77,12 +74,12 @@ bool DemoInput::read_from_file(Coord coord, xtring fname, const char* format,
 	return foundgrid;
 }
 
-bool DemoInput::readenv(Coord coord, long& seed) {
+bool DemoInput::readenv(const Coord& coord, long& seed, ThreadState& state) {
 
 	// Searches for environmental data in driver temperature, precipitation,
 	// sunshine and soil code files for the grid cell whose coordinates are given by
-	// 'coord'. Data are written to arrays mtemp, mprec, msun and the variable
-	// soilcode, which are defined as global variables in this file
+	// 'coord'. Data are written to arrays mtemp, mprec, msun and the member
+	// soilcode of state
 
 	// The temperature, precipitation and sunshine files (Cramer & Leemans,
 	// unpublished) should be in ASCII text format and contain one-line records for the
@@ -143,17 +140,17 @@ bool DemoInput::readenv(Coord coord, long& seed) {
 	if(gridfound)
 		gridfound = read_from_file(coord, file_sun, "f6.2,f5.2,i4,12f3", msun);
 	if(gridfound)
-		gridfound = read_from_file(coord, file_soil, "f,f,i", msun, true);	// msun is not used here: just dummy
+		gridfound = read_from_file(coord, file_soil, "f,f,i", msun, &state.soilcode);	// msun is not used here: just dummy
 
 	if(gridfound) {
 		// Interpolate monthly values for environmental drivers to daily values
 		// (relevant daily values will be sent to the framework each simulation
 		// day in function getclimate, below)
-		interp_climate(mtemp, mprec, msun, mdtr, dtemp, dprec, dsun, ddtr);
+		interp_climate(mtemp, mprec, msun, mdtr, state.dtemp, state.dprec, state.dsun, state.ddtr);
 
 		// Recalculate precipitation values using weather generator
 		// (from Dieter Gerten 021121)
-		prdaily(mprec, dprec, mwet, seed);
+		prdaily(mprec, state.dprec, mwet, seed);
 	}
 
 	return gridfound;
@@ -183,7 +180,6 @@ void DemoInput::init() {
 	if (!in_grid) fail("initio: could not open %s for input",(char*)file_gridlist);
 
 	gridlist.killall();
-	first_call = true;
 
 	while (!eof) {
 
@@ -208,10 +204,8 @@ void DemoInput::init() {
 	// Retrieve specified N value as read from ins file
 	ndep=param["ndep"].num;
 
-	// Open landcover files
-	landcover_input.init();
-	// Open management files
-	management_input.init();
+	// Open landcover and management files
+	landuse_input.init();
 
 	// Retrieve input file names as read from ins file
 
@@ -232,78 +226,76 @@ bool DemoInput::getgridcell(Gridcell& gridcell) {
 
 	// See base class for documentation about this function's responsibilities
 
-	// Select coordinates for next grid cell in linked list
-	bool gridfound = false;
+	// Step through the gridlist, starting with the first grid cell
+	ThreadState& state = thread_state.get();
+	state.position++;
 
-	bool LUerror = false;
+	return load_gridcell(gridcell, state, true);
+}
 
-	// Make sure we use the first gridcell in the first call to this function,
-	// and then step through the gridlist in subsequent calls.
 
-	if (first_call) {
-		gridlist.firstobj();
+bool DemoInput::getgridcell_at(Gridcell& gridcell, int index) {
 
-		// Note that first_call is static, so this assignment is remembered
-		// across function calls.
-		first_call = false;
-	}
-	else gridlist.nextobj();
-
-	if (gridlist.isobj) {
-
-		while(!gridfound) {
-
-			// Retrieve coordinate of next grid cell from linked list
-			Coord& c = gridlist.getobj();
-
-			// Load environmental data for this grid cell from files
-			if(run_landcover) {
-				LUerror = landcover_input.loadlandcover(gridlist.getobj().lon, gridlist.getobj().lat);
-				if(!LUerror)
-					LUerror = management_input.loadmanagement(gridlist.getobj().lon, gridlist.getobj().lat);
-			}
-			if (!LUerror) {
-				gridfound = readenv(c, gridcell.seed);
-			} else {
-				gridlist.nextobj();
-				if(!gridlist.isobj)
-					return false;
-			}
+	// See base class for documentation about this function's responsibilities
+
+	ThreadState& state = thread_state.get();
+	state.position = index;
+
+	return load_gridcell(gridcell, state, false);
+}
+
+bool DemoInput::load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead) {
+
+	while (state.position < (int)gridlist.nobj) {
+
+		// Retrieve coordinate of the grid cell from the gridlist
+		const Coord& c = gridlist[state.position];
+
+		bool LUerror = false;
+
+		// Load environmental data for this grid cell from files
+		if (run_landcover) {
+			LUerror = landuse_input.loadlanduse(c.lon, c.lat);
 		}
 
-		dprintf("\nCommencing simulation for stand at (%g,%g)",gridlist.getobj().lon,
-			gridlist.getobj().lat);
-		if (gridlist.getobj().descrip!="") dprintf(" (%s)\n\n",
-			(char*)gridlist.getobj().descrip);
-		else dprintf("\n\n");
+		if (!LUerror && readenv(c, gridcell.seed, state)) {
+
+			dprintf("\nCommencing simulation for stand at (%g,%g)",c.lon,c.lat);
+			if (c.descrip!="") dprintf(" (%s)\n\n",(const char*)c.descrip);
+			else dprintf("\n\n");
+
+			// Tell framework the coordinates of this grid cell
+			gridcell.set_coordinates(c.lon, c.lat);
+
+			// The insolation data will be sent (in function getclimate, below)
+			// as percentage sunshine
 
-		// Tell framework the coordinates of this grid cell
-		gridcell.set_coordinates(gridlist.getobj().lon, gridlist.getobj().lat);
+			gridcell.climate.instype=SUNSHINE;
 
-		// The insolation data will be sent (in function getclimate, below)
-		// as percentage sunshine
+			// Tell framework the soil type of this grid cell
+			soilparameters(gridcell.soiltype,state.soilcode);
 
-		gridcell.climate.instype=SUNSHINE;
+			// For Windows shell - clear graphical output
+			// (ignored on other platforms)
 
-		// Tell framework the soil type of this grid cell
-		soilparameters(gridcell.soiltype,soilcode);
+			clear_all_graphs();
 
-		// For Windows shell - clear graphical output
-		// (ignored on other platforms)
+			return true; // simulate this stand
+		}
 
-		clear_all_graphs();
+		if (!skip_ahead) {
+			return false;
+		}
 
-		return true; // simulate this stand
+		state.position++;
 	}
 
 	return false; // no more stands
 }
 
-
 void DemoInput::getlandcover(Gridcell& gridcell) {
 
-	landcover_input.getlandcover(gridcell);
-	landcover_input.get_land_transitions(gridcell);
+	landuse_input.getlandcover(gridcell);
 }
 
 bool DemoInput::getclimate(Gridcell& gridcell) {
@@ -314,6 +306,8 @@ bool DemoInput::getclimate(Gridcell& gridcell) {
 
 	Climate& climate = gridcell.climate;
 
+	const ThreadState& state = thread_state.get();
+
 
 	// Send environmental values for today to framework
 
@@ -321,13 +315,13 @@ bool DemoInput::getclimate(Gridcell& gridcell) {
 
 	climate.co2 = co2;
 
-	climate.temp  = dtemp[date.day];
-	climate.prec  = dprec[date.day];
-	climate.insol = dsun[date.day];
+	climate.temp  = state.dtemp[date.day];
+	climate.prec  = state.dprec[date.day];
+	climate.insol = state.dsun[date.day];
 
 	// bvoc
 
-	climate.dtr=ddtr[date.day];
+	climate.dtr=state.ddtr[date.day];
 
 
 	// First day of year only ...
@@ -339,8 +333,10 @@ bool DemoInput::getclimate(Gridcell& gridcell) {
 
 		// Progress report to user and update timer
 
+		std::lock_guard<std::mutex> lock(progress_mutex);
+
 		if (tmute.getprogress()>=1.0) {
-			progress=(double)(gridlist.getobj().id*(nyear_spinup+nyear)
+			progress=(double)(state.position*(nyear_spinup+nyear)
 				+date.year)/(double)(gridlist.nobj*(nyear_spinup+nyear));
 
 
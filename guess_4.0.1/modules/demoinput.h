@@ -13,8 +13,10 @@
 #include "guess.h"
 #include "inputmodule.h"
 #include <vector>
+#include <mutex>
 #include "gutil.h"
 #include "externalinput.h"
+#include "perthread.h"
 
 /// An input module for a toy data set (for demonstration purposes)
 /** This input module is provided as an example of an input module.
@@ -42,6 +44,15 @@ public:
 	/// See base class for documentation about this function's responsibilities
 	bool getgridcell(Gridcell& gridcell);
 
+	/// See base class for documentation about this function's responsibilities
+	int gridlist_size() const { return gridlist.nobj; }
+
+	/// See base class for documentation about this function's responsibilities
+	int simulated_years() const { return nyear_spinup + nyear; }
+
+	/// See base class for documentation about this function's responsibilities
+	bool getgridcell_at(Gridcell& gridcell, int index);
+
 	/// See base class for documentation about this function's responsibilities
 	bool getclimate(Gridcell& gridcell);
 
@@ -49,7 +60,7 @@ public:
 	void getlandcover(Gridcell& gridcell);
 
 	/// Obtains land management data for one day
-	void getmanagement(Gridcell& gridcell) {management_input.getmanagement(gridcell);}
+	void getmanagement(Gridcell& gridcell) {landuse_input.getmanagement(gridcell);}
 
 private:
 
@@ -62,17 +73,44 @@ private:
 		xtring descrip;
 	};
 
-	/// Land cover input module
-	LandcoverInput landcover_input;
-	/// Management input module
-	ManagementInput management_input;
+	/// What each thread keeps for the grid cell it is simulating
+	/** The module is shared by all threads simulating grid cells, everything
+	 *  else in it is read-only after init(). */
+	struct ThreadState {
+		ThreadState() : position(-1), soilcode(0) {}
+
+		/// Position in gridlist of the current grid cell, -1 before the first one
+		int position;
+
+		/// LPJ soil code
+		int soilcode;
+
+		// Daily temperature, precipitation and sunshine for one year
+		double dtemp[Date::MAX_YEAR_LENGTH];
+		double dprec[Date::MAX_YEAR_LENGTH];
+		double dsun[Date::MAX_YEAR_LENGTH];
+		// bvoc
+		// Daily diurnal temperature range for one year
+		double ddtr[Date::MAX_YEAR_LENGTH];
+	};
+
+	PerThread<ThreadState> thread_state;
+
+	/// Land cover and management input
+	LanduseInput landuse_input;
+
+	/// Sets up gridcell for the grid cell at state.position in the gridlist
+	/** If data can't be loaded for it, the function moves on to the next
+	 *  grid cell if skip_ahead is true, otherwise it returns false. */
+	bool load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead);
 
 	/// Help function to readenv, reads in 12 monthly values from a text file
-	bool read_from_file(Coord coord, xtring fname, const char* format,
-	                    double monthly[12], bool soil = false);
+	/** Reads a soil code instead if soilcode is given. */
+	bool read_from_file(const Coord& coord, xtring fname, const char* format,
+	                    double monthly[12], int* soilcode = 0);
 
 	/// Reads in environmental data for a location
-	bool readenv(Coord coord, long& seed);
+	bool readenv(const Coord& coord, long& seed, ThreadState& state);
 
 	/// number of simulation years to run after spinup
 	int nyear;
@@ -80,20 +118,12 @@ private:
 	/// A list of Coord objects containing coordinates of the grid cells to simulate
 	ListArray_id<Coord> gridlist;
 
-	/// Flag for getgridcell(). True indicates that the first gridcell has not been read yet by getgridcell()
-	bool first_call;
-
 	// Timers for keeping track of progress through the simulation
 	Timer tprogress,tmute;
 	static const int MUTESEC=20; // minimum number of sec to wait between progress messages
 
-	// Daily temperature, precipitation and sunshine for one year
-	double dtemp[Date::MAX_YEAR_LENGTH];
-	double dprec[Date::MAX_YEAR_LENGTH];
-	double dsun[Date::MAX_YEAR_LENGTH];
-	// bvoc
-	// Daily diurnal temperature range for one year
-	double ddtr[Date::MAX_YEAR_LENGTH];
+	/// Serializes the progress reports from several threads
+	std::mutex progress_mutex;
 
 	/// atmospheric CO2 concentration (ppmv) (read from ins file)
 	double co2;
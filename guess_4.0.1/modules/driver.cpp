@@ -795,11 +795,9 @@ void dailyaccounting_gridcell(Gridcell& gridcell, Climate& climate) {
 			climate.atemp_mean = climate.temp;
 
 			// Initialise gridcellpfts Michaelis-Menten kinetic Km value
-			pftlist.firstobj();
-			while (pftlist.isobj) {
+			for (int p = 0; p < npft; p++) {
 				// cw SubPixel wtot NOT ADJUSTED FOR TRUE DEPTH !!!
-				gridcell.pft[pftlist.getobj().id].Km = pftlist.getobj().km_volume * gridcell.soiltype.wtot;
-				pftlist.nextobj();
+				gridcell.pft[pftlist[p].id].Km = pftlist[p].km_volume * gridcell.soiltype.wtot;
 			}
 		}
 
@@ -961,9 +959,8 @@ void dailyaccounting_patch_lc(Patch& patch) {
 	Landcover& lc = patch.stand.get_gridcell().landcover;
 	double scale = patch.stand.get_gridcell_fraction() / (double)patch.stand.nobj;
 
-	pftlist.firstobj();
-	while(pftlist.isobj) {				// NB. also inactive pft's
-		Pft& pft = pftlist.getobj();
+	for (int p = 0; p < npft; p++) {				// NB. also inactive pft's
+		Pft& pft = pftlist[p];
 		Patchpft& ppft = patch.pft[pft.id];
 
 		lc.acflux_harvest_slow += ppft.harvested_products_slow * pft.turnover_harv_prod * scale;
@@ -974,7 +971,6 @@ void dailyaccounting_patch_lc(Patch& patch) {
 		lc.anflux_harvest_slow_lc[patch.stand.landcover] += ppft.harvested_products_slow_nmass * pft.turnover_harv_prod * scale;
 		ppft.harvested_products_slow_nmass = ppft.harvested_products_slow_nmass * (1 - pft.turnover_harv_prod);
 
-		pftlist.nextobj();
 	}
 }
 
@@ -1105,7 +1101,6 @@ void daylengthinsoleet(Climate& climate) {
 	// INPUT AND OUTPUT PARAMETER
 	// climate = gridcell climate
 
-	const double QOO = 1360.0;
 	const double BETA = 0.17;
 	const double A = 107.0;
 	const double B = 0.2;
@@ -1180,37 +1175,23 @@ void daylengthinsoleet(Climate& climate) {
 	//	From (12) & (13), and converting from angular units to seconds
 	//	(14) rad = 2 * w * ( u*hh + v*sin(hh) ) * k
 
-	if (!climate.doneday[date.day]) {
-
-		// Calculate values of saved parameters for this day
-		climate.qo[date.day] = QOO * (1.0 + 2.0 * 0.01675 *
-							cos(2.0 * PI * ((double)date.day + 0.5) / date.year_length())); // Eqn 2
-		double delta = -23.4 * DEGTORAD * cos(2.0 * PI * ((double)date.day + 10.5) / date.year_length());
-				// Eqn 4, solar declination angle (radians)
-		climate.u[date.day] = climate.sinelat * sin(delta); // Eqn 9
-		climate.v[date.day] = climate.cosinelat * cos(delta); // Eqn 10
-
-		if (climate.u[date.day] >= climate.v[date.day])
-			climate.hh[date.day] = PI; // polar day
-		else if (climate.u[date.day] <= -climate.v[date.day])
-			climate.hh[date.day] = 0.0; // polar night
-		else climate.hh[date.day] =
-			acos(-climate.u[date.day] / climate.v[date.day]); // Eqn 11
-
-		climate.sinehh[date.day] = sin(climate.hh[date.day]);
-
-		// Calculate daylength in hours from hh
-
-		climate.daylength_save[date.day] = 24.0 * climate.hh[date.day] / PI;
-		climate.doneday[date.day] = true;
+	// The terms which only depend on latitude and day of the year are
+	// calculated once for each latitude (see get_solar_geometry). As when
+	// each climate saved its own values for each day, they are kept until
+	// the climate is initialised again (see Climate::initdrivers).
+	if (!climate.solar_geometry) {
+		climate.solar_geometry = get_solar_geometry(climate.lat, date.year_length());
 	}
-	climate.daylength = climate.daylength_save[date.day];
+	const SolarGeometry& geometry = *climate.solar_geometry;
+	const int day = date.day;
+
+	climate.daylength = geometry.daylength[day];
 
 	if (climate.instype == SUNSHINE) {		// insolation is percentage sunshine
 
-		w = (C+D * climate.insol / 100.0) * (1.0 - BETA) * climate.qo[date.day]; // Eqn 13
-		climate.rad = 2.0 * w * (climate.u[date.day] * climate.hh[date.day] +
-				climate.v[date.day] * climate.sinehh[date.day]) * K; // Eqn 14
+		w = (C+D * climate.insol / 100.0) * (1.0 - BETA) * geometry.qo[day]; // Eqn 13
+		climate.rad = 2.0 * w * (geometry.u[day] * geometry.hh[day] +
+				geometry.v[day] * geometry.sinehh[day]) * K; // Eqn 14
 
 	}
 	else { // insolation provided as instantaneous downward shortwave radiation flux
@@ -1222,7 +1203,7 @@ void daylengthinsoleet(Climate& climate) {
 
 		if (climate.instype == NETSWRAD || climate.instype == SWRAD) {
 			// insolation is provided as radiation during daylight hours
-			averaging_period = climate.daylength_save[date.day] * 3600.0;
+			averaging_period = geometry.daylength[day] * 3600.0;
 		}
 
 		double net_coeff = 1;
@@ -1243,12 +1224,12 @@ void daylengthinsoleet(Climate& climate) {
 		}
 
 		// special case for polar night
-		if (climate.hh[date.day] < 0.001) {
+		if (geometry.hh[day] < 0.001) {
 			w = 0;
 		}
 		else {
-			w = climate.rad/2.0/(climate.u[date.day]*climate.hh[date.day]
-				+climate.v[date.day]*climate.sinehh[date.day])/K; // from Eqn 14
+			w = climate.rad/2.0/(geometry.u[day]*geometry.hh[day]
+				+geometry.v[day]*geometry.sinehh[day])/K; // from Eqn 14
 		}
 	}
 
@@ -1307,7 +1288,7 @@ void daylengthinsoleet(Climate& climate) {
 	//	(26) eet_day = 2 * ( s / (s + gamma) / lambda ) *
 	//	               ( uu*hn + vv*sin(hn) ) * k
 
-	double rl = (B + (1.0 - B) * (w / climate.qo[date.day] / (1.0 - BETA) - C) / D) *
+	double rl = (B + (1.0 - B) * (w / geometry.qo[day] / (1.0 - BETA) - C) / D) *
 				(A - climate.temp); // Eqn 19: instantaneous net upward longwave radiation flux (W/m2)
 
 	//	Calculate gamma and lambda
@@ -1317,8 +1298,8 @@ void daylengthinsoleet(Climate& climate) {
 	double ct = 237.3 + climate.temp;
 	double s = 2.503e6 * exp(17.269 * climate.temp / ct) / ct / ct;		// Eqn 16
 
-	double uu = w * climate.u[date.day] - rl;			// Eqn 20
-	double vv = w * climate.v[date.day];				// Eqn 21
+	double uu = w * geometry.u[day] - rl;			// Eqn 20
+	double vv = w * geometry.v[day];				// Eqn 21
 
 	// Calculate half-period with positive net radiation, hn
 	// In Eqn (25), hn defined for uu in range -vv to vv
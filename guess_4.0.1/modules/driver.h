@@ -35,6 +35,6 @@ void dailyaccounting_stand(Stand& stand);
 void dailyaccounting_patch(Patch& patch);
 void respiration_temperature_response(double temp,double& gtemp);
 void daylengthinsoleet(Climate& climate);
-void soiltemp(Climate& climate,Soil& soil);
+void soiltemp(const Climate& climate,Soil& soil);
 
 #endif // LPJ_GUESS_DRIVER_H
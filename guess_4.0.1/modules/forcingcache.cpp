@@ -0,0 +1,343 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file forcingcache.cpp
+/// \brief A binary file with forcing data stored one grid cell at a time
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "forcingcache.h"
+#include "shell.h"
+#include <string.h>
+
+#include <sys/stat.h>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+// File layout, everything in 8 byte words in the byte order of the machine
+// which wrote it:
+//
+//  - MAGIC and BYTE_ORDER_MARK, to detect files from machines with other byte order
+//  - number of variables, and for each variable: location size, modification
+//    time and size of the NetCDF file, length of file name, length of variable
+//    name, file name and variable name (padded with zeros to whole words)
+//  - the data for each location, all variables after each other
+//  - the index: x, y and offset of the data (0 if none) for each location
+//  - offset of the index, number of locations and MAGIC again, so an
+//    incomplete file can be detected
+
+namespace {
+
+const char MAGIC[8] = { 'G', 'U', 'E', 'S', 'S', 'F', 'C', '2' };
+
+/// Magic of the first version, without the NetCDF files' modification times and sizes
+const char OLD_MAGIC[8] = { 'G', 'U', 'E', 'S', 'S', 'F', 'C', '1' };
+
+const unsigned long long BYTE_ORDER_MARK = 0x0102030405060708ULL;
+
+const size_t WORD = 8;
+
+const size_t TRAILER_SIZE = 3 * WORD;
+
+/// Number of bytes needed for a string padded to whole words
+size_t padded_size(size_t length) {
+	return (length + WORD - 1) / WORD * WORD;
+}
+
+/// Reads a word from the cache, fails if it's beyond the end of the file
+unsigned long long read_word(const char* contents, size_t size, size_t& pos, const char* filename) {
+	if (pos + WORD > size) {
+		fail("Forcing cache %s is truncated", filename);
+	}
+
+	unsigned long long word;
+	memcpy(&word, contents + pos, WORD);
+	pos += WORD;
+	return word;
+}
+
+/// Reads a string from the cache, fails if it's beyond the end of the file
+std::string read_string(const char* contents, size_t size, size_t& pos, size_t length, const char* filename) {
+	if (pos + padded_size(length) > size) {
+		fail("Forcing cache %s is truncated", filename);
+	}
+
+	std::string result(contents + pos, length);
+	pos += padded_size(length);
+	return result;
+}
+
+}
+
+ForcingCache::ForcingCache(const char* filename)
+	: contents(0),
+	  size(0) {
+
+#ifdef _MSC_VER
+	FILE* file = fopen(filename, "rb");
+	if (!file) {
+		fail("Could not open forcing cache %s for input", filename);
+	}
+
+	char chunk[65536];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		buffer.insert(buffer.end(), chunk, chunk + n);
+	}
+	fclose(file);
+
+	size = buffer.size();
+	contents = size > 0 ? &buffer.front() : 0;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1) {
+		fail("Could not open forcing cache %s for input", filename);
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		fail("Could not get size of forcing cache %s", filename);
+	}
+	size = info.st_size;
+
+	if (size > 0) {
+		void* mapped = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapped == MAP_FAILED) {
+			::close(fd);
+			fail("Could not map forcing cache %s into memory", filename);
+		}
+		contents = (const char*)mapped;
+	}
+
+	// The mapping stays valid without the file descriptor
+	::close(fd);
+#endif
+
+	// Check the header and trailer
+
+	if (size >= WORD && memcmp(contents, OLD_MAGIC, WORD) == 0) {
+		fail("Forcing cache %s was written by an older version, it needs to be written again", filename);
+	}
+
+	if (size < 2 * WORD + TRAILER_SIZE ||
+	    memcmp(contents, MAGIC, WORD) != 0) {
+		fail("%s is not a forcing cache", filename);
+	}
+
+	size_t pos = WORD;
+	if (read_word(contents, size, pos, filename) != BYTE_ORDER_MARK) {
+		fail("Forcing cache %s was written on a machine with different byte order", filename);
+	}
+
+	if (memcmp(contents + size - WORD, MAGIC, WORD) != 0) {
+		fail("Forcing cache %s is incomplete, it needs to be written again", filename);
+	}
+
+	// The variables
+
+	const unsigned long long nvariables = read_word(contents, size, pos, filename);
+
+	size_t offset = 0;
+	for (unsigned long long i = 0; i < nvariables; ++i) {
+		Variable v;
+		v.location_size = read_word(contents, size, pos, filename);
+		v.file_mtime = (long long)read_word(contents, size, pos, filename);
+		v.file_size = (long long)read_word(contents, size, pos, filename);
+		const size_t file_length = read_word(contents, size, pos, filename);
+		const size_t variable_length = read_word(contents, size, pos, filename);
+		v.file = read_string(contents, size, pos, file_length, filename);
+		v.variable = read_string(contents, size, pos, variable_length, filename);
+
+		variables.push_back(v);
+		variable_offsets.push_back(offset);
+		offset += v.location_size;
+	}
+
+	// The index
+
+	size_t trailer = size - TRAILER_SIZE;
+	const unsigned long long index_offset = read_word(contents, size, trailer, filename);
+	const unsigned long long nlocations = read_word(contents, size, trailer, filename);
+
+	if (index_offset < pos || index_offset + nlocations * 3 * WORD != size - TRAILER_SIZE) {
+		fail("Forcing cache %s has an invalid index", filename);
+	}
+
+	const unsigned long long location_bytes = offset * sizeof(double);
+
+	pos = index_offset;
+	for (unsigned long long i = 0; i < nlocations; ++i) {
+		const int x = (int)(long long)read_word(contents, size, pos, filename);
+		const int y = (int)(long long)read_word(contents, size, pos, filename);
+		const unsigned long long data_offset = read_word(contents, size, pos, filename);
+
+		if (data_offset != 0 && data_offset + location_bytes > index_offset) {
+			fail("Forcing cache %s has an invalid index", filename);
+		}
+
+		locations[std::make_pair(x, y)] = data_offset;
+	}
+}
+
+ForcingCache::~ForcingCache() {
+#ifndef _MSC_VER
+	if (contents) {
+		munmap((void*)contents, size);
+	}
+#endif
+}
+
+const std::vector<ForcingCache::Variable>& ForcingCache::get_variables() const {
+	return variables;
+}
+
+int ForcingCache::find_variable(const std::string& file, const std::string& variable) const {
+	for (size_t i = 0; i < variables.size(); ++i) {
+		if (variables[i].file == file && variables[i].variable == variable) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+bool ForcingCache::is_up_to_date(int variable) const {
+	const Variable& v = variables[variable];
+
+	long long mtime, file_size;
+	return get_file_stamp(v.file, mtime, file_size) &&
+		mtime == v.file_mtime && file_size == v.file_size;
+}
+
+bool ForcingCache::get_file_stamp(const std::string& file, long long& mtime, long long& size) {
+	struct stat info;
+	if (stat(file.c_str(), &info) != 0) {
+		return false;
+	}
+	mtime = info.st_mtime;
+	size = info.st_size;
+	return true;
+}
+
+bool ForcingCache::has_data(int x, int y) const {
+	return find_location(x, y) != 0;
+}
+
+const double* ForcingCache::get_data(int x, int y, int variable) const {
+	const unsigned long long offset = find_location(x, y);
+	if (offset == 0) {
+		return 0;
+	}
+
+	// Data is always written at whole words from the start of the file,
+	// so it's properly aligned for doubles in the mapped memory
+	return (const double*)(contents + offset) + variable_offsets[variable];
+}
+
+size_t ForcingCache::get_locations() const {
+	return locations.size();
+}
+
+unsigned long long ForcingCache::find_location(int x, int y) const {
+	std::map<std::pair<int, int>, unsigned long long>::const_iterator itr =
+		locations.find(std::make_pair(x, y));
+
+	return itr == locations.end() ? 0 : itr->second;
+}
+
+
+ForcingCacheWriter::ForcingCacheWriter(const char* filename,
+                                       const std::vector<ForcingCache::Variable>& variables)
+	: filename(filename),
+	  written(0),
+	  variables(variables) {
+
+	file = fopen(filename, "wb");
+	if (!file) {
+		fail("Could not open %s for output", filename);
+	}
+
+	write(MAGIC, WORD);
+	write(&BYTE_ORDER_MARK, WORD);
+
+	const unsigned long long nvariables = variables.size();
+	write(&nvariables, WORD);
+
+	const char zeros[WORD] = { 0 };
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		const ForcingCache::Variable& v = variables[i];
+
+		const unsigned long long header[5] = { v.location_size,
+		                                       (unsigned long long)v.file_mtime,
+		                                       (unsigned long long)v.file_size,
+		                                       v.file.size(),
+		                                       v.variable.size() };
+		write(header, sizeof(header));
+
+		write(v.file.data(), v.file.size());
+		write(zeros, padded_size(v.file.size()) - v.file.size());
+
+		write(v.variable.data(), v.variable.size());
+		write(zeros, padded_size(v.variable.size()) - v.variable.size());
+	}
+}
+
+ForcingCacheWriter::~ForcingCacheWriter() {
+	if (file) {
+		close();
+	}
+}
+
+void ForcingCacheWriter::add_location(int x, int y, const std::vector<const double*>& data) {
+	if (data.size() != variables.size()) {
+		fail("ForcingCacheWriter::add_location: expected data for %d variables",
+		     (int)variables.size());
+	}
+
+	index.push_back(x);
+	index.push_back(y);
+	index.push_back(written);
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		write(data[i], variables[i].location_size * sizeof(double));
+	}
+}
+
+void ForcingCacheWriter::add_missing_location(int x, int y) {
+	index.push_back(x);
+	index.push_back(y);
+	index.push_back(0);
+}
+
+void ForcingCacheWriter::close() {
+	const unsigned long long trailer[2] = { written, index.size() / 3 };
+
+	if (!index.empty()) {
+		write(&index.front(), index.size() * WORD);
+	}
+	write(trailer, sizeof(trailer));
+	write(MAGIC, WORD);
+
+	if (fclose(file) != 0) {
+		file = 0;
+		fail("Failed to write %s", filename.c_str());
+	}
+	file = 0;
+}
+
+void ForcingCacheWriter::write(const void* data, size_t bytes) {
+	if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) {
+		fail("Failed to write %s", filename.c_str());
+	}
+	written += bytes;
+}
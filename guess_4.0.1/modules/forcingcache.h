@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file forcingcache.h
+/// \brief A binary file with forcing data stored one grid cell at a time
+///
+/// The forcing cache is written once from the NetCDF forcing files (see the
+/// guess_forcing_cache program) and can then be used instead of them by the
+/// input module, which saves reading and decompressing the NetCDF files for
+/// every run with the same forcing.
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_FORCINGCACHE_H
+#define LPJ_GUESS_FORCINGCACHE_H
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/// Read-only access to a forcing cache file
+/** The file is memory mapped, so the data for a location can be used
+ *  directly from the mapped file without copying it, and repeated runs
+ *  with the same forcing are served from the operating system's page cache.
+ *
+ *  The file contains a number of variables, each identified by the NetCDF
+ *  file and variable it was converted from, along with the modification
+ *  time and size the file had then (see is_up_to_date). For each location, the data
+ *  for all variables is stored together, and each variable's data is
+ *  laid out as in GuessNC::CF::GridcellOrderedVariable (all values for
+ *  the first timestep, then the next timestep and so on). The data is
+ *  already unpacked (scale_factor and add_offset applied).
+ *
+ *  Locations are identified with an (x,y)-pair of indices in the NetCDF
+ *  files, or for files with a reduced grid with the land id as x and 0 as y.
+ */
+class ForcingCache {
+public:
+	/// Describes one of the variables in the cache
+	struct Variable {
+		/// The NetCDF file the variable was read from
+		std::string file;
+
+		/// Name of the variable in the NetCDF file
+		std::string variable;
+
+		/// Number of values stored for each location
+		size_t location_size;
+
+		/// Modification time of the NetCDF file when it was converted (seconds since 1970)
+		long long file_mtime;
+
+		/// Size of the NetCDF file in bytes when it was converted
+		long long file_size;
+
+		Variable()
+			: location_size(0),
+			  file_mtime(0),
+			  file_size(0) {
+		}
+	};
+
+	/// Opens and maps a cache file, calls fail() if it isn't a valid cache
+	ForcingCache(const char* filename);
+
+	/// Unmaps the file
+	~ForcingCache();
+
+	/// The variables in the cache
+	const std::vector<Variable>& get_variables() const;
+
+	/// Finds a variable by the NetCDF file and variable it was converted from
+	/** \returns the variable's index, or -1 if it isn't in the cache */
+	int find_variable(const std::string& file, const std::string& variable) const;
+
+	/// Checks if a variable's NetCDF file is the same as when the cache was written
+	/** Compares the file's current modification time and size with the
+	 *  ones stored in the cache, a changed file means the cached data may
+	 *  be out of date.
+	 */
+	bool is_up_to_date(int variable) const;
+
+	/// Gets the modification time and size of a file, as stored for the variables
+	/** \returns false if the file can't be found */
+	static bool get_file_stamp(const std::string& file, long long& mtime, long long& size);
+
+	/// Checks if a location is in the cache and has data
+	/** Locations where the data couldn't be read, or had missing values,
+	 *  are in the cache but without data.
+	 */
+	bool has_data(int x, int y) const;
+
+	/// Gets the data for a variable at a location
+	/** \returns a pointer to location_size values in the mapped file, valid as
+	 *           long as the cache is open, or NULL if the location has no data.
+	 */
+	const double* get_data(int x, int y, int variable) const;
+
+	/// Number of locations in the cache (including those without data)
+	size_t get_locations() const;
+
+private:
+	/// Offset in bytes of a location's data from the start of the file, 0 if it has no data
+	unsigned long long find_location(int x, int y) const;
+
+	/// The mapped file
+	const char* contents;
+
+	/// Size of the file in bytes
+	size_t size;
+
+	std::vector<Variable> variables;
+
+	/// Offset of each variable's data within a location's data, in number of values
+	std::vector<size_t> variable_offsets;
+
+	/// Locations to offsets of their data, see find_location()
+	std::map<std::pair<int, int>, unsigned long long> locations;
+
+#ifdef _MSC_VER
+	/// The whole file, read into memory since there is no mmap on Windows
+	std::vector<char> buffer;
+#endif
+
+	// Not copyable
+	ForcingCache(const ForcingCache&);
+	ForcingCache& operator=(const ForcingCache&);
+};
+
+/// Writes a forcing cache file, see ForcingCache
+/** Locations are added one at a time, with the data for all variables. */
+class ForcingCacheWriter {
+public:
+	/// Creates the file, calls fail() if it can't be created
+	ForcingCacheWriter(const char* filename, const std::vector<ForcingCache::Variable>& variables);
+
+	/// Closes the file, if close() hasn't been called
+	~ForcingCacheWriter();
+
+	/// Adds a location with data for each variable
+	/** \param data Points to location_size values for each variable, in the
+	 *              same order as the variables were given to the constructor
+	 */
+	void add_location(int x, int y, const std::vector<const double*>& data);
+
+	/// Adds a location without any data
+	void add_missing_location(int x, int y);
+
+	/// Writes the index of locations and closes the file
+	void close();
+
+private:
+	/// Writes bytes to the file, calls fail() if that fails
+	void write(const void* data, size_t bytes);
+
+	FILE* file;
+
+	std::string filename;
+
+	/// Bytes written so far
+	unsigned long long written;
+
+	std::vector<ForcingCache::Variable> variables;
+
+	/// Index entries for the locations added so far
+	std::vector<long long> index;
+
+	// Not copyable
+	ForcingCacheWriter(const ForcingCacheWriter&);
+	ForcingCacheWriter& operator=(const ForcingCacheWriter&);
+};
+
+#endif // LPJ_GUESS_FORCINGCACHE_H
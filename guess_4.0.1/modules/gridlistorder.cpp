@@ -0,0 +1,131 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file gridlistorder.cpp
+/// \brief Orders for simulating the grid cells in a gridlist
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "gridlistorder.h"
+#include "shell.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+typedef unsigned long long CurveIndex;
+
+/// Distance along a Hilbert curve filling a square with side n (a power of two)
+CurveIndex hilbert_index(CurveIndex n, CurveIndex x, CurveIndex y) {
+	CurveIndex d = 0;
+	for (CurveIndex s = n / 2; s > 0; s /= 2) {
+		const CurveIndex rx = (x & s) > 0;
+		const CurveIndex ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+
+		// Rotate the quadrant so the curve continues from the previous one
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+/// Distance along a Morton curve, the bits of x and y interleaved
+CurveIndex morton_index(CurveIndex n, CurveIndex x, CurveIndex y) {
+	CurveIndex d = 0;
+	int bit = 0;
+	for (CurveIndex s = 1; s < n; s *= 2, bit += 2) {
+		d |= ((x & s) ? 1ULL : 0ULL) << bit;
+		d |= ((y & s) ? 2ULL : 0ULL) << bit;
+	}
+	return d;
+}
+
+/// Sorts the positions of points by their index along a curve
+template<typename Curve>
+std::vector<int> curve_order(const std::vector<std::pair<int, int> >& points, Curve curve) {
+
+	if (points.empty()) {
+		return std::vector<int>();
+	}
+
+	// Move the points to start at (0,0) and find the smallest square covering them
+
+	int min_x = std::numeric_limits<int>::max();
+	int min_y = std::numeric_limits<int>::max();
+	int max_x = std::numeric_limits<int>::min();
+	int max_y = std::numeric_limits<int>::min();
+
+	for (size_t i = 0; i < points.size(); ++i) {
+		min_x = std::min(min_x, points[i].first);
+		min_y = std::min(min_y, points[i].second);
+		max_x = std::max(max_x, points[i].first);
+		max_y = std::max(max_y, points[i].second);
+	}
+
+	const CurveIndex extent = std::max((CurveIndex)((long long)max_x - min_x),
+	                                   (CurveIndex)((long long)max_y - min_y)) + 1;
+	CurveIndex n = 1;
+	while (n < extent) {
+		n *= 2;
+	}
+
+	std::vector<std::pair<CurveIndex, int> > indices(points.size());
+	for (size_t i = 0; i < points.size(); ++i) {
+		indices[i].first = curve(n,
+		                         (CurveIndex)((long long)points[i].first - min_x),
+		                         (CurveIndex)((long long)points[i].second - min_y));
+		indices[i].second = (int)i;
+	}
+
+	// Sorting the pairs keeps equal points in gridlist order
+	std::sort(indices.begin(), indices.end());
+
+	std::vector<int> order(points.size());
+	for (size_t i = 0; i < indices.size(); ++i) {
+		order[i] = indices[i].second;
+	}
+	return order;
+}
+
+}
+
+namespace GridlistOrder {
+
+std::vector<int> hilbert_order(const std::vector<std::pair<int, int> >& points) {
+	return curve_order(points, hilbert_index);
+}
+
+std::vector<int> morton_order(const std::vector<std::pair<int, int> >& points) {
+	return curve_order(points, morton_index);
+}
+
+std::vector<int> simulation_order(const std::string& name,
+                                  const std::vector<std::pair<int, int> >& points) {
+	if (name == "file") {
+		return std::vector<int>();
+	}
+	else if (name == "hilbert") {
+		return hilbert_order(points);
+	}
+	else if (name == "morton") {
+		return morton_order(points);
+	}
+	else {
+		fail("Unknown gridlist_order: %s (should be file, hilbert or morton)", name.c_str());
+		return std::vector<int>();
+	}
+}
+
+}
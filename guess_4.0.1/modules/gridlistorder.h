@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file gridlistorder.h
+/// \brief Orders for simulating the grid cells in a gridlist
+///
+/// The input modules reading gridcell ordered NetCDF files (CFInput, SPInput)
+/// can simulate the gridlist in a different order than it's given in, so that
+/// grid cells close to each other in the files are read one after the other.
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_GRIDLISTORDER_H
+#define LPJ_GUESS_GRIDLISTORDER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace GridlistOrder {
+
+/// Orders points along a Hilbert curve
+/** \returns the positions in points, in the order they come along the curve.
+ *           Equal points keep their order from points.
+ */
+std::vector<int> hilbert_order(const std::vector<std::pair<int, int> >& points);
+
+/// Orders points along a Morton (Z-order) curve
+/** \returns the positions in points, in the order they come along the curve.
+ *           Equal points keep their order from points.
+ */
+std::vector<int> morton_order(const std::vector<std::pair<int, int> >& points);
+
+/// Gets the order given by a gridlist_order parameter
+/** Calls fail() if the name isn't "file", "hilbert" or "morton".
+ *
+ *  \param name    Value of the gridlist_order parameter
+ *  \param points  Index coordinates in the NetCDF files for each entry in the
+ *                 gridlist, (rlon, rlat) or for reduced grids (landid, 0)
+ *  \returns the gridlist positions in the order to simulate them, or an empty
+ *           vector for simulating the gridlist in the order it was given
+ */
+std::vector<int> simulation_order(const std::string& name,
+                                  const std::vector<std::pair<int, int> >& points);
+
+}
+
+#endif // LPJ_GUESS_GRIDLISTORDER_H
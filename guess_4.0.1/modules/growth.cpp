@@ -335,11 +335,12 @@ void reproduction(double reprfrac, double npp, double& bminc, double& cmass_repr
 // for a new individual.
 
 // File scope global variables: used by function f below (see function allocation)
+// (thread local since grid cells may be simulated in parallel)
 
-static double k1, k2, k3, b;
-static double ltor_g;
-static double cmass_heart_g;
-static double cmass_leaf_g;
+static thread_local double k1, k2, k3, b;
+static thread_local double ltor_g;
+static thread_local double cmass_heart_g;
+static thread_local double cmass_leaf_g;
 
 inline double f(double& cmass_leaf_inc) {
 
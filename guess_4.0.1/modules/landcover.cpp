@@ -74,9 +74,8 @@ void landcover_init(Gridcell& gridcell, InputModule* input_module) {
 	// get landcover and crop area fractions from landcover input file(s) or ins-file.
 	input_module->getlandcover(gridcell);
 
-	stlist.firstobj();
-	while (stlist.isobj) {
-		StandType& st = stlist.getobj();
+	for (int s = 0; s < nst; s++) {
+		StandType& st = stlist[s];
 		Gridcellst& gcst = gridcell.st[st.id];
 
 		gcst.frac_old = gcst.frac;
@@ -85,7 +84,6 @@ void landcover_init(Gridcell& gridcell, InputModule* input_module) {
 			gridcell.create_stand_lu(st, gcst.frac);
 		}
 
-		stlist.nextobj();
 	}
 }
 
@@ -1285,9 +1283,8 @@ void donor_stand_change(Gridcell& gridcell, double& receiving_fraction, landcove
  */
 void stand_dynamics(Gridcell& gridcell) {
 
-	stlist.firstobj();
-	while (stlist.isobj) {
-		StandType& st=stlist.getobj();
+	for (int s = 0; s < nst; s++) {
+		StandType& st=stlist[s];
 		Gridcellst& gcst = gridcell.st[st.id];
 		landcovertype lc = st.landcover;
 
@@ -1341,7 +1338,6 @@ void stand_dynamics(Gridcell& gridcell) {
 			}
 		}
 
-		stlist.nextobj();
 	}
 }
 
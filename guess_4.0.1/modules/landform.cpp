@@ -23,6 +23,7 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <math.h>
 
 void check_same_spatial_domains(const std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> variables) {
 	
@@ -39,10 +40,6 @@ using namespace GuessNC::CF;
 
 namespace {
 
-	bool is_null_NoTime(const GuessNC::CF::GridcellOrderedVariableNoTime* ptr) {
-		return ptr == 0;
-	}
-
 	// Verifies that a NC variable with sand data contains what we expect
 	void check_sand_variable(const GuessNC::CF::GridcellOrderedVariableNoTime* nc_var) {
 		if (nc_var->get_standard_name() != "sand") {
@@ -160,41 +157,98 @@ namespace {
 	}
 	 */
 	
+	// Key for a grid cell in the landform and site tables, the land id for
+	// files with a reduced grid, otherwise made from the coordinates
+	// (to 1e-4 degrees, the files are expected to use the same grid as the forcing)
+	long long table_key(bool reduced, double lon, double lat, int landid) {
+		if (reduced) {
+			return landid;
+		}
+		return llround((lon + 360) * 1e4) * 10000000LL + llround((lat + 90) * 1e4);
+	}
+
+	// Gets all locations in a variable's file, as (x,y)-pairs or (landid,0)
+	std::vector<std::pair<size_t, size_t> > all_locations(const GridcellOrderedVariableNoTime* nc_var) {
+		std::vector<std::pair<size_t, size_t> > result;
+
+		if (nc_var->is_reduced()) {
+			for (size_t landid = 0; nc_var->location_exists(landid); ++landid) {
+				result.push_back(std::make_pair(landid, size_t(0)));
+			}
+		}
+		else {
+			for (size_t x = 0; nc_var->location_exists(x, 0); ++x) {
+				for (size_t y = 0; nc_var->location_exists(x, y); ++y) {
+					result.push_back(std::make_pair(x, y));
+				}
+			}
+		}
+		return result;
+	}
+
+	// Loads data for all variables for a location, stops at the first one that fails
+	bool load_data_for(const std::vector<GridcellOrderedVariableNoTime*>& variables,
+	                   size_t x, size_t y) {
+		for (size_t i = 0; i < variables.size(); ++i) {
+			const bool ok = variables[i]->is_reduced() ?
+				variables[i]->load_data_for(x) : variables[i]->load_data_for(x, y);
+			if (!ok) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Gets the table key for a location, see table_key()
+	long long location_key(const GridcellOrderedVariableNoTime* nc_var, size_t x, size_t y) {
+		if (nc_var->is_reduced()) {
+			return table_key(true, 0, 0, (int)x);
+		}
+
+		double lon, lat;
+		nc_var->get_coords_for(x, y, lon, lat);
+		return table_key(false, lon, lat, 0);
+	}
+
+	// Deletes the variables when going out of scope
+	struct VariableList : std::vector<GridcellOrderedVariableNoTime*> {
+		~VariableList() {
+			for (size_t i = 0; i < size(); ++i) {
+				delete (*this)[i];
+			}
+		}
+	};
 }
 // cw SubPixel - Site Input Class
 
-SiteInput::SiteInput() {}
+SiteInput::SiteInput()
+	: reduced(false) {}
 
-SiteInput::~SiteInput() {
-	delete nc_elevation;
-	delete nc_sand;
-	delete nc_silt;
-	delete nc_clay;
-	delete nc_soc;
-	delete nc_soildepth;
-	
-	nc_elevation = 0;
-	nc_sand = 0;
-	nc_silt = 0;
-	nc_clay = 0;
-	nc_soc = 0;
-	nc_elevation = 0;
-}
+SiteInput::~SiteInput() {}
 
 
 void SiteInput::init() {
+	// The variables are only needed while reading the file
+	VariableList variables;
+
 	// Try to open the NetCDF files
 	try {
-		nc_elevation = new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_elevation"].str);
-		nc_sand = new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_sand"].str);
-		nc_silt = new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_silt"].str);
-		nc_clay = new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_clay"].str);
-		nc_soc = new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_soc"].str);
-		// nc_soildepth = new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_soildepth"].str);
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_elevation"].str));
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_sand"].str));
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_silt"].str));
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_clay"].str));
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_soc"].str));
+		// variables.push_back(new GridcellOrderedVariableNoTime(param["file_site"].str, param["variable_soildepth"].str));
 	}
 	catch (const std::runtime_error& e) {
 		fail(e.what());
 	}
+
+	GridcellOrderedVariableNoTime* nc_elevation = variables[0];
+	GridcellOrderedVariableNoTime* nc_sand = variables[1];
+	GridcellOrderedVariableNoTime* nc_silt = variables[2];
+	GridcellOrderedVariableNoTime* nc_clay = variables[3];
+	GridcellOrderedVariableNoTime* nc_soc = variables[4];
 	
 	// Make sure they contain what we expect
 	
@@ -210,55 +264,64 @@ void SiteInput::init() {
 	
 	//check_soildepth_variable(nc_soildepth);
 
-	check_same_spatial_domains(all_variables());
+	check_same_spatial_domains(variables);
 
+	// Read the whole file into the table
+	try {
+		for (size_t i = 0; i < variables.size(); ++i) {
+			variables[i]->load_all_data();
+		}
+
+		reduced = nc_sand->is_reduced();
+
+		const std::vector<std::pair<size_t, size_t> > locations = all_locations(nc_sand);
+		for (size_t i = 0; i < locations.size(); ++i) {
+			if (!load_data_for(variables, locations[i].first, locations[i].second)) {
+				continue;
+			}
+
+			Site& s = table[location_key(nc_sand, locations[i].first, locations[i].second)];
+			s.elevation = nc_elevation->get_value();
+			s.sand = nc_sand->get_value();
+			s.silt = nc_silt->get_value();
+			s.clay = nc_clay->get_value();
+			s.soc = nc_soc->get_value();
+			// this will be enabled later
+			// s.soildepth = nc_soildepth->get_value();
+		}
+	}
+	catch (const std::runtime_error& e) {
+		fail(e.what());
+	}
 }
 
 bool SiteInput::loadsite(double lon, double lat, int landid){
+	const bool found = find_site(lon, lat, landid, site);
+	print_site(found, lon, lat, landid, site);
+	return found;
+};
+
+
+void SiteInput::print_site(bool found, double lon, double lat, int landid, const Site& result) const {
 	dprintf("\nAttempting to load Site NC data\n");
-	// Try to load the data from the NetCDF files
-	if (nc_sand->is_reduced()) {
-		if (!nc_sand->load_data_for(landid) ||
-			!nc_elevation->load_data_for(landid) ||
-			!nc_silt->load_data_for(landid) ||
-			!nc_clay->load_data_for(landid) ||
-			!nc_soc->load_data_for(landid)
-			//!nc_soildepth->load_data_for(landid)
-			) {
+
+	if (!found) {
+		if (reduced) {
 			dprintf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
-			return false;
 		}
-	}
-	else {
-		if (!nc_elevation->load_data_for(lat, lon) ||
-			!nc_sand->load_data_for(lat, lon) ||
-			!nc_silt->load_data_for(lat, lon) ||
-			!nc_clay->load_data_for(lat, lon) ||
-			!nc_soc->load_data_for(lat, lon)
-			//!nc_soildepth->load_data_for(lat, lon)
-			) {
-			dprintf("Failed to load data for (%d, %d) from NetCDF files, skipping.\n", lon, lat);
-			return false;
+		else {
+			dprintf("Failed to load data for (%g, %g) from NetCDF files, skipping.\n", lon, lat);
 		}
+		return;
 	}
 	
-	site.elevation = nc_elevation->get_value();
-	site.sand = nc_sand->get_value();
-	site.silt = nc_silt->get_value();
-	site.clay = nc_clay->get_value();
-	site.soc = nc_soc->get_value();
-	// this will be enabled later
-	// site.soildepth = nc_soildepth->get_value();
-	
-	dprintf("\n SITE elevation: %g\n", site.elevation);
-	dprintf("           sand: %g\n", site.sand);
-	dprintf("           silt: %g\n", site.silt);
-	dprintf("           clay: %g\n", site.clay);
-	dprintf("            soc: %g\n", site.soc);
-	dprintf("     soil depth: %g\n", site.soildepth);
-	
-	return true;
-};
+	dprintf("\n SITE elevation: %g\n", result.elevation);
+	dprintf("           sand: %g\n", result.sand);
+	dprintf("           silt: %g\n", result.silt);
+	dprintf("           clay: %g\n", result.clay);
+	dprintf("            soc: %g\n", result.soc);
+	dprintf("     soil depth: %g\n", result.soildepth);
+}
 
 
 Site SiteInput::get_site() const{
@@ -266,21 +329,14 @@ Site SiteInput::get_site() const{
 };
 
 
-std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> SiteInput::all_variables() const {
-	std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> result;
-	result.push_back(nc_elevation);
-	result.push_back(nc_sand);
-	result.push_back(nc_silt);
-	result.push_back(nc_clay);
-	result.push_back(nc_soc);
-	// this will be enabled later
-	//result.push_back(nc_soildepth);
-	
-	// Get rid of null pointers
-	result.erase(std::remove_if(result.begin(), result.end(), is_null_NoTime),
-				 result.end());
-	
-	return result;
+bool SiteInput::find_site(double lon, double lat, int landid, Site& result) const {
+	std::unordered_map<long long, Site>::const_iterator itr = table.find(table_key(reduced, lon, lat, landid));
+	if (itr == table.end()) {
+		return false;
+	}
+
+	result = itr->second;
+	return true;
 }
 
 
@@ -288,47 +344,36 @@ std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> SiteInput::all_variable
 
 
 LandformInput::LandformInput()
-	: nc_fraction(0),
-	nc_elevation(0),
-	nc_slope(0),
-    nc_aspect(0),
-    nc_asp_slope(0),
-	nc_soildepth(0) {}
+	: reduced(false) {}
 	
-LandformInput::~LandformInput() {
-	delete nc_fraction;
-	delete nc_elevation;
-	delete nc_slope;
-    delete nc_aspect;
-    delete nc_asp_slope;
-	delete nc_soildepth;
-	
-	nc_fraction = 0;
-	nc_elevation = 0;
-	nc_slope = 0;
-    nc_aspect = 0;
-    nc_asp_slope = 0;
-	nc_soildepth = 0;
-}
+LandformInput::~LandformInput() {}
 	
 void LandformInput::init() {
 	
 	if(!run_landform)
 		return;
 	
+	// The variables are only needed while reading the file
+	VariableList variables;
 	
 	// Try to open the NetCDF files
 	try {
-		nc_fraction = new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_fraction"].str);
-		nc_elevation = new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_elevation"].str);
-		nc_slope = new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_slope"].str);
-        nc_aspect = new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_aspect"].str);
-        nc_asp_slope = new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_asp_slope"].str);
-        //nc_soildepth = new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_soildepth"].str);
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_fraction"].str));
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_elevation"].str));
+		variables.push_back(new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_slope"].str));
+        variables.push_back(new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_aspect"].str));
+        variables.push_back(new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_asp_slope"].str));
+        //variables.push_back(new GridcellOrderedVariableNoTime(param["file_landform"].str, param["variable_soildepth"].str));
 	}
 	catch (const std::runtime_error& e) {
 		fail(e.what());
 	}
+
+	GridcellOrderedVariableNoTime* nc_fraction = variables[0];
+	GridcellOrderedVariableNoTime* nc_elevation = variables[1];
+	GridcellOrderedVariableNoTime* nc_slope = variables[2];
+	GridcellOrderedVariableNoTime* nc_aspect = variables[3];
+	GridcellOrderedVariableNoTime* nc_asp_slope = variables[4];
 	
 	// Make sure they contain what we expect
 	
@@ -344,185 +389,213 @@ void LandformInput::init() {
     
 	//check_soildepth_variable(nc_soildepth);
 	
-	check_same_spatial_domains(all_variables());
+	check_same_spatial_domains(variables);
+
+	// Read the whole file, keeping the valid landforms of each grid cell
+	try {
+		for (size_t i = 0; i < variables.size(); ++i) {
+			variables[i]->load_all_data();
+		}
+
+		reduced = nc_fraction->is_reduced();
+
+		// derive lf_ids, classification and stwp_width from netcdf file
+		std::vector<int> lf_ids;
+		nc_elevation->get_landforms(lf_ids);
+
+		// not required atm
+		// std::string lgt_classification;
+		// int lgt_stepwidth;
+		// nc_elevation->get_lgt_classification(lgt_classification);
+		// nc_elevation->get_lgt_elevation_step(lgt_stepwidth);
+
+		const std::vector<std::pair<size_t, size_t> > locations = all_locations(nc_fraction);
+		for (size_t l = 0; l < locations.size(); ++l) {
+			if (!load_data_for(variables, locations[l].first, locations[l].second)) {
+				continue;
+			}
+
+			std::vector<double> fraction;
+			std::vector<double> slope;
+			std::vector<double> avg_aspect;
+			std::vector<double> asp_slope;
+			std::vector<double> elevation;
+			std::vector<bool> lf_valid;
+
+			nc_elevation->get_values(elevation, lf_valid);
+			nc_fraction->get_values(fraction);
+			nc_slope->get_values(slope);
+			nc_asp_slope->get_values(asp_slope);
+			nc_aspect->get_values(avg_aspect);
+
+			const size_t first = records.size();
+			for (size_t i = 0; i < lf_ids.size(); i++) {
+				if (lf_valid[i]) {
+					LandformRecord record;
+					record.id = lf_ids[i];
+					record.fraction = fraction[i];
+					record.elevation = elevation[i];
+					record.avg_aspect = avg_aspect[i];
+					record.slope = slope[i];
+					record.asp_slope = asp_slope[i];
+					records.push_back(record);
+				}
+			}
+
+			table[location_key(nc_fraction, locations[l].first, locations[l].second)] =
+				std::make_pair(first, records.size() - first);
+		}
+	}
+	catch (const std::runtime_error& e) {
+		fail(e.what());
+	}
 }
 
 	
 bool LandformInput::loadlandform(double lon, double lat, int landid) {
 	
-	// Try to load the data from the NetCDF files
+	// Look up the landforms read from the NetCDF files
+	const bool found = find_landforms(lon, lat, landid, landforms);
+	print_landforms(found, lon, lat, landid, landforms);
+	return found;
+}
+
+
+void LandformInput::print_landforms(bool found, double lon, double lat, int landid,
+                                    const std::vector<Landform>& result) const {
 	dprintf("\nAttempting to load Landform NC data\n");
 
-	if (nc_fraction->is_reduced()) {
-		if (!nc_fraction->load_data_for(landid) ||
-			!nc_elevation->load_data_for(landid) ||
-			!nc_slope->load_data_for(landid) ||
-            !nc_aspect->load_data_for(landid) ||
-            !nc_asp_slope->load_data_for(landid)
-			//!nc_soildepth->load_data_for(landid)
-			) {
+	if (!found) {
+		if (reduced) {
 			dprintf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
-			return false;
 		}
-	}
-	else {
-		if (!nc_fraction->load_data_for(lon, lat) ||
-			!nc_elevation->load_data_for(lon, lat) ||
-            !nc_slope->load_data_for(lon, lat) ||
-            !nc_aspect->load_data_for(lon, lat) ||
-            !nc_asp_slope->load_data_for(lon, lat)
-			//!nc_soildepth->load_data_for(lon, lat)
-			) {
-			dprintf("Failed to load data for (%d, %d) from NetCDF files, skipping.\n", lon, lat);
-			return false;
+		else {
+			dprintf("Failed to load data for (%g, %g) from NetCDF files, skipping.\n", lon, lat);
 		}
+		return;
 	}
-	
-	std::vector<int> lf_ids;
-	std::vector<aspect_type> aspect;
-  std::vector<slopepos_type> slopepos;
-
-	std::vector<double> fraction;
-  std::vector<double> slope;
-  std::vector<double> avg_aspect;
-  std::vector<double> asp_slope;
-  std::vector<double> elevation;
-	std::vector<bool> lf_valid;
-	
-	nc_elevation->get_values(elevation, lf_valid);
-	nc_fraction->get_values(fraction);
-	nc_slope->get_values(slope);
-  nc_asp_slope->get_values(asp_slope);
-  nc_aspect->get_values(avg_aspect);
-
-  // derive lf_ids, classification and stwp_width from netcdf file
-  nc_elevation->get_landforms(lf_ids);
-    
-  // not required atm
-  // std::string lgt_classification;
-  // int lgt_stepwidth;
-  // nc_elevation->get_lgt_classification(lgt_classification);
-  // nc_elevation->get_lgt_elevation_step(lgt_stepwidth);
 
-	aspect_type aspect_lookup[] = {NOASPECT, NORTH, EAST, SOUTH, WEST};
-    
-	// loop over possible landforms
-	landforms.clear();
-	int _cnt(1);
-	for (size_t i = 0; i < lf_ids.size(); i++){
-		if (lf_valid[i]){
-			Landform lf;
-			lf.id = lf_ids[i];
-            
-      int aspect_class = lf.id % 10;       // aspect class = last digit
-      int slope_class = (lf.id / 10) % 10; // slope class = second last digit
-      // int elevation_class = lf.id / 100;   // elevation class = front digits
-
-			lf.aspect = aspect_lookup[aspect_class];
-			lf.elevation = elevation[i];
-			lf.fraction = fraction[i];
-            lf.avg_aspect = avg_aspect[i];
-			lf.slope = slope[i];
-            lf.asp_slope = asp_slope[i];
-
-            // mod lower soil layer depth according to landform (slope component)
-            //
-            // 1 (hilltop) * 0.25 -> 0.75
-            // 2 (upslope) * 0.33 ? -> 1m
-            // 3 (mid-slope) * 0.5 -> 1m
-            // 4 (mesa/ flat) * 1 -> 1.5m (orig)
-            // 5 (low-slope) * 1.25 -> 1.75m
-            // 6 (valley) * 1.5  -> 2m
-            switch (slope_class) {
-                case RIDGE:
-                    lf.soildepth_lower_mod = 0.25;
-                    lf.avg_aspect = -1;
-                    break;
-                case UPSLOPE:
-                    lf.soildepth_lower_mod = 0.33; break;
-                case MIDSLOPE:
-                    lf.soildepth_lower_mod = 0.5; break;
-                case FLAT:
-                    lf.soildepth_lower_mod = 1.0;
-                    lf.avg_aspect = -1;
-                    // deepwater
-                    if(ifdeepwater) {
-                        lf.has_deepwater = true;
-                    }
-                    break;
-                case DOWNSLOPE:
-                    lf.soildepth_lower_mod = 1.25;
-                    // deepwater
-                    if(ifdeepwater) {
-                        lf.has_deepwater = true;
-                    }
-                    break;
-                case VALLEY:
-                    lf.soildepth_lower_mod = 1.5;
-                    lf.avg_aspect = -1;
-                    
-                    // deepwater
-                    if(ifdeepwater) {
-                        lf.has_deepwater = true;
-                    }
-                    break;
-                default:
-                    lf.soildepth_lower_mod = 1.0;
-                    lf.avg_aspect = -1;
-                    break;
-            }
-            
-            if (sp_modifysoildepth == false) lf.soildepth_lower_mod = 1.0;
-			landforms.push_back(lf);
+	// The first one is the standard landform, see find_landforms
+	for (size_t i = 1; i < result.size(); i++) {
+		const Landform& lf = result[i];
+
+		dprintf("\n LANDFORM id: %d (%d)\n", (int)i, lf.id);
+		dprintf("      aspect: %d\n", lf.aspect);
+		dprintf("   elevation: %g\n", lf.elevation);
+		dprintf("    fraction: %g\n", lf.fraction);
+		dprintf("      aspect: %g\n", lf.avg_aspect);
+		dprintf("       slope: %g\n", lf.slope);
+		dprintf(" (asp) slope: %g\n", lf.asp_slope);
+		dprintf("   soildepth: %g\n", (SOILDEPTH_UPPER + SOILDEPTH_LOWER * lf.soildepth_lower_mod));
+	}
+}
 
-			dprintf("\n LANDFORM id: %d (%d)\n", _cnt, lf.id);
-			dprintf("      aspect: %d\n", lf.aspect);
-			dprintf("   elevation: %g\n", lf.elevation);
-			dprintf("    fraction: %g\n", lf.fraction);
-            dprintf("      aspect: %g\n", lf.avg_aspect);
-			dprintf("       slope: %g\n", lf.slope);
-            dprintf(" (asp) slope: %g\n", lf.asp_slope);
-            dprintf("   soildepth: %g\n", (SOILDEPTH_UPPER + SOILDEPTH_LOWER * lf.soildepth_lower_mod));
 
-			_cnt += 1;
-		}
+std::vector<Landform> LandformInput::get_landforms() const {
+	return landforms;
+}
+
+
+bool LandformInput::find_landforms(double lon, double lat, int landid, std::vector<Landform>& result) const {
+	std::unordered_map<long long, std::pair<size_t, size_t> >::const_iterator itr =
+		table.find(table_key(reduced, lon, lat, landid));
+	if (itr == table.end()) {
+		return false;
+	}
+
+	result.clear();
+
+	// f_js_20171110 standard/unmodified landform at landform position 0
+	Landform lf;
+	lf.id = 0;
+	lf.aspect     = NOASPECT;
+	lf.elevation  = -9999.0;
+	lf.fraction   = 0.0;
+	lf.avg_aspect = 0.0;
+	lf.slope      = 0.0;
+	lf.asp_slope  = 0.0;
+	lf.soildepth_lower_mod = 1.0;
+	lf.avg_aspect = -1;
+	result.push_back(lf);
+
+	const size_t first = itr->second.first;
+	const size_t count = itr->second.second;
+	for (size_t i = first; i < first + count; i++) {
+		result.push_back(make_landform(records[i]));
 	}
 
-  // f_js_20171110 standard/unmodified landform at landform position 0
-  Landform lf;
-  lf.id = 0;
-  lf.aspect     = aspect_lookup[0];
-  lf.elevation  = -9999.0;
-  lf.fraction   = 0.0;
-  lf.avg_aspect = 0.0;
-  lf.slope      = 0.0;
-  lf.asp_slope  = 0.0;
-  lf.soildepth_lower_mod = 1.0;
-  lf.avg_aspect = -1;
-  landforms.insert(landforms.begin(), lf);
-  
 	return true;
 }
 
 
-std::vector<Landform> LandformInput::get_landforms() const {
-	return landforms;
-}
+Landform LandformInput::make_landform(const LandformRecord& record) {
 
-std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> LandformInput::all_variables() const {
-	std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> result;
-	result.push_back(nc_fraction);
-	result.push_back(nc_elevation);
-	result.push_back(nc_slope);
-    result.push_back(nc_aspect);
-    result.push_back(nc_asp_slope);
-	result.push_back(nc_soildepth);
-	
-	// Get rid of null pointers
-	result.erase(std::remove_if(result.begin(), result.end(), is_null_NoTime),
-				 result.end());
-	
-	return result;
+	aspect_type aspect_lookup[] = {NOASPECT, NORTH, EAST, SOUTH, WEST};
+
+	Landform lf;
+	lf.id = record.id;
+            
+	int aspect_class = lf.id % 10;       // aspect class = last digit
+	int slope_class = (lf.id / 10) % 10; // slope class = second last digit
+	// int elevation_class = lf.id / 100;   // elevation class = front digits
+
+	lf.aspect = aspect_lookup[aspect_class];
+	lf.elevation = record.elevation;
+	lf.fraction = record.fraction;
+	lf.avg_aspect = record.avg_aspect;
+	lf.slope = record.slope;
+	lf.asp_slope = record.asp_slope;
+
+	// mod lower soil layer depth according to landform (slope component)
+	//
+	// 1 (hilltop) * 0.25 -> 0.75
+	// 2 (upslope) * 0.33 ? -> 1m
+	// 3 (mid-slope) * 0.5 -> 1m
+	// 4 (mesa/ flat) * 1 -> 1.5m (orig)
+	// 5 (low-slope) * 1.25 -> 1.75m
+	// 6 (valley) * 1.5  -> 2m
+	switch (slope_class) {
+		case RIDGE:
+			lf.soildepth_lower_mod = 0.25;
+			lf.avg_aspect = -1;
+			break;
+		case UPSLOPE:
+			lf.soildepth_lower_mod = 0.33; break;
+		case MIDSLOPE:
+			lf.soildepth_lower_mod = 0.5; break;
+		case FLAT:
+			lf.soildepth_lower_mod = 1.0;
+			lf.avg_aspect = -1;
+			// deepwater
+			if(ifdeepwater) {
+				lf.has_deepwater = true;
+			}
+			break;
+		case DOWNSLOPE:
+			lf.soildepth_lower_mod = 1.25;
+			// deepwater
+			if(ifdeepwater) {
+				lf.has_deepwater = true;
+			}
+			break;
+		case VALLEY:
+			lf.soildepth_lower_mod = 1.5;
+			lf.avg_aspect = -1;
+
+			// deepwater
+			if(ifdeepwater) {
+				lf.has_deepwater = true;
+			}
+			break;
+		default:
+			lf.soildepth_lower_mod = 1.0;
+			lf.avg_aspect = -1;
+			break;
+	}
+
+	if (sp_modifysoildepth == false) lf.soildepth_lower_mod = 1.0;
+
+	return lf;
 }
 
 
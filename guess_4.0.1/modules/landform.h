@@ -17,65 +17,85 @@
 #include "guess.h"
 #include "guessnc.h"
 #include "inputmodule.h"
+#include <unordered_map>
 
 /// Class that deals with landform input
+/** All landforms in the landform file are read into memory in init(), so
+ *  looking up the landforms for a grid cell makes no NetCDF calls.
+ */
 class LandformInput {
 
 public:
 	LandformInput();
 	~LandformInput();
     
-	/// Opens landform data files
+	/// Reads the landform data files
 	void init();
 	/// Loads landform info (elevation, slope, aspect, soil depth from input files)
 	bool loadlandform(double lat, double lon, int landid);
 	/// get landform(s) for gridcell
 	std::vector<Landform> get_landforms() const;
+	/// Gets the landforms for a grid cell, doesn't change the object
+	/** \returns false if the grid cell isn't in the landform file */
+	bool find_landforms(double lon, double lat, int landid, std::vector<Landform>& result) const;
+	/// Prints what loadlandform() prints about a grid cell, for a result from find_landforms()
+	void print_landforms(bool found, double lon, double lat, int landid,
+	                     const std::vector<Landform>& result) const;
     
 private:
-	xtring file_landform;
-    
-	// The Variables
-	GuessNC::CF::GridcellOrderedVariableNoTime* nc_fraction;
-	GuessNC::CF::GridcellOrderedVariableNoTime* nc_elevation;
-	GuessNC::CF::GridcellOrderedVariableNoTime* nc_slope;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_aspect;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_asp_slope;
-	GuessNC::CF::GridcellOrderedVariableNoTime* nc_soildepth;
-    
-	/// \returns all (used) variables
-	std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> all_variables() const;
+	/// The values read from the file for one landform in a grid cell
+	struct LandformRecord {
+		int id;
+		double fraction;
+		double elevation;
+		double avg_aspect;
+		double slope;
+		double asp_slope;
+	};
+
+	/// Sets up a landform from the values read from the file
+	static Landform make_landform(const LandformRecord& record);
+
+	/// Whether the file has a reduced grid
+	bool reduced;
+
+	/// The valid landforms of all grid cells, one grid cell after the other
+	std::vector<LandformRecord> records;
+
+	/// First record and number of records for each grid cell
+	std::unordered_map<long long, std::pair<size_t, size_t> > table;
+
 	std::vector<Landform> landforms;
 };
 
 
 /// Class that deals with site input (gridcell specific elevation, soil properties etc.)
+/** As for LandformInput, the whole site file is read in init(). */
 class SiteInput {
 
 public:
     SiteInput();
     ~SiteInput();
 
-	/// Opens site data file
+	/// Reads the site data file
 	void init();
 	/// Loads site info (soil properties, soil depth and elevation)
 	bool loadsite(double lon, double lat, int landid);
 	/// Get site info for a stand
 	Site get_site() const;
+	/// Gets the site info for a grid cell, doesn't change the object
+	/** \returns false if the grid cell isn't in the site file */
+	bool find_site(double lon, double lat, int landid, Site& result) const;
+	/// Prints what loadsite() prints about a grid cell, for a result from find_site()
+	void print_site(bool found, double lon, double lat, int landid, const Site& result) const;
 	
 private:
-    xtring file_site;
-	
-    // The Variables
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_elevation;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_sand;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_silt;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_clay;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_soc;
-    GuessNC::CF::GridcellOrderedVariableNoTime* nc_soildepth;
-    
-    /// \returns all (used) variables
-    std::vector<GuessNC::CF::GridcellOrderedVariableNoTime*> all_variables() const;
+	/// Whether the file has a reduced grid
+	bool reduced;
+
+	/// Site info for each grid cell in the file
+	std::unordered_map<long long, Site> table;
+
 	Site site;
 };
 
@@ -1130,11 +1130,10 @@ void nfert_crop(Patch& patch) {
 
 	patch.dnfert = 0.0;
 
-	pftlist.firstobj();
 	// Loop through PFTs
-	while(pftlist.isobj) {
+	for (int p = 0; p < npft; p++) {
 
-		Pft& pft = pftlist.getobj();
+		Pft& pft = pftlist[p];
 		Patchpft& patchpft = patch.pft[pft.id];
 		Gridcellpft& gridcellpft = gridcell.pft[pft.id];
 
@@ -1142,7 +1141,6 @@ void nfert_crop(Patch& patch) {
 
 			cropphen_struct& ppftcrop = *(patchpft.get_cropphen());
 			if(!ppftcrop.growingseason) {
-				pftlist.nextobj();
 				continue;
 			}
 
@@ -1164,7 +1162,6 @@ void nfert_crop(Patch& patch) {
 				ppftcrop.fertilised[2] = true;
 			}
 		}
-		pftlist.nextobj();
 	}
 	patch.anfert += patch.dnfert;
 }
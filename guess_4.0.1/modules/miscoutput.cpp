@@ -117,6 +117,23 @@ MiscOutput::~MiscOutput() {
 void MiscOutput::init() {
 	
 	define_output_tables();
+
+	// outdaily is skipped entirely without daily tables
+	daily_tables_needed =
+		!out_daily_lai.invalid() || !out_daily_npp.invalid() || !out_daily_cton.invalid() ||
+		!out_daily_nmass.invalid() || !out_daily_cmass.invalid() || !out_daily_ndemand.invalid() ||
+		!out_daily_cmass_leaf.invalid() || !out_daily_nmass_leaf.invalid() ||
+		!out_daily_cmass_root.invalid() || !out_daily_nmass_root.invalid() ||
+		!out_daily_cmass_stem.invalid() || !out_daily_nmass_stem.invalid() ||
+		!out_daily_cmass_storage.invalid() || !out_daily_nmass_storage.invalid() ||
+		!out_daily_n_input_soil.invalid() || !out_daily_cmass_dead_leaf.invalid() ||
+		!out_daily_nmass_dead_leaf.invalid() || !out_daily_fphu.invalid() ||
+		!out_daily_avail_nmass_soil.invalid() || !out_daily_upper_wcont.invalid() ||
+		!out_daily_lower_wcont.invalid() || !out_daily_irrigation.invalid() ||
+		!out_daily_temp.invalid() || !out_daily_prec.invalid() || !out_daily_rad.invalid() ||
+		!out_daily_nminleach.invalid() || !out_daily_norgleach.invalid() ||
+		!out_daily_nuptake.invalid() || !out_daily_ds.invalid() || !out_daily_stem.invalid() ||
+		!out_daily_leaf.invalid() || !out_daily_root.invalid() || !out_daily_storage.invalid();
 }
 
 /// Specify all columns in all output tables
@@ -133,16 +150,14 @@ void MiscOutput::define_output_tables() {
 	// create a vector with the crop pft names
 	std::vector<std::string> crop_pfts;
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pft=pftlist[p];
 
 		pfts.push_back((char*)pft.name);
 
 		if (pft.landcover==CROPLAND)
 			crop_pfts.push_back((char*)pft.name);
 
-		pftlist.nextobj();
 	}
 
 	// create a vector with the landcover column titles
@@ -319,45 +334,45 @@ void MiscOutput::define_output_tables() {
 
 	// *** DAILY OUTPUT VARIABLES ***
 
-	create_output_table(out_daily_lai,					file_daily_lai,					daily_columns);
-	create_output_table(out_daily_npp,					file_daily_npp,					daily_columns);
-	create_output_table(out_daily_ndemand,				file_daily_ndemand,				daily_columns);
-	create_output_table(out_daily_nmass,				file_daily_nmass,				daily_columns);
-	create_output_table(out_daily_cmass,				file_daily_cmass,				daily_columns);
-	create_output_table(out_daily_nmass_leaf,			file_daily_nmass_leaf,			daily_columns);
-	create_output_table(out_daily_cmass_leaf,			file_daily_cmass_leaf,			daily_columns);
-	create_output_table(out_daily_nmass_root,			file_daily_nmass_root,			daily_columns);
-	create_output_table(out_daily_cmass_root,			file_daily_cmass_root,			daily_columns);
-	create_output_table(out_daily_nmass_stem,			file_daily_nmass_stem,			daily_columns);
-	create_output_table(out_daily_cmass_stem,			file_daily_cmass_stem,			daily_columns);
-	create_output_table(out_daily_nmass_storage,        file_daily_nmass_storage,       daily_columns);
-	create_output_table(out_daily_cmass_storage,        file_daily_cmass_storage,       daily_columns);
-	create_output_table(out_daily_nmass_dead_leaf,      file_daily_nmass_dead_leaf,     daily_columns);
-	create_output_table(out_daily_cmass_dead_leaf,      file_daily_cmass_dead_leaf,     daily_columns);
-	create_output_table(out_daily_n_input_soil,         file_daily_n_input_soil,        daily_columns);
-	create_output_table(out_daily_avail_nmass_soil,     file_daily_avail_nmass_soil,    daily_columns);
-
-	create_output_table(out_daily_upper_wcont,			file_daily_upper_wcont,         daily_columns);
-	create_output_table(out_daily_lower_wcont,			file_daily_lower_wcont,         daily_columns);
-	create_output_table(out_daily_irrigation,			file_daily_irrigation,			daily_columns);
-
-	create_output_table(out_daily_temp,					file_daily_temp,				daily_columns);
-	create_output_table(out_daily_prec,					file_daily_prec,				daily_columns);
-	create_output_table(out_daily_rad,					file_daily_rad,					daily_columns);
-
-	create_output_table(out_daily_cton,					file_daily_cton,				daily_columns);
-
-	create_output_table(out_daily_nminleach,			file_daily_nminleach,			daily_columns);
-	create_output_table(out_daily_norgleach,			file_daily_norgleach,			daily_columns);
-	create_output_table(out_daily_nuptake,				file_daily_nuptake,				daily_columns);
+	create_output_table(out_daily_lai,					file_daily_lai,					daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_npp,					file_daily_npp,					daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_ndemand,				file_daily_ndemand,				daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nmass,				file_daily_nmass,				daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_cmass,				file_daily_cmass,				daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nmass_leaf,			file_daily_nmass_leaf,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_cmass_leaf,			file_daily_cmass_leaf,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nmass_root,			file_daily_nmass_root,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_cmass_root,			file_daily_cmass_root,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nmass_stem,			file_daily_nmass_stem,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_cmass_stem,			file_daily_cmass_stem,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nmass_storage,        file_daily_nmass_storage,       daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_cmass_storage,        file_daily_cmass_storage,       daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nmass_dead_leaf,      file_daily_nmass_dead_leaf,     daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_cmass_dead_leaf,      file_daily_cmass_dead_leaf,     daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_n_input_soil,         file_daily_n_input_soil,        daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_avail_nmass_soil,     file_daily_avail_nmass_soil,    daily_columns, ROWS_DAILY);
+
+	create_output_table(out_daily_upper_wcont,			file_daily_upper_wcont,         daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_lower_wcont,			file_daily_lower_wcont,         daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_irrigation,			file_daily_irrigation,			daily_columns, ROWS_DAILY);
+
+	create_output_table(out_daily_temp,					file_daily_temp,				daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_prec,					file_daily_prec,				daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_rad,					file_daily_rad,					daily_columns, ROWS_DAILY);
+
+	create_output_table(out_daily_cton,					file_daily_cton,				daily_columns, ROWS_DAILY);
+
+	create_output_table(out_daily_nminleach,			file_daily_nminleach,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_norgleach,			file_daily_norgleach,			daily_columns, ROWS_DAILY);
+	create_output_table(out_daily_nuptake,				file_daily_nuptake,				daily_columns, ROWS_DAILY);
 
 	if (ifnlim) {
-		create_output_table(out_daily_ds,				file_daily_ds,					daily_columns);
-		create_output_table(out_daily_fphu,				file_daily_fphu,				daily_columns);
-		create_output_table(out_daily_stem,				file_daily_stem,				daily_columns);
-		create_output_table(out_daily_leaf,				file_daily_leaf,				daily_columns);
-		create_output_table(out_daily_root,				file_daily_root,				daily_columns);
-		create_output_table(out_daily_storage,			file_daily_storage,				daily_columns);
+		create_output_table(out_daily_ds,				file_daily_ds,					daily_columns, ROWS_DAILY);
+		create_output_table(out_daily_fphu,				file_daily_fphu,				daily_columns, ROWS_DAILY);
+		create_output_table(out_daily_stem,				file_daily_stem,				daily_columns, ROWS_DAILY);
+		create_output_table(out_daily_leaf,				file_daily_leaf,				daily_columns, ROWS_DAILY);
+		create_output_table(out_daily_root,				file_daily_root,				daily_columns, ROWS_DAILY);
+		create_output_table(out_daily_storage,			file_daily_storage,				daily_columns, ROWS_DAILY);
 	}
 
 }
@@ -427,10 +442,9 @@ void MiscOutput::outannual(Gridcell& gridcell) {
 	double standpft_yield2=0.0;
 	double standpft_densindiv_total=0.0;
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
+	for (int p = 0; p < npft; p++) {
 
-		Pft& pft=pftlist.getobj();
+		Pft& pft=pftlist[p];
 
 		// Sum values across stands, patches and PFTs
 		double mean_standpft_yield=0.0;
@@ -669,7 +683,6 @@ void MiscOutput::outannual(Gridcell& gridcell) {
 			outlimit_misc(out, out_fhi,    pft_fhi);
 		}
 
-		pftlist.nextobj();
 
 	} // *** End of PFT loop ***
 
@@ -1061,6 +1074,10 @@ void MiscOutput::outannual(Gridcell& gridcell) {
   */
 void MiscOutput::outdaily(Gridcell& gridcell) {
 
+	if (!daily_tables_needed) {
+		return;
+	}
+
 	double lon = gridcell.get_lon();
 	double lat = gridcell.get_lat();
 	OutputRows out(output_channel, lon, lat, date.get_calendar_year(), date.day);
@@ -1069,12 +1086,10 @@ void MiscOutput::outdaily(Gridcell& gridcell) {
 		return;
 	}
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pft=pftlist[p];
 
 		if (pft.landcover != CROPLAND) {
-			pftlist.nextobj();
 			continue;
 		}
 
@@ -1152,7 +1167,6 @@ void MiscOutput::outdaily(Gridcell& gridcell) {
 			}
 			++gc_itr;
 		}
-		pftlist.nextobj();
 	}
 
 	outlimit_misc(out, out_daily_temp, gridcell.climate.temp);
@@ -1214,16 +1228,14 @@ void MiscOutput::openlocalfiles(Gridcell& gridcell) {
 			// create a vector with the pft names
 			std::vector<std::string> pfts;
 
-			pftlist.firstobj();
-			while (pftlist.isobj) {
+			for (int p = 0; p < npft; p++) {
 
-				 Pft& pft=pftlist.getobj();	 
+				 Pft& pft=pftlist[p];	 
 				 Standpft& standpft=stand.pft[pft.id];
 
 				 if(standpft.active)
 					 pfts.push_back((char*)pft.name);
 
-				 pftlist.nextobj();
 			}
 			ColumnDescriptors anpp_columns;
 			anpp_columns += ColumnDescriptors(pfts,               8, 3);
@@ -113,6 +113,9 @@ private:
 		  out_daily_prec, out_daily_rad, out_daily_nminleach,
 		  out_daily_norgleach, out_daily_nuptake, out_daily_ds, out_daily_stem,
 		  out_daily_leaf, out_daily_root, out_daily_storage;
+
+	/// Whether any daily table has been created, set in init
+	bool daily_tables_needed;
 };
 
 }
@@ -0,0 +1,99 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file profileoutput.cpp
+/// \brief Output module for the timing of the stages of the daily simulation
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "profileoutput.h"
+#include "parameters.h"
+#include "guess.h"
+
+namespace GuessOutput {
+
+REGISTER_OUTPUT_MODULE("profile", ProfileOutput)
+
+ProfileOutput::ProfileOutput()
+	: ngridcells(0),
+	  last_year(0) {
+	declare_parameter("file_profile", &file_profile, 300, "Time spent in each stage of the simulation, per grid cell");
+	declare_parameter("file_profile_run", &file_profile_run, 300, "Time spent in each stage of the simulation, for the whole run");
+}
+
+ProfileOutput::~ProfileOutput() {
+}
+
+void ProfileOutput::init() {
+
+	GuessProfiler::enabled = file_profile != "" || file_profile_run != "";
+
+	define_output_tables();
+}
+
+void ProfileOutput::define_output_tables() {
+
+	ColumnDescriptors stage_columns;
+	for (int i = 0; i < GuessProfiler::NSTAGES; i++) {
+		stage_columns += ColumnDescriptor(GuessProfiler::stage_name((GuessProfiler::Stage)i), 10, 3);
+	}
+
+	ColumnDescriptors run_columns;
+	run_columns += ColumnDescriptor("Cells", 8, 0);
+	run_columns += stage_columns;
+
+	create_output_table(out_profile, file_profile, stage_columns, ROWS_OTHER);
+	create_output_table(out_profile_run, file_profile_run, run_columns, ROWS_OTHER);
+}
+
+void ProfileOutput::outannual(Gridcell& /*gridcell*/) {
+}
+
+void ProfileOutput::outdaily(Gridcell& /*gridcell*/) {
+}
+
+void ProfileOutput::outgridcell(Gridcell& gridcell) {
+
+	const GuessProfiler::Profile* profile = GuessProfiler::current_profile;
+	if (!profile) {
+		return;
+	}
+
+	// The date has already moved past the last simulated day
+	const int year = date.get_calendar_year() - 1;
+
+	{
+		OutputRows out(output_channel, gridcell.get_lon(), gridcell.get_lat(), year);
+
+		for (int i = 0; i < GuessProfiler::NSTAGES; i++) {
+			out.add_value(out_profile, profile->seconds((GuessProfiler::Stage)i));
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	run_profile.add(*profile);
+	++ngridcells;
+	last_year = year;
+}
+
+void ProfileOutput::outsimulation() {
+
+	if (!GuessProfiler::enabled) {
+		return;
+	}
+
+	OutputRows out(output_channel, 0, 0, last_year);
+
+	out.add_value(out_profile_run, ngridcells);
+	for (int i = 0; i < GuessProfiler::NSTAGES; i++) {
+		out.add_value(out_profile_run, run_profile.seconds((GuessProfiler::Stage)i));
+	}
+}
+
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file profileoutput.h
+/// \brief Output module for the timing of the stages of the daily simulation
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LPJ_GUESS_PROFILE_OUTPUT_H
+#define LPJ_GUESS_PROFILE_OUTPUT_H
+
+#include "outputmodule.h"
+#include "outputchannel.h"
+#include "profiler.h"
+#include "gutil.h"
+#include <mutex>
+
+namespace GuessOutput {
+
+/// Output module for the time spent in each stage of the simulation
+/** Profiling (see profiler.h) is switched on if any of the output files
+ *  of this module are given in the instruction file.
+ *
+ *  file_profile gets one row per grid cell. file_profile_run gets a single
+ *  row with the totals for all grid cells simulated by the process, with
+ *  zero coordinates and the number of grid cells in the first column.
+ *  All times are wall times in seconds. With the -standthreads option the
+ *  stage times are summed over the threads, so they may add up to more
+ *  than the Total column.
+ */
+class ProfileOutput : public OutputModule {
+public:
+
+	ProfileOutput();
+
+	~ProfileOutput();
+
+	// implemented functions inherited from OutputModule
+	// (see documentation in OutputModule)
+
+	void init();
+
+	void outannual(Gridcell& gridcell);
+
+	void outdaily(Gridcell& gridcell);
+
+	void outgridcell(Gridcell& gridcell);
+
+	void outsimulation();
+
+private:
+
+	/// Defines all output tables
+	void define_output_tables();
+
+	xtring file_profile;
+	xtring file_profile_run;
+
+	Table out_profile;
+	Table out_profile_run;
+
+	/// Totals for all grid cells simulated so far
+	GuessProfiler::Profile run_profile;
+
+	/// Number of grid cells in run_profile
+	int ngridcells;
+
+	/// Last simulated year, for the Year column of the run table
+	int last_year;
+
+	/// Grid cells may finish on several threads at once
+	std::mutex mutex;
+};
+
+}
+
+#endif // LPJ_GUESS_PROFILE_OUTPUT_H
@@ -22,4 +22,12 @@ void initial_infiltration(Patch& patch, Climate& climate);
 void irrigation(Patch& patch);
 void soilwater(Patch& patch, Climate& climate);
 
+/// Percolation, runoff and evaporation of the soil layers (LPJF hydrology)
+/** Internal function of the module, only declared here for the benchmarks
+ *  (see bench/main.cpp), not intended to be called by the framework. */
+void hydrology_lpjf(Patch& patch, Climate& climate, double rain_melt, double perc_base,
+		double perc_exp, double awc[NSOILLAYER], double fevap, double snowpack,
+		bool percolate, double max_rain_melt, double awcont[NSOILLAYER],
+		double wcont[NSOILLAYER], double& wcont_evap, double& runoff, double& dperc);
+
 #endif // LPJ_GUESS_SOILWATER_H
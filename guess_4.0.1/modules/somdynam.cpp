@@ -71,11 +71,13 @@ static const double NCONC_SAT = 0.02;
 // Exponential decay constants for litter and SOM fractions
 // Values set from turnover times (constants above) on first call to decayrates
 
-static double k_litter10;
-static double k_soilfast10;
-static double k_soilslow10;
+// (thread local since grid cells may be simulated in parallel)
 
-static bool firsttime=true;
+static thread_local double k_litter10;
+static thread_local double k_soilfast10;
+static thread_local double k_soilslow10;
+
+static thread_local bool firsttime=true;
 	// indicates whether function decayrates has been called before
 
 
@@ -1237,19 +1239,410 @@ void add_litter(Soil& soil, int year, int pool) {
 	soil.sompool[pool].nmass += soil.solvesom[year].get_nlitter(pool);
 }
 
+/// One year of monthly SOM dynamics in equilsom()
+/** Uses the saved litter input, nitrogen addition and fractions of nitrogen
+ *  uptake and leaching of a given year in the saved data set
+ */
+void equilsom_year(Soil& soil, int savedyear) {
+
+	Patch& patch = soil.patch;
+	const Climate& climate = soil.patch.get_climate();
+
+	// Monthly time steps
+	for (int m = 0; m < 12; m++) {
+
+		// Transfer yearly mean litter on first day of year
+		add_litter(soil, savedyear*12+m, SURFSTRUCT);
+		add_litter(soil, savedyear*12+m, SURFMETA);
+		add_litter(soil, savedyear*12+m, SOILSTRUCT);
+		add_litter(soil, savedyear*12+m, SOILMETA);
+		add_litter(soil, savedyear*12+m, SURFFWD);
+		add_litter(soil, savedyear*12+m, SURFCWD);
+
+		// Calculate total litter carbon and nitrogen mass for set N:C ratio of surface microbial pool
+		double litter_cmass = soil.sompool[SURFSTRUCT].cmass + soil.sompool[SURFMETA].cmass +
+			soil.sompool[SURFFWD].cmass + soil.sompool[SURFCWD].cmass;
+		double litter_nmass = soil.sompool[SURFSTRUCT].nmass + soil.sompool[SURFMETA].nmass +
+			soil.sompool[SURFFWD].nmass + soil.sompool[SURFCWD].nmass;
+
+		// Set N:C ratio of surface microbial pool based on N:C ratio of litter from all PFTs
+		if (!negligible(litter_cmass)) {
+			setntoc(soil, litter_nmass / (litter_cmass * 2.0), SURFMICRO, 20.0, 10.0, 0.0, NCONC_SAT);
+		}
+
+		// Monthly nitrogen uptake
+		soil.nmass_avail *= (1.0 - soil.fnuptake_mean[m]);
+
+		// Monthly mineral nitrogen leaching
+		soil.nmass_avail *= (1.0 - soil.mminleach_mean[m]);
+
+		// Monthly nitrogen addition to the system
+		soil.nmass_avail += (climate.andep + soil.anfix_mean) / 12.0;
+
+		// Monthly decomposition and fluxes between SOM pools
+
+		// Set this months decay rates
+		for (int p = 0; p < NSOMPOOL-1; p++) {
+			soil.sompool[p].fracremain = soil.sompool[p].mfracremain_mean[m];
+		}
+
+		// Set this months organic nitrogen leaching fraction
+		soil.orgleachfrac = soil.morgleach_mean[m];
+
+		// Monthly decomposition and fluxes between SOM pools
+		// and nitrogen flux from soil
+		somfluxes(patch, true, false);
+	}
+}
+
+/// Spins the SOM pools in equilsom() for a number of years
+/** Starts with the first year in the saved data set and cycles through it */
+void equilsom_spin(Soil& soil, int nyear, int years) {
+
+	for (int yr = 0; yr < years; yr++) {
+		equilsom_year(soil, yr%nyear);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+// ANALYTIC SOLUTION OF THE CENTURY SOM POOLS
+// Internal functions used by equilsom()
+//
+// With the decay rates and fluxes of the saved years fixed, one cycle through the
+// saved years is (nearly) an affine map of the state of the SOM system, x -> Ax + b,
+// where x holds the carbon and nitrogen mass of the pools and the soil available
+// nitrogen. The carbon part is exactly affine unless decay is limited by nitrogen,
+// the nitrogen part is piecewise affine since the N:C ratios of some pools depend on
+// the soil available nitrogen.
+//
+// The map is estimated by running the cycle from the current state and from small
+// perturbations of each state variable, and the state after the n cycles of
+// equilsom_spin() is then given directly by the n-th power of the map, computed
+// with repeated squaring. Since the map is only piecewise affine, it is estimated
+// again around the new state until the state no longer changes.
+
+/// Number of state variables in the analytic solution
+/** Carbon and nitrogen mass of all pools but LEACHED, and soil available nitrogen */
+static const int NSOMSTATE = 2 * (NSOMPOOL-1) + 1;
+
+/// Size of the matrix for the affine map of the state
+/** The last column holds the constant part of the map, and the last row is
+ *  (0, ..., 0, 1), so maps are composed by multiplying the matrices.
+ */
+static const int NSOMMAP = NSOMSTATE + 1;
+
+/// Largest number of times the map is estimated before giving up
+static const int EQUILSOM_MAX_LINEARISATIONS = 8;
+
+/// Largest relative change in the state between two estimates of the map at convergence
+static const double EQUILSOM_TOLERANCE = 1.0e-6;
+
+/// Size of perturbations used to estimate the map, relative to the perturbed variable
+static const double EQUILSOM_PERTURBATION = 1.0e-6;
+
+/// Smallest state variable (kg/m2) considered in relative differences
+static const double EQUILSOM_MIN_STATE = 1.0e-12;
+
+/// Variables smaller than this fraction of the largest carbon or nitrogen pool are
+/// perturbed and compared as if they had this size
+/** Perturbations of small pools would otherwise be lost in rounding errors in
+ *  the large pools.
+ */
+static const double EQUILSOM_SMALL_STATE = 1.0e-3;
+
+/// Gets the state variables of the analytic solution from the soil
+void get_equilsom_state(const Soil& soil, double x[NSOMSTATE]) {
+
+	for (int p = 0; p < NSOMPOOL-1; p++) {
+		x[p] = soil.sompool[p].cmass;
+		x[NSOMPOOL-1+p] = soil.sompool[p].nmass;
+	}
+	x[NSOMSTATE-1] = soil.nmass_avail;
+}
+
+/// Sets the state variables of the analytic solution in the soil
+void set_equilsom_state(Soil& soil, const double x[NSOMSTATE]) {
+
+	for (int p = 0; p < NSOMPOOL-1; p++) {
+		soil.sompool[p].cmass = x[p];
+		soil.sompool[p].nmass = x[NSOMPOOL-1+p];
+	}
+	soil.nmass_avail = x[NSOMSTATE-1];
+}
+
+/// Relative difference between two values of a state variable
+double equilsom_difference(double x, double y) {
+
+	double scale = max(max(fabs(x), fabs(y)), EQUILSOM_MIN_STATE);
+	return fabs(x - y) / scale;
+}
+
+/// Sizes of the state variables, for perturbations and convergence of the analytic solution
+void get_equilsom_scales(const double x[NSOMSTATE], double scale[NSOMSTATE]) {
+
+	double cmax = EQUILSOM_MIN_STATE;
+	double nmax = EQUILSOM_MIN_STATE;
+	for (int p = 0; p < NSOMPOOL-1; p++) {
+		cmax = max(cmax, fabs(x[p]));
+		nmax = max(nmax, fabs(x[NSOMPOOL-1+p]));
+	}
+
+	// Soil available nitrogen is compared to the nitrogen pools
+	for (int j = 0; j < NSOMSTATE; j++) {
+		scale[j] = max(fabs(x[j]), EQUILSOM_SMALL_STATE * (j < NSOMPOOL-1 ? cmax : nmax));
+	}
+}
+
+/// Runs one cycle through the saved years from state x, fx is set to the resulting state
+/** The pools are first reset to start, so the cycle doesn't depend on what
+ *  was run before.
+ */
+void equilsom_cycle(Soil& soil, const Sompool start[NSOMPOOL], int nyear,
+                    const double x[NSOMSTATE], double fx[NSOMSTATE]) {
+
+	for (int p = 0; p < NSOMPOOL; p++) {
+		soil.sompool[p] = start[p];
+	}
+	set_equilsom_state(soil, x);
+
+	equilsom_spin(soil, nyear, nyear);
+
+	get_equilsom_state(soil, fx);
+}
+
+/// Estimates the affine map of the state over one cycle around state x
+void estimate_equilsom_map(Soil& soil, const Sompool start[NSOMPOOL], int nyear,
+                           const double x[NSOMSTATE], double map[NSOMMAP][NSOMMAP]) {
+
+	double fx[NSOMSTATE];
+	equilsom_cycle(soil, start, nyear, x, fx);
+
+	double scale[NSOMSTATE];
+	get_equilsom_scales(x, scale);
+
+	// Linear part, by finite differences
+	for (int j = 0; j < NSOMSTATE; j++) {
+
+		double xh[NSOMSTATE];
+		std::copy(x, x + NSOMSTATE, xh);
+
+		const double h = EQUILSOM_PERTURBATION * scale[j];
+		xh[j] += h;
+
+		double fxh[NSOMSTATE];
+		equilsom_cycle(soil, start, nyear, xh, fxh);
+
+		for (int i = 0; i < NSOMSTATE; i++) {
+			map[i][j] = (fxh[i] - fx[i]) / h;
+		}
+	}
+
+	// Constant part, so that the map gives fx at x
+	for (int i = 0; i < NSOMSTATE; i++) {
+		double ax = 0.0;
+		for (int j = 0; j < NSOMSTATE; j++) {
+			ax += map[i][j] * x[j];
+		}
+		map[i][NSOMSTATE] = fx[i] - ax;
+	}
+
+	for (int j = 0; j < NSOMSTATE; j++) {
+		map[NSOMSTATE][j] = 0.0;
+	}
+	map[NSOMSTATE][NSOMSTATE] = 1.0;
+}
+
+/// Composes two maps, result = a after b (result may not be a or b)
+void compose_equilsom_maps(const double a[NSOMMAP][NSOMMAP], const double b[NSOMMAP][NSOMMAP],
+                           double result[NSOMMAP][NSOMMAP]) {
+
+	for (int i = 0; i < NSOMMAP; i++) {
+		for (int j = 0; j < NSOMMAP; j++) {
+			double sum = 0.0;
+			for (int k = 0; k < NSOMMAP; k++) {
+				sum += a[i][k] * b[k][j];
+			}
+			result[i][j] = sum;
+		}
+	}
+}
+
+/// Applies a map n times to state x (by repeated squaring of the map)
+void apply_equilsom_map(const double map[NSOMMAP][NSOMMAP], int n,
+                        const double x[NSOMSTATE], double result[NSOMSTATE]) {
+
+	// The map to the power of 2^k, and the power accumulated so far
+	double square[NSOMMAP][NSOMMAP];
+	double power[NSOMMAP][NSOMMAP];
+	double tmp[NSOMMAP][NSOMMAP];
+
+	for (int i = 0; i < NSOMMAP; i++) {
+		for (int j = 0; j < NSOMMAP; j++) {
+			square[i][j] = map[i][j];
+			power[i][j] = i == j ? 1.0 : 0.0;
+		}
+	}
+
+	while (n > 0) {
+		if (n & 1) {
+			compose_equilsom_maps(square, power, tmp);
+			std::copy(&tmp[0][0], &tmp[0][0] + NSOMMAP*NSOMMAP, &power[0][0]);
+		}
+		n >>= 1;
+		if (n > 0) {
+			compose_equilsom_maps(square, square, tmp);
+			std::copy(&tmp[0][0], &tmp[0][0] + NSOMMAP*NSOMMAP, &square[0][0]);
+		}
+	}
+
+	for (int i = 0; i < NSOMSTATE; i++) {
+		result[i] = power[i][NSOMSTATE];
+		for (int j = 0; j < NSOMSTATE; j++) {
+			result[i] += power[i][j] * x[j];
+		}
+	}
+}
+
+/// Analytic alternative to equilsom_spin()
+/** Gives (nearly) the same pools as equilsom_spin(soil, nyear, years), see
+ *  above. The last cycle and any remaining years are spun as usual.
+ *
+ *  \returns false if the solution didn't converge, in which case the pools
+ *           are left unchanged
+ */
+bool equilsom_analytic(Soil& soil, int nyear, int years) {
+
+	// Number of cycles given by the map
+	const int ncycles = years / nyear - 1;
+
+	if (ncycles < 1) {
+		equilsom_spin(soil, nyear, years);
+		return true;
+	}
+
+	Sompool start[NSOMPOOL];
+	for (int p = 0; p < NSOMPOOL; p++) {
+		start[p] = soil.sompool[p];
+	}
+
+	double x0[NSOMSTATE];
+	get_equilsom_state(soil, x0);
+
+	// Start by estimating the map around the initial state
+	double x[NSOMSTATE];
+	std::copy(x0, x0 + NSOMSTATE, x);
+
+	double map[NSOMMAP][NSOMMAP];
+
+	bool converged = false;
+
+	for (int i = 0; i < EQUILSOM_MAX_LINEARISATIONS && !converged; i++) {
+
+		estimate_equilsom_map(soil, start, nyear, x, map);
+
+		double xn[NSOMSTATE];
+		apply_equilsom_map(map, ncycles, x0, xn);
+
+		bool finite = true;
+
+		for (int j = 0; j < NSOMSTATE && finite; j++) {
+
+			finite = std::isfinite(xn[j]);
+
+			// Pools can't be negative. An estimate of the map far from the solution
+			// may still give negative values, but the map is then estimated again
+			// around the state with those set to zero.
+			xn[j] = max(xn[j], 0.0);
+		}
+
+		if (!finite) {
+			break;
+		}
+
+		double scale[NSOMSTATE];
+		get_equilsom_scales(xn, scale);
+
+		double max_difference = 0.0;
+		for (int j = 0; j < NSOMSTATE; j++) {
+			max_difference = max(max_difference, fabs(xn[j] - x[j]) / scale[j]);
+		}
+
+		// The first estimate is around the initial state, so it always needs
+		// to be estimated again around the solution
+		converged = i > 0 && max_difference < EQUILSOM_TOLERANCE;
+
+		std::copy(xn, xn + NSOMSTATE, x);
+	}
+
+	// Restore the other pool variables, which were changed by the cycles
+	for (int p = 0; p < NSOMPOOL; p++) {
+		soil.sompool[p] = start[p];
+	}
+
+	if (!converged) {
+		set_equilsom_state(soil, x0);
+		return false;
+	}
+
+	set_equilsom_state(soil, x);
+
+	// Last cycle and remaining years with the ordinary monthly time steps, so
+	// the pools end up as after equilsom_spin() (N:C ratios, decay rates etc.)
+	for (int yr = ncycles * nyear; yr < years; yr++) {
+		equilsom_year(soil, yr%nyear);
+	}
+
+	return true;
+}
+
+/// Reports differences between the pools from equilsom_spin() and equilsom_analytic()
+void report_equilsom_differences(const Soil& soil, const Sompool spin[NSOMPOOL], bool converged) {
+
+	const Gridcell& gridcell = soil.patch.stand.get_gridcell();
+
+	if (!converged) {
+		dprintf("equilsom validation at (%g,%g), patch %d: analytic solution didn't converge\n",
+			gridcell.get_lon(), gridcell.get_lat(), soil.patch.id);
+		return;
+	}
+
+	int cpool = 0, npool = 0;
+	double cdiff = 0.0, ndiff = 0.0;
+
+	for (int p = 0; p < NSOMPOOL-1; p++) {
+
+		double d = equilsom_difference(soil.sompool[p].cmass, spin[p].cmass);
+		if (d > cdiff) {
+			cdiff = d;
+			cpool = p;
+		}
+
+		d = equilsom_difference(soil.sompool[p].nmass, spin[p].nmass);
+		if (d > ndiff) {
+			ndiff = d;
+			npool = p;
+		}
+	}
+
+	dprintf("equilsom validation at (%g,%g), patch %d: largest relative difference C %.3g (pool %d), N %.3g (pool %d)\n",
+		gridcell.get_lon(), gridcell.get_lat(), soil.patch.id, cdiff, cpool, ndiff, npool);
+}
+
 /// Iteratively solving differential flux equations for century SOM pools
 /** Iteratively solving differential flux equations for century SOM pools
  *  assuming annual litter inputs, nitrogen uptake and leaching is close
- *  to long term equilibrium
+ *  to long term equilibrium.
+ *
+ *  The pools are either spun with monthly time steps, or solved analytically
+ *  for the same number of years (see equilsom_analytic), depending on the
+ *  instruction file parameter equilsom. In validation mode both are done, the
+ *  differences are reported and the spun pools are kept.
  */
 void equilsom(Soil& soil) {
 
 	// Number of years to run SOM pools, value chosen to get cold climates to equilibrium
 	const int EQUILSOM_YEARS = 40000;
 
-	Patch& patch = soil.patch;
-	const Climate& climate = soil.patch.get_climate();
-
 	// Save nmass_avail status
 	double save_nmass_avail = soil.nmass_avail;
 
@@ -1278,57 +1671,46 @@ void equilsom(Soil& soil) {
 
 	// Spin SOM pools with saved litter input, nitrogen addition and fractions of
 	// nitrogen uptake and leaching for EQUILSOM_YEARS years with monthly timesteps
-	for (int yr = 0; yr < EQUILSOM_YEARS; yr++) {
-
-		// Which year in saved data set
-		int savedyear = yr%nyear;
-
-		// Monthly time steps
-		for (int m = 0; m < 12; m++) {
-
-			// Transfer yearly mean litter on first day of year
-			add_litter(soil, savedyear*12+m, SURFSTRUCT);
-			add_litter(soil, savedyear*12+m, SURFMETA);
-			add_litter(soil, savedyear*12+m, SOILSTRUCT);
-			add_litter(soil, savedyear*12+m, SOILMETA);
-			add_litter(soil, savedyear*12+m, SURFFWD);
-			add_litter(soil, savedyear*12+m, SURFCWD);
-
-			// Calculate total litter carbon and nitrogen mass for set N:C ratio of surface microbial pool
-			double litter_cmass = soil.sompool[SURFSTRUCT].cmass + soil.sompool[SURFMETA].cmass +
-				soil.sompool[SURFFWD].cmass + soil.sompool[SURFCWD].cmass;
-			double litter_nmass = soil.sompool[SURFSTRUCT].nmass + soil.sompool[SURFMETA].nmass +
-				soil.sompool[SURFFWD].nmass + soil.sompool[SURFCWD].nmass;
-
-			// Set N:C ratio of surface microbial pool based on N:C ratio of litter from all PFTs
-			if (!negligible(litter_cmass)) {
-				setntoc(soil, litter_nmass / (litter_cmass * 2.0), SURFMICRO, 20.0, 10.0, 0.0, NCONC_SAT);
-			}
+	if (equilsom_method == EQUILSOM_ANALYTIC) {
+		if (!equilsom_analytic(soil, nyear, EQUILSOM_YEARS)) {
+			equilsom_spin(soil, nyear, EQUILSOM_YEARS);
+		}
+	}
+	else if (equilsom_method == EQUILSOM_VALIDATE) {
 
-			// Monthly nitrogen uptake
-			soil.nmass_avail *= (1.0 - soil.fnuptake_mean[m]);
+		Sompool initial[NSOMPOOL];
+		for (int p = 0; p < NSOMPOOL; p++) {
+			initial[p] = soil.sompool[p];
+		}
+		double initial_nmass_avail = soil.nmass_avail;
 
-			// Monthly mineral nitrogen leaching
-			soil.nmass_avail *= (1.0 - soil.mminleach_mean[m]);
+		bool converged = equilsom_analytic(soil, nyear, EQUILSOM_YEARS);
 
-			// Monthly nitrogen addition to the system
-			soil.nmass_avail += (climate.andep + soil.anfix_mean) / 12.0;
+		Sompool analytic[NSOMPOOL];
+		for (int p = 0; p < NSOMPOOL; p++) {
+			analytic[p] = soil.sompool[p];
+			soil.sompool[p] = initial[p];
+		}
+		soil.nmass_avail = initial_nmass_avail;
 
-			// Monthly decomposition and fluxes between SOM pools
+		equilsom_spin(soil, nyear, EQUILSOM_YEARS);
 
-			// Set this months decay rates
-			for (int p = 0; p < NSOMPOOL-1; p++) {
-				soil.sompool[p].fracremain = soil.sompool[p].mfracremain_mean[m];
-			}
+		Sompool spin[NSOMPOOL];
+		for (int p = 0; p < NSOMPOOL; p++) {
+			spin[p] = soil.sompool[p];
+			soil.sompool[p] = analytic[p];
+		}
 
-			// Set this months organic nitrogen leaching fraction
-			soil.orgleachfrac = soil.morgleach_mean[m];
+		report_equilsom_differences(soil, spin, converged);
 
-			// Monthly decomposition and fluxes between SOM pools
-			// and nitrogen flux from soil
-			somfluxes(patch, true, false);
+		// Keep the spun pools
+		for (int p = 0; p < NSOMPOOL; p++) {
+			soil.sompool[p] = spin[p];
 		}
 	}
+	else {
+		equilsom_spin(soil, nyear, EQUILSOM_YEARS);
+	}
 
 	// Reset nmass_avail status
 	soil.nmass_avail = save_nmass_avail;
@@ -18,4 +18,13 @@
 
 void som_dynamics(Patch& patch);
 
+/// Brings the CENTURY SOM pools to equilibrium with the litter saved during the spinup
+/** Called by som_dynamics at the end of the saving period (Soil::solvesomcent_endyr) */
+void equilsom(Soil& soil);
+
+/// Fluxes between the CENTURY pools, and CO2 release to the atmosphere
+/** Internal function of the module, only declared here for the benchmarks
+ *  (see bench/main.cpp), not intended to be called by the framework. */
+void somfluxes(Patch& patch, bool ifequilsom, bool tillage);
+
 #endif // LPJ_GUESS_SOMDYNAM_H
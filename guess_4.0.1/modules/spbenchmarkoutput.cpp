@@ -38,6 +38,11 @@ BenchmarkOutput::~BenchmarkOutput() {
 void BenchmarkOutput::init() {
 
 	define_output_tables();
+
+	// use spoutput_startyear and spoutput_step to restrict output
+	if (spoutput_startyear != -1) {
+		set_schedule(OutputSchedule(spoutput_startyear + nyear_spinup, spoutput_step));
+	}
 }
 
 /** This function specifies all columns in all output tables, their names,
@@ -61,16 +66,14 @@ void BenchmarkOutput::define_output_tables() {
 	// create a vector with the crop pft names
 	std::vector<std::string> crop_pfts;
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		 Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		 Pft& pft=pftlist[p];
 
 		 pfts.push_back((char*)pft.name);
 
 		 if(pft.landcover==CROPLAND)
 			 crop_pfts.push_back((char*)pft.name);
 
-		 pftlist.nextobj();
 	}
 
 	// create a vector with the landcover column titles
@@ -108,8 +111,8 @@ void BenchmarkOutput::define_output_tables() {
 
 	// *** ANNUAL OUTPUT VARIABLES ***
 
-	create_output_table(out_vegcover, file_vegcover, vegcover_columns);
-	create_output_table(out_canopyheight, file_canopyheight, canopyheight_columns);
+	create_output_table(out_vegcover, file_vegcover, vegcover_columns, ROWS_PATCH);
+	create_output_table(out_canopyheight, file_canopyheight, canopyheight_columns, ROWS_PATCH);
 	create_output_table(out_mfpar, file_mfpar, month_columns);
 
 
@@ -123,18 +126,12 @@ void BenchmarkOutput::define_output_tables() {
   * If only yearly output between, say 1961 and 1990 is requred, use:
   *  if (date.get_calendar_year() >= 1961 && date.get_calendar_year() <= 1990)
   *  (assuming the input module has set the first calendar year in the date object)	
+  *
+  * The years given by spoutput_startyear and spoutput_step are handled by the
+  * schedule set in init(), outannual() isn't called at all for other years.
   */
 void outlimit_benchmark(OutputRows& out, const Table& table, double d) {
-
-    // use spoutput_startyear and spoutput_step to restrict output
-    if ( spoutput_startyear == -1 ) {
-        // do not restrict output
-        out.add_value(table, d);
-    } else {
-        // restrict output
-        if ( (date.year >= spoutput_startyear + nyear_spinup) && (date.get_calendar_year() % spoutput_step) == 0 )// nyear_spinup)
-            out.add_value(table, d);
-    }
+    out.add_value(table, d);
 }
 
 /// Output of simulation results at the end of each year
@@ -149,6 +146,11 @@ void outlimit_benchmark(OutputRows& out, const Table& table, double d) {
   */
 void BenchmarkOutput::outannual(Gridcell& gridcell) {
 
+	// mfpar is not written (see below), so nothing to do without the per patch tables
+	if (out_vegcover.invalid() && out_canopyheight.invalid()) {
+		return;
+	}
+
 	int c, m;
 
 	// Annual
@@ -177,10 +179,9 @@ void BenchmarkOutput::outannual(Gridcell& gridcell) {
 
 	// *** Loop through PFTs ***
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
+	for (int p = 0; p < npft; p++) {
 
-		Pft& pft=pftlist.getobj();
+		Pft& pft=pftlist[p];
 		Gridcellpft& gridcellpft=gridcell.pft[pft.id];
 
 		// Sum per-PFT output such as monthly C fluxes, litter, instances of leaf shedding across patches
@@ -240,7 +241,6 @@ void BenchmarkOutput::outannual(Gridcell& gridcell) {
 
 		}//End of loop through stands
 
-		pftlist.nextobj();
 
 	} // *** End of PFT loop ***
 
@@ -305,17 +305,20 @@ void BenchmarkOutput::outannual(Gridcell& gridcell) {
 			// Calculate average top of canopy height
 
 			// STEP 1: Copy all heights and fpc of all vegetation which is not a grass into vectors
+			// (left empty without a canopy height table, which skips STEP 2)
 			std::vector<double> fpc_vector;
 			std::vector<double> height_vector;
 
-			vegetation.firstobj();
-			while (vegetation.isobj) {
-				Individual& indiv = vegetation.getobj();
-				if (indiv.pft.lifeform != GRASS) {
-					fpc_vector.push_back(indiv.fpc);
-					height_vector.push_back(indiv.height);
+			if (!out_canopyheight.invalid()) {
+				vegetation.firstobj();
+				while (vegetation.isobj) {
+					Individual& indiv = vegetation.getobj();
+					if (indiv.pft.lifeform != GRASS) {
+						fpc_vector.push_back(indiv.fpc);
+						height_vector.push_back(indiv.height);
+					}
+					vegetation.nextobj();
 				}
-				vegetation.nextobj();
 			}
 
 			// STEP 2:
@@ -20,6 +20,7 @@
 #include "guess.h"
 #include "driver.h"
 #include "guessstring.h"
+#include "gridlistorder.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -317,10 +318,110 @@ void check_same_spatial_domains(const std::vector<GuessNC::CF::GridcellOrderedVa
 	}
 }
 
+// Opens the same variables a second time
+std::vector<GuessNC::CF::GridcellOrderedVariable*>
+reopen_variables(const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables) {
+
+	std::vector<GuessNC::CF::GridcellOrderedVariable*> result;
+	for (size_t i = 0; i < variables.size(); ++i) {
+		result.push_back(new GridcellOrderedVariable(variables[i]->get_filename().c_str(),
+		                                             variables[i]->get_variable_name().c_str()));
+	}
+	return result;
+}
+
+// Timesteps needed for a year of data, counting a skipped leap day and
+// the previous year's last timestep which may be used again
+int timesteps_per_year(const GuessNC::CF::GridcellOrderedVariable* cf_var) {
+	return is_daily(cf_var) ? 367 : 13;
+}
+
+// Makes the variables read their data a few years at a time
+void set_streaming(const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables,
+                   int nyear_spinup_data, int window_years) {
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		const int per_year = timesteps_per_year(variables[i]);
+
+		// The spinup data may start a year into the record
+		const int first_window = (nyear_spinup_data + 1) * per_year;
+
+		variables[i]->set_streaming(max(first_window, window_years * per_year),
+		                            window_years * per_year);
+	}
+}
+
+// Shares the memory for tile caches between variables reading from the files
+void share_tile_cache(const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables,
+                      int megabytes) {
+
+	const size_t bytes = size_t(megabytes) * 1024 * 1024;
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		variables[i]->set_tile_cache_size(bytes / variables.size());
+	}
+}
+
+// Makes sure a streamed variable has the timesteps for the current year in memory
+void load_year_window(GuessNC::CF::GridcellOrderedVariable* cf_var, int historic_timestep) {
+
+	const int first_timestep = max(0, historic_timestep);
+
+	if (!cf_var->window_contains(first_timestep, timesteps_per_year(cf_var))) {
+		GuessNC::LibraryLock lock;
+		try {
+			cf_var->load_window(first_timestep);
+		}
+		catch (const std::runtime_error& e) {
+			fail(e.what());
+		}
+	}
+}
+
+// Finds the variables in the forcing cache, calls fail() if any of them is missing
+std::vector<int> find_cached_variables(const ForcingCache& cache,
+                                       const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables) {
+
+	std::vector<int> result;
+	for (size_t i = 0; i < variables.size(); ++i) {
+		const std::string file = variables[i]->get_filename();
+		const std::string name = variables[i]->get_variable_name();
+
+		const int index = cache.find_variable(file, name);
+		if (index == -1 ||
+		    cache.get_variables()[index].location_size != variables[i]->get_location_size() ||
+		    !cache.is_up_to_date(index)) {
+			fail("The forcing cache doesn't contain %s from %s, or it has changed since the cache was written",
+			     name.c_str(), file.c_str());
+		}
+		result.push_back(index);
+	}
+	return result;
+}
+
+// Points the variables to their data for a location in the forcing cache
+bool use_cached_data(const ForcingCache& cache,
+                     const std::vector<int>& indices,
+                     const std::vector<GuessNC::CF::GridcellOrderedVariable*> variables,
+                     int x, int y) {
+
+	for (size_t i = 0; i < variables.size(); ++i) {
+		const double* data = cache.get_data(x, y, indices[i]);
+		if (!data) {
+			return false;
+		}
+		variables[i]->set_data(data);
+	}
+	return true;
+}
+
 }
 
 SPInput::SPInput()
-	: cf_temp(0),
+	: gridlist_order("file"),
+	  forcing_window_years(0),
+	  tile_cache_mb(256),
+	  cf_temp(0),
 	  cf_prec(0),
 	  cf_insol(0),
 	  cf_wetdays(0),
@@ -334,6 +435,11 @@ SPInput::SPInput()
 
 	declare_parameter("ndep_timeseries", &ndep_timeseries, 10, "Nitrogen deposition time series to use (historic, rcp26, rcp45, rcp60 or rcp85");
 
+	declare_parameter("gridlist_order", &gridlist_order, 10, "Order to simulate the gridlist in (file, hilbert or morton)");
+
+	declare_parameter("forcing_window_years", &forcing_window_years, 0, 1000, "Years of forcing data to read at a time (0 reads the whole record for each grid cell)");
+
+	declare_parameter("tile_cache_mb", &tile_cache_mb, 0, 100000, "Memory for caching neighbouring grid cells read from chunked NetCDF files (MB per thread)");
 }
 
 SPInput::~SPInput() {
@@ -360,8 +466,117 @@ SPInput::~SPInput() {
 	cf_ndep_noywet = 0;
 }
 
+SPInput::ThreadState::ThreadState()
+	: position(0),
+	  cf_temp(0),
+	  cf_prec(0),
+	  cf_insol(0),
+	  cf_wetdays(0),
+	  cf_min_temp(0),
+	  cf_max_temp(0),
+	  cf_ndep_nhxdry(0),
+	  cf_ndep_nhxwet(0),
+	  cf_ndep_noydry(0),
+	  cf_ndep_noywet(0),
+	  previous_position(-1),
+	  prefetch_step(1) {
+
+	prefetched.index = -1;
+}
+
+SPInput::ThreadState::~ThreadState() {
+	// Stop the background thread before deleting the variables it uses
+	prefetcher.reset();
+
+	GuessNC::LibraryLock lock;
+
+	for (size_t i = 0; i < prefetch_forcing.size(); ++i) {
+		delete prefetch_forcing[i];
+	}
+	for (size_t i = 0; i < prefetch_ndep.size(); ++i) {
+		delete prefetch_ndep[i];
+	}
+
+	delete cf_temp;
+	delete cf_prec;
+	delete cf_insol;
+	delete cf_wetdays;
+	delete cf_min_temp;
+	delete cf_max_temp;
+	delete cf_ndep_nhxdry;
+	delete cf_ndep_nhxwet;
+	delete cf_ndep_noydry;
+	delete cf_ndep_noywet;
+}
+
+SPInput::ThreadState& SPInput::thread_data() {
+
+	ThreadState& state = thread_state.get();
+
+	if (state.prefetcher.get()) {
+		return state;
+	}
+
+	// First use on this thread, open the variables for it
+	{
+		GuessNC::LibraryLock lock;
+
+		try {
+			std::vector<GridcellOrderedVariable*> forcing = reopen_variables(all_variables());
+			GridcellOrderedVariable** members[] = { &state.cf_temp, &state.cf_prec, &state.cf_insol,
+			                                        &state.cf_wetdays, &state.cf_min_temp, &state.cf_max_temp };
+			const GridcellOrderedVariable* originals[] = { cf_temp, cf_prec, cf_insol,
+			                                               cf_wetdays, cf_min_temp, cf_max_temp };
+			size_t next = 0;
+			for (size_t i = 0; i < sizeof(members)/sizeof(members[0]); ++i) {
+				if (originals[i]) {
+					*members[i] = forcing[next++];
+				}
+			}
+
+			std::vector<GridcellOrderedVariable*> ndep = reopen_variables(ndep_variables());
+			state.cf_ndep_nhxdry = ndep[0];
+			state.cf_ndep_nhxwet = ndep[1];
+			state.cf_ndep_noydry = ndep[2];
+			state.cf_ndep_noywet = ndep[3];
+
+			state.prefetch_forcing = reopen_variables(all_variables());
+			state.prefetch_ndep = reopen_variables(ndep_variables());
+
+			if (forcing_window_years > 0) {
+				set_streaming(state.all_variables(), NYEAR_SPINUP_DATA, forcing_window_years);
+				set_streaming(state.ndep_variables(), NYEAR_SPINUP_DATA, forcing_window_years);
+				set_streaming(state.prefetch_forcing, NYEAR_SPINUP_DATA, forcing_window_years);
+				set_streaming(state.prefetch_ndep, NYEAR_SPINUP_DATA, forcing_window_years);
+			}
+
+			// Only the variables used by the background thread read whole grid cells,
+			// the others only read later windows of the current one when streaming,
+			// which doesn't go through the tile cache
+			std::vector<GridcellOrderedVariable*> readers = state.prefetch_forcing;
+			readers.insert(readers.end(), state.prefetch_ndep.begin(), state.prefetch_ndep.end());
+
+			std::vector<GridcellOrderedVariable*> current = state.all_variables();
+			std::vector<GridcellOrderedVariable*> current_ndep = state.ndep_variables();
+			current.insert(current.end(), current_ndep.begin(), current_ndep.end());
+			share_tile_cache(current, 0);
+			share_tile_cache(readers, tile_cache_mb);
+		}
+		catch (const std::runtime_error& e) {
+			fail(e.what());
+		}
+	}
+
+	state.prefetcher = std::auto_ptr<BackgroundTask>(new BackgroundTask);
+
+	return state;
+}
+
 void SPInput::init() {
 
+	// Other input modules may be reading NetCDF files in the background
+	GuessNC::LibraryLock lock;
+
 	// Read CO2 data from file
 	co2.load_file(param["file_co2"].str);
 
@@ -416,6 +631,8 @@ void SPInput::init() {
 
 	extensive_precipitation = cf_prec->get_standard_name() == "precipitation_amount";
 
+	insol_type = cf_standard_name_to_insoltype(cf_insol->get_standard_name());
+
 	check_ndep_nhxdry(cf_ndep_nhxdry);
 	check_ndep_nhxwet(cf_ndep_nhxwet);
 	check_ndep_noydry(cf_ndep_noydry);
@@ -464,12 +681,22 @@ void SPInput::init() {
 		gridlist.push_back(c);
 	}
 
-	current_gridcell = gridlist.begin();
+	// Simulate along a curve through the grid cells' positions in the files, if asked for
+	std::vector<std::pair<int, int> > positions;
+	for (size_t i = 0; i < gridlist.size(); ++i) {
+		const Coord& c = gridlist[i];
+		positions.push_back(cf_temp->is_reduced() ? std::make_pair(c.landid, 0) : std::make_pair(c.rlon, c.rlat));
+	}
+
+	order = GridlistOrder::simulation_order(gridlist_order, positions);
+
+	order_position.assign(order.size(), 0);
+	for (size_t i = 0; i < order.size(); ++i) {
+		order_position[order[i]] = (int)i;
+	}
 
-	// Open landcover files
-	landcover_input.init();
-	// Open management files
-	management_input.init();
+	// Open landcover and management files
+	landuse_input.init();
     
     // cw SubPixel
     // Open site files
@@ -482,6 +709,12 @@ void SPInput::init() {
 	date.set_first_calendar_year(cf_temp->get_date_time(0).get_year() - nyear_spinup +
 								 cf_temp->get_paleo_offset());
 
+	if (param.isparam("file_forcing_cache") && param["file_forcing_cache"].str != "") {
+		forcing_cache = std::auto_ptr<ForcingCache>(new ForcingCache(param["file_forcing_cache"].str));
+		cached_forcing = find_cached_variables(*forcing_cache, all_variables());
+		cached_ndep = find_cached_variables(*forcing_cache, ndep_variables());
+	}
+
 	// Set timers
 	tprogress.init();
 	tmute.init();
@@ -490,40 +723,128 @@ void SPInput::init() {
 	tmute.settimer(MUTESEC);
 }
 
+int SPInput::simulated_years() const {
+	// The spinup, then each calendar year in the forcing data
+	return nyear_spinup + last_day_to_simulate(cf_temp).get_year() -
+		cf_temp->get_date_time(0).get_year() + 1;
+}
+
+bool SPInput::gridcell_coordinates(int index, double& lon, double& lat) const {
+	const Coord& c = gridlist[index];
+
+	GuessNC::LibraryLock lock;
+	try {
+		if (cf_temp->is_reduced()) {
+			cf_temp->get_coords_for(c.landid, lon, lat);
+		}
+		else {
+			cf_temp->get_coords_for(c.rlon, c.rlat, lon, lat);
+		}
+	}
+	catch (const std::runtime_error&) {
+		// Not in the forcing files, the model will skip it
+		return false;
+	}
+	return true;
+}
+
 bool SPInput::getgridcell(Gridcell& gridcell) {
+	ThreadState& state = thread_data();
+	state.prefetch_step = 1;
+	return load_gridcell(gridcell, state, true);
+}
+
+bool SPInput::getgridcell_at(Gridcell& gridcell, int index) {
+	ThreadState& state = thread_data();
+
+	// Guess that the grid cells are asked for in steps of the same size
+	// along the simulation order
+	const int position = simulation_position(index);
+	if (state.previous_position >= 0 && position > state.previous_position) {
+		state.prefetch_step = position - state.previous_position;
+	}
+	else {
+		state.prefetch_step = 1;
+	}
+	state.previous_position = position;
+
+	state.position = index;
+	return load_gridcell(gridcell, state, false);
+}
+
+int SPInput::simulation_position(int index) const {
+	return order.empty() ? index : order_position[index];
+}
+
+int SPInput::guess_next_gridcell(const ThreadState& state, int index) const {
+	const int position = simulation_position(index) + state.prefetch_step;
+	if (position >= (int)gridlist.size()) {
+		return -1;
+	}
+	return order.empty() ? position : order[position];
+}
+
+bool SPInput::load_gridcell(Gridcell& gridcell, ThreadState& state, bool skip_ahead) {
 
 	double lon, lat;
 	int soilcode;
 
-	// Load data for next gridcell, or if that fails, skip ahead until
-	// we find one that works.
-	while (current_gridcell != gridlist.end() &&
-		   !load_data_from_files()){
-		++current_gridcell;
+	// Get data for next gridcell, or if that fails, skip ahead until
+	// we find one that works. Usually the data has already been loaded
+	// in the background while the previous grid cell was simulated.
+	while (state.position < (int)gridlist.size()) {
+		if (state.prefetched.index != state.position) {
+			start_prefetch(state, state.position);
+		}
+		wait_for_prefetch(state);
+		state.prefetched.index = -1;
+
+		if (state.prefetched.message != "") {
+			dprintf("%s", (char*)state.prefetched.message);
+		}
+
+		if (state.prefetched.ok) {
+			break;
+		}
+		if (!skip_ahead) {
+			return false;
+		}
+		++state.position;
 	}
 
-	if (current_gridcell == gridlist.end()) {
+	if (state.position >= (int)gridlist.size()) {
 		// simulation finished
 		return false;
 	}
 
-	// Get lon/lat for the gridcell
-	if (cf_temp->is_reduced()) {
-		cf_temp->get_coords_for(current_gridcell->landid, lon, lat);
+	const Coord& c = gridlist[state.position];
+
+	// Take over the data from the variables used by the background thread
+	std::vector<GridcellOrderedVariable*> forcing = state.all_variables();
+	for (size_t i = 0; i < forcing.size(); ++i) {
+		forcing[i]->swap_data(*state.prefetch_forcing[i]);
 	}
-	else {
-		cf_temp->get_coords_for(current_gridcell->rlon, current_gridcell->rlat, lon, lat);
+
+	std::vector<GridcellOrderedVariable*> ndep = state.ndep_variables();
+	for (size_t i = 0; i < ndep.size(); ++i) {
+		ndep[i]->swap_data(*state.prefetch_ndep[i]);
 	}
+
+	const Prefetched& prefetched = state.prefetched;
+
+	// Get lon/lat for the gridcell
+	lon = prefetched.lon;
+	lat = prefetched.lat;
 	gridcell.set_coordinates(lon, lat);
     
     // cw SubPixel
     if(run_landform) {
-		bool LFworked = false;
-		LFworked = site_input.loadsite(lon, lat, current_gridcell->landid);
-		if (LFworked)
-			gridcell.set_site(site_input.get_site());
-			LFworked = landform_input.loadlandform(lon, lat, current_gridcell->landid);
-		if (!LFworked) {
+		site_input.print_site(prefetched.site_ok, lon, lat, c.landid, prefetched.site);
+		landform_input.print_landforms(prefetched.landforms_ok, lon, lat, c.landid, prefetched.landforms);
+
+		if (prefetched.site_ok)
+			gridcell.set_site(prefetched.site);
+		if (!prefetched.landforms_ok) {
 			dprintf("\nError: could not find landform info at (%g,%g) in site/landform data file(s)\n", lon, lat);
 			return false;
 		}
@@ -531,108 +852,167 @@ bool SPInput::getgridcell(Gridcell& gridcell) {
 
 	// Load spinup data for all variables
 
-	load_spinup_data(cf_temp, spinup_temp);
-	load_spinup_data(cf_prec, spinup_prec);
-	load_spinup_data(cf_insol, spinup_insol);
+	load_spinup_data(state.cf_temp, state.spinup_temp);
+	load_spinup_data(state.cf_prec, state.spinup_prec);
+	load_spinup_data(state.cf_insol, state.spinup_insol);
 
-	if (cf_wetdays) {
-		load_spinup_data(cf_wetdays, spinup_wetdays);
+	if (state.cf_wetdays) {
+		load_spinup_data(state.cf_wetdays, state.spinup_wetdays);
 	}
 
-	if (cf_min_temp) {
-		load_spinup_data(cf_min_temp, spinup_min_temp);
+	if (state.cf_min_temp) {
+		load_spinup_data(state.cf_min_temp, state.spinup_min_temp);
 	}
 
-	if (cf_max_temp) {
-		load_spinup_data(cf_max_temp, spinup_max_temp);
+	if (state.cf_max_temp) {
+		load_spinup_data(state.cf_max_temp, state.spinup_max_temp);
 	}
 
-	load_spinup_data(cf_ndep_nhxdry, spinup_ndep_nhxdry);
-	load_spinup_data(cf_ndep_nhxwet, spinup_ndep_nhxwet);
-	load_spinup_data(cf_ndep_noydry, spinup_ndep_noydry);
-	load_spinup_data(cf_ndep_noywet, spinup_ndep_noywet);
+	load_spinup_data(state.cf_ndep_nhxdry, state.spinup_ndep_nhxdry);
+	load_spinup_data(state.cf_ndep_nhxwet, state.spinup_ndep_nhxwet);
+	load_spinup_data(state.cf_ndep_noydry, state.spinup_ndep_noydry);
+	load_spinup_data(state.cf_ndep_noywet, state.spinup_ndep_noywet);
 
-	spinup_temp.detrend_data();
+	state.spinup_temp.detrend_data();
 
-	gridcell.climate.instype = cf_standard_name_to_insoltype(cf_insol->get_standard_name());
+	gridcell.climate.instype = insol_type;
 
     // cw SubPixel
 	// Setup the landforms/ stands and soil type
 
     // create stands for valid landforms
-    std::vector<Landform> landforms = landform_input.get_landforms();
+    const std::vector<Landform>& landforms = prefetched.landforms;
     for (size_t i = 0; i < landforms.size(); ++i) {
         Stand& stand = gridcell.create_stand(NATURAL, landforms[i]);
 	}
 
-	soilparameters(gridcell.soiltype, soilcode, site_input.get_site());
+	soilparameters(gridcell.soiltype, soilcode, prefetched.site);
 
-	historic_timestep_temp = -1;
-	historic_timestep_prec = -1;
-	historic_timestep_insol = -1;
-	historic_timestep_wetdays = -1;
-	historic_timestep_min_temp = -1;
-	historic_timestep_max_temp = -1;
-	historic_timestep_ndep_nhxdry = -1;
-	historic_timestep_ndep_nhxwet = -1;
-	historic_timestep_ndep_noydry = -1;
-	historic_timestep_ndep_noywet = -1;
+	state.historic_timestep_temp = -1;
+	state.historic_timestep_prec = -1;
+	state.historic_timestep_insol = -1;
+	state.historic_timestep_wetdays = -1;
+	state.historic_timestep_min_temp = -1;
+	state.historic_timestep_max_temp = -1;
+	state.historic_timestep_ndep_nhxdry = -1;
+	state.historic_timestep_ndep_nhxwet = -1;
+	state.historic_timestep_ndep_noydry = -1;
+	state.historic_timestep_ndep_noywet = -1;
 
 	dprintf("\nCommencing simulation for gridcell at (%g,%g)\n", lon, lat);
-	if (current_gridcell->descrip != "") {
-		dprintf("Description: %s\n", current_gridcell->descrip.c_str());
+	if (c.descrip != "") {
+		dprintf("Description: %s\n", c.descrip.c_str());
 	}
 	//dprintf("Using soil code and Nitrogen deposition for (%3.1f,%3.1f)\n", cru_lon, cru_lat);
 
+	// Start loading the grid cell which will probably be asked for next
+	const int next = guess_next_gridcell(state, state.position);
+	if (next >= 0) {
+		start_prefetch(state, next);
+	}
+
 	return true;
 }
 
-bool SPInput::load_data_from_files(){
+void SPInput::start_prefetch(ThreadState& state, int index) {
+	wait_for_prefetch(state);
+	state.prefetched.index = index;
+	state.prefetcher->start([this, &state, index]() {
+		prefetch(state, index);
+	});
+}
 
-	int rlon = current_gridcell->rlon;
-	int rlat = current_gridcell->rlat;
-	int landid = current_gridcell->landid;
+void SPInput::prefetch(ThreadState& state, int index) {
 
-	// Try to load the data from the NetCDF files
+	GuessNC::LibraryLock lock;
 
-	if (cf_temp->is_reduced()) {
-		if (!cf_temp->load_data_for(landid) ||
-		    !cf_prec->load_data_for(landid) ||
-		    !cf_insol->load_data_for(landid) ||
-		    (cf_wetdays && !cf_wetdays->load_data_for(landid)) ||
-		    (cf_min_temp && !cf_min_temp->load_data_for(landid)) ||
-		    (cf_max_temp && !cf_max_temp->load_data_for(landid))) {
-			dprintf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
-			return false;
-		}
+	const Coord& c = gridlist[index];
+	Prefetched& prefetched = state.prefetched;
+
+	prefetched.message = "";
+	prefetched.ok = load_data_from_files(state, c, prefetched.message);
+	if (!prefetched.ok) {
+		return;
+	}
+
+	// Get lon/lat for the gridcell
+	GridcellOrderedVariable* temp = state.prefetch_forcing.front();
+	if (temp->is_reduced()) {
+		temp->get_coords_for(c.landid, prefetched.lon, prefetched.lat);
 	}
 	else {
-		if (!cf_temp->load_data_for(rlon, rlat) ||
-		    !cf_prec->load_data_for(rlon, rlat) ||
-		    !cf_insol->load_data_for(rlon, rlat) ||
-		    (cf_wetdays && !cf_wetdays->load_data_for(rlon, rlat)) ||
-		    (cf_min_temp && !cf_min_temp->load_data_for(rlon, rlat)) ||
-		    (cf_max_temp && !cf_max_temp->load_data_for(rlon, rlat))) {
-			dprintf("Failed to load data for (%d, %d) from NetCDF files, skipping.\n", rlon, rlat);
+		temp->get_coords_for(c.rlon, c.rlat, prefetched.lon, prefetched.lat);
+	}
+
+	// cw SubPixel
+	// (the site and landform objects are shared by all threads, the
+	// lookups don't change them and are reported by load_gridcell)
+	prefetched.site_ok = false;
+	prefetched.landforms_ok = false;
+	if (run_landform) {
+		prefetched.site_ok = site_input.find_site(prefetched.lon, prefetched.lat, c.landid,
+		                                          prefetched.site);
+		prefetched.landforms_ok = landform_input.find_landforms(prefetched.lon, prefetched.lat, c.landid,
+		                                                        prefetched.landforms);
+	}
+}
+
+void SPInput::wait_for_prefetch(ThreadState& state) {
+	try {
+		state.prefetcher->wait();
+	}
+	catch (const std::runtime_error& e) {
+		fail(e.what());
+	}
+}
+
+bool SPInput::load_data_from_files(ThreadState& state, const Coord& c, xtring& message) {
+
+	int rlon = c.rlon;
+	int rlat = c.rlat;
+	int landid = c.landid;
+
+	const std::vector<GridcellOrderedVariable*>& prefetch_forcing = state.prefetch_forcing;
+	const std::vector<GridcellOrderedVariable*>& prefetch_ndep = state.prefetch_ndep;
+
+	if (forcing_cache.get()) {
+		// Locations with a reduced grid are stored as (landid, 0)
+		const bool reduced = prefetch_forcing.front()->is_reduced();
+		const int x = reduced ? landid : rlon;
+		const int y = reduced ? 0 : rlat;
+
+		if (!use_cached_data(*forcing_cache, cached_forcing, prefetch_forcing, x, y) ||
+		    !use_cached_data(*forcing_cache, cached_ndep, prefetch_ndep, x, y)) {
+			if (reduced) {
+				message.printf("No data for (%d) in forcing cache, skipping.\n", landid);
+			}
+			else {
+				message.printf("No data for (%d, %d) in forcing cache, skipping.\n", rlon, rlat);
+			}
 			return false;
 		}
+		return true;
 	}
 
-	if (cf_ndep_nhxdry->is_reduced()) {
-		if (!cf_ndep_nhxdry->load_data_for(landid) ||
-			!cf_ndep_nhxwet->load_data_for(landid) ||
-			!cf_ndep_noydry->load_data_for(landid) ||
-			!cf_ndep_noywet->load_data_for(landid)) {
-			dprintf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
-			return false;
+	// Try to load the data from the NetCDF files
+
+	if (!load_data_for(prefetch_forcing, rlon, rlat, landid)) {
+		if (prefetch_forcing.front()->is_reduced()) {
+			message.printf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
 		}
+		else {
+			message.printf("Failed to load data for (%d, %d) from NetCDF files, skipping.\n", rlon, rlat);
+		}
+		return false;
 	}
-	else {
-		if (!cf_ndep_nhxdry->load_data_for(rlon, rlat) ||
-			!cf_ndep_nhxwet->load_data_for(rlon, rlat) ||
-			!cf_ndep_noydry->load_data_for(rlon, rlat) ||
-			!cf_ndep_noywet->load_data_for(rlon, rlat)) {
-			dprintf("Failed to load data for (%d, %d) from NDep NetCDF files, skipping.\n", rlon, rlat);
+
+	if (!load_data_for(prefetch_ndep, rlon, rlat, landid)) {
+		if (prefetch_ndep.front()->is_reduced()) {
+			message.printf("Failed to load data for (%d) from NetCDF files, skipping.\n", landid);
+			return false;
+		}
+		else {
+			message.printf("Failed to load data for (%d, %d) from NDep NetCDF files, skipping.\n", rlon, rlat);
 		}
 	}
 	return true;
@@ -645,6 +1025,10 @@ void SPInput::get_yearly_data(std::vector<double>& data,
 	// Extract all values for this year, for one variable,
 	// either from spinup dataset or historical dataset
 
+	if (forcing_window_years > 0) {
+		load_year_window(cf_historic, historic_timestep);
+	}
+
 	int calendar_year = date.get_calendar_year();
 
 	if (is_daily(cf_historic)) {
@@ -770,26 +1154,26 @@ void SPInput::populate_daily_array(double* daily,
 	}
 }
 
-void SPInput::populate_daily_prec_array(long& seed) {
+void SPInput::populate_daily_prec_array(ThreadState& state, long& seed) {
 
 	// Get the data from spinup and/or historic
 	std::vector<double> prec_data;
-	get_yearly_data(prec_data, spinup_prec, cf_prec, historic_timestep_prec);
+	get_yearly_data(prec_data, state.spinup_prec, state.cf_prec, state.historic_timestep_prec);
 
 	std::vector<double> wetdays_data;
-	if (cf_wetdays) {
-		get_yearly_data(wetdays_data, spinup_wetdays, cf_wetdays, historic_timestep_wetdays);
+	if (state.cf_wetdays) {
+		get_yearly_data(wetdays_data, state.spinup_wetdays, state.cf_wetdays, state.historic_timestep_wetdays);
 	}
 
-	if (is_daily(cf_prec)) {
+	if (is_daily(state.cf_prec)) {
 		// Simply copy from data to daily, and if needed convert from
 		// precipitation rate to precipitation amount
 
 		for (size_t i = 0; i < prec_data.size(); ++i) {
-			dprec[i] = prec_data[i];
+			state.dprec[i] = prec_data[i];
 
 			if (!extensive_precipitation) {
-				dprec[i] *= SECONDS_PER_DAY;
+				state.dprec[i] *= SECONDS_PER_DAY;
 			}
 		}
 	}
@@ -804,68 +1188,68 @@ void SPInput::populate_daily_prec_array(long& seed) {
 			}
 		}
 
-		if (cf_wetdays) {
-			prdaily(&prec_data.front(), dprec, &wetdays_data.front(), seed);
+		if (state.cf_wetdays) {
+			prdaily(&prec_data.front(), state.dprec, &wetdays_data.front(), seed);
 		}
 		else {
-			interp_monthly_totals_conserve(&prec_data.front(), dprec, 0);
+			interp_monthly_totals_conserve(&prec_data.front(), state.dprec, 0);
 		}
 	}
 }
 
-void SPInput::populate_daily_arrays(long& seed) {
+void SPInput::populate_daily_arrays(ThreadState& state, long& seed) {
 	// Extract daily values for all days in this year, either from
 	// spinup dataset or historical dataset
 
-	populate_daily_array(dtemp, spinup_temp, cf_temp, historic_timestep_temp, 0);
-	populate_daily_prec_array(seed);
-	populate_daily_array(dinsol, spinup_insol, cf_insol, historic_timestep_insol, 0,
-	                     max_insolation(cf_standard_name_to_insoltype(cf_insol->get_standard_name())));
+	populate_daily_array(state.dtemp, state.spinup_temp, state.cf_temp, state.historic_timestep_temp, 0);
+	populate_daily_prec_array(state, seed);
+	populate_daily_array(state.dinsol, state.spinup_insol, state.cf_insol, state.historic_timestep_insol, 0,
+	                     max_insolation(insol_type));
 
-	if (cf_min_temp) {
-		populate_daily_array(dmin_temp, spinup_min_temp, cf_min_temp, historic_timestep_min_temp, 0);
+	if (state.cf_min_temp) {
+		populate_daily_array(state.dmin_temp, state.spinup_min_temp, state.cf_min_temp, state.historic_timestep_min_temp, 0);
 	}
 
-	if (cf_max_temp) {
-		populate_daily_array(dmax_temp, spinup_max_temp, cf_max_temp, historic_timestep_max_temp, 0);
+	if (state.cf_max_temp) {
+		populate_daily_array(state.dmax_temp, state.spinup_max_temp, state.cf_max_temp, state.historic_timestep_max_temp, 0);
 	}
 
 	// Convert to units the model expects
-	bool cloud_fraction_to_sunshine = (cf_standard_name_to_insoltype(cf_insol->get_standard_name()) == SUNSHINE);
+	bool cloud_fraction_to_sunshine = (insol_type == SUNSHINE);
 	for (int i = 0; i < date.year_length(); ++i) {
-		dtemp[i] -= K2degC;
+		state.dtemp[i] -= K2degC;
 
-		if (cf_min_temp) {
-			dmin_temp[i] -= K2degC;
+		if (state.cf_min_temp) {
+			state.dmin_temp[i] -= K2degC;
 		}
 
-		if (cf_max_temp) {
-			dmax_temp[i] -= K2degC;
+		if (state.cf_max_temp) {
+			state.dmax_temp[i] -= K2degC;
 		}
 
 		if (cloud_fraction_to_sunshine) {
 			// Invert from cloudiness to sunshine,
 			// and convert fraction (0-1) to percent (0-100)
-			dinsol[i] = (1-dinsol[i]) * 100.0;
+			state.dinsol[i] = (1-state.dinsol[i]) * 100.0;
 		}
 	}
 
 	// Move to next year in spinup dataset
 
-	spinup_temp.nextyear();
-	spinup_prec.nextyear();
-	spinup_insol.nextyear();
+	state.spinup_temp.nextyear();
+	state.spinup_prec.nextyear();
+	state.spinup_insol.nextyear();
 
-	if (cf_wetdays) {
-		spinup_wetdays.nextyear();
+	if (state.cf_wetdays) {
+		state.spinup_wetdays.nextyear();
 	}
 
-	if (cf_min_temp) {
-		spinup_min_temp.nextyear();
+	if (state.cf_min_temp) {
+		state.spinup_min_temp.nextyear();
 	}
 
-	if (cf_max_temp) {
-		spinup_max_temp.nextyear();
+	if (state.cf_max_temp) {
+		state.spinup_max_temp.nextyear();
 	}
 
 	// Get monthly ndep values and convert to daily
@@ -881,10 +1265,10 @@ void SPInput::populate_daily_arrays(long& seed) {
 	std::vector<double>dry;
 	std::vector<double>wet;
 
-	get_yearly_data(nhxdry, spinup_ndep_nhxdry, cf_ndep_nhxdry, historic_timestep_ndep_nhxdry);
-	get_yearly_data(nhxwet, spinup_ndep_nhxwet, cf_ndep_nhxwet, historic_timestep_ndep_nhxwet);
-	get_yearly_data(noydry, spinup_ndep_noydry, cf_ndep_noydry, historic_timestep_ndep_noydry);
-	get_yearly_data(noywet, spinup_ndep_noywet, cf_ndep_noywet, historic_timestep_ndep_noywet);
+	get_yearly_data(nhxdry, state.spinup_ndep_nhxdry, state.cf_ndep_nhxdry, state.historic_timestep_ndep_nhxdry);
+	get_yearly_data(nhxwet, state.spinup_ndep_nhxwet, state.cf_ndep_nhxwet, state.historic_timestep_ndep_nhxwet);
+	get_yearly_data(noydry, state.spinup_ndep_noydry, state.cf_ndep_noydry, state.historic_timestep_ndep_noydry);
+	get_yearly_data(noywet, state.spinup_ndep_noywet, state.cf_ndep_noywet, state.historic_timestep_ndep_noywet);
 
 	// make sure all vectors have the same length
 	assert(allequal(nhxdry.size(), nhxwet.size(), noydry.size(), noywet.size()));
@@ -907,48 +1291,49 @@ void SPInput::populate_daily_arrays(long& seed) {
 	std::copy(wet.begin(), wet.end(), mnwetdep);
 
 	// Distribute N deposition
-	distribute_ndep(mndrydep, mnwetdep, dprec, dndep);
+	distribute_ndep(mndrydep, mnwetdep, state.dprec, state.dndep);
 
-	spinup_ndep_nhxdry.nextyear();
-	spinup_ndep_nhxwet.nextyear();
-	spinup_ndep_noydry.nextyear();
-	spinup_ndep_noywet.nextyear();
+	state.spinup_ndep_nhxdry.nextyear();
+	state.spinup_ndep_nhxwet.nextyear();
+	state.spinup_ndep_noydry.nextyear();
+	state.spinup_ndep_noywet.nextyear();
 }
 
 void SPInput::getlandcover(Gridcell& gridcell) {
 
-	landcover_input.getlandcover(gridcell);
-	landcover_input.get_land_transitions(gridcell);
+	landuse_input.getlandcover(gridcell);
 }
 
 bool SPInput::getclimate(Gridcell& gridcell) {
 
 	Climate& climate = gridcell.climate;
 
+	ThreadState& state = thread_data();
+
 	GuessNC::CF::DateTime last_date = last_day_to_simulate(cf_temp);
 
 	if (later_day(date, last_date, cf_temp->get_paleo_offset())) {
-		++current_gridcell;
+		++state.position;
 		return false;
 	}
 
 	climate.co2 = co2[date.get_calendar_year()];
 
 	if (date.day == 0) {
-		populate_daily_arrays(gridcell.seed);
+		populate_daily_arrays(state, gridcell.seed);
 	}
 
-	climate.temp = dtemp[date.day];
-	climate.prec = dprec[date.day];
-	climate.insol = dinsol[date.day];
+	climate.temp = state.dtemp[date.day];
+	climate.prec = state.dprec[date.day];
+	climate.insol = state.dinsol[date.day];
 
 	// Nitrogen deposition
-	climate.dndep = dndep[date.day];
+	climate.dndep = state.dndep[date.day];
 
 	// bvoc
 	if(ifbvoc){
 		if (cf_min_temp && cf_max_temp) {
-			climate.dtr = dmax_temp[date.day] - dmin_temp[date.day];
+			climate.dtr = state.dmax_temp[date.day] - state.dmin_temp[date.day];
 		}
 		else {
 			fail("When BVOC is switched on, valid paths for minimum and maximum temperature must be given.");
@@ -961,6 +1346,8 @@ bool SPInput::getclimate(Gridcell& gridcell) {
 
 		// Progress report to user and update timer
 
+		std::lock_guard<std::mutex> lock(progress_mutex);
+
 		if (tmute.getprogress()>=1.0) {
 
 			int first_historic_year = cf_temp->get_date_time(0).get_year();
@@ -969,7 +1356,7 @@ bool SPInput::getclimate(Gridcell& gridcell) {
 
 			int years_to_simulate = nyear_spinup + historic_years;
 
-			int cells_done = distance(gridlist.begin(), current_gridcell);
+			int cells_done = simulation_position(state.position);
 
 			double progress=(double)(cells_done*years_to_simulate+date.year)/
 				(double)(gridlist.size()*years_to_simulate);
@@ -1126,9 +1513,14 @@ bool is_null(const GuessNC::CF::GridcellOrderedVariable* ptr) {
 	return ptr == 0;
 }
 
-}
-
-std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::all_variables() const {
+// Collects the forcing variables which are in use
+std::vector<GuessNC::CF::GridcellOrderedVariable*>
+used_variables(GuessNC::CF::GridcellOrderedVariable* cf_temp,
+               GuessNC::CF::GridcellOrderedVariable* cf_prec,
+               GuessNC::CF::GridcellOrderedVariable* cf_insol,
+               GuessNC::CF::GridcellOrderedVariable* cf_wetdays,
+               GuessNC::CF::GridcellOrderedVariable* cf_min_temp,
+               GuessNC::CF::GridcellOrderedVariable* cf_max_temp) {
 	std::vector<GuessNC::CF::GridcellOrderedVariable*> result;
 	result.push_back(cf_temp);
 	result.push_back(cf_prec);
@@ -1144,7 +1536,12 @@ std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::all_variables() cons
 	return result;
 }
 
-std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::ndep_variables() const {
+// Collects the nitrogen deposition variables which are in use
+std::vector<GuessNC::CF::GridcellOrderedVariable*>
+used_ndep_variables(GuessNC::CF::GridcellOrderedVariable* cf_ndep_nhxdry,
+                    GuessNC::CF::GridcellOrderedVariable* cf_ndep_nhxwet,
+                    GuessNC::CF::GridcellOrderedVariable* cf_ndep_noydry,
+                    GuessNC::CF::GridcellOrderedVariable* cf_ndep_noywet) {
 	std::vector<GuessNC::CF::GridcellOrderedVariable*> result;
 	result.push_back(cf_ndep_nhxdry);
 	result.push_back(cf_ndep_nhxwet);
@@ -1158,4 +1555,22 @@ std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::ndep_variables() con
 	return result;
 }
 
+}
+
+std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::all_variables() const {
+	return used_variables(cf_temp, cf_prec, cf_insol, cf_wetdays, cf_min_temp, cf_max_temp);
+}
+
+std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::ndep_variables() const {
+	return used_ndep_variables(cf_ndep_nhxdry, cf_ndep_nhxwet, cf_ndep_noydry, cf_ndep_noywet);
+}
+
+std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::ThreadState::all_variables() const {
+	return used_variables(cf_temp, cf_prec, cf_insol, cf_wetdays, cf_min_temp, cf_max_temp);
+}
+
+std::vector<GuessNC::CF::GridcellOrderedVariable*> SPInput::ThreadState::ndep_variables() const {
+	return used_ndep_variables(cf_ndep_nhxdry, cf_ndep_nhxwet, cf_ndep_noydry, cf_ndep_noywet);
+}
+
 #endif // HAVE_NETCDF
@@ -22,7 +22,10 @@ GenericSpinupData::GenericSpinupData()
 }
 
 void GenericSpinupData::get_data_from(RawData& source) {
-	data = source;
+	data.assign(source.size(), vector<value_type>());
+	for (size_t i = 0; i < source.size(); ++i) {
+		data[i].assign(source[i].begin(), source[i].end());
+	}
 
 	if (source.empty()) {
 		fail("No source data given to GenericSpinupData::get_data_from()");
@@ -230,6 +230,14 @@ public:
 	/// Datatype for the data, a 2D matrix of doubles
 	typedef std::vector<std::vector<double> > RawData;
 
+#ifdef FLOAT_FORCING
+	/// Type used to store the data, see the FLOAT_FORCING option in CMakeLists.txt
+	typedef float value_type;
+#else
+	/// Type used to store the data
+	typedef double value_type;
+#endif
+
 	GenericSpinupData();
 
 	/// Loads the underlying forcing data (and sets the "current" year to 0)
@@ -255,7 +263,7 @@ private:
 	int thisyear;
 
 	/// The forcing data which is used over and over during the spinup
-	RawData data;
+	std::vector<std::vector<value_type> > data;
 };
 
 #endif // LPJ_GUESS_SPINUP_DATA_H
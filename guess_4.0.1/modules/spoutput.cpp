@@ -88,6 +88,37 @@ SPOutput::~SPOutput() {
 void SPOutput::init() {
 
 	define_output_tables();
+
+	// use spoutput_startyear and spoutput_step to restrict output
+	if (spoutput_startyear != -1) {
+		set_schedule(OutputSchedule(spoutput_startyear + nyear_spinup, spoutput_step));
+	}
+
+	// Skip the sums which aren't written to any table
+
+	monthly_sums_needed =
+		!out_mnpp.invalid() || !out_mlai.invalid() || !out_mgpp.invalid() ||
+		!out_mra.invalid() || !out_maet.invalid() || !out_mpet.invalid() ||
+		!out_mevap.invalid() || !out_mrunoff.invalid() || !out_mintercep.invalid() ||
+		!out_mrh.invalid() || !out_mnee.invalid() || !out_mwcont_upper.invalid() ||
+		!out_mwcont_lower.invalid() || !out_mwcont_deep.invalid() || !out_miso.invalid() ||
+		!out_mmon.invalid() || !out_mfpc.invalid();
+
+	patch_sums_needed =
+		!out_cflux.invalid() || !out_doc.invalid() || !out_cpool.invalid() ||
+		!out_nsources.invalid() || !out_npool.invalid() || !out_nflux.invalid() ||
+		!out_ngases.invalid();
+
+	pft_sums_needed =
+		!out_cmass.invalid() || !out_anpp.invalid() || !out_agpp.invalid() ||
+		!out_fpc.invalid() || !out_aaet.invalid() || !out_dens.invalid() ||
+		!out_lai.invalid() || !out_clitter.invalid() || !out_speciesheights.invalid() ||
+		!out_aiso.invalid() || !out_amon.invalid() || !out_nmass.invalid() ||
+		!out_cton_leaf.invalid() || !out_nlitter.invalid() || !out_nuptake.invalid() ||
+		!out_vmaxnlim.invalid() || !out_cpool.invalid() || !out_npool.invalid();
+
+	patch_tables_needed = monthly_sums_needed || patch_sums_needed || pft_sums_needed ||
+		!out_runoff.invalid() || !out_firert.invalid();
 }
 
 
@@ -113,16 +144,14 @@ void SPOutput::define_output_tables() {
 	// create a vector with the crop pft names
 	std::vector<std::string> crop_pfts;
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		 Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		 Pft& pft=pftlist[p];
 
 		 pfts.push_back((char*)pft.name);
 
 		 if(pft.landcover==CROPLAND)
 			 crop_pfts.push_back((char*)pft.name);
 
-		 pftlist.nextobj();
 	}
 
     // cw REMOVE LATER
@@ -320,61 +349,61 @@ void SPOutput::define_output_tables() {
 	ngases_columns += ColumnDescriptor("Total",            9, 3);
 
 	// *** ANNUAL OUTPUT VARIABLES ***
-	create_output_table(out_cmass,          file_cmass,          cmass_columns);
-	create_output_table(out_anpp,           file_anpp,           anpp_columns);
-	create_output_table(out_agpp,           file_agpp,           agpp_columns);
-	create_output_table(out_fpc,            file_fpc,            fpc_columns);
-	create_output_table(out_aaet,           file_aaet,           aaet_columns);
-	create_output_table(out_dens,           file_dens,           dens_columns);
-	create_output_table(out_lai,            file_lai,            lai_columns);
-	create_output_table(out_cflux,          file_cflux,          cflux_columns);
-	create_output_table(out_doc,	        file_doc,			 doc_columns);
-	create_output_table(out_cpool,          file_cpool,          cpool_columns);
-	create_output_table(out_clitter,        file_clitter,        clitter_columns);
-
-	create_output_table(out_firert,         file_firert,         firert_columns);
-	create_output_table(out_runoff,         file_runoff,         runoff_columns);
-	create_output_table(out_speciesheights, file_speciesheights, speciesheights_columns);
-	create_output_table(out_aiso,           file_aiso,           aiso_columns);
-	create_output_table(out_amon,           file_amon,           amon_columns);
-
-	create_output_table(out_nmass,          file_nmass,          nmass_columns);
-	create_output_table(out_cton_leaf,      file_cton_leaf,      cton_columns);
-	create_output_table(out_nsources,       file_nsources,       nsources_columns);
-	create_output_table(out_npool,          file_npool,          npool_columns);
-	create_output_table(out_nlitter,        file_nlitter,        nlitter_columns);
-	create_output_table(out_nuptake,        file_nuptake,        nuptake_columns);
-	create_output_table(out_vmaxnlim,       file_vmaxnlim,       vmaxnlim_columns);
-	create_output_table(out_nflux,          file_nflux,          nflux_columns);
-	create_output_table(out_ngases,         file_ngases,         ngases_columns);
+	create_output_table(out_cmass,          file_cmass,          cmass_columns,          ROWS_PATCH);
+	create_output_table(out_anpp,           file_anpp,           anpp_columns,           ROWS_PATCH);
+	create_output_table(out_agpp,           file_agpp,           agpp_columns,           ROWS_PATCH);
+	create_output_table(out_fpc,            file_fpc,            fpc_columns,            ROWS_PATCH);
+	create_output_table(out_aaet,           file_aaet,           aaet_columns,           ROWS_PATCH);
+	create_output_table(out_dens,           file_dens,           dens_columns,           ROWS_PATCH);
+	create_output_table(out_lai,            file_lai,            lai_columns,            ROWS_PATCH);
+	create_output_table(out_cflux,          file_cflux,          cflux_columns,          ROWS_PATCH);
+	create_output_table(out_doc,	        file_doc,			 doc_columns,            ROWS_PATCH);
+	create_output_table(out_cpool,          file_cpool,          cpool_columns,          ROWS_PATCH);
+	create_output_table(out_clitter,        file_clitter,        clitter_columns,        ROWS_PATCH);
+
+	create_output_table(out_firert,         file_firert,         firert_columns,         ROWS_PATCH);
+	create_output_table(out_runoff,         file_runoff,         runoff_columns,         ROWS_PATCH);
+	create_output_table(out_speciesheights, file_speciesheights, speciesheights_columns, ROWS_PATCH);
+	create_output_table(out_aiso,           file_aiso,           aiso_columns,           ROWS_PATCH);
+	create_output_table(out_amon,           file_amon,           amon_columns,           ROWS_PATCH);
+
+	create_output_table(out_nmass,          file_nmass,          nmass_columns,          ROWS_PATCH);
+	create_output_table(out_cton_leaf,      file_cton_leaf,      cton_columns,           ROWS_PATCH);
+	create_output_table(out_nsources,       file_nsources,       nsources_columns,       ROWS_PATCH);
+	create_output_table(out_npool,          file_npool,          npool_columns,          ROWS_PATCH);
+	create_output_table(out_nlitter,        file_nlitter,        nlitter_columns,        ROWS_PATCH);
+	create_output_table(out_nuptake,        file_nuptake,        nuptake_columns,        ROWS_PATCH);
+	create_output_table(out_vmaxnlim,       file_vmaxnlim,       vmaxnlim_columns,       ROWS_PATCH);
+	create_output_table(out_nflux,          file_nflux,          nflux_columns,          ROWS_PATCH);
+	create_output_table(out_ngases,         file_ngases,         ngases_columns,         ROWS_PATCH);
 
 	// *** MONTHLY OUTPUT VARIABLES ***
 
-	create_output_table(out_mnpp,           file_mnpp,           month_columns);
-	create_output_table(out_mlai,           file_mlai,           month_columns);
-	create_output_table(out_mgpp,           file_mgpp,           month_columns);
-	create_output_table(out_mra,            file_mra,            month_columns);
-	create_output_table(out_maet,           file_maet,           month_columns);
-	create_output_table(out_mpet,           file_mpet,           month_columns);
-	create_output_table(out_mevap,          file_mevap,          month_columns);
-	create_output_table(out_mrunoff,        file_mrunoff,        month_columns_wide);
-	create_output_table(out_mintercep,      file_mintercep,      month_columns);
-	create_output_table(out_mrh,            file_mrh,            month_columns);
-	create_output_table(out_mnee,           file_mnee,           month_columns);
-	create_output_table(out_mwcont_upper,   file_mwcont_upper,   month_columns);
-	create_output_table(out_mwcont_lower,   file_mwcont_lower,   month_columns);
-    create_output_table(out_mwcont_deep,   file_mwcont_deep,   month_columns);
-	create_output_table(out_miso,           file_miso,           month_columns_wide);
-	create_output_table(out_mmon,           file_mmon,           month_columns_wide);
+	create_output_table(out_mnpp,           file_mnpp,           month_columns,          ROWS_PATCH);
+	create_output_table(out_mlai,           file_mlai,           month_columns,          ROWS_PATCH);
+	create_output_table(out_mgpp,           file_mgpp,           month_columns,          ROWS_PATCH);
+	create_output_table(out_mra,            file_mra,            month_columns,          ROWS_PATCH);
+	create_output_table(out_maet,           file_maet,           month_columns,          ROWS_PATCH);
+	create_output_table(out_mpet,           file_mpet,           month_columns,          ROWS_PATCH);
+	create_output_table(out_mevap,          file_mevap,          month_columns,          ROWS_PATCH);
+	create_output_table(out_mrunoff,        file_mrunoff,        month_columns_wide,     ROWS_PATCH);
+	create_output_table(out_mintercep,      file_mintercep,      month_columns,          ROWS_PATCH);
+	create_output_table(out_mrh,            file_mrh,            month_columns,          ROWS_PATCH);
+	create_output_table(out_mnee,           file_mnee,           month_columns,          ROWS_PATCH);
+	create_output_table(out_mwcont_upper,   file_mwcont_upper,   month_columns,          ROWS_PATCH);
+	create_output_table(out_mwcont_lower,   file_mwcont_lower,   month_columns,          ROWS_PATCH);
+    create_output_table(out_mwcont_deep,   file_mwcont_deep,   month_columns,          ROWS_PATCH);
+	create_output_table(out_miso,           file_miso,           month_columns_wide,     ROWS_PATCH);
+	create_output_table(out_mmon,           file_mmon,           month_columns_wide,     ROWS_PATCH);
 	// f_js_20170223 climate output
-	create_output_table(out_mtemp,          file_mtemp,          month_columns);
-	create_output_table(out_mprec,          file_mprec,          month_columns_wide);
-	create_output_table(out_mrad,           file_mrad,           month_columns);
-	create_output_table(out_mgdd5,          file_mgdd5,          month_columns_wide);
-	create_output_table(out_mndepo,         file_mndepo,         month_columns_wide);
+	create_output_table(out_mtemp,          file_mtemp,          month_columns,          ROWS_STAND);
+	create_output_table(out_mprec,          file_mprec,          month_columns_wide,     ROWS_STAND);
+	create_output_table(out_mrad,           file_mrad,           month_columns,          ROWS_STAND);
+	create_output_table(out_mgdd5,          file_mgdd5,          month_columns_wide,     ROWS_STAND);
+	create_output_table(out_mndepo,         file_mndepo,         month_columns_wide,     ROWS_STAND);
 
     // cw SubPixel extra output for LandLab
-    create_output_table(out_mfpc,           file_mfpc,           month_columns_wide);
+    create_output_table(out_mfpc,           file_mfpc,           month_columns_wide,     ROWS_PATCH);
 
 }
 
@@ -386,19 +415,12 @@ void SPOutput::define_output_tables() {
   * If only yearly output between, say 1961 and 1990 is requred, use:
   *  if (date.get_calendar_year() >= 1961 && date.get_calendar_year() <= 1990)
   *  (assuming the input module has set the first calendar year in the date object)
+  *
+  * The years given by spoutput_startyear and spoutput_step are handled by the
+  * schedule set in init(), outannual() isn't called at all for other years.
   */
-
-
 void outlimit_sp(OutputRows& out, const Table& table, double d) {
-    // use spoutput_startyear and spoutput_step to restrict output
-	if ( spoutput_startyear == -1 ) {
-		// do not restrict output
-		out.add_value(table, d);
-	} else {
-		// restrict output
-		if ( (date.year >= spoutput_startyear + nyear_spinup) && (date.get_calendar_year() % spoutput_step) == 0 )// nyear_spinup)
-			out.add_value(table, d);
-	}
+	out.add_value(table, d);
 }
 		
 
@@ -407,7 +429,8 @@ void outlimit_sp(OutputRows& out, const Table& table, double d) {
   * the simulation of each stand or grid cell.
   * This function does not have to provide any information to the framework.
   *
-  * Restrict output to specific years in the local helper function outlimit_sp().
+  * Only called for the years given by spoutput_startyear and spoutput_step,
+  * restrict output further in the local helper function outlimit_sp().
   *
   * Changes in the structure of this function should be mirrored in outannual()
   * of the other output modules, e.g. MiscOutput::outannual().
@@ -550,7 +573,7 @@ void SPOutput::outannual(Gridcell& gridcell) {
 		OutputRows out_st(output_channel, lon, lat, date.get_calendar_year(), -1, stand_id);
 
         // Loop through Patches
-        while (stand.isobj) {
+        while (stand.isobj && patch_tables_needed) {
             Patch& patch = stand.getobj();
             Vegetation& vegetation = patch.vegetation;
 
@@ -558,16 +581,14 @@ void SPOutput::outannual(Gridcell& gridcell) {
             active_fraction = 0.0;
             double all_pfts(0.0);
             
-            pftlist.firstobj();
-            while (pftlist.isobj) {
-                Pft& pft = pftlist.getobj();
+            for (int p = 0; p < npft; p++) {
+                Pft& pft = pftlist[p];
                 
                 // Determine area fraction of stands where this pft is active:
                 if (stand.pft[pft.id].active) {
                     active_fraction += 1;
                 }
                 all_pfts += 1.0;
-                pftlist.nextobj();
             }
 
             active_fraction /= all_pfts;
@@ -628,10 +649,9 @@ void SPOutput::outannual(Gridcell& gridcell) {
            
             
             // *** Loop through PFTs ***
-            pftlist.firstobj();
-            while (pftlist.isobj) {
+            for (int p = 0; p < npft && pft_sums_needed; p++) {
                 
-                Pft& pft=pftlist.getobj();
+                Pft& pft=pftlist[p];
                 
                 Patchpft& patchpft = patch.pft[pft.id];
 
@@ -758,7 +778,6 @@ void SPOutput::outannual(Gridcell& gridcell) {
                 mean_standpft_nuptake += standpft_nuptake / active_fraction;
                 mean_standpft_vmaxnlim += standpft_vmaxnlim / active_fraction;
 
-                pftlist.nextobj();
 
             } // *** End of PFT loop ***
             
@@ -784,119 +803,124 @@ void SPOutput::outannual(Gridcell& gridcell) {
 
             
             
-            // non veg data
-            flux_veg+=-patch.fluxes.get_annual_flux(Fluxes::NPP);
-            flux_repr+=-patch.fluxes.get_annual_flux(Fluxes::REPRC);
-            flux_soil+=patch.fluxes.get_annual_flux(Fluxes::SOILC);
-            flux_fire+=patch.fluxes.get_annual_flux(Fluxes::FIREC);
-            flux_est+=patch.fluxes.get_annual_flux(Fluxes::ESTC);
-            flux_seed+=patch.fluxes.get_annual_flux(Fluxes::SEEDC);
-            flux_charvest+=patch.fluxes.get_annual_flux(Fluxes::HARVESTC);
+            if (patch_sums_needed) {
+                // non veg data
+                flux_veg+=-patch.fluxes.get_annual_flux(Fluxes::NPP);
+                flux_repr+=-patch.fluxes.get_annual_flux(Fluxes::REPRC);
+                flux_soil+=patch.fluxes.get_annual_flux(Fluxes::SOILC);
+                flux_fire+=patch.fluxes.get_annual_flux(Fluxes::FIREC);
+                flux_est+=patch.fluxes.get_annual_flux(Fluxes::ESTC);
+                flux_seed+=patch.fluxes.get_annual_flux(Fluxes::SEEDC);
+                flux_charvest+=patch.fluxes.get_annual_flux(Fluxes::HARVESTC);
             
-            flux_nseed+=patch.fluxes.get_annual_flux(Fluxes::SEEDN);
-            flux_nharvest+=patch.fluxes.get_annual_flux(Fluxes::HARVESTN);
-            flux_nh3+=patch.fluxes.get_annual_flux(Fluxes::NH3_FIRE);
-            flux_nox+=patch.fluxes.get_annual_flux(Fluxes::NOx_FIRE);
-            flux_n2o+=patch.fluxes.get_annual_flux(Fluxes::N2O_FIRE);
-            flux_n2+=patch.fluxes.get_annual_flux(Fluxes::N2_FIRE);
-            flux_nsoil+=patch.fluxes.get_annual_flux(Fluxes::N_SOIL);
-            flux_ntot+=(patch.fluxes.get_annual_flux(Fluxes::NH3_FIRE) +
-                        patch.fluxes.get_annual_flux(Fluxes::NOx_FIRE) +
-                        patch.fluxes.get_annual_flux(Fluxes::N2O_FIRE) +
-                        patch.fluxes.get_annual_flux(Fluxes::N2_FIRE) +
-                        patch.fluxes.get_annual_flux(Fluxes::N_SOIL));
+                flux_nseed+=patch.fluxes.get_annual_flux(Fluxes::SEEDN);
+                flux_nharvest+=patch.fluxes.get_annual_flux(Fluxes::HARVESTN);
+                flux_nh3+=patch.fluxes.get_annual_flux(Fluxes::NH3_FIRE);
+                flux_nox+=patch.fluxes.get_annual_flux(Fluxes::NOx_FIRE);
+                flux_n2o+=patch.fluxes.get_annual_flux(Fluxes::N2O_FIRE);
+                flux_n2+=patch.fluxes.get_annual_flux(Fluxes::N2_FIRE);
+                flux_nsoil+=patch.fluxes.get_annual_flux(Fluxes::N_SOIL);
+                flux_ntot+=(patch.fluxes.get_annual_flux(Fluxes::NH3_FIRE) +
+                            patch.fluxes.get_annual_flux(Fluxes::NOx_FIRE) +
+                            patch.fluxes.get_annual_flux(Fluxes::N2O_FIRE) +
+                            patch.fluxes.get_annual_flux(Fluxes::N2_FIRE) +
+                            patch.fluxes.get_annual_flux(Fluxes::N_SOIL));
             
-            c_fast+=patch.soil.cpool_fast;
-            c_slow+=patch.soil.cpool_slow;
+                c_fast+=patch.soil.cpool_fast;
+                c_slow+=patch.soil.cpool_slow;
             
-            surfrunoff_gridcell+=patch.asurfrunoff * (stand.landform.fraction * 0.01);
-            drainrunoff_gridcell+=patch.adrainrunoff * (stand.landform.fraction * 0.01);
-            baserunoff_gridcell+=patch.abaserunoff * (stand.landform.fraction * 0.01);
-            runoff_gridcell+=patch.arunoff * (stand.landform.fraction * 0.01);
+                surfrunoff_gridcell+=patch.asurfrunoff * (stand.landform.fraction * 0.01);
+                drainrunoff_gridcell+=patch.adrainrunoff * (stand.landform.fraction * 0.01);
+                baserunoff_gridcell+=patch.abaserunoff * (stand.landform.fraction * 0.01);
+                runoff_gridcell+=patch.arunoff * (stand.landform.fraction * 0.01);
             
-            // Fire return time
-            if (!patch.has_fires() || patch.fireprob < 0.001)
-                firert_gridcell+=1000.0; // Set a limit of 1000 years
-            else
-                firert_gridcell+=(1.0/patch.fireprob);
+                // Fire return time
+                if (!patch.has_fires() || patch.fireprob < 0.001)
+                    firert_gridcell+=1000.0; // Set a limit of 1000 years
+                else
+                    firert_gridcell+=(1.0/patch.fireprob);
             
             
-            andep_gridcell += stand.get_climate().andep;
-            anfert_gridcell += patch.anfert;
-            anmin_gridcell += patch.soil.anmin;
-            animm_gridcell += patch.soil.animmob;
-            anfix_gridcell += patch.soil.anfix;
-            n_min_leach_gridcell += patch.soil.aminleach;
-            n_org_leach_gridcell += patch.soil.aorgNleach;
-            c_org_leach_gridcell += patch.soil.aorgCleach;
-            availn += (patch.soil.nmass_avail + patch.soil.snowpack_nmass);
+                andep_gridcell += stand.get_climate().andep;
+                anfert_gridcell += patch.anfert;
+                anmin_gridcell += patch.soil.anmin;
+                animm_gridcell += patch.soil.animmob;
+                anfix_gridcell += patch.soil.anfix;
+                n_min_leach_gridcell += patch.soil.aminleach;
+                n_org_leach_gridcell += patch.soil.aorgNleach;
+                c_org_leach_gridcell += patch.soil.aorgCleach;
+                availn += (patch.soil.nmass_avail + patch.soil.snowpack_nmass);
             
-            c_org_leach_lc[stand.landcover] += patch.soil.aorgCleach;
+                c_org_leach_lc[stand.landcover] += patch.soil.aorgCleach;
             
-            for (int r = 0; r < NSOMPOOL-1; r++) {
+                for (int r = 0; r < NSOMPOOL-1; r++) {
                 
-                if(r == SURFMETA || r == SURFSTRUCT || r == SOILMETA || r == SOILSTRUCT){
-                    surfsoillitterc += patch.soil.sompool[r].cmass;
-                    surfsoillittern += patch.soil.sompool[r].nmass;
-                }
-                else if (r == SURFFWD || r == SURFCWD) {
-                    cwdc += patch.soil.sompool[r].cmass;
-                    cwdn += patch.soil.sompool[r].nmass;
-                }
-                else {
-                    centuryc += patch.soil.sompool[r].cmass;
-                    centuryn += patch.soil.sompool[r].nmass;
+                    if(r == SURFMETA || r == SURFSTRUCT || r == SOILMETA || r == SOILSTRUCT){
+                        surfsoillitterc += patch.soil.sompool[r].cmass;
+                        surfsoillittern += patch.soil.sompool[r].nmass;
+                    }
+                    else if (r == SURFFWD || r == SURFCWD) {
+                        cwdc += patch.soil.sompool[r].cmass;
+                        cwdn += patch.soil.sompool[r].nmass;
+                    }
+                    else {
+                        centuryc += patch.soil.sompool[r].cmass;
+                        centuryn += patch.soil.sompool[r].nmass;
+                    }
                 }
             }
-            
-            // Monthly output variables
 
-            for (m=0;m<12;m++) {
-                maet[m] += patch.maet[m];
-                mpet[m] += patch.mpet[m];
-                mevap[m] += patch.mevap[m];
-                mintercep[m] += patch.mintercep[m];
-                mrunoff[m] += patch.mrunoff[m];
-                mrh[m] += patch.fluxes.get_monthly_flux(Fluxes::SOILC, m);
-                mwcont_upper[m] += patch.soil.mwcont[m][0];
-                mwcont_lower[m] += patch.soil.mwcont[m][1];
-                mwcont_deep[m] += patch.soil.mwcont_deep[m];
-
-                mgpp[m] += patch.fluxes.get_monthly_flux(Fluxes::GPP, m);
-                mra[m] += patch.fluxes.get_monthly_flux(Fluxes::RA, m);
+            
+            if (monthly_sums_needed) {
+                // Monthly output variables
+
+                for (m=0;m<12;m++) {
+                    maet[m] += patch.maet[m];
+                    mpet[m] += patch.mpet[m];
+                    mevap[m] += patch.mevap[m];
+                    mintercep[m] += patch.mintercep[m];
+                    mrunoff[m] += patch.mrunoff[m];
+                    mrh[m] += patch.fluxes.get_monthly_flux(Fluxes::SOILC, m);
+                    mwcont_upper[m] += patch.soil.mwcont[m][0];
+                    mwcont_lower[m] += patch.soil.mwcont[m][1];
+                    mwcont_deep[m] += patch.soil.mwcont_deep[m];
+
+                    mgpp[m] += patch.fluxes.get_monthly_flux(Fluxes::GPP, m);
+                    mra[m] += patch.fluxes.get_monthly_flux(Fluxes::RA, m);
                 
-                miso[m]+=patch.fluxes.get_monthly_flux(Fluxes::ISO, m);
-                mmon[m]+=patch.fluxes.get_monthly_flux(Fluxes::MON, m);
-            }
+                    miso[m]+=patch.fluxes.get_monthly_flux(Fluxes::ISO, m);
+                    mmon[m]+=patch.fluxes.get_monthly_flux(Fluxes::MON, m);
+                }
             
             
-            // Calculate monthly NPP and LAI
-            vegetation.firstobj();
-            while (vegetation.isobj) {
-                Individual& indiv = vegetation.getobj();
+                // Calculate monthly NPP and LAI
+                vegetation.firstobj();
+                while (vegetation.isobj) {
+                    Individual& indiv = vegetation.getobj();
                 
-                // guess2008 - alive check added
-                if (indiv.id != -1 && indiv.alive) {
+                    // guess2008 - alive check added
+                    if (indiv.id != -1 && indiv.alive) {
                     
-                    for (m=0;m<12;m++) {
-                        mlai[m] += indiv.mlai[m];
-                        mfpc[m] += indiv.mfpc[m];
-                    }
+                        for (m=0;m<12;m++) {
+                            mlai[m] += indiv.mlai[m];
+                            mfpc[m] += indiv.mfpc[m];
+                        }
                     
-                } // alive?
+                    } // alive?
                 
-                vegetation.nextobj();
+                    vegetation.nextobj();
                 
-            } // while/vegetation loop
+                } // while/vegetation loop
             
-            // In contrast to annual NEE, monthly NEE does not include fire
-            // or establishment fluxes
-            for (m=0;m<12;m++) {
-                mnpp[m] = mgpp[m] - mra[m];
-                mnee[m] = mrh[m] - mnpp[m];
+                // In contrast to annual NEE, monthly NEE does not include fire
+                // or establishment fluxes
+                for (m=0;m<12;m++) {
+                    mnpp[m] = mgpp[m] - mra[m];
+                    mnee[m] = mrh[m] - mnpp[m];
                 
-                // cw SubPixel
-                mfpc[m] = min(mfpc[m], 1.0);
+                    // cw SubPixel
+                    mfpc[m] = min(mfpc[m], 1.0);
+                }
             }
             
 
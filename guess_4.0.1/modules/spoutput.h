@@ -77,6 +77,20 @@ private:
 	
 	// extra summary tables
 	Table out_site;
+
+	// Which parts of outannual are needed for the created tables, set in init
+
+	/// The loop summing vegetation per PFT, for the PFT tables and VegC/VegN in cpool and npool
+	bool pft_sums_needed;
+
+	/// The sums of fluxes and soil pools in each patch
+	bool patch_sums_needed;
+
+	/// The monthly sums in each patch
+	bool monthly_sums_needed;
+
+	/// Whether any table has a row per patch
+	bool patch_tables_needed;
 };
 
 }
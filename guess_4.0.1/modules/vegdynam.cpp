@@ -195,9 +195,8 @@ void establishment_lpj(Stand& stand,Patch& patch) {
 	// Loop through all possible PFTs to determine whether there are any not currently
 	// present but within their bioclimatic limits for establishment
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pft=pftlist[p];
 
 		if (stand.pft[pft.id].active) {	//standpft.active is set in landcover_init according to rules for each stand
 
@@ -227,7 +226,6 @@ void establishment_lpj(Stand& stand,Patch& patch) {
 				}
 			}
 		}
-		pftlist.nextobj(); // ... on to next PFT
 	}
 
 	// Calculate total FPC and number of PFT's (i.e. average individuals) establishing
@@ -438,9 +436,8 @@ void establishment_guess(Stand& stand,Patch& patch) {
 	// guess2008 - determine the number of woody PFTs that can establish
 	// Thomas Hickler
 	int nwoodypfts_estab=0;
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pft=pftlist[p];
 		Standpft& standpft=stand.pft[pft.id];
 
 		bool force_planting = patch.plant_this_year && standpft.plant;
@@ -457,7 +454,6 @@ void establishment_guess(Stand& stand,Patch& patch) {
       est_max_all.push_back(pft.est_max); // f_js_20170504
     }
     // f_js_20170118-
-		pftlist.nextobj();
 	}
 
   //f_js_20170504+
@@ -478,9 +474,8 @@ void establishment_guess(Stand& stand,Patch& patch) {
 
 	// Loop through PFTs
 
-	pftlist.firstobj();
-	while (pftlist.isobj) {
-		Pft& pft=pftlist.getobj();
+	for (int p = 0; p < npft; p++) {
+		Pft& pft=pftlist[p];
 		Standpft& standpft=stand.pft[pft.id];
 
 		// For this PFT ...
@@ -728,7 +723,6 @@ void establishment_guess(Stand& stand,Patch& patch) {
 		}
 
 		// ... on to next PFT
-		pftlist.nextobj();
 	}
 }
 
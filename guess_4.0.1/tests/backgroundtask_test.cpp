@@ -0,0 +1,62 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file backgroundtask_test.cpp
+/// \brief Unit tests for BackgroundTask
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "backgroundtask.h"
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("BackgroundTask", "Tests for BackgroundTask") {
+
+	BackgroundTask background;
+
+	// Nothing to wait for yet
+	background.wait();
+
+	// Each task runs once, after the previous one, and is done when wait() returns
+	std::vector<int> done;
+	for (int i = 0; i < 100; i++) {
+		background.start([&done, i]() {
+			done.push_back(i);
+		});
+	}
+	background.wait();
+
+	bool all_ok = done.size() == 100;
+	for (size_t i = 0; i < done.size(); i++) {
+		if (done[i] != (int)i) {
+			all_ok = false;
+		}
+	}
+	REQUIRE(all_ok);
+
+	// Exceptions are passed on by wait(), once
+	background.start([]() {
+		throw std::runtime_error("failed");
+	});
+	REQUIRE_THROWS_AS(background.wait(), std::runtime_error);
+	REQUIRE_NOTHROW(background.wait());
+
+	// The thread still works after an exception, and the destructor
+	// waits for the last task
+	int value = 0;
+	{
+		BackgroundTask other;
+		other.start([&value]() {
+			value = 1;
+		});
+	}
+	REQUIRE(value == 1);
+}
@@ -116,6 +116,7 @@ TEST_CASE("CF::DateTime/add_time", "Tests the DateTime::add_time function") {
 	start_tm.tm_mday = 2;
 	start_tm.tm_mon = 2;
 	start_tm.tm_year = 82;
+	start_tm.tm_isdst = 0;
 
 	time_t end_t = mktime(&start_tm)+25*365*24*3600;
 	tm* end_tm = localtime(&end_t);
@@ -0,0 +1,314 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file cfvariable_test.cpp
+/// \brief Unit tests for reading GridcellOrderedVariables and their tile cache
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#ifdef HAVE_NETCDF
+
+#include "guessnc.h"
+#include <netcdf.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace GuessNC::CF;
+
+namespace {
+
+const char* FILENAME = "cfvariable_test.nc";
+
+const size_t NX = 5;
+const size_t NY = 3;
+const size_t NT = 10;
+
+/// Value stored for a location and timestep in the test file
+double test_value(size_t x, size_t y, size_t t) {
+	return y * 1000 + x * 100 + t;
+}
+
+void check(int status) {
+	REQUIRE(status == NC_NOERR);
+}
+
+void put_text(int ncid, int varid, const char* name, const char* text) {
+	check(nc_put_att_text(ncid, varid, name, strlen(text), text));
+}
+
+/// Writes two daily variables on a 5x3 grid, tas chunked 2x2 locations, so
+/// the tiles along the last column and row are smaller than the others
+void create_test_file() {
+	int ncid;
+	check(nc_create(FILENAME, NC_NETCDF4 | NC_CLOBBER, &ncid));
+
+	int dim_time, dim_lat, dim_lon;
+	check(nc_def_dim(ncid, "time", NT, &dim_time));
+	check(nc_def_dim(ncid, "lat", NY, &dim_lat));
+	check(nc_def_dim(ncid, "lon", NX, &dim_lon));
+
+	int time, lat, lon;
+	check(nc_def_var(ncid, "time", NC_DOUBLE, 1, &dim_time, &time));
+	put_text(ncid, time, "units", "days since 2000-01-01 00:00:00");
+	put_text(ncid, time, "calendar", "noleap");
+	put_text(ncid, time, "standard_name", "time");
+
+	check(nc_def_var(ncid, "lat", NC_DOUBLE, 1, &dim_lat, &lat));
+	put_text(ncid, lat, "units", "degrees_north");
+	put_text(ncid, lat, "standard_name", "latitude");
+
+	check(nc_def_var(ncid, "lon", NC_DOUBLE, 1, &dim_lon, &lon));
+	put_text(ncid, lon, "units", "degrees_east");
+	put_text(ncid, lon, "standard_name", "longitude");
+
+	const int dims[] = { dim_time, dim_lat, dim_lon };
+	int tas;
+	check(nc_def_var(ncid, "tas", NC_FLOAT, 3, dims, &tas));
+	put_text(ncid, tas, "units", "K");
+	put_text(ncid, tas, "standard_name", "air_temperature");
+
+	const size_t chunks[] = { NT, 2, 2 };
+	check(nc_def_var_chunking(ncid, tas, NC_CHUNKED, chunks));
+
+	// A second variable in the same file, with the values negated,
+	// and a missing value in the last timestep of the last location
+	int pr;
+	check(nc_def_var(ncid, "pr", NC_FLOAT, 3, dims, &pr));
+	put_text(ncid, pr, "units", "kg m-2 s-1");
+	put_text(ncid, pr, "standard_name", "precipitation_flux");
+	const float missing_value = 1e20f;
+	check(nc_put_att_float(ncid, pr, "missing_value", NC_FLOAT, 1, &missing_value));
+
+	check(nc_enddef(ncid));
+
+	std::vector<double> values;
+	for (size_t t = 0; t < NT; ++t) {
+		values.push_back(t);
+	}
+	check(nc_put_var_double(ncid, time, &values.front()));
+
+	values.clear();
+	for (size_t y = 0; y < NY; ++y) {
+		values.push_back(50.25 + y * 0.5);
+	}
+	check(nc_put_var_double(ncid, lat, &values.front()));
+
+	values.clear();
+	for (size_t x = 0; x < NX; ++x) {
+		values.push_back(10.25 + x * 0.5);
+	}
+	check(nc_put_var_double(ncid, lon, &values.front()));
+
+	values.clear();
+	for (size_t t = 0; t < NT; ++t) {
+		for (size_t y = 0; y < NY; ++y) {
+			for (size_t x = 0; x < NX; ++x) {
+				values.push_back(test_value(x, y, t));
+			}
+		}
+	}
+	check(nc_put_var_double(ncid, tas, &values.front()));
+
+	for (size_t i = 0; i < values.size(); ++i) {
+		values[i] = -values[i];
+	}
+	values.back() = missing_value;
+	check(nc_put_var_double(ncid, pr, &values.front()));
+
+	check(nc_close(ncid));
+}
+
+/// Loads a location and checks that all its values are the ones written
+bool load_and_verify(GridcellOrderedVariable& variable, size_t x, size_t y) {
+	if (!variable.load_data_for(x, y)) {
+		return false;
+	}
+	for (size_t t = 0; t < NT; ++t) {
+		if (variable.get_value(t) != test_value(x, y, t)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Loads the first window of a location and checks its values
+bool load_and_verify_window(GridcellOrderedVariable& variable, size_t x, size_t y) {
+	if (!variable.load_data_for(x, y)) {
+		return false;
+	}
+	for (size_t t = 0; t < 4; ++t) {
+		if (variable.get_value(t) != test_value(x, y, t)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Loads every location, row by row
+bool load_all(GridcellOrderedVariable& variable) {
+	for (size_t y = 0; y < NY; ++y) {
+		for (size_t x = 0; x < NX; ++x) {
+			if (!load_and_verify(variable, x, y)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+}
+
+TEST_CASE("CF::GridcellOrderedVariable/tiles", "Tests the tile cache of GridcellOrderedVariable") {
+
+	create_test_file();
+
+	const size_t location_bytes = NT * sizeof(GridcellOrderedVariable::value_type);
+
+	{
+		GridcellOrderedVariable variable(FILENAME, "tas");
+
+		const size_t default_size = GridcellOrderedVariable::DEFAULT_TILE_CACHE_BYTES;
+		REQUIRE(variable.get_tile_cache_size() == default_size);
+		REQUIRE(variable.get_cached_tiles() == 0);
+
+		SECTION("whole", "All tiles fit in the cache") {
+			REQUIRE(load_all(variable));
+
+			// 3x2 tiles, the ones in the last column and row are cut off at the edge
+			REQUIRE(variable.get_cached_tiles() == 6);
+			REQUIRE(variable.get_tile_cache_usage() == NX * NY * location_bytes);
+
+			// Reading again is done from the cache
+			REQUIRE(load_and_verify(variable, 4, 2));
+			REQUIRE(load_and_verify(variable, 0, 0));
+			REQUIRE(variable.get_cached_tiles() == 6);
+		}
+
+		SECTION("eviction", "The least recently used tiles are dropped") {
+			// Room for four whole tiles
+			variable.set_tile_cache_size(16 * location_bytes);
+			REQUIRE(variable.get_tile_cache_size() == 16 * location_bytes);
+
+			REQUIRE(load_all(variable));
+			REQUIRE(variable.get_cached_tiles() == 4);
+			REQUIRE(variable.get_tile_cache_usage() <= 16 * location_bytes);
+
+			// Dropped tiles are read again
+			REQUIRE(load_and_verify(variable, 0, 0));
+			REQUIRE(load_and_verify(variable, 1, 1));
+			REQUIRE(variable.get_cached_tiles() == 4);
+			REQUIRE(variable.get_tile_cache_usage() <= 16 * location_bytes);
+		}
+
+		SECTION("small", "Chunks too big for the cache are read in smaller tiles") {
+			// A tile may only use a quarter of the cache, so two locations
+			variable.set_tile_cache_size(8 * location_bytes);
+
+			REQUIRE(load_and_verify(variable, 0, 0));
+			REQUIRE(variable.get_tile_cache_usage() == 2 * location_bytes);
+
+			// The chunk is split along x, so (1,0) is read separately...
+			REQUIRE(load_and_verify(variable, 1, 0));
+			REQUIRE(variable.get_cached_tiles() == 2);
+
+			// ...and (0,1) comes with (0,0)
+			REQUIRE(load_and_verify(variable, 0, 1));
+			REQUIRE(variable.get_cached_tiles() == 2);
+
+			// At the bottom edge only one location is left
+			REQUIRE(load_and_verify(variable, 4, 2));
+			REQUIRE(variable.get_tile_cache_usage() == 5 * location_bytes);
+
+			REQUIRE(load_all(variable));
+			REQUIRE(variable.get_tile_cache_usage() <= 8 * location_bytes);
+		}
+
+		SECTION("none", "Without a cache one location at a time is read") {
+			variable.set_tile_cache_size(0);
+
+			REQUIRE(load_all(variable));
+			REQUIRE(variable.get_cached_tiles() == 1);
+			REQUIRE(variable.get_tile_cache_usage() == location_bytes);
+		}
+
+		SECTION("streaming", "The tiles only hold the first window") {
+			variable.set_tile_cache_size(16 * location_bytes);
+			variable.set_streaming(4, 4);
+			REQUIRE(variable.get_cached_tiles() == 0);
+
+			REQUIRE(variable.load_data_for(4, 1));
+			REQUIRE(variable.get_value(3) == test_value(4, 1, 3));
+
+			variable.load_window(8);
+			REQUIRE(variable.get_value(9) == test_value(4, 1, 9));
+
+			// Only the first window is cached (in the tile at the right edge,
+			// with 2 locations), the later ones are read for the location alone
+			const size_t window_bytes = 4 * sizeof(GridcellOrderedVariable::value_type);
+			REQUIRE(variable.get_cached_tiles() == 1);
+			REQUIRE(variable.get_tile_cache_usage() == 2 * window_bytes);
+
+			// The first windows of other locations are cached as usual
+			REQUIRE(load_and_verify_window(variable, 4, 0));
+			REQUIRE(variable.get_cached_tiles() == 1);
+			REQUIRE(load_and_verify_window(variable, 0, 2));
+			REQUIRE(variable.get_cached_tiles() == 2);
+		}
+	}
+
+	remove(FILENAME);
+}
+
+TEST_CASE("CF::load_data_for", "Tests loading several variables at once") {
+
+	create_test_file();
+
+	{
+		REQUIRE(!GuessNC::library_locked());
+
+		// The variables share the file, so the lock is needed to read them
+		GuessNC::LibraryLock lock;
+		REQUIRE(GuessNC::library_locked());
+
+		GridcellOrderedVariable tas(FILENAME, "tas");
+		GridcellOrderedVariable pr(FILENAME, "pr");
+
+		std::vector<GridcellOrderedVariable*> variables;
+		variables.push_back(&tas);
+		variables.push_back(&pr);
+
+		REQUIRE(load_data_for(variables, 3, 1, 0));
+		for (size_t t = 0; t < NT; ++t) {
+			REQUIRE(tas.get_value(t) == test_value(3, 1, t));
+			REQUIRE(pr.get_value(t) == -test_value(3, 1, t));
+		}
+
+		// Outside the grid
+		REQUIRE(!load_data_for(variables, NX, 0, 0));
+
+		// The missing value is found both when reading the whole record...
+		REQUIRE(!pr.load_data_for(NX - 1, NY - 1));
+		REQUIRE(pr.load_data_for(NX - 2, NY - 1));
+
+		// ...and, before the window with it is read, when streaming
+		pr.set_streaming(4, 4);
+		REQUIRE(!pr.load_data_for(NX - 1, NY - 1));
+		REQUIRE(pr.load_data_for(NX - 2, NY - 1));
+		pr.load_window(8);
+		REQUIRE(pr.get_value(9) == -test_value(NX - 2, NY - 1, 9));
+	}
+
+	REQUIRE(!GuessNC::library_locked());
+
+	remove(FILENAME);
+}
+
+#endif // HAVE_NETCDF
@@ -16,7 +16,9 @@
 #include "catch.hpp"
 
 #include "driver.h"
+#include "archive.h"
 #include <algorithm>
+#include <sstream>
 #include <vector>
 
 namespace {
@@ -70,6 +72,14 @@ bool verify_prdaily_single_month(double prec, double wetdays) {
 	return true;
 }
 
+/// The serialized state of a Climate object
+std::string serialized(Climate& climate) {
+	std::ostringstream os;
+	ArchiveOutStream aos(os);
+	climate.serialize(aos);
+	return os.str();
+}
+
 bool verify_interp_monthly_means_conserve(const double* mvals,
                                           double minimum = -std::numeric_limits<double>::max(),
                                           double maximum = std::numeric_limits<double>::max()) {
@@ -153,3 +163,99 @@ TEST_CASE("climate/interp_monthly_means_conserve", "Tests the monthly to daily i
 
 	REQUIRE(verify_interp_monthly_means_conserve(test1, 0, 40));
 }
+
+TEST_CASE("climate/clone", "Tests that clone copies the serialized state") {
+
+	Gridcell gridcell;
+	Climate& climate = gridcell.climate;
+
+	climate.initdrivers(55.75);
+	climate.instype = SUNSHINE;
+	climate.co2 = 370;
+
+	// Some history and cached solar geometry
+	Date saved_date = date;
+	date.init(1);
+	for (int d = 0; d < date.year_length(); d++) {
+		climate.temp = 10 + d % 7;
+		climate.prec = d % 3;
+		climate.insol = 40;
+		climate.dtemp_31.add(climate.temp);
+		climate.dprec_31.add(climate.prec);
+		daylengthinsoleet(climate);
+		climate.deet_31.add(climate.eet);
+		climate.hmtemp_20[d % 12].add(climate.temp);
+		climate.mtemp_20[d % 20][d % 12] = climate.temp;
+		date.next();
+	}
+	date = saved_date;
+
+	Climate local_climate(gridcell);
+	local_climate.initdrivers(-30);
+
+	climate.clone(gridcell, local_climate);
+
+	REQUIRE(serialized(local_climate) == serialized(climate));
+}
+
+TEST_CASE("climate/solar_geometry", "Tests the shared solar geometry") {
+
+	std::shared_ptr<const SolarGeometry> geometry = get_solar_geometry(55.75, 365);
+
+	// Shared between callers asking for the same latitude
+	REQUIRE(get_solar_geometry(55.75, 365) == geometry);
+	REQUIRE(get_solar_geometry(-55.75, 365) != geometry);
+
+	// Longest day at the June solstice
+	const int longest = (int)(std::max_element(geometry->daylength, geometry->daylength + 365) - geometry->daylength);
+	REQUIRE(longest == 172);
+
+	// About twelve hours every day at the equator
+	std::shared_ptr<const SolarGeometry> equator = get_solar_geometry(0, 365);
+	REQUIRE(*std::min_element(equator->daylength, equator->daylength + 365) == Approx(12));
+	REQUIRE(*std::max_element(equator->daylength, equator->daylength + 365) == Approx(12));
+
+	// Polar night and polar day
+	std::shared_ptr<const SolarGeometry> arctic = get_solar_geometry(80, 365);
+	REQUIRE(arctic->daylength[0] == 0);
+	REQUIRE(arctic->daylength[172] == 24);
+}
+
+TEST_CASE("climate/daylengthinsoleet", "Tests daylength and radiation against the equations") {
+
+	Gridcell gridcell;
+	Climate& climate = gridcell.climate;
+
+	const double lat = 55.75;
+	climate.initdrivers(lat);
+	climate.instype = SUNSHINE;
+	climate.insol = 40;
+	climate.temp = 10;
+
+	Date saved_date = date;
+	date.init(2);
+	for (int y = 0; y < 2; y++) {
+		for (int d = 0; d < date.year_length(); d++) {
+			daylengthinsoleet(climate);
+
+			// Eqns 2, 4 and 9-14 in daylengthinsoleet
+			const double qo = 1360.0 * (1.0 + 2.0 * 0.01675 * cos(2.0 * PI * (d + 0.5) / date.year_length()));
+			const double delta = -23.4 * DEGTORAD * cos(2.0 * PI * (d + 10.5) / date.year_length());
+			const double u = sin(lat * DEGTORAD) * sin(delta);
+			const double v = cos(lat * DEGTORAD) * cos(delta);
+			const double hh = u >= v ? PI : (u <= -v ? 0.0 : acos(-u / v));
+			const double w = (0.25 + 0.5 * climate.insol / 100.0) * (1.0 - 0.17) * qo;
+
+			REQUIRE(climate.daylength == Approx(24.0 * hh / PI));
+			REQUIRE(climate.rad == Approx(2.0 * w * (u * hh + v * sin(hh)) * 13750.98708));
+
+			date.next();
+		}
+	}
+	date = saved_date;
+
+	// The geometry is looked up once, and kept until initdrivers
+	REQUIRE(climate.solar_geometry == get_solar_geometry(lat, Date::MAX_YEAR_LENGTH));
+	climate.initdrivers(lat);
+	REQUIRE(!climate.solar_geometry);
+}
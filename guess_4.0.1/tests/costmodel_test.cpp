@@ -0,0 +1,113 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file costmodel_test.cpp
+/// \brief Unit tests for the grid cell cost model and gridlist partitioning
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "costmodel.h"
+#include <algorithm>
+
+namespace {
+
+GridcellTiming make_timing(double seconds, int patches, int years) {
+	GridcellTiming timing;
+	timing.lon = 12.25;
+	timing.lat = -47.75;
+	timing.seconds = seconds;
+	timing.patches = patches;
+	timing.years = years;
+	timing.subdaily = 1;
+	return timing;
+}
+
+}
+
+TEST_CASE("costmodel/timing", "Log file lines for grid cell timings") {
+	GridcellTiming timing = make_timing(123.5, 40, 1600);
+
+	std::string line = "  " + format_gridcell_timing(timing);
+
+	GridcellTiming parsed;
+	REQUIRE(parse_gridcell_timing(line.c_str(), parsed));
+	REQUIRE(parsed.lon == Approx(12.25));
+	REQUIRE(parsed.lat == Approx(-47.75));
+	REQUIRE(parsed.seconds == Approx(123.5));
+	REQUIRE(parsed.patches == 40);
+	REQUIRE(parsed.years == 1600);
+	REQUIRE(parsed.subdaily == 1);
+
+	REQUIRE(!parse_gridcell_timing("End of year: 12 (1913) co2:300.00 ndep:1.00", parsed));
+}
+
+TEST_CASE("costmodel/calibrate", "Fitting the cost model to timings") {
+	GridcellCostModel model;
+
+	// Uncalibrated, the cost is the work
+	REQUIRE(!model.is_calibrated());
+	REQUIRE(!model.calibrate(std::vector<GridcellTiming>()));
+	REQUIRE(model.cost(100) == Approx(100));
+
+	// Timings following 2 s + 0.001 s per patch-year exactly
+	std::vector<GridcellTiming> timings;
+	for (int patches = 5; patches <= 50; patches += 5) {
+		timings.push_back(make_timing(2 + 0.001 * patches * 1000, patches, 1000));
+	}
+
+	REQUIRE(model.calibrate(timings));
+	REQUIRE(model.is_calibrated());
+	REQUIRE(model.get_overhead() == Approx(2));
+	REQUIRE(model.get_per_work() == Approx(0.001));
+
+	// All grid cells with the same work, no way to tell the overhead
+	timings.clear();
+	timings.push_back(make_timing(9, 10, 300));
+	timings.push_back(make_timing(11, 10, 300));
+
+	REQUIRE(model.calibrate(timings));
+	REQUIRE(model.get_overhead() == 0);
+	REQUIRE(model.cost(3000) == Approx(10));
+}
+
+TEST_CASE("costmodel/partition", "Cost-balanced partitioning") {
+
+	// Fewer items than parts, every item in its own part
+	std::vector<double> costs(3, 1.0);
+	std::vector<int> parts = partition_by_cost(costs, 5);
+	REQUIRE(parts.size() == 3);
+	REQUIRE(parts[0] != parts[1]);
+	REQUIRE(parts[1] != parts[2]);
+	REQUIRE(parts[0] != parts[2]);
+
+	// A few expensive grid cells (many landforms) at the end of the gridlist,
+	// where a split into equally long parts puts them all in the last part
+	costs.clear();
+	for (int i = 0; i < 100; i++) {
+		costs.push_back(i < 90 ? 1.0 : 20.0);
+	}
+
+	const int nparts = 7;
+	parts = partition_by_cost(costs, nparts);
+
+	std::vector<double> totals(nparts, 0.0);
+	for (size_t i = 0; i < costs.size(); i++) {
+		REQUIRE(parts[i] >= 0);
+		REQUIRE(parts[i] < nparts);
+		totals[parts[i]] += costs[i];
+	}
+
+	// 290 in total, which can be split within one cheap grid cell
+	const double max_total = *std::max_element(totals.begin(), totals.end());
+	const double min_total = *std::min_element(totals.begin(), totals.end());
+	const double spread = max_total - min_total;
+	REQUIRE(spread <= 1.0 + 1e-9);
+}
@@ -0,0 +1,109 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file forcingcache_test.cpp
+/// \brief Unit tests for the forcing cache
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "forcingcache.h"
+#include <stdio.h>
+#include <vector>
+
+TEST_CASE("ForcingCache", "Tests writing and reading a forcing cache") {
+
+	const char* filename = "forcingcache_test.bin";
+
+	// Stands in for a NetCDF file, only its modification time and size are used
+	const char* source = "forcingcache_test.nc";
+	FILE* file = fopen(source, "w");
+	REQUIRE(file);
+	fputs("temperature", file);
+	fclose(file);
+
+	std::vector<ForcingCache::Variable> variables(2);
+	variables[0].file = source;
+	variables[0].variable = "tas";
+	variables[0].location_size = 3;
+	REQUIRE(ForcingCache::get_file_stamp(source, variables[0].file_mtime, variables[0].file_size));
+	REQUIRE(variables[0].file_size == 11);
+	variables[1].file = "ndep.nc";
+	variables[1].variable = "NHxDry";
+	variables[1].location_size = 5;
+
+	std::vector<double> temp1(3), temp2(3), ndep1(5), ndep2(5);
+	for (int i = 0; i < 3; i++) {
+		temp1[i] = i;
+		temp2[i] = -i - 0.5;
+	}
+	for (int i = 0; i < 5; i++) {
+		ndep1[i] = 100 + i;
+		ndep2[i] = 1e-9 * i;
+	}
+
+	{
+		ForcingCacheWriter writer(filename, variables);
+
+		std::vector<const double*> data(2);
+		data[0] = &temp1.front();
+		data[1] = &ndep1.front();
+		writer.add_location(10, 20, data);
+
+		writer.add_missing_location(11, 20);
+
+		data[0] = &temp2.front();
+		data[1] = &ndep2.front();
+		writer.add_location(-3, 0, data);
+
+		writer.close();
+	}
+
+	{
+		ForcingCache cache(filename);
+
+		REQUIRE(cache.get_variables().size() == 2);
+		REQUIRE(cache.get_variables()[1].file == "ndep.nc");
+		REQUIRE(cache.get_variables()[1].variable == "NHxDry");
+		REQUIRE(cache.get_variables()[1].location_size == 5);
+
+		REQUIRE(cache.find_variable(source, "tas") == 0);
+		REQUIRE(cache.find_variable("ndep.nc", "NHxDry") == 1);
+		REQUIRE(cache.find_variable("ndep.nc", "tas") == -1);
+
+		REQUIRE(cache.get_variables()[0].file_mtime == variables[0].file_mtime);
+		REQUIRE(cache.get_variables()[0].file_size == 11);
+		REQUIRE(cache.is_up_to_date(0));
+
+		// ndep.nc doesn't exist
+		REQUIRE(!cache.is_up_to_date(1));
+
+		REQUIRE(cache.get_locations() == 3);
+		REQUIRE(cache.has_data(10, 20));
+		REQUIRE(!cache.has_data(11, 20));
+		REQUIRE(!cache.has_data(20, 10));
+		REQUIRE(cache.get_data(11, 20, 0) == 0);
+
+		REQUIRE(std::vector<double>(cache.get_data(10, 20, 0), cache.get_data(10, 20, 0) + 3) == temp1);
+		REQUIRE(std::vector<double>(cache.get_data(10, 20, 1), cache.get_data(10, 20, 1) + 5) == ndep1);
+		REQUIRE(std::vector<double>(cache.get_data(-3, 0, 0), cache.get_data(-3, 0, 0) + 3) == temp2);
+		REQUIRE(std::vector<double>(cache.get_data(-3, 0, 1), cache.get_data(-3, 0, 1) + 5) == ndep2);
+
+		// The cache is out of date once the source changes
+		file = fopen(source, "a");
+		REQUIRE(file);
+		fputs(" and more", file);
+		fclose(file);
+		REQUIRE(!cache.is_up_to_date(0));
+	}
+
+	remove(filename);
+	remove(source);
+}
@@ -0,0 +1,106 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file gridlistorder_test.cpp
+/// \brief Unit tests for the gridlist orders
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "gridlistorder.h"
+#include <algorithm>
+#include <stdlib.h>
+
+namespace {
+
+typedef std::vector<std::pair<int, int> > Points;
+
+/// All points in a square with side n, starting at (x0,y0), row by row
+Points square(int n, int x0, int y0) {
+	Points points;
+	for (int y = 0; y < n; y++) {
+		for (int x = 0; x < n; x++) {
+			points.push_back(std::make_pair(x0 + x, y0 + y));
+		}
+	}
+	return points;
+}
+
+bool is_permutation(const std::vector<int>& order, size_t n) {
+	std::vector<int> sorted(order);
+	std::sort(sorted.begin(), sorted.end());
+	for (size_t i = 0; i < sorted.size(); i++) {
+		if (sorted[i] != (int)i) {
+			return false;
+		}
+	}
+	return sorted.size() == n;
+}
+
+}
+
+TEST_CASE("GridlistOrder/hilbert", "Tests ordering along a Hilbert curve") {
+
+	// In a full square, each point along the curve is next to the previous one
+	Points rows = square(8, -3, 100);
+	Points points;
+	for (size_t i = 0; i < rows.size(); i++) {
+		points.push_back(rows[(i * 37) % rows.size()]);
+	}
+
+	std::vector<int> order = GridlistOrder::hilbert_order(points);
+	REQUIRE(is_permutation(order, points.size()));
+
+	for (size_t i = 1; i < order.size(); i++) {
+		const std::pair<int, int>& a = points[order[i-1]];
+		const std::pair<int, int>& b = points[order[i]];
+		const int distance = abs(a.first - b.first) + abs(a.second - b.second);
+		REQUIRE(distance == 1);
+	}
+
+	// The curve starts and ends in corners on the same side
+	REQUIRE(points[order.front()] == std::make_pair(-3, 100));
+	REQUIRE(points[order.back()] == std::make_pair(4, 100));
+
+	// Duplicates keep their order
+	Points duplicates;
+	duplicates.push_back(std::make_pair(1, 1));
+	duplicates.push_back(std::make_pair(0, 0));
+	duplicates.push_back(std::make_pair(1, 1));
+	order = GridlistOrder::hilbert_order(duplicates);
+	REQUIRE(order.size() == 3);
+	REQUIRE(order[0] == 1);
+	REQUIRE(order[1] == 0);
+	REQUIRE(order[2] == 2);
+}
+
+TEST_CASE("GridlistOrder/morton", "Tests ordering along a Morton curve") {
+
+	Points points = square(4, 10, 20);
+
+	std::vector<int> order = GridlistOrder::morton_order(points);
+	REQUIRE(is_permutation(order, points.size()));
+
+	// The first quadrant is done before moving on to the next
+	const int expected[] = { 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15 };
+	for (size_t i = 0; i < order.size(); i++) {
+		REQUIRE(order[i] == expected[i]);
+	}
+}
+
+TEST_CASE("GridlistOrder/simulation_order", "Tests choosing the order from the parameter") {
+
+	Points points = square(2, 0, 0);
+
+	REQUIRE(GridlistOrder::simulation_order("file", points).empty());
+	REQUIRE(GridlistOrder::simulation_order("hilbert", points) == GridlistOrder::hilbert_order(points));
+	REQUIRE(GridlistOrder::simulation_order("morton", points) == GridlistOrder::morton_order(points));
+	REQUIRE(GridlistOrder::simulation_order("hilbert", Points()).empty());
+}
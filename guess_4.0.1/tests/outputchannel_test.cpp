@@ -0,0 +1,273 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file outputchannel_test.cpp
+/// \brief Unit tests for the output channels in outputchannel.h
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "outputchannel.h"
+#include <limits>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+using namespace GuessOutput;
+
+namespace {
+
+/// Output channel which prints the rows to a string, used to check the output
+class StringOutputChannel : public OutputChannel {
+public:
+	void finish_row(const Table& table, double lon, double lat, int year) {
+		print_row(table, lon, lat, year, -1, -1, -1);
+	}
+
+	void finish_row(const Table& table, double lon, double lat, int year, int day) {
+		print_row(table, lon, lat, year, day, -1, -1);
+	}
+
+	void finish_row(const Table& table, double lon, double lat, int year, int day, int stand) {
+		print_row(table, lon, lat, year, day, stand, -1);
+	}
+
+	void finish_row(const Table& table, double lon, double lat, int year, int day, int stand, int patch) {
+		print_row(table, lon, lat, year, day, stand, patch);
+	}
+
+	void close_table(Table& table) {}
+
+	std::ostringstream os;
+
+private:
+	void print_row(const Table& table, double lon, double lat, int year, int day, int stand, int patch) {
+		os << table.id() << ':' << lon << ',' << lat << ',' << year << ',' << day << ',' << stand << ',' << patch;
+
+		const std::vector<double> row = get_current_row(table);
+		for (size_t i = 0; i < row.size(); i++) {
+			os << ' ' << row[i];
+		}
+		os << ';';
+
+		clear_current_row(table);
+	}
+};
+
+/// Writes a few rows to two tables in a FileOutputChannel
+void write_rows(FileOutputChannel& channel, Table& first, Table& second, int years) {
+	for (int year = 0; year < years; year++) {
+		OutputRows out(&channel, 12.25, -3.5, year);
+		out.add_value(first, year * 0.001);
+		out.add_value(first, -1e6 / (year + 1));
+		out.add_value(second, year);
+	}
+}
+
+/// Reads a whole file into a string
+std::string read_file(const char* filename) {
+	std::ifstream ifs(filename, std::ios::binary);
+	std::ostringstream os;
+	os << ifs.rdbuf();
+	return os.str();
+}
+
+/// Formats a value with snprintf, which format_fixed should agree with
+std::string printf_fixed(double value, int width, int precision) {
+	char format[32], buf[512];
+	snprintf(format, sizeof(format), "%%%d.%df", width, precision);
+	snprintf(buf, sizeof(buf), format, value);
+	return buf;
+}
+
+}
+
+TEST_CASE("format_fixed", "Tests that format_fixed formats numbers like printf") {
+	const double values[] = {
+		0, -0.0, 1, -1, 0.5, 1.5, 2.5, -2.5, 0.125, 0.0625, 1e-20, -1e-20, -0.0004,
+		0.0005, 0.00049999999999999999, 123456.789, 999.9995, 9.9999999, 1e15, -1e15,
+		4503599627370495.0, 4503599627370497.0, 1e22, 1.7976931348623157e308, 0.1, 0.3,
+		std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+		std::numeric_limits<double>::quiet_NaN()
+	};
+
+	for (size_t i = 0; i < sizeof(values)/sizeof(values[0]); i++) {
+		for (int precision = 0; precision <= 17; precision++) {
+			std::string formatted;
+			format_fixed(formatted, values[i], 8, precision);
+			INFO(values[i] << " " << precision);
+			REQUIRE(formatted == printf_fixed(values[i], 8, precision));
+		}
+	}
+
+	// Random values of all magnitudes, and values close to ties
+	srand(1);
+	for (int i = 0; i < 100000; i++) {
+		const double mantissa = (double)rand() / RAND_MAX - 0.5;
+		const int exponent = rand() % 30 - 15;
+		const int precision = rand() % 10;
+
+		double value = mantissa * pow(10.0, exponent);
+		if (i % 2) {
+			value = (floor(value * pow(10.0, precision)) + 0.5) / pow(10.0, precision);
+		}
+
+		const int width = rand() % 15;
+
+		// only REQUIRE on failure, to keep the number of assertions down
+		std::string formatted;
+		format_fixed(formatted, value, width, precision);
+		if (formatted != printf_fixed(value, width, precision)) {
+			INFO(value << " " << precision);
+			REQUIRE(formatted == printf_fixed(value, width, precision));
+		}
+	}
+}
+
+TEST_CASE("FileOutputChannel", "Tests that buffered output gives the same files") {
+	ColumnDescriptors first_columns;
+	first_columns += ColumnDescriptor("small", 8, 3);
+	first_columns += ColumnDescriptor("large", 12, 1);
+
+	ColumnDescriptors second_columns;
+	second_columns += ColumnDescriptor("year", 6, 0);
+
+	std::string expected_first, expected_second;
+
+	{
+		FileOutputChannel channel("", 2);
+		Table first = channel.create_table(TableDescriptor("outputchannel_test_1.out", first_columns));
+		Table second = channel.create_table(TableDescriptor("outputchannel_test_2.out", second_columns));
+
+		write_rows(channel, first, second, 1000);
+
+		// Each row is written directly
+		REQUIRE(read_file("outputchannel_test_2.out").size() == 1001 * 33);
+
+		channel.close_table(first);
+		channel.close_table(second);
+	}
+
+	expected_first = read_file("outputchannel_test_1.out");
+	expected_second = read_file("outputchannel_test_2.out");
+
+	SECTION("closed", "Buffered output is written when the tables are closed") {
+		FileOutputChannel channel("", 2, 100);
+		Table first = channel.create_table(TableDescriptor("outputchannel_test_1.out", first_columns));
+		Table second = channel.create_table(TableDescriptor("outputchannel_test_2.out", second_columns));
+
+		write_rows(channel, first, second, 1000);
+		channel.close_table(first);
+		channel.close_table(second);
+
+		REQUIRE(read_file("outputchannel_test_1.out") == expected_first);
+		REQUIRE(read_file("outputchannel_test_2.out") == expected_second);
+	}
+
+	SECTION("destroyed", "Buffered output is written when the channel is destroyed") {
+		{
+			FileOutputChannel channel("", 2, 1 << 20);
+			Table first = channel.create_table(TableDescriptor("outputchannel_test_1.out", first_columns));
+			Table second = channel.create_table(TableDescriptor("outputchannel_test_2.out", second_columns));
+
+			write_rows(channel, first, second, 1000);
+		}
+
+		REQUIRE(read_file("outputchannel_test_1.out") == expected_first);
+		REQUIRE(read_file("outputchannel_test_2.out") == expected_second);
+	}
+
+	SECTION("gridcell", "Buffered output is written when a grid cell is finished") {
+		FileOutputChannel channel("", 2, 1 << 20, true);
+		Table first = channel.create_table(TableDescriptor("outputchannel_test_1.out", first_columns));
+		Table second = channel.create_table(TableDescriptor("outputchannel_test_2.out", second_columns));
+
+		write_rows(channel, first, second, 1000);
+		REQUIRE(read_file("outputchannel_test_2.out") == "");
+
+		channel.gridcell_finished();
+		REQUIRE(read_file("outputchannel_test_1.out") == expected_first);
+		REQUIRE(read_file("outputchannel_test_2.out") == expected_second);
+
+		channel.close_table(first);
+		channel.close_table(second);
+	}
+
+	remove("outputchannel_test_1.out");
+	remove("outputchannel_test_2.out");
+}
+
+TEST_CASE("RowBufferOutputChannel", "Tests for RowBufferOutputChannel") {
+	StringOutputChannel target;
+
+	ColumnDescriptors columns;
+	columns += ColumnDescriptor("a", 8, 3);
+	columns += ColumnDescriptor("b", 8, 3);
+
+	Table first = target.create_table(TableDescriptor("first", columns));
+	Table second = target.create_table(TableDescriptor("second", columns));
+
+	// Rows written directly to the target
+	std::ostringstream expected;
+	{
+		OutputRows out(&target, 1, 2, 3);
+		out.add_value(second, 4);
+		out.add_value(second, 5);
+		out.add_value(first, 6);
+		out.add_value(first, 7);
+		out.add_value(Table(), 8);
+	}
+	{
+		OutputRows out(&target, 1, 2, 3, 9);
+		out.add_value(first, 10);
+		out.add_value(first, 11);
+	}
+	{
+		OutputRows out(&target, 1, 2, 3, -1, 12, 13);
+		out.add_value(second, 14);
+		out.add_value(second, 15);
+	}
+	expected << target.os.str();
+	target.os.str("");
+
+	// Same rows through the buffer
+	RowBufferOutputChannel buffer(&target);
+	{
+		OutputRows out(&buffer, 1, 2, 3);
+		out.add_value(second, 4);
+		out.add_value(second, 5);
+		out.add_value(first, 6);
+		out.add_value(first, 7);
+		out.add_value(Table(), 8);
+	}
+	{
+		OutputRows out(&buffer, 1, 2, 3, 9);
+		out.add_value(first, 10);
+		out.add_value(first, 11);
+	}
+	{
+		OutputRows out(&buffer, 1, 2, 3, -1, 12, 13);
+		out.add_value(second, 14);
+		out.add_value(second, 15);
+	}
+
+	// Nothing reaches the target until the buffer is flushed
+	REQUIRE(target.os.str() == "");
+
+	buffer.flush();
+	REQUIRE(target.os.str() == expected.str());
+
+	// The buffer is empty after flushing
+	target.os.str("");
+	buffer.flush();
+	REQUIRE(target.os.str() == "");
+}
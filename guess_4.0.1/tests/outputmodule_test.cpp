@@ -0,0 +1,91 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file outputmodule_test.cpp
+/// \brief Unit tests for OutputSchedule and TableSelection
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "guess.h"
+#include "outputmodule.h"
+
+using GuessOutput::OutputSchedule;
+using GuessOutput::TableSelection;
+
+namespace {
+
+/// Returns the years (counted like date.year) in which schedule is active
+std::vector<int> active_years(const OutputSchedule& schedule, int first_calendar_year, int nyears) {
+	Date d;
+	d.init(nyears);
+	d.set_first_calendar_year(first_calendar_year);
+
+	std::vector<int> years;
+	for (int year = 0; year < nyears; year++) {
+		if (schedule.active(d)) {
+			years.push_back(year);
+		}
+		for (int day = 0; day < Date::MAX_YEAR_LENGTH; day++) {
+			d.next();
+		}
+	}
+	return years;
+}
+
+}
+
+TEST_CASE("OutputSchedule", "Tests for OutputSchedule") {
+
+	// every year by default
+	REQUIRE(active_years(OutputSchedule(), 1900, 5).size() == 5);
+
+	// from the fourth year
+	std::vector<int> years = active_years(OutputSchedule(3), 1900, 5);
+	REQUIRE(years.size() == 2);
+	REQUIRE(years[0] == 3);
+	REQUIRE(years[1] == 4);
+
+	// calendar years divisible by 5 from the third year (1902), 1905 and 1910
+	years = active_years(OutputSchedule(2, 5), 1900, 12);
+	REQUIRE(years.size() == 2);
+	REQUIRE(years[0] == 5);
+	REQUIRE(years[1] == 10);
+}
+
+TEST_CASE("TableSelection", "Tests for TableSelection") {
+
+	SECTION("empty", "An empty list selects all tables") {
+		TableSelection all;
+		REQUIRE(all.selected("cmass.out"));
+		REQUIRE(!all.selected(""));
+		REQUIRE(all.unmatched().empty());
+	}
+
+	SECTION("list", "Names with or without extension, separated by spaces or commas") {
+		TableSelection some(" cmass.out,anpp\tmlai.out , extra ");
+
+		REQUIRE(some.selected("cmass.out"));
+		REQUIRE(some.selected("anpp.out"));
+		REQUIRE(some.selected("mlai.out"));
+		REQUIRE(!some.selected("lai.out"));
+		REQUIRE(!some.selected(""));
+
+		std::vector<std::string> unmatched = some.unmatched();
+		REQUIRE(unmatched.size() == 1);
+		REQUIRE(unmatched[0] == "extra");
+	}
+
+	SECTION("directories", "Directories are ignored") {
+		TableSelection some("out/cmass.out");
+		REQUIRE(some.selected("cmass.out"));
+		REQUIRE(some.selected("run1/cmass.out"));
+	}
+}
@@ -0,0 +1,45 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file parallel_test.cpp
+/// \brief Unit tests for the parallel module
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "parallel.h"
+
+TEST_CASE("GuessParallel/gridcell_batch_size", "Tests for gridcell_batch_size") {
+
+	// Nothing left to hand out
+	REQUIRE(GuessParallel::gridcell_batch_size(0, 14) == 0);
+
+	// Large batches early on, single grid cells at the end
+	REQUIRE(GuessParallel::gridcell_batch_size(5600, 14) == 100);
+	REQUIRE(GuessParallel::gridcell_batch_size(56, 14) == 1);
+	REQUIRE(GuessParallel::gridcell_batch_size(1, 14) == 1);
+
+	// Handing out batches until the gridlist is exhausted covers
+	// every grid cell exactly once, and the last batches are single cells
+	for (int ngridcells = 0; ngridcells < 500; ngridcells += 7) {
+		int next = 0;
+		int last_batch = 0;
+		int batch;
+		while ((batch = GuessParallel::gridcell_batch_size(ngridcells - next, 3)) > 0) {
+			REQUIRE(batch <= ngridcells - next);
+			next += batch;
+			last_batch = batch;
+		}
+		REQUIRE(next == ngridcells);
+		if (ngridcells > 0) {
+			REQUIRE(last_batch == 1);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file perthread_test.cpp
+/// \brief Unit tests for PerThread
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "perthread.h"
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Counter {
+	Counter() : value(0) {}
+	int value;
+};
+
+}
+
+TEST_CASE("PerThread", "Tests for PerThread") {
+
+	PerThread<Counter> counters;
+
+	// The same thread always gets the same object
+	counters.get().value = 1;
+	REQUIRE(&counters.get() == &counters.get());
+	REQUIRE(counters.get().value == 1);
+
+	// A second object has objects of its own
+	PerThread<Counter> others;
+	REQUIRE(others.get().value == 0);
+	REQUIRE(counters.get().value == 1);
+
+	// Other threads get objects of their own
+	const int nthreads = 4;
+	std::vector<Counter*> objects(nthreads);
+	std::vector<int> values(nthreads);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < nthreads; i++) {
+		threads.push_back(std::thread([&, i]() {
+			for (int j = 0; j < 1000; j++) {
+				counters.get().value++;
+				others.get().value--;
+			}
+			objects[i] = &counters.get();
+			values[i] = counters.get().value;
+		}));
+	}
+	for (int i = 0; i < nthreads; i++) {
+		threads[i].join();
+	}
+
+	for (int i = 0; i < nthreads; i++) {
+		REQUIRE(values[i] == 1000);
+		REQUIRE(objects[i] != &counters.get());
+		for (int j = i + 1; j < nthreads; j++) {
+			REQUIRE(objects[i] != objects[j]);
+		}
+	}
+	REQUIRE(counters.get().value == 1);
+	REQUIRE(others.get().value == 0);
+}
@@ -0,0 +1,58 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file profiler_test.cpp
+/// \brief Unit tests for the profiler
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "profiler.h"
+#include <string>
+
+using namespace GuessProfiler;
+
+TEST_CASE("profiler", "Tests for the profiler") {
+
+	// Every stage has a name
+	for (int i = 0; i < NSTAGES; i++) {
+		REQUIRE(std::string(stage_name((Stage)i)) != "");
+	}
+
+	Profile profile;
+	REQUIRE(profile.seconds(FPAR) == 0);
+
+	profile.add(FPAR, std::chrono::milliseconds(1500));
+	profile.add(FPAR, std::chrono::milliseconds(500));
+	REQUIRE(profile.seconds(FPAR) == Approx(2.0));
+	REQUIRE(profile.seconds(NPP) == 0);
+
+	Profile total;
+	total.add(profile);
+	total.add(profile);
+	REQUIRE(total.seconds(FPAR) == Approx(4.0));
+
+	// Timers only count when there is a current profile
+	{
+		Timer timer(NPP);
+	}
+	REQUIRE(profile.seconds(NPP) == 0);
+
+	current_profile = &profile;
+	{
+		Timer timer(NPP);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(2)) {
+		}
+	}
+	current_profile = 0;
+
+	REQUIRE(profile.seconds(NPP) >= 0.002);
+}
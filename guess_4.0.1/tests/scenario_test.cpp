@@ -0,0 +1,64 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file scenario_test.cpp
+/// \brief Unit tests for the scenario parameters
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "parameters.h"
+#include <string>
+
+namespace {
+
+// Declared parameters stay declared, so the variables must outlive the test
+int test_int = 1;
+xtring test_xtring = "historic";
+
+}
+
+TEST_CASE("parameters/scenario", "Tests that ScenarioParameters sets and restores parameters") {
+
+	declare_parameter("scenario_test_int", &test_int, 0, 100);
+	declare_parameter("scenario_test_xtring", &test_xtring, 100);
+
+	test_int = 1;
+	test_xtring = "historic";
+	param.addparam("scenario_test_file", xtring("historic.txt"));
+
+	Scenario scenario;
+	scenario.name = "rcp45";
+	scenario.ints["scenario_test_int"] = 2;
+	scenario.xtrings["scenario_test_xtring"] = "rcp45";
+	scenario.param.addparam("scenario_test_file", xtring("rcp45.txt"));
+	scenario.param.addparam("scenario_test_extra", 3.0);
+
+	{
+		ScenarioParameters parameters(scenario);
+
+		REQUIRE(test_int == 2);
+		REQUIRE(std::string(test_xtring) == "rcp45");
+
+		// A module created now gets the scenario's values
+		int module_int = 0;
+		declare_parameter("scenario_test_int", &module_int, 0, 100);
+		REQUIRE(module_int == 2);
+
+		REQUIRE(std::string(param["scenario_test_file"].str) == "rcp45.txt");
+		REQUIRE(param["scenario_test_extra"].num == 3.0);
+	}
+
+	REQUIRE(test_int == 1);
+	REQUIRE(std::string(test_xtring) == "historic");
+
+	REQUIRE(std::string(param["scenario_test_file"].str) == "historic.txt");
+	REQUIRE(!param.isparam("scenario_test_extra"));
+}
@@ -0,0 +1,137 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file somdynam_test.cpp
+/// \brief Unit tests for the CENTURY SOM dynamics
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "somdynam.h"
+#include "driver.h"
+#include <math.h>
+
+namespace {
+
+/// Saved years of litter input and decay rates for equilsom()
+const int NYEAR = 3;
+
+/// Gives a soil the data equilsom() saves during the spinup
+/** Seasonal litter input and decay rates, roughly as for a temperate forest,
+ *  varying a bit between the saved years.
+ */
+void save_equilsom_data(Soil& soil) {
+
+	// Maximum annual decay rates (as in decayrates)
+	double k_max[NSOMPOOL];
+	k_max[SURFSTRUCT] = 3.9;
+	k_max[SURFMETA] = 14.8;
+	k_max[SOILSTRUCT] = 4.9;
+	k_max[SOILMETA] = 18.5;
+	k_max[SURFFWD] = 1.5;
+	k_max[SURFCWD] = 0.2;
+	k_max[SURFMICRO] = 6.0;
+	k_max[SOILMICRO] = 7.3;
+	k_max[SURFHUMUS] = 0.2;
+	k_max[SLOWSOM] = 0.2;
+	k_max[PASSIVESOM] = 0.0045;
+
+	soil.solvesomcent_beginyr = 0;
+	soil.solvesomcent_endyr = NYEAR - 1;
+	soil.solvesom.resize(NYEAR * 12);
+
+	soil.sompool[SURFSTRUCT].ligcfrac = 0.2;
+	soil.sompool[SOILSTRUCT].ligcfrac = 0.2;
+	soil.sompool[SURFFWD].ligcfrac = 0.25;
+	soil.sompool[SURFCWD].ligcfrac = 0.3;
+
+	for (int y = 0; y < NYEAR; y++) {
+		for (int m = 0; m < 12; m++) {
+
+			// Temperature and moisture response, highest in July
+			const double response = 0.2 + 0.8 * (0.5 - 0.5 * cos((m + 0.5) * PI / 6)) * (1 + 0.1 * y) / 1.2;
+
+			for (int p = 0; p < NSOMPOOL-1; p++) {
+				soil.sompool[p].mfracremain_mean[m] += exp(-k_max[p] * response / 365);
+			}
+
+			soil.fnuptake_mean[m] += 0.1 + 0.4 * response;
+			soil.mminleach_mean[m] += 0.01;
+			soil.morgleach_mean[m] += 0.001;
+
+			// Leaf and fine root litter in autumn, woody litter all year
+			LitterSolveSOM& litter = soil.solvesom[y * 12 + m];
+			const double leaves = m == 9 ? 0.15 + 0.02 * y : 0.0;
+			litter.add_litter(0.6 * leaves, 0.6 * leaves / 60, SURFSTRUCT);
+			litter.add_litter(0.4 * leaves, 0.4 * leaves / 30, SURFMETA);
+			litter.add_litter(0.5 * leaves, 0.5 * leaves / 60, SOILSTRUCT);
+			litter.add_litter(0.3 * leaves, 0.3 * leaves / 30, SOILMETA);
+			litter.add_litter(0.005, 0.005 / 200, SURFFWD);
+			litter.add_litter(0.01, 0.01 / 300, SURFCWD);
+		}
+	}
+
+	soil.anfix_mean = NYEAR * 0.0005;
+}
+
+/// Creates a stand with one patch and medium textured soil, returns its soil
+Soil& create_soil(Gridcell& gridcell) {
+
+	soilparameters(gridcell.soiltype, 2);
+	gridcell.climate.andep = 0.001;
+
+	Stand& stand = gridcell.create_stand(NATURAL, 1);
+	stand.local_climate.andep = gridcell.climate.andep;
+
+	Soil& soil = stand[0].soil;
+	save_equilsom_data(soil);
+
+	return soil;
+}
+
+}
+
+TEST_CASE("somdynam/equilsom", "Tests that the analytic solution of the SOM pools agrees with the spin") {
+
+	// Parameters used by equilsom and somfluxes, with nitrogen limitation
+	const bool saved_ifnlim = ifnlim;
+	const int saved_freenyears = freenyears;
+	const equilsomtype saved_method = equilsom_method;
+
+	ifnlim = true;
+	freenyears = date.year - 1;
+
+	Gridcell spin_gridcell;
+	Soil& spin = create_soil(spin_gridcell);
+
+	Gridcell analytic_gridcell;
+	Soil& analytic = create_soil(analytic_gridcell);
+
+	equilsom_method = EQUILSOM_SPIN;
+	equilsom(spin);
+
+	equilsom_method = EQUILSOM_ANALYTIC;
+	equilsom(analytic);
+
+	ifnlim = saved_ifnlim;
+	freenyears = saved_freenyears;
+	equilsom_method = saved_method;
+
+	REQUIRE(spin.sompool[PASSIVESOM].cmass > 0.1);
+
+	for (int p = 0; p < NSOMPOOL-1; p++) {
+		REQUIRE(analytic.sompool[p].cmass == Approx(spin.sompool[p].cmass).epsilon(1e-4));
+		REQUIRE(analytic.sompool[p].nmass == Approx(spin.sompool[p].nmass).epsilon(1e-4));
+	}
+
+	// Saved data is reset by both
+	REQUIRE(analytic.solvesom.empty());
+	REQUIRE(analytic.anfix_mean == 0.0);
+}
@@ -0,0 +1,43 @@
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// \file workerpool_test.cpp
+/// \brief Unit tests for WorkerPool
+///
+/// $Date$
+///
+///////////////////////////////////////////////////////////////////////////////////////
+
+#include "config.h"
+#include "catch.hpp"
+
+#include "workerpool.h"
+
+TEST_CASE("WorkerPool", "Tests for WorkerPool") {
+
+	for (int nthreads = 1; nthreads <= 4; nthreads++) {
+		WorkerPool pool(nthreads);
+		REQUIRE(pool.size() == nthreads);
+
+		// Run many short loops of different lengths, each iteration
+		// should be run exactly once
+		bool all_ok = true;
+		for (int n = 0; n < 50; n++) {
+			std::vector<int> calls(n, 0);
+
+			pool.run(n, [&calls](int i) {
+				calls[i]++;
+			});
+
+			for (int i = 0; i < n; i++) {
+				if (calls[i] != 1) {
+					all_ok = false;
+				}
+			}
+		}
+		REQUIRE(all_ok);
+	}
+}